@@ -11,9 +11,14 @@
 #include "td/utils/benchmark.h"
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
+#include "td/utils/Heap.h"
 #include "td/utils/logging.h"
 #include "td/utils/Promise.h"
+#include "td/utils/Random.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/TimerWheel.h"
+
+#include <set>
 
 #if TD_MSVC
 #pragma comment(linker, "/STACK:16777216")
@@ -324,9 +329,130 @@ class QueryBench final : public td::Benchmark {
   td::ActorOwn<ServerActor> server_;
 };
 
+// storage of MultiTimeout before it was switched to TimerWheel
+class HeapTimeouts {
+  struct Item final : public td::HeapNode {
+    td::int64 key;
+
+    explicit Item(td::int64 key) : key(key) {
+    }
+
+    bool operator<(const Item &other) const {
+      return key < other.key;
+    }
+  };
+
+  td::KHeap<double> timeout_queue_;
+  std::set<Item> items_;
+
+ public:
+  static const char *get_name() {
+    return "KHeap";
+  }
+
+  void set_timeout(td::int64 key, double timeout) {
+    auto item = items_.emplace(key);
+    auto heap_node = static_cast<td::HeapNode *>(const_cast<Item *>(&*item.first));
+    if (heap_node->in_heap()) {
+      timeout_queue_.fix(timeout, heap_node);
+    } else {
+      timeout_queue_.insert(timeout, heap_node);
+    }
+  }
+
+  void cancel_timeout(td::int64 key) {
+    auto item = items_.find(Item(key));
+    if (item != items_.end()) {
+      timeout_queue_.erase(static_cast<td::HeapNode *>(const_cast<Item *>(&*item)));
+      items_.erase(item);
+    }
+  }
+
+  double get_wakeup_time() const {
+    return timeout_queue_.empty() ? 1e100 : timeout_queue_.top_key();
+  }
+
+  size_t get_expired_key_count(double now) {
+    size_t result = 0;
+    while (!timeout_queue_.empty() && timeout_queue_.top_key() < now) {
+      items_.erase(Item(static_cast<Item *>(timeout_queue_.pop())->key));
+      result++;
+    }
+    return result;
+  }
+};
+
+class WheelTimeouts {
+  td::TimerWheel timer_wheel_;
+
+ public:
+  static const char *get_name() {
+    return "TimerWheel";
+  }
+
+  void set_timeout(td::int64 key, double timeout) {
+    timer_wheel_.set_timeout(key, timeout);
+  }
+
+  void cancel_timeout(td::int64 key) {
+    timer_wheel_.cancel_timeout(key);
+  }
+
+  double get_wakeup_time() const {
+    return timer_wheel_.empty() ? 1e100 : timer_wheel_.get_wakeup_time();
+  }
+
+  size_t get_expired_key_count(double now) {
+    return timer_wheel_.get_expired_keys(now).size();
+  }
+};
+
+// simulates self-destructing messages: every new message gets a TTL timeout, which is often changed or cancelled
+// before it expires, and expired timeouts are collected as the time goes
+template <class TimeoutsT>
+class MessageTtlBench final : public td::Benchmark {
+  static constexpr int MESSAGE_COUNT = 200000;
+
+ public:
+  td::string get_description() const final {
+    return PSTRING() << "MessageTtlBench: " << TimeoutsT::get_name();
+  }
+
+  void run(int n) final {
+    TimeoutsT timeouts;
+    double now = 1000.0;
+    td::int64 next_key = 1;
+    size_t expired_key_count = 0;
+    auto get_ttl = [] {
+      static const double ttls[] = {1.0, 5.0, 60.0, 3600.0, 86400.0};
+      return ttls[td::Random::fast(0, 4)] + td::Random::fast(0, 1000) * 0.001;
+    };
+    for (int i = 0; i < MESSAGE_COUNT; i++) {
+      timeouts.set_timeout(next_key++, now + get_ttl());
+    }
+    for (int i = 0; i < n; i++) {
+      now += 0.0001;
+      timeouts.set_timeout(next_key++, now + get_ttl());
+      auto key = next_key - td::Random::fast(1, MESSAGE_COUNT);
+      auto type = td::Random::fast(0, 9);
+      if (type < 3) {
+        timeouts.cancel_timeout(key);
+      } else if (type < 5) {
+        timeouts.set_timeout(key, now + get_ttl());
+      }
+      if (timeouts.get_wakeup_time() <= now) {
+        expired_key_count += timeouts.get_expired_key_count(now);
+      }
+    }
+    CHECK(expired_key_count <= static_cast<size_t>(n) + MESSAGE_COUNT);
+  }
+};
+
 int main() {
   td::init_openssl_threads();
 
+  bench(MessageTtlBench<HeapTimeouts>());
+  bench(MessageTtlBench<WheelTimeouts>());
   bench(CreateActorBench());
   bench(RingBench<4>(504, 0));
   bench(RingBench<3>(504, 0));
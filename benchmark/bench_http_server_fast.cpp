@@ -14,7 +14,9 @@
 
 #include "td/utils/buffer.h"
 #include "td/utils/BufferedFd.h"
+#include "td/utils/common.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/port/detail/PollableFd.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Slice.h"
@@ -82,32 +84,30 @@ class HttpEchoConnection final : public td::Actor {
   }
 };
 
-const int N = 8;
-class Server final : public td::TcpListener::Callback {
- public:
-  void start_up() final {
-    listener_ =
-        td::create_actor<td::TcpListener>("Listener", 8082, td::ActorOwn<td::TcpListener::Callback>(actor_id(this)));
+int main(int argc, char *argv[]) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  int thread_count = argc > 1 ? td::to_integer<int>(td::Slice(argv[1])) : 8;
+  if (thread_count < 0) {
+    thread_count = 0;
   }
-  void accept(td::SocketFd fd) final {
-    pos_++;
-    auto scheduler_id = pos_ % (N != 0 ? N : 1) + (N != 0);
-    td::create_actor_on_scheduler<HttpEchoConnection>("HttpEchoConnection", scheduler_id, std::move(fd)).release();
+  td::vector<td::int32> scheduler_ids;
+  for (int i = 0; i < thread_count; i++) {
+    scheduler_ids.push_back(i + 1);
   }
-  void hangup() final {
-    LOG(ERROR) << "Hanging up..";
-    stop();
+  if (scheduler_ids.empty()) {
+    scheduler_ids.push_back(0);
   }
 
- private:
-  td::ActorOwn<td::TcpListener> listener_;
-  int pos_{0};
-};
-
-int main() {
-  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
-  auto scheduler = td::make_unique<td::ConcurrentScheduler>(N, 0);
-  scheduler->create_actor_unsafe<Server>(0, "Server").release();
+  auto scheduler = td::make_unique<td::ConcurrentScheduler>(thread_count, 0);
+  // every connection is accepted and served by the same scheduler
+  scheduler
+      ->create_actor_unsafe<td::ShardedTcpListener>(0, "Server", 8082, std::move(scheduler_ids),
+                                                    [](td::SocketFd fd) {
+                                                      td::create_actor<HttpEchoConnection>("HttpEchoConnection",
+                                                                                           std::move(fd))
+                                                          .release();
+                                                    })
+      .release();
   scheduler->start();
   while (scheduler->run_main(10)) {
     // empty
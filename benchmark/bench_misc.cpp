@@ -11,6 +11,7 @@
 #include "td/utils/algorithm.h"
 #include "td/utils/benchmark.h"
 #include "td/utils/common.h"
+#include "td/utils/List.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/Clocks.h"
 #include "td/utils/port/EventFd.h"
@@ -22,6 +23,7 @@
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/SlidingWindowMap.h"
 #include "td/utils/StackAllocator.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
@@ -40,7 +42,10 @@
 #include <array>
 #include <atomic>
 #include <cstdint>
+#include <deque>
+#include <map>
 #include <set>
+#include <utility>
 
 class F {
   td::uint32 &sum;
@@ -698,6 +703,95 @@ class DuplicateCheckerBenchEvenOdd final : public td::Benchmark {
   }
 };
 
+struct SentQuery final : private td::ListNode {
+  td::uint64 container_message_id_;
+  bool is_acknowledged_ = false;
+
+  SentQuery(td::uint64 message_id, td::ListNode *list) : container_message_id_(message_id) {
+    list->put(static_cast<td::ListNode *>(this));
+  }
+};
+
+class SentQueriesStdMap {
+ public:
+  static td::string get_description() {
+    return "StdMap";
+  }
+  SentQuery *get(td::uint64 message_id) {
+    auto it = queries_.find(message_id);
+    return it == queries_.end() ? nullptr : &it->second;
+  }
+  void emplace(td::uint64 message_id, SentQuery &&query) {
+    queries_.emplace(message_id, std::move(query));
+  }
+  void erase(td::uint64 message_id) {
+    queries_.erase(message_id);
+  }
+
+ private:
+  std::map<td::uint64, SentQuery> queries_;
+};
+
+class SentQueriesSlidingWindowMap {
+ public:
+  static td::string get_description() {
+    return "SlidingWindowMap";
+  }
+  SentQuery *get(td::uint64 message_id) {
+    return queries_.get(message_id);
+  }
+  void emplace(td::uint64 message_id, SentQuery &&query) {
+    queries_.emplace(message_id, std::move(query));
+  }
+  void erase(td::uint64 message_id) {
+    queries_.erase(message_id);
+  }
+
+ private:
+  td::SlidingWindowMap<td::uint64, SentQuery> queries_;
+};
+
+// models Session::sent_queries_: a query is sent, a recent query is acknowledged and one of the oldest queries is
+// answered on each iteration
+template <class T>
+class SentQueriesBench final : public td::Benchmark {
+ public:
+  explicit SentQueriesBench(size_t in_flight_count) : in_flight_count_(in_flight_count) {
+  }
+
+ private:
+  size_t in_flight_count_;
+
+  td::string get_description() const final {
+    return PSTRING() << "SentQueriesBench" << T::get_description() << in_flight_count_;
+  }
+
+  void run(int n) final {
+    T queries;
+    td::ListNode list;
+    std::deque<td::uint64> message_ids;
+    td::uint64 message_id = static_cast<td::uint64>(1) << 62;
+    for (int i = 0; i < n; i++) {
+      message_id += 4 * td::Random::fast(1, 256);
+      queries.emplace(message_id, SentQuery(message_id, &list));
+      message_ids.push_back(message_id);
+
+      auto recent_count = static_cast<int>(td::min(message_ids.size(), static_cast<size_t>(16)));
+      auto query = queries.get(message_ids[message_ids.size() - 1 - td::Random::fast(0, recent_count - 1)]);
+      CHECK(query != nullptr);
+      query->is_acknowledged_ = true;
+
+      if (message_ids.size() > in_flight_count_) {
+        auto result_pos = static_cast<size_t>(td::Random::fast(0, 7));
+        std::swap(message_ids[0], message_ids[result_pos]);
+        CHECK(queries.get(message_ids[0]) != nullptr);
+        queries.erase(message_ids[0]);
+        message_ids.pop_front();
+      }
+    }
+  }
+};
+
 BENCH(AddToTopStd, "add_to_top std") {
   td::vector<int> v;
   for (int i = 0; i < n; i++) {
@@ -755,6 +849,11 @@ BENCH(AnyOfTd, "any_of td") {
 int main() {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(DEBUG));
 
+  for (size_t in_flight_count : {16, 256, 1024}) {
+    td::bench(SentQueriesBench<SentQueriesStdMap>(in_flight_count));
+    td::bench(SentQueriesBench<SentQueriesSlidingWindowMap>(in_flight_count));
+  }
+
   td::bench(AnyOfStdBench());
   td::bench(AnyOfTdBench());
 
@@ -0,0 +1,1018 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/mtproto/AuthData.h"
+#include "td/mtproto/AuthKey.h"
+#include "td/mtproto/DhCallback.h"
+#include "td/mtproto/DhHandshake.h"
+#include "td/mtproto/MessageId.h"
+#include "td/mtproto/mtproto_api.h"
+#include "td/mtproto/PacketInfo.h"
+#include "td/mtproto/PacketStorer.h"
+#include "td/mtproto/ProxySecret.h"
+#include "td/mtproto/RawConnection.h"
+#include "td/mtproto/SessionConnection.h"
+#include "td/mtproto/TcpTransport.h"
+#include "td/mtproto/Transport.h"
+#include "td/mtproto/TransportType.h"
+#include "td/mtproto/utils.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
+
+#include "td/utils/AesCtrByteFlow.h"
+#include "td/utils/algorithm.h"
+#include "td/utils/as.h"
+#include "td/utils/base64.h"
+#include "td/utils/buffer.h"
+#include "td/utils/BufferedFd.h"
+#include "td/utils/ByteFlow.h"
+#include "td/utils/common.h"
+#include "td/utils/crypto.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/format.h"
+#include "td/utils/Gzip.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/OptionParser.h"
+#include "td/utils/port/Clocks.h"
+#include "td/utils/port/detail/PollableFd.h"
+#include "td/utils/port/IPAddress.h"
+#include "td/utils/port/ServerSocketFd.h"
+#include "td/utils/port/SocketFd.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Status.h"
+#include "td/utils/StorerBase.h"
+#include "td/utils/Time.h"
+#include "td/utils/tl_parsers.h"
+#include "td/utils/UInt.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+
+// An in-process fake DC, which serves MTProto sessions over loopback TCP, and a benchmark of
+// SessionConnection, RawConnection and TCP transports connected to it.
+//
+// The fake DC supports plain intermediate and obfuscated TCP transports, acknowledgements, containers, gzip_packed,
+// invokeAfterMsg(s), pings and future salts, and can emulate network latency and bandwidth.
+// Auth keys are created before the benchmark by the same Diffie-Hellman exchange as the one used in handshakes,
+// but without RSA-encrypted steps, which would require a private key of the fake DC.
+
+static td::int32 g = 3;
+static td::string prime_base64 =
+    "xxyuucaxyQSObFIvcPE_c5gNQCOOPiHBSTTQN1Y9kw9IGYoKp8FAWCKUk9IlMPTb-jNvbgrJJROVQ67UTM58NyD9UfaUWHBaxozU_mtrE6vcl0ZRKW"
+    "kyhFTxj6-MWV9kJHf-lrsqlB1bzR1KyMxJiAcI-ps3jjxPOpBgvuZ8-aSkppWBEFGQfhYnU7VrD2tBDbp02KhLKhSzFE4O8ShHVP0X7ZUNWWW0ud1G"
+    "WC2xF40WnGvEZbDW_5yjko_vW5rk5Bj8Feg-vqD4f6n_Xu1wBQ3tKEn0e_lZ2VaFDOkphR8NgRX2NbEF7i5OFdBLJFS_b0-t8DSxBAMRnNjjuS_MW"
+    "w";
+
+// constructors of benchmark queries and their answers, which aren't used by the real API
+static constexpr td::int32 BENCH_QUERY_ID = 0x0be4c401;
+static constexpr td::int32 BENCH_ANSWER_ID = 0x0be4c402;
+
+static constexpr td::int32 MSG_CONTAINER_ID = 0x73f1f8dc;
+static constexpr td::int32 RPC_RESULT_ID = static_cast<td::int32>(0xf35c6d01);
+static constexpr td::int32 INVOKE_AFTER_MSG_ID = static_cast<td::int32>(0xcb9f372d);
+static constexpr td::int32 INVOKE_AFTER_MSGS_ID = 0x3dc4b4f0;
+
+struct BenchOptions {
+  int session_count = 16;
+  int thread_count = 2;
+  int query_count = 10000;
+  int max_in_flight_query_count = 32;
+  int query_size = 64;
+  int answer_size = 256;
+  bool use_gzip = false;
+  bool use_obfuscation = true;
+  double latency = 0.0;
+  double bandwidth = 0.0;
+  int port = 10443;
+};
+
+struct FakeDcOptions {
+  double latency = 0.0;    // added to delivery time of every answer, in seconds
+  double bandwidth = 0.0;  // bytes per second for every connection; 0 means unlimited
+  bool use_gzip = false;
+  std::map<td::uint64, td::mtproto::AuthKey> auth_keys;
+};
+
+static td::BufferSlice create_filler(td::int32 constructor_id, td::int32 value, size_t size) {
+  size = td::max(size, static_cast<size_t>(8));
+  size = (size + 3) & ~static_cast<size_t>(3);
+  td::BufferSlice result(size);
+  auto data = result.as_mutable_slice();
+  td::as<td::int32>(data.begin()) = constructor_id;
+  td::as<td::int32>(data.begin() + 4) = value;
+  // half-random data is compressed approximately twice like usual server responses
+  for (size_t i = 8; i < size; i++) {
+    data[i] = static_cast<char>('a' + td::Random::fast(0, 15));
+  }
+  return result;
+}
+
+class FakeDcPacketImpl {
+ public:
+  struct Message {
+    td::int64 message_id;
+    td::int32 seq_no;
+    td::BufferSlice body;
+  };
+
+  FakeDcPacketImpl(const td::vector<Message> &messages, td::int64 container_message_id, td::int32 container_seq_no)
+      : messages_(messages), container_message_id_(container_message_id), container_seq_no_(container_seq_no) {
+  }
+
+  template <class StorerT>
+  void do_store(StorerT &storer) const {
+    if (messages_.size() == 1) {
+      return store_message(storer, messages_[0]);
+    }
+    size_t container_size = 8;
+    for (auto &message : messages_) {
+      container_size += 16 + message.body.size();
+    }
+    storer.store_binary(container_message_id_);
+    storer.store_binary(container_seq_no_);
+    storer.store_binary(static_cast<td::int32>(container_size));
+    storer.store_binary(MSG_CONTAINER_ID);
+    storer.store_binary(static_cast<td::int32>(messages_.size()));
+    for (auto &message : messages_) {
+      store_message(storer, message);
+    }
+  }
+
+ private:
+  const td::vector<Message> &messages_;
+  td::int64 container_message_id_;
+  td::int32 container_seq_no_;
+
+  template <class StorerT>
+  static void store_message(StorerT &storer, const Message &message) {
+    storer.store_binary(message.message_id);
+    storer.store_binary(message.seq_no);
+    storer.store_binary(static_cast<td::int32>(message.body.size()));
+    storer.store_slice(message.body.as_slice());
+  }
+};
+
+class FakeDcConnection final : public td::Actor {
+ public:
+  FakeDcConnection(td::SocketFd socket_fd, std::shared_ptr<const FakeDcOptions> options)
+      : fd_(std::move(socket_fd)), options_(std::move(options)) {
+  }
+
+ private:
+  static constexpr size_t MAX_PACKET_SIZE = 1 << 20;
+
+  struct DelayedPacket {
+    double deliver_at;
+    td::BufferSlice packet;
+  };
+
+  td::BufferedFd<td::SocketFd> fd_;
+  std::shared_ptr<const FakeDcOptions> options_;
+
+  td::unique_ptr<td::mtproto::tcp::IntermediateTransport> transport_;
+  bool is_obfuscated_ = false;
+  td::AesCtrByteFlow aes_ctr_byte_flow_;
+  td::ByteFlowSink byte_flow_sink_;
+  td::AesCtrState output_state_;
+  td::ChainBufferReader *input_ = nullptr;
+
+  const td::mtproto::AuthKey *auth_key_ = nullptr;
+  td::uint64 session_id_ = 0;
+  td::uint64 salt_ = 0;
+  td::int64 first_message_id_ = 0;
+  td::uint64 last_message_id_ = 0;
+  td::int32 seq_no_ = 0;
+
+  td::vector<td::int64> to_ack_;
+  td::vector<std::pair<bool, td::BufferSlice>> answers_;
+
+  std::deque<DelayedPacket> delayed_packets_;
+  double link_free_at_ = 0.0;
+
+  void start_up() final {
+    td::Scheduler::subscribe(fd_.get_poll_info().extract_pollable_fd(this));
+  }
+
+  void tear_down() final {
+    td::Scheduler::unsubscribe_before_close(fd_.get_poll_info().get_pollable_fd_ref());
+    fd_.close();
+  }
+
+  void loop() final {
+    sync_with_poll(fd_);
+    auto status = [&] {
+      TRY_STATUS(fd_.flush_read());
+      TRY_STATUS(read_packets());
+      flush_delayed_packets();
+      TRY_STATUS(fd_.flush_write());
+      return td::Status::OK();
+    }();
+    if (status.is_error()) {
+      LOG(ERROR) << "Close connection: " << status;
+      return stop();
+    }
+    if (can_close_local(fd_)) {
+      return stop();
+    }
+  }
+
+  td::Result<bool> init_transport() {
+    auto &input = fd_.input_buffer();
+    if (input.size() < 4) {
+      return false;
+    }
+    td::uint32 magic;
+    input.clone().advance(4, td::MutableSlice(reinterpret_cast<char *>(&magic), sizeof(magic)));
+    if (magic == 0xeeeeeeee || magic == 0xdddddddd) {
+      input.advance(4);
+      transport_ = td::make_unique<td::mtproto::tcp::IntermediateTransport>(magic == 0xdddddddd);
+      input_ = &input;
+      return true;
+    }
+
+    const size_t header_size = 64;
+    if (input.size() < header_size) {
+      return false;
+    }
+    td::string header(header_size, '\0');
+    input.advance(header_size, header);
+
+    // the connection is from a direct client, so there is no proxy secret to mix into the keys
+    td::AesCtrState input_state;
+    input_state.init(td::Slice(header).substr(8, 32), td::Slice(header).substr(40, 16));
+    td::string decrypted_header(header_size, '\0');
+    input_state.encrypt(header, decrypted_header);
+    magic = td::as<td::uint32>(decrypted_header.data() + 56);
+    if (magic != 0xeeeeeeee && magic != 0xdddddddd) {
+      return td::Status::Error(PSLICE() << "Unsupported obfuscated transport " << td::format::as_hex(magic));
+    }
+
+    td::string reversed_header = header;
+    std::reverse(reversed_header.begin(), reversed_header.end());
+    output_state_.init(td::Slice(reversed_header).substr(8, 32), td::Slice(reversed_header).substr(40, 16));
+
+    aes_ctr_byte_flow_.init(std::move(input_state));
+    aes_ctr_byte_flow_.set_input(&input);
+    aes_ctr_byte_flow_ >> byte_flow_sink_;
+    is_obfuscated_ = true;
+    transport_ = td::make_unique<td::mtproto::tcp::IntermediateTransport>(magic == 0xdddddddd);
+    input_ = byte_flow_sink_.get_output();
+    return true;
+  }
+
+  td::Status read_packets() {
+    if (transport_ == nullptr) {
+      TRY_RESULT(is_inited, init_transport());
+      if (!is_inited) {
+        return td::Status::OK();
+      }
+    }
+    if (is_obfuscated_) {
+      aes_ctr_byte_flow_.wakeup();
+    }
+
+    while (true) {
+      td::BufferSlice packet;
+      td::uint32 quick_ack = 0;
+      if (transport_->read_from_stream(input_, &packet, &quick_ack) != 0) {
+        break;
+      }
+      if (packet.empty()) {
+        // the client has set the highest bit of the packet length to request a quick acknowledgement
+        return td::Status::Error("Quick acknowledgements aren't supported");
+      }
+      if (!td::is_aligned_pointer<4>(packet.as_slice().ubegin())) {
+        td::BufferSlice aligned_packet(packet.size());
+        aligned_packet.as_mutable_slice().copy_from(packet.as_slice());
+        packet = std::move(aligned_packet);
+      }
+      TRY_STATUS(on_packet(std::move(packet)));
+    }
+
+    send_answers();
+    return td::Status::OK();
+  }
+
+  td::Status on_packet(td::BufferSlice packet) {
+    TRY_RESULT(auth_key_id, td::mtproto::Transport::read_auth_key_id(packet.as_slice()));
+    if (auth_key_id == 0) {
+      return td::Status::Error("Unencrypted packets aren't supported");
+    }
+    auto it = options_->auth_keys.find(auth_key_id);
+    if (it == options_->auth_keys.end()) {
+      return td::Status::Error(PSLICE() << "Receive packet with unknown auth key " << auth_key_id);
+    }
+    auth_key_ = &it->second;
+
+    td::mtproto::PacketInfo packet_info;
+    packet_info.version = 2;
+    packet_info.is_server = true;
+    TRY_RESULT(read_result, td::mtproto::Transport::read(packet.as_mutable_slice(), *auth_key_, &packet_info));
+    if (read_result.type() != td::mtproto::Transport::ReadResult::Packet) {
+      return td::Status::Error("Receive unexpected transport packet");
+    }
+    if (packet_info.session_id != session_id_) {
+      session_id_ = packet_info.session_id;
+      salt_ = packet_info.salt;
+      first_message_id_ = static_cast<td::int64>(packet_info.message_id.get());
+      td::mtproto_api::new_session_created new_session_created(first_message_id_, td::Random::secure_int64(),
+                                                               static_cast<td::int64>(salt_));
+      add_answer(true, new_session_created);
+    }
+
+    td::TlParser parser(read_result.packet());
+    TRY_STATUS(on_message(parser));
+    parser.fetch_end();
+    return parser.get_status();
+  }
+
+  td::Status on_message(td::TlParser &parser) {
+    // msg_id:long seqno:int bytes:int body:Object
+    auto message_id = parser.fetch_long();
+    auto seq_no = parser.fetch_int();
+    auto size = parser.fetch_int();
+    if (size < 0 || size % 4 != 0) {
+      return td::Status::Error(PSLICE() << "Receive message of invalid size " << size);
+    }
+    auto body = parser.fetch_string_raw<td::Slice>(static_cast<size_t>(size));
+    if (parser.get_error() != nullptr) {
+      return parser.get_status();
+    }
+    if (seq_no & 1) {
+      to_ack_.push_back(message_id);
+    }
+    return on_message_body(message_id, body);
+  }
+
+  td::Status on_message_body(td::int64 message_id, td::Slice body) {
+    td::TlParser parser(body);
+    switch (parser.fetch_int()) {
+      case MSG_CONTAINER_ID: {
+        auto count = parser.fetch_int();
+        for (td::int32 i = 0; i < count && parser.get_error() == nullptr; i++) {
+          TRY_STATUS(on_message(parser));
+        }
+        break;
+      }
+      case td::mtproto_api::msgs_ack::ID:
+        // answers are never resent, so their acknowledgements are ignored
+        return td::Status::OK();
+      case td::mtproto_api::ping_delay_disconnect::ID: {
+        td::mtproto_api::ping_delay_disconnect ping(parser);
+        add_answer(false, td::mtproto_api::pong(message_id, ping.ping_id_));
+        break;
+      }
+      case td::mtproto_api::get_future_salts::ID: {
+        td::mtproto_api::get_future_salts get_future_salts(parser);
+        auto now = static_cast<td::int32>(td::Clocks::system());
+        td::mtproto_api::array<td::mtproto_api::object_ptr<td::mtproto_api::future_salt>> salts;
+        salts.push_back(td::mtproto_api::make_object<td::mtproto_api::future_salt>(now - 60, now + 86400,
+                                                                                  static_cast<td::int64>(salt_)));
+        add_answer(true, td::mtproto_api::future_salts(message_id, now, std::move(salts)));
+        break;
+      }
+      default:
+        return on_query(message_id, body);
+    }
+    parser.fetch_end();
+    return parser.get_status();
+  }
+
+  td::Status on_query(td::int64 message_id, td::Slice query) {
+    td::TlParser parser(query);
+    switch (parser.fetch_int()) {
+      case INVOKE_AFTER_MSG_ID:
+        parser.fetch_long();
+        break;
+      case INVOKE_AFTER_MSGS_ID: {
+        parser.fetch_int();  // vector constructor
+        auto count = parser.fetch_int();
+        for (td::int32 i = 0; i < count && parser.get_error() == nullptr; i++) {
+          parser.fetch_long();
+        }
+        break;
+      }
+      case td::mtproto_api::gzip_packed::ID: {
+        td::mtproto_api::gzip_packed gzip(parser);
+        if (parser.get_error() != nullptr) {
+          return parser.get_status();
+        }
+        auto unpacked_query = td::gzdecode(gzip.packed_data_);
+        if (unpacked_query.empty()) {
+          return td::Status::Error("Failed to unpack query");
+        }
+        return on_query(message_id, unpacked_query.as_slice());
+      }
+      case BENCH_QUERY_ID: {
+        auto answer_size = parser.fetch_int();
+        if (parser.get_error() != nullptr) {
+          return parser.get_status();
+        }
+        add_rpc_result(message_id, create_filler(BENCH_ANSWER_ID, answer_size, static_cast<size_t>(answer_size)));
+        return td::Status::OK();
+      }
+      default:
+        add_rpc_result(message_id, serialize(td::mtproto_api::rpc_error(400, "INPUT_METHOD_INVALID")));
+        return td::Status::OK();
+    }
+    if (parser.get_error() != nullptr) {
+      return parser.get_status();
+    }
+    return on_query(message_id, query.substr(query.size() - parser.get_left_len()));
+  }
+
+  template <class T>
+  static td::BufferSlice serialize(const T &object) {
+    td::TLObjectStorer<T> storer(object);
+    td::BufferSlice result(storer.size());
+    auto real_size = storer.store(result.as_mutable_slice().ubegin());
+    CHECK(real_size == result.size());
+    return result;
+  }
+
+  template <class T>
+  void add_answer(bool is_content_related, const T &object) {
+    answers_.emplace_back(is_content_related, serialize(object));
+  }
+
+  void add_rpc_result(td::int64 request_message_id, td::BufferSlice result) {
+    if (options_->use_gzip) {
+      auto packed_result = td::gzencode(result.as_slice(), 0.9);
+      if (!packed_result.empty()) {
+        result = serialize(td::mtproto_api::gzip_packed(packed_result.as_slice()));
+      }
+    }
+    // rpc_result#f35c6d01 req_msg_id:long result:Object = RpcResult;
+    td::BufferSlice rpc_result(12 + result.size());
+    auto data = rpc_result.as_mutable_slice();
+    td::as<td::int32>(data.begin()) = RPC_RESULT_ID;
+    td::as<td::int64>(data.begin() + 4) = request_message_id;
+    data.substr(12).copy_from(result.as_slice());
+    answers_.emplace_back(true, std::move(rpc_result));
+  }
+
+  td::int64 next_message_id() {
+    auto now = static_cast<td::uint64>(td::Clocks::system() * static_cast<double>(static_cast<td::uint64>(1) << 32));
+    auto message_id = (now & ~static_cast<td::uint64>(3)) | 1;
+    if (message_id <= last_message_id_) {
+      message_id = last_message_id_ + 4;
+    }
+    last_message_id_ = message_id;
+    return static_cast<td::int64>(message_id);
+  }
+
+  td::int32 next_seq_no(bool is_content_related) {
+    auto seq_no = seq_no_ * 2;
+    if (is_content_related) {
+      seq_no_++;
+      seq_no++;
+    }
+    return seq_no;
+  }
+
+  void send_answers() {
+    if (!to_ack_.empty()) {
+      add_answer(false, td::mtproto_api::msgs_ack(std::move(to_ack_)));
+      to_ack_.clear();
+    }
+
+    td::vector<FakeDcPacketImpl::Message> messages;
+    size_t packet_size = 0;
+    for (auto &answer : answers_) {
+      auto size = answer.second.size();
+      if (!messages.empty() && packet_size + size > MAX_PACKET_SIZE) {
+        send_packet(messages);
+        messages.clear();
+        packet_size = 0;
+      }
+      messages.push_back({next_message_id(), next_seq_no(answer.first), std::move(answer.second)});
+      packet_size += size + 16;
+    }
+    answers_.clear();
+    if (!messages.empty()) {
+      send_packet(messages);
+    }
+  }
+
+  void send_packet(const td::vector<FakeDcPacketImpl::Message> &messages) {
+    td::int64 container_message_id = 0;
+    td::int32 container_seq_no = 0;
+    if (messages.size() > 1) {
+      container_message_id = next_message_id();
+      container_seq_no = next_seq_no(false);
+    }
+    td::mtproto::PacketStorer<FakeDcPacketImpl> storer(messages, container_message_id, container_seq_no);
+
+    td::mtproto::PacketInfo packet_info;
+    packet_info.version = 2;
+    packet_info.is_server = true;
+    packet_info.salt = salt_;
+    packet_info.session_id = session_id_;
+    packet_info.use_random_padding = transport_->with_padding();
+    auto packet = td::mtproto::Transport::write(storer, *auth_key_, &packet_info, 4, 15);
+    transport_->write_prepare_inplace(&packet, false);
+    if (is_obfuscated_) {
+      output_state_.encrypt(packet.as_slice(), packet.as_mutable_slice());
+    }
+    auto size = packet.size();
+
+    // the packet is transmitted after all previous packets and is delivered after the specified latency
+    auto now = td::Time::now();
+    auto transmitted_at = td::max(now, link_free_at_);
+    if (options_->bandwidth > 0) {
+      transmitted_at += static_cast<double>(size) / options_->bandwidth;
+    }
+    link_free_at_ = transmitted_at;
+    delayed_packets_.push_back({transmitted_at + options_->latency, packet.as_buffer_slice()});
+  }
+
+  void flush_delayed_packets() {
+    auto now = td::Time::now();
+    while (!delayed_packets_.empty() && delayed_packets_.front().deliver_at <= now) {
+      fd_.output_buffer().append(std::move(delayed_packets_.front().packet));
+      delayed_packets_.pop_front();
+    }
+    if (!delayed_packets_.empty()) {
+      set_timeout_at(delayed_packets_.front().deliver_at);
+    }
+  }
+};
+
+class FakeDc final : public td::Actor {
+ public:
+  FakeDc(td::ServerSocketFd server_fd, td::vector<td::int32> scheduler_ids, std::shared_ptr<const FakeDcOptions> options)
+      : server_fd_(std::move(server_fd)), scheduler_ids_(std::move(scheduler_ids)), options_(std::move(options)) {
+  }
+
+ private:
+  td::ServerSocketFd server_fd_;
+  td::vector<td::int32> scheduler_ids_;
+  size_t next_scheduler_ = 0;
+  std::shared_ptr<const FakeDcOptions> options_;
+
+  void start_up() final {
+    td::Scheduler::subscribe(server_fd_.get_poll_info().extract_pollable_fd(this));
+  }
+
+  void tear_down() final {
+    td::Scheduler::unsubscribe_before_close(server_fd_.get_poll_info().get_pollable_fd_ref());
+    server_fd_.close();
+  }
+
+  void loop() final {
+    sync_with_poll(server_fd_);
+    while (can_read_local(server_fd_)) {
+      auto r_socket_fd = server_fd_.accept();
+      if (r_socket_fd.is_error()) {
+        if (r_socket_fd.error().code() != -1) {
+          LOG(ERROR) << r_socket_fd.error();
+        }
+        continue;
+      }
+      auto scheduler_id = scheduler_ids_[next_scheduler_++ % scheduler_ids_.size()];
+      td::create_actor_on_scheduler<FakeDcConnection>("FakeDcConnection", scheduler_id, r_socket_fd.move_as_ok(),
+                                                      options_)
+          .release();
+    }
+    if (can_close_local(server_fd_)) {
+      stop();
+    }
+  }
+};
+
+struct SessionResult {
+  td::vector<double> rtts;
+  td::uint64 read_size = 0;
+  td::uint64 write_size = 0;
+};
+
+class BenchSession final
+    : public td::Actor
+    , private td::mtproto::SessionConnection::Callback {
+ public:
+  BenchSession(const BenchOptions &options, td::IPAddress ip_address, td::mtproto::AuthKey auth_key,
+               td::Promise<SessionResult> promise)
+      : options_(options)
+      , ip_address_(std::move(ip_address))
+      , auth_key_(std::move(auth_key))
+      , promise_(std::move(promise)) {
+  }
+
+ private:
+  class StatsCallback final : public td::mtproto::RawConnection::StatsCallback {
+   public:
+    explicit StatsCallback(SessionResult *result) : result_(result) {
+    }
+    void on_read(td::uint64 bytes) final {
+      result_->read_size += bytes;
+    }
+    void on_write(td::uint64 bytes) final {
+      result_->write_size += bytes;
+    }
+    void on_pong() final {
+    }
+    void on_error() final {
+    }
+    void on_mtproto_error() final {
+    }
+
+   private:
+    SessionResult *result_;
+  };
+
+  BenchOptions options_;
+  td::IPAddress ip_address_;
+  td::mtproto::AuthKey auth_key_;
+  td::Promise<SessionResult> promise_;
+
+  td::mtproto::AuthData auth_data_;
+  td::unique_ptr<td::mtproto::SessionConnection> connection_;
+  td::BufferSlice query_;
+  bool is_query_gzipped_ = false;
+
+  td::FlatHashMap<td::mtproto::MessageId, double, td::mtproto::MessageIdHash> sent_queries_;
+  int sent_query_count_ = 0;
+  int received_answer_count_ = 0;
+  SessionResult result_;
+  td::Status error_;
+  bool is_closed_ = false;
+
+  void start_up() final {
+    auto r_socket_fd = td::SocketFd::open(ip_address_);
+    if (r_socket_fd.is_error()) {
+      promise_.set_error(r_socket_fd.move_as_error());
+      return stop();
+    }
+    auto transport_type = options_.use_obfuscation
+                              ? td::mtproto::TransportType{td::mtproto::TransportType::ObfuscatedTcp, 2,
+                                                           td::mtproto::ProxySecret()}
+                              : td::mtproto::TransportType{td::mtproto::TransportType::Tcp, 0, td::mtproto::ProxySecret()};
+    auto raw_connection =
+        td::mtproto::RawConnection::create(ip_address_, td::BufferedFd<td::SocketFd>(r_socket_fd.move_as_ok()),
+                                           std::move(transport_type), td::make_unique<StatsCallback>(&result_));
+
+    auto now = td::Time::now();
+    auth_data_.set_main_auth_key(auth_key_);
+    auth_data_.set_use_pfs(false);
+    auth_data_.reset_server_time_difference(td::Clocks::system() - now);
+    auth_data_.set_server_salt(td::Random::secure_uint64(), now);
+    auth_data_.set_future_salts({td::mtproto::ServerSalt{0, 1e20, 1e30}}, now);
+    td::uint64 session_id = 0;
+    while (session_id == 0) {
+      session_id = td::Random::secure_uint64();
+    }
+    auth_data_.set_session_id(session_id);
+
+    connection_ = td::make_unique<td::mtproto::SessionConnection>(td::mtproto::SessionConnection::Mode::Tcp,
+                                                                  std::move(raw_connection), &auth_data_);
+    connection_->set_online(true, true);
+    td::Scheduler::subscribe(connection_->get_poll_info().extract_pollable_fd(this));
+
+    query_ = create_filler(BENCH_QUERY_ID, options_.answer_size, static_cast<size_t>(options_.query_size));
+    if (options_.use_gzip) {
+      auto packed_query = td::gzencode(query_.as_slice(), 0.9);
+      if (!packed_query.empty()) {
+        query_ = std::move(packed_query);
+        is_query_gzipped_ = true;
+      }
+    }
+
+    loop();
+  }
+
+  bool can_send_query() const {
+    return sent_query_count_ < options_.query_count &&
+           sent_queries_.size() < static_cast<size_t>(options_.max_in_flight_query_count);
+  }
+
+  void loop() final {
+    if (connection_ == nullptr) {
+      return;
+    }
+    double wakeup_at = 0;
+    do {
+      while (can_send_query()) {
+        auto r_message_id = connection_->send_query(query_.clone(), is_query_gzipped_);
+        if (r_message_id.is_error()) {
+          error_ = r_message_id.move_as_error();
+          break;
+        }
+        sent_queries_.emplace(r_message_id.ok(), td::Time::now());
+        sent_query_count_++;
+      }
+      wakeup_at = connection_->flush(this);
+      if (is_closed_ || error_.is_error() || received_answer_count_ == options_.query_count) {
+        return finish();
+      }
+    } while (can_send_query());
+    if (wakeup_at != 0) {
+      set_timeout_at(wakeup_at);
+    }
+  }
+
+  void finish() {
+    auto raw_connection = connection_->move_as_raw_connection();
+    connection_ = nullptr;
+    td::Scheduler::unsubscribe_before_close(raw_connection->get_poll_info().get_pollable_fd_ref());
+    raw_connection->close();
+
+    if (received_answer_count_ == options_.query_count) {
+      promise_.set_value(std::move(result_));
+    } else if (error_.is_error()) {
+      promise_.set_error(std::move(error_));
+    } else {
+      promise_.set_error(td::Status::Error("Connection was closed"));
+    }
+    stop();
+  }
+
+  void on_connected() final {
+  }
+
+  void on_closed(td::Status status) final {
+    is_closed_ = true;
+    if (status.is_error() && error_.is_ok()) {
+      error_ = std::move(status);
+    }
+  }
+
+  void on_server_salt_updated() final {
+  }
+
+  void on_server_time_difference_updated(bool force) final {
+  }
+
+  void on_new_session_created(td::uint64 unique_id, td::mtproto::MessageId first_message_id) final {
+  }
+
+  void on_session_failed(td::Status status) final {
+    if (error_.is_ok()) {
+      error_ = std::move(status);
+    }
+  }
+
+  void on_container_sent(td::mtproto::MessageId container_message_id,
+                         td::vector<td::mtproto::MessageId> message_ids) final {
+  }
+
+  td::Status on_pong(double ping_time, double pong_time, double current_time) final {
+    return td::Status::OK();
+  }
+
+  td::Status on_update(td::BufferSlice packet) final {
+    return td::Status::OK();
+  }
+
+  void on_message_ack(td::mtproto::MessageId message_id) final {
+  }
+
+  td::Status on_message_result_ok(td::mtproto::MessageId message_id, td::BufferSlice packet,
+                                  size_t original_size) final {
+    auto it = sent_queries_.find(message_id);
+    if (it == sent_queries_.end()) {
+      return td::Status::OK();
+    }
+    if (packet.size() < 4 || td::as<td::int32>(packet.as_slice().begin()) != BENCH_ANSWER_ID) {
+      return td::Status::Error("Receive wrong answer");
+    }
+    result_.rtts.push_back(td::Time::now() - it->second);
+    sent_queries_.erase(it);
+    received_answer_count_++;
+    return td::Status::OK();
+  }
+
+  void on_message_result_error(td::mtproto::MessageId message_id, int code, td::string message) final {
+    if (error_.is_ok()) {
+      error_ = td::Status::Error(code, message);
+    }
+  }
+
+  void on_message_failed(td::mtproto::MessageId message_id, td::Status status) final {
+    if (error_.is_ok()) {
+      error_ = std::move(status);
+    }
+  }
+
+  void on_message_info(td::mtproto::MessageId message_id, td::int32 state, td::mtproto::MessageId answer_message_id,
+                       td::int32 answer_size, td::int32 source) final {
+  }
+
+  td::Status on_destroy_auth_key() final {
+    return td::Status::OK();
+  }
+};
+
+class BenchRunner final : public td::Actor {
+ public:
+  BenchRunner(BenchOptions options, td::IPAddress ip_address, td::vector<td::int32> scheduler_ids,
+              td::vector<td::mtproto::AuthKey> auth_keys)
+      : options_(std::move(options))
+      , ip_address_(std::move(ip_address))
+      , scheduler_ids_(std::move(scheduler_ids))
+      , auth_keys_(std::move(auth_keys)) {
+  }
+
+ private:
+  BenchOptions options_;
+  td::IPAddress ip_address_;
+  td::vector<td::int32> scheduler_ids_;
+  td::vector<td::mtproto::AuthKey> auth_keys_;
+
+  double start_time_ = 0.0;
+  size_t pending_session_count_ = 0;
+  size_t failed_session_count_ = 0;
+  SessionResult result_;
+
+  void start_up() final {
+    start_time_ = td::Time::now();
+    for (size_t i = 0; i < auth_keys_.size(); i++) {
+      auto promise = td::PromiseCreator::lambda([actor_id = actor_id(this)](td::Result<SessionResult> r_result) {
+        td::send_closure(actor_id, &BenchRunner::on_session_finished, std::move(r_result));
+      });
+      td::create_actor_on_scheduler<BenchSession>("BenchSession", scheduler_ids_[i % scheduler_ids_.size()],
+                                                  options_, ip_address_, std::move(auth_keys_[i]), std::move(promise))
+          .release();
+      pending_session_count_++;
+    }
+  }
+
+  void on_session_finished(td::Result<SessionResult> r_result) {
+    if (r_result.is_error()) {
+      LOG(ERROR) << "Session failed: " << r_result.error();
+      failed_session_count_++;
+    } else {
+      auto result = r_result.move_as_ok();
+      td::append(result_.rtts, result.rtts);
+      result_.read_size += result.read_size;
+      result_.write_size += result.write_size;
+    }
+
+    CHECK(pending_session_count_ > 0);
+    if (--pending_session_count_ == 0) {
+      print_results();
+      td::Scheduler::instance()->finish();
+      stop();
+    }
+  }
+
+  void print_results() {
+    auto elapsed_time = td::Time::now() - start_time_;
+    auto &rtts = result_.rtts;
+    std::sort(rtts.begin(), rtts.end());
+    auto get_percentile = [&rtts](double percentile) {
+      if (rtts.empty()) {
+        return 0.0;
+      }
+      auto pos = static_cast<size_t>(percentile * static_cast<double>(rtts.size() - 1));
+      return rtts[pos] * 1000;
+    };
+
+    LOG(PLAIN) << "Sessions: " << auth_keys_.size() << ", failed: " << failed_session_count_
+               << ", transport: " << (options_.use_obfuscation ? "obfuscated TCP" : "TCP")
+               << ", gzip: " << options_.use_gzip << ", latency: " << options_.latency * 1000
+               << " ms, bandwidth: " << options_.bandwidth << " B/s";
+    LOG(PLAIN) << "Queries: " << rtts.size() << " in " << elapsed_time << " seconds, "
+               << static_cast<double>(rtts.size()) / elapsed_time << " queries/s";
+    LOG(PLAIN) << "RTT: p50 = " << get_percentile(0.5) << " ms, p99 = " << get_percentile(0.99)
+               << " ms, max = " << get_percentile(1.0) << " ms";
+    LOG(PLAIN) << "Traffic: read " << static_cast<double>(result_.read_size) / elapsed_time << " B/s, written "
+               << static_cast<double>(result_.write_size) / elapsed_time << " B/s";
+  }
+};
+
+class FakeDhCallback final : public td::mtproto::DhCallback {
+ public:
+  int is_good_prime(td::Slice prime_str) const final {
+    auto it = cache.find(prime_str.str());
+    if (it == cache.end()) {
+      return -1;
+    }
+    return it->second;
+  }
+  void add_good_prime(td::Slice prime_str) const final {
+    cache[prime_str.str()] = 1;
+  }
+  void add_bad_prime(td::Slice prime_str) const final {
+    cache[prime_str.str()] = 0;
+  }
+  mutable std::map<td::string, int> cache;
+};
+
+int main(int argc, char *argv[]) {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+
+  BenchOptions options;
+  int latency_ms = 0;
+  td::OptionParser parser;
+  parser.set_description("Benchmark of MTProto sessions connected to an in-process fake DC");
+  parser.add_checked_option('s', "sessions", "number of sessions (default: 16)",
+                            td::OptionParser::parse_integer(options.session_count));
+  parser.add_checked_option('t', "threads", "number of scheduler threads (default: 2)",
+                            td::OptionParser::parse_integer(options.thread_count));
+  parser.add_checked_option('n', "queries", "number of queries in every session (default: 10000)",
+                            td::OptionParser::parse_integer(options.query_count));
+  parser.add_checked_option('w', "window", "maximum number of simultaneous queries in a session (default: 32)",
+                            td::OptionParser::parse_integer(options.max_in_flight_query_count));
+  parser.add_checked_option('q', "query-size", "size of a query in bytes (default: 64)",
+                            td::OptionParser::parse_integer(options.query_size));
+  parser.add_checked_option('a', "answer-size", "size of an answer in bytes (default: 256)",
+                            td::OptionParser::parse_integer(options.answer_size));
+  parser.add_option('z', "gzip", "pack queries and answers with gzip", [&] { options.use_gzip = true; });
+  parser.add_option('p', "plain", "use intermediate TCP transport without obfuscation",
+                    [&] { options.use_obfuscation = false; });
+  parser.add_checked_option('l', "latency", "latency added by the fake DC in milliseconds (default: 0)",
+                            td::OptionParser::parse_integer(latency_ms));
+  parser.add_checked_option('b', "bandwidth", "bandwidth of every connection in bytes per second (default: unlimited)",
+                            [&](td::Slice value) {
+                              TRY_RESULT(bandwidth, td::to_integer_safe<td::int64>(value));
+                              options.bandwidth = static_cast<double>(bandwidth);
+                              return td::Status::OK();
+                            });
+  parser.add_checked_option('P', "port", "loopback port for the fake DC (default: 10443)",
+                            td::OptionParser::parse_integer(options.port));
+  parser.add_check([&] {
+    if (options.session_count <= 0 || options.thread_count < 0 || options.query_count <= 0 ||
+        options.max_in_flight_query_count <= 0 || options.query_size < 0 || options.answer_size < 0 ||
+        latency_ms < 0 || options.bandwidth < 0) {
+      return td::Status::Error("Invalid option value specified");
+    }
+    return td::Status::OK();
+  });
+  auto r_non_options = parser.run(argc, argv, 0);
+  if (r_non_options.is_error()) {
+    LOG(PLAIN) << argv[0] << ": " << r_non_options.error().message();
+    LOG(PLAIN) << parser;
+    return 1;
+  }
+  options.latency = latency_ms * 1e-3;
+
+  auto fake_dc_options = std::make_shared<FakeDcOptions>();
+  fake_dc_options->latency = options.latency;
+  fake_dc_options->bandwidth = options.bandwidth;
+  fake_dc_options->use_gzip = options.use_gzip;
+
+  FakeDhCallback dh_callback;
+  auto prime = td::base64url_decode(prime_base64).move_as_ok();
+  td::mtproto::DhHandshake::check_config(g, prime, &dh_callback).ensure();
+  td::vector<td::mtproto::AuthKey> auth_keys;
+  auto handshake_start_time = td::Time::now();
+  for (int i = 0; i < options.session_count; i++) {
+    td::mtproto::DhHandshake client;
+    td::mtproto::DhHandshake server;
+    client.set_config(g, prime);
+    server.set_config(g, prime);
+    server.set_g_a(client.get_g_b());
+    client.set_g_a(server.get_g_b());
+    client.run_checks(true, &dh_callback).ensure();
+    server.run_checks(true, &dh_callback).ensure();
+    auto client_key = client.gen_key();
+    auto server_key = server.gen_key();
+    CHECK(client_key.first == server_key.first);
+    auto auth_key_id = static_cast<td::uint64>(client_key.first);
+    auth_keys.emplace_back(auth_key_id, std::move(client_key.second));
+    fake_dc_options->auth_keys.emplace(auth_key_id, td::mtproto::AuthKey(auth_key_id, std::move(server_key.second)));
+  }
+  LOG(PLAIN) << "Created " << options.session_count << " auth keys in " << td::Time::now() - handshake_start_time
+             << " seconds";
+
+  auto r_server_fd = td::ServerSocketFd::open(options.port, "127.0.0.1");
+  if (r_server_fd.is_error()) {
+    LOG(PLAIN) << "Failed to open server socket: " << r_server_fd.error();
+    return 1;
+  }
+  td::IPAddress ip_address;
+  ip_address.init_ipv4_port("127.0.0.1", options.port).ensure();
+
+  td::vector<td::int32> scheduler_ids;
+  for (int i = 0; i < options.thread_count; i++) {
+    scheduler_ids.push_back(i + 1);
+  }
+  if (scheduler_ids.empty()) {
+    scheduler_ids.push_back(0);
+  }
+
+  td::ConcurrentScheduler scheduler(options.thread_count, 0);
+  scheduler
+      .create_actor_unsafe<FakeDc>(0, "FakeDc", r_server_fd.move_as_ok(), scheduler_ids,
+                                   std::shared_ptr<const FakeDcOptions>(std::move(fake_dc_options)))
+      .release();
+  scheduler
+      .create_actor_unsafe<BenchRunner>(0, "BenchRunner", options, std::move(ip_address), std::move(scheduler_ids),
+                                        std::move(auth_keys))
+      .release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+    // empty
+  }
+  scheduler.finish();
+}
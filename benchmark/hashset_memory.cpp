@@ -12,6 +12,7 @@
 #include "td/utils/FlatHashMap.h"
 #include "td/utils/FlatHashMapChunks.h"
 #include "td/utils/FlatHashTable.h"
+#include "td/utils/FlatHashTableSwiss.h"
 #include "td/utils/HashTableUtils.h"
 #include "td/utils/logging.h"
 #include "td/utils/MapNode.h"
@@ -172,6 +173,7 @@ using FlatHashMapImpl = td::FlatHashTable<td::MapNode<KeyT, ValueT>, HashT, EqT>
 
 #define FOR_EACH_TABLE(F) \
   F(FlatHashMapImpl)      \
+  F(td::FlatHashMapSwiss) \
   F(folly::F14FastMap)    \
   F(absl::flat_hash_map)  \
   F(std::unordered_map)   \
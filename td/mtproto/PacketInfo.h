@@ -25,6 +25,7 @@ struct PacketInfo {
   int32 version{1};
   bool no_crypto_flag{false};
   bool is_creator{false};
+  bool is_server{false};
   bool check_mod4{true};
   bool use_random_padding{false};
 };
@@ -262,12 +262,13 @@ Status SessionConnection::on_packet_rpc_result(const MsgInfo &info, Slice packet
       return Status::OK();
     }
     case mtproto_api::gzip_packed::ID: {
-      mtproto_api::gzip_packed gzip(parser);
+      // packed data is decoded directly from the packet without copying it to mtproto_api::gzip_packed
+      auto packed_data = parser.fetch_string<Slice>();
       if (parser.get_error()) {
         return Status::Error(PSLICE() << "Failed to parse mtproto_api::gzip_packed: " << parser.get_error());
       }
       // yep, gzip in rpc_result
-      BufferSlice object = gzdecode(gzip.packed_data_);
+      BufferSlice object = gzdecode(packed_data);
       // send header no more optimization
       return callback_->on_message_result_ok(MessageId(req_msg_id), std::move(object), info.size);
     }
@@ -277,6 +278,18 @@ Status SessionConnection::on_packet_rpc_result(const MsgInfo &info, Slice packet
   }
 }
 
+Status SessionConnection::on_packet_gzip_packed(const MsgInfo &info, Slice packet) {
+  TlParser parser(packet);
+  auto packed_data = parser.fetch_string<Slice>();
+  parser.fetch_end();
+  if (parser.get_error()) {
+    return parser.get_status();
+  }
+  BufferSlice res = gzdecode(packed_data);
+  auto guard = set_buffer_slice(&res);
+  return on_slice_packet(info, res.as_slice());
+}
+
 template <class T>
 Status SessionConnection::on_packet(const MsgInfo &info, const T &packet) {
   LOG(ERROR) << "Unsupported: " << to_string(packet);
@@ -513,6 +526,9 @@ Status SessionConnection::on_slice_packet(const MsgInfo &info, Slice packet) {
   if (constructor_id == mtproto_api::rpc_result::ID) {
     return on_packet_rpc_result(info, packet.substr(4));
   }
+  if (constructor_id == mtproto_api::gzip_packed::ID) {
+    return on_packet_gzip_packed(info, packet.substr(4));
+  }
 
   TlDowncastHelper<mtproto_api::Object> helper(constructor_id);
   Status status;
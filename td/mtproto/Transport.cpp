@@ -303,7 +303,7 @@ Status Transport::read_crypto(MutableSlice message, const AuthKey &auth_key, Pac
                               MutableSlice *data) {
   CryptoHeader *header = nullptr;
   CryptoPrefix *prefix = nullptr;
-  TRY_STATUS(read_crypto_impl(8, message, auth_key, &header, &prefix, data, packet_info));
+  TRY_STATUS(read_crypto_impl(packet_info->is_server ? 0 : 8, message, auth_key, &header, &prefix, data, packet_info));
   CHECK(header != nullptr);
   CHECK(prefix != nullptr);
   CHECK(packet_info != nullptr);
@@ -382,7 +382,7 @@ BufferWriter Transport::write_crypto(const Storer &storer, const AuthKey &auth_k
   header.salt = packet_info->salt;
   header.session_id = packet_info->session_id;
 
-  write_crypto_impl(0, storer, auth_key, packet_info, &header, data_size, padded_size);
+  write_crypto_impl(packet_info->is_server ? 8 : 0, storer, auth_key, packet_info, &header, data_size, padded_size);
 
   return packet;
 }
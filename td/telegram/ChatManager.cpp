@@ -4456,6 +4456,45 @@ void ChatManager::on_load_channel_from_database(ChannelId channel_id, string val
   set_promises(promises);
 }
 
+vector<std::pair<ChatId, string>> ChatManager::get_startup_snapshot_chats(const vector<ChatId> &chat_ids) const {
+  vector<std::pair<ChatId, string>> result;
+  for (auto chat_id : chat_ids) {
+    const Chat *c = get_chat(chat_id);
+    if (c != nullptr && c->is_saved && c->log_event_id == 0) {
+      result.emplace_back(chat_id, get_chat_database_value(c));
+    }
+  }
+  return result;
+}
+
+vector<std::pair<ChannelId, string>> ChatManager::get_startup_snapshot_channels(
+    const vector<ChannelId> &channel_ids) const {
+  vector<std::pair<ChannelId, string>> result;
+  for (auto channel_id : channel_ids) {
+    const Channel *c = get_channel(channel_id);
+    if (c != nullptr && c->is_saved && c->log_event_id == 0) {
+      result.emplace_back(channel_id, get_channel_database_value(c));
+    }
+  }
+  return result;
+}
+
+void ChatManager::on_load_startup_snapshot_chats(vector<std::pair<ChatId, string>> &&chats) {
+  for (auto &chat : chats) {
+    if (chat.first.is_valid()) {
+      on_load_chat_from_database(chat.first, std::move(chat.second), true);
+    }
+  }
+}
+
+void ChatManager::on_load_startup_snapshot_channels(vector<std::pair<ChannelId, string>> &&channels) {
+  for (auto &channel : channels) {
+    if (channel.first.is_valid()) {
+      on_load_channel_from_database(channel.first, std::move(channel.second), true);
+    }
+  }
+}
+
 bool ChatManager::have_channel_force(ChannelId channel_id, const char *source) {
   return get_channel_force(channel_id, source) != nullptr;
 }
@@ -4482,15 +4521,17 @@ ChatManager::Channel *ChatManager::get_channel_force(ChannelId channel_id, const
   return get_channel(channel_id);
 }
 
-void ChatManager::save_chat_full(const ChatFull *chat_full, ChatId chat_id) {
+void ChatManager::save_chat_full(ChatFull *chat_full, ChatId chat_id) {
   if (!G()->use_chat_info_database()) {
     return;
   }
 
   LOG(INFO) << "Trying to save to database full " << chat_id;
   CHECK(chat_full != nullptr);
-  G()->td_db()->get_sqlite_pmc()->set(get_chat_full_database_key(chat_id), get_chat_full_database_value(chat_full),
-                                      Auto());
+  auto value = get_chat_full_database_value(chat_full);
+  unloaded_chat_fulls_.on_size_changed(chat_full->estimated_size, sizeof(ChatFull) + value.size());
+  G()->td_db()->get_sqlite_pmc()->set(get_chat_full_database_key(chat_id), std::move(value), Auto());
+  try_unload_full_infos();
 }
 
 string ChatManager::get_chat_full_database_key(ChatId chat_id) {
@@ -4564,6 +4605,7 @@ void ChatManager::on_load_chat_full_from_database(ChatId chat_id, string value)
 
   td_->group_call_manager_->on_update_dialog_about(DialogId(chat_id), chat_full->description, false);
 
+  unloaded_chat_fulls_.on_size_changed(chat_full->estimated_size, sizeof(ChatFull) + value.size());
   chat_full->is_update_chat_full_sent = true;
   update_chat_full(chat_full, chat_id, "on_load_chat_full_from_database", true);
 }
@@ -4575,6 +4617,7 @@ ChatManager::ChatFull *ChatManager::get_chat_full_force(ChatId chat_id, const ch
 
   ChatFull *chat_full = get_chat_full(chat_id);
   if (chat_full != nullptr) {
+    chat_full->last_used_time = Time::now();
     return chat_full;
   }
   if (!G()->use_chat_info_database()) {
@@ -4583,6 +4626,7 @@ ChatManager::ChatFull *ChatManager::get_chat_full_force(ChatId chat_id, const ch
   if (!unavailable_chat_fulls_.insert(chat_id).second) {
     return nullptr;
   }
+  unloaded_chat_fulls_.on_load(chat_id);
 
   LOG(INFO) << "Trying to load full " << chat_id << " from database from " << source;
   on_load_chat_full_from_database(chat_id,
@@ -4590,15 +4634,17 @@ ChatManager::ChatFull *ChatManager::get_chat_full_force(ChatId chat_id, const ch
   return get_chat_full(chat_id);
 }
 
-void ChatManager::save_channel_full(const ChannelFull *channel_full, ChannelId channel_id) {
+void ChatManager::save_channel_full(ChannelFull *channel_full, ChannelId channel_id) {
   if (!G()->use_chat_info_database()) {
     return;
   }
 
   LOG(INFO) << "Trying to save to database full " << channel_id;
   CHECK(channel_full != nullptr);
-  G()->td_db()->get_sqlite_pmc()->set(get_channel_full_database_key(channel_id),
-                                      get_channel_full_database_value(channel_full), Auto());
+  auto value = get_channel_full_database_value(channel_full);
+  unloaded_channel_fulls_.on_size_changed(channel_full->estimated_size, sizeof(ChannelFull) + value.size());
+  G()->td_db()->get_sqlite_pmc()->set(get_channel_full_database_key(channel_id), std::move(value), Auto());
+  try_unload_full_infos();
 }
 
 string ChatManager::get_channel_full_database_key(ChannelId channel_id) {
@@ -4703,6 +4749,7 @@ void ChatManager::on_load_channel_full_from_database(ChannelId channel_id, strin
 
   update_channel(c, channel_id);
 
+  unloaded_channel_fulls_.on_size_changed(channel_full->estimated_size, sizeof(ChannelFull) + value.size());
   channel_full->is_update_channel_full_sent = true;
   update_channel_full(channel_full, channel_id, "on_load_channel_full_from_database", true);
 
@@ -4719,6 +4766,7 @@ ChatManager::ChannelFull *ChatManager::get_channel_full_force(ChannelId channel_
 
   ChannelFull *channel_full = get_channel_full(channel_id, only_local, source);
   if (channel_full != nullptr) {
+    channel_full->last_used_time = Time::now();
     return channel_full;
   }
   if (!G()->use_chat_info_database()) {
@@ -4727,6 +4775,7 @@ ChatManager::ChannelFull *ChatManager::get_channel_full_force(ChannelId channel_
   if (!unavailable_channel_fulls_.insert(channel_id).second) {
     return nullptr;
   }
+  unloaded_channel_fulls_.on_load(channel_id);
 
   LOG(INFO) << "Trying to load full " << channel_id << " from database from " << source;
   on_load_channel_full_from_database(
@@ -5039,6 +5088,7 @@ void ChatManager::update_chat_full(ChatFull *chat_full, ChatId chat_id, const ch
   chat_full->is_changed = false;
   if (chat_full->need_send_update || chat_full->need_save_to_database) {
     LOG(INFO) << "Update full " << chat_id << " from " << source;
+    chat_full->last_used_time = Time::now();
   }
   if (chat_full->need_send_update) {
     vector<DialogAdministrator> administrators;
@@ -5130,6 +5180,7 @@ void ChatManager::update_channel_full(ChannelFull *channel_full, ChannelId chann
   channel_full->is_changed = false;
   if (channel_full->need_send_update || channel_full->need_save_to_database) {
     LOG(INFO) << "Update full " << channel_id << " from " << source;
+    channel_full->last_used_time = Time::now();
   }
   if (channel_full->need_send_update) {
     if (channel_full->linked_channel_id.is_valid()) {
@@ -7563,6 +7614,7 @@ ChatManager::ChatFull *ChatManager::add_chat_full(ChatId chat_id) {
   auto &chat_full_ptr = chats_full_[chat_id];
   if (chat_full_ptr == nullptr) {
     chat_full_ptr = make_unique<ChatFull>();
+    chat_full_ptr->last_used_time = Time::now();
   }
   return chat_full_ptr.get();
 }
@@ -8044,10 +8096,105 @@ ChatManager::ChannelFull *ChatManager::add_channel_full(ChannelId channel_id) {
   auto &channel_full_ptr = channels_full_[channel_id];
   if (channel_full_ptr == nullptr) {
     channel_full_ptr = make_unique<ChannelFull>();
+    channel_full_ptr->last_used_time = Time::now();
   }
   return channel_full_ptr.get();
 }
 
+void ChatManager::try_unload_full_infos() {
+  if (is_unload_full_infos_scheduled_ || !G()->use_chat_info_database()) {
+    return;
+  }
+  auto max_size = G()->get_option_integer("max_cached_full_info_size");
+  if (max_size <= 0) {
+    return;
+  }
+  auto unload_size = static_cast<size_t>(max_size + max_size / 8);
+  if (unloaded_chat_fulls_.get_total_size() <= unload_size &&
+      unloaded_channel_fulls_.get_total_size() <= unload_size) {
+    return;
+  }
+
+  // objects must not be unloaded while pointers to them can be used
+  is_unload_full_infos_scheduled_ = true;
+  send_closure_later(actor_id(this), &ChatManager::unload_full_infos);
+}
+
+void ChatManager::unload_full_infos() {
+  is_unload_full_infos_scheduled_ = false;
+  if (G()->close_flag()) {
+    return;
+  }
+  auto max_size = G()->get_option_integer("max_cached_full_info_size");
+  if (max_size <= 0) {
+    return;
+  }
+
+  auto chat_ids = get_least_recently_used_keys(
+      chats_full_, unloaded_chat_fulls_.get_total_size(), static_cast<size_t>(max_size),
+      [](ChatId, const ChatFull *chat_full) { return can_unload_chat_full(chat_full); });
+  for (auto chat_id : chat_ids) {
+    unload_chat_full(chat_id);
+  }
+  auto channel_ids = get_least_recently_used_keys(
+      channels_full_, unloaded_channel_fulls_.get_total_size(), static_cast<size_t>(max_size),
+      [this](ChannelId, const ChannelFull *channel_full) { return can_unload_channel_full(channel_full); });
+  for (auto channel_id : channel_ids) {
+    unload_channel_full(channel_id);
+  }
+  LOG(INFO) << "Unloaded " << chat_ids.size() << " full basic groups and " << channel_ids.size()
+            << " full supergroups; totally unloaded " << get_unloaded_full_info_count() << " and reloaded "
+            << get_reloaded_full_info_count() << " full chats";
+}
+
+int64 ChatManager::get_unloaded_full_info_count() const {
+  return unloaded_chat_fulls_.get_unload_count() + unloaded_channel_fulls_.get_unload_count();
+}
+
+int64 ChatManager::get_reloaded_full_info_count() const {
+  return unloaded_chat_fulls_.get_reload_count() + unloaded_channel_fulls_.get_reload_count();
+}
+
+bool ChatManager::can_unload_chat_full(const ChatFull *chat_full) {
+  return !chat_full->is_being_updated && !chat_full->is_changed && !chat_full->need_send_update &&
+         !chat_full->need_save_to_database;
+}
+
+bool ChatManager::can_unload_channel_full(const ChannelFull *channel_full) const {
+  // slow mode state is updated by a timeout
+  return !channel_full->is_being_updated && !channel_full->is_changed && !channel_full->need_send_update &&
+         !channel_full->need_save_to_database && channel_full->slow_mode_next_send_date == 0;
+}
+
+void ChatManager::unload_chat_full(ChatId chat_id) {
+  auto chat_full = get_chat_full(chat_id);
+  CHECK(chat_full != nullptr);
+  LOG(DEBUG) << "Unload full " << chat_id;
+  if (chat_full->file_source_id.is_valid()) {
+    // keep the file source to reuse it after the full basic group is loaded again
+    td_->file_manager_->change_files_source(chat_full->file_source_id, chat_full->registered_photo_file_ids, {});
+    chat_full_file_source_ids_.set(chat_id, chat_full->file_source_id);
+  }
+  unloaded_chat_fulls_.on_unload(chat_id, chat_full->estimated_size);
+  chats_full_.erase(chat_id);
+  unavailable_chat_fulls_.erase(chat_id);
+}
+
+void ChatManager::unload_channel_full(ChannelId channel_id) {
+  auto channel_full = get_channel_full(channel_id, true, "unload_channel_full");
+  CHECK(channel_full != nullptr);
+  LOG(DEBUG) << "Unload full " << channel_id;
+  if (channel_full->file_source_id.is_valid()) {
+    // keep the file source to reuse it after the full supergroup is loaded again
+    td_->file_manager_->change_files_source(channel_full->file_source_id, channel_full->registered_photo_file_ids,
+                                            {});
+    channel_full_file_source_ids_.set(channel_id, channel_full->file_source_id);
+  }
+  unloaded_channel_fulls_.on_unload(channel_id, channel_full->estimated_size);
+  channels_full_.erase(channel_id);
+  unavailable_channel_fulls_.erase(channel_id);
+}
+
 void ChatManager::load_channel_full(ChannelId channel_id, bool force, Promise<Unit> &&promise, const char *source) {
   auto channel_full = get_channel_full_force(channel_id, true, source);
   if (channel_full == nullptr) {
@@ -20,6 +20,7 @@
 #include "td/telegram/EmojiStatus.h"
 #include "td/telegram/files/FileId.h"
 #include "td/telegram/files/FileSourceId.h"
+#include "td/telegram/LeastRecentlyUsed.h"
 #include "td/telegram/MessageFullId.h"
 #include "td/telegram/MessageId.h"
 #include "td/telegram/MessageTtl.h"
@@ -132,6 +133,12 @@ class ChatManager final : public Actor {
   void on_binlog_chat_event(BinlogEvent &&event);
   void on_binlog_channel_event(BinlogEvent &&event);
 
+  vector<std::pair<ChatId, string>> get_startup_snapshot_chats(const vector<ChatId> &chat_ids) const;
+  vector<std::pair<ChannelId, string>> get_startup_snapshot_channels(const vector<ChannelId> &channel_ids) const;
+
+  void on_load_startup_snapshot_chats(vector<std::pair<ChatId, string>> &&chats);
+  void on_load_startup_snapshot_channels(vector<std::pair<ChannelId, string>> &&channels);
+
   void on_get_chat(tl_object_ptr<telegram_api::Chat> &&chat, const char *source);
   void on_get_chats(vector<tl_object_ptr<telegram_api::Chat>> &&chats, const char *source);
 
@@ -381,6 +388,10 @@ class ChatManager final : public Actor {
 
   void repair_chat_participants(ChatId chat_id);
 
+  int64 get_unloaded_full_info_count() const;
+
+  int64 get_reloaded_full_info_count() const;
+
   void get_current_state(vector<td_api::object_ptr<td_api::Update>> &updates) const;
 
  private:
@@ -455,6 +466,9 @@ class ChatManager final : public Actor {
     bool need_save_to_database = true;  // have new changes that need only to be saved to the database
     bool is_update_chat_full_sent = false;
 
+    double last_used_time = 0.0;
+    size_t estimated_size = 0;  // the size of the object in memory, estimated by the size of its database value
+
     template <class StorerT>
     void store(StorerT &storer) const;
 
@@ -599,6 +613,8 @@ class ChatManager final : public Actor {
     bool is_update_channel_full_sent = false;
 
     double expires_at = 0.0;
+    double last_used_time = 0.0;
+    size_t estimated_size = 0;  // the size of the object in memory, estimated by the size of its database value
 
     bool is_expired() const {
       return expires_at < Time::now();
@@ -676,6 +692,18 @@ class ChatManager final : public Actor {
 
   ChatFull *add_chat_full(ChatId chat_id);
 
+  void try_unload_full_infos();
+
+  void unload_full_infos();
+
+  static bool can_unload_chat_full(const ChatFull *chat_full);
+
+  bool can_unload_channel_full(const ChannelFull *channel_full) const;
+
+  void unload_chat_full(ChatId chat_id);
+
+  void unload_channel_full(ChannelId channel_id);
+
   void send_get_chat_full_query(ChatId chat_id, Promise<Unit> &&promise, const char *source);
 
   const Channel *get_channel(ChannelId channel_id) const;
@@ -805,12 +833,12 @@ class ChatManager final : public Actor {
   void load_channel_from_database_impl(ChannelId channel_id, Promise<Unit> promise);
   void on_load_channel_from_database(ChannelId channel_id, string value, bool force);
 
-  static void save_chat_full(const ChatFull *chat_full, ChatId chat_id);
+  void save_chat_full(ChatFull *chat_full, ChatId chat_id);
   static string get_chat_full_database_key(ChatId chat_id);
   static string get_chat_full_database_value(const ChatFull *chat_full);
   void on_load_chat_full_from_database(ChatId chat_id, string value);
 
-  static void save_channel_full(const ChannelFull *channel_full, ChannelId channel_id);
+  void save_channel_full(ChannelFull *channel_full, ChannelId channel_id);
   static string get_channel_full_database_key(ChannelId channel_id);
   static string get_channel_full_database_value(const ChannelFull *channel_full);
   void on_load_channel_full_from_database(ChannelId channel_id, string value, const char *source);
@@ -926,12 +954,15 @@ class ChatManager final : public Actor {
   FlatHashMap<ChatId, vector<Promise<Unit>>, ChatIdHash> load_chat_from_database_queries_;
   FlatHashSet<ChatId, ChatIdHash> loaded_from_database_chats_;
   FlatHashSet<ChatId, ChatIdHash> unavailable_chat_fulls_;
+  UnloadedObjects<ChatId, ChatIdHash> unloaded_chat_fulls_;
 
   FlatHashMap<ChannelId, vector<Promise<Unit>>, ChannelIdHash> load_channel_from_database_queries_;
   FlatHashSet<ChannelId, ChannelIdHash> loaded_from_database_channels_;
   FlatHashSet<ChannelId, ChannelIdHash> unavailable_channel_fulls_;
+  UnloadedObjects<ChannelId, ChannelIdHash> unloaded_channel_fulls_;
+  bool is_unload_full_infos_scheduled_ = false;
 
-  QueryMerger get_chat_queries_{"GetChatMerger", 3, 50};
+  QueryMerger get_chat_queries_{"GetChatMerger", 3, 100, 0.01};
   QueryMerger get_channel_queries_{"GetChannelMerger", 100, 1};  // can't merge getChannel queries without access hash
 
   QueryCombiner get_chat_full_queries_{"GetChatFullCombiner", 2.0};
@@ -6,6 +6,7 @@
 //
 #include "td/telegram/Client.h"
 
+#include "td/telegram/HibernatableTd.h"
 #include "td/telegram/Td.h"
 #include "td/telegram/TdCallback.h"
 
@@ -37,6 +38,8 @@
 
 namespace td {
 
+static constexpr int32 MAX_RECEIVE_SHARD_COUNT = 256;
+
 #if TD_THREAD_UNSUPPORTED || TD_EVENTFD_UNSUPPORTED
 class TdReceiver {
  public:
@@ -107,6 +110,26 @@ class ClientManager::Impl final {
     requests_.push_back({client_id, request_id, std::move(request)});
   }
 
+  bool set_receive_shard_count(int32 shard_count) {
+    // all responses are received through the only shard
+    return 1 <= shard_count && shard_count <= MAX_RECEIVE_SHARD_COUNT;
+  }
+
+  int32 get_receive_shard(ClientId client_id) const {
+    return 0;
+  }
+
+  bool set_hibernation_timeout(double hibernation_timeout) {
+    return hibernation_timeout == 0.0;
+  }
+
+  Response receive(int32 shard, double timeout) {
+    if (shard != 0) {
+      return {0, 0, nullptr};
+    }
+    return receive(timeout);
+  }
+
   Response receive(double timeout) {
     if (!requests_.empty()) {
       for (size_t i = 0; i < requests_.size(); i++) {
@@ -239,34 +262,44 @@ class MultiTd final : public Actor {
  public:
   explicit MultiTd(Td::Options options) : options_(std::move(options)) {
   }
-  void create(int32 td_id, unique_ptr<TdCallback> callback) {
-    auto &td = tds_[td_id];
-    CHECK(td.empty());
+  void create(int32 td_id, unique_ptr<TdCallback> callback, double hibernation_timeout) {
+    CHECK(tds_.count(td_id) == 0);
+    CHECK(hibernatable_tds_.count(td_id) == 0);
 
     string name = "Td";
     auto context = std::make_shared<ActorContext>();
     auto old_context = set_context(context);
     auto old_tag = set_tag(to_string(td_id));
-    td = create_actor<Td>("Td", std::move(callback), options_);
+    if (hibernation_timeout > 0) {
+      hibernatable_tds_[td_id] =
+          create_actor<HibernatableTd<Td>>("HibernatableTd", std::move(callback), options_, hibernation_timeout);
+    } else {
+      tds_[td_id] = create_actor<Td>("Td", std::move(callback), options_);
+    }
     set_context(std::move(old_context));
     set_tag(std::move(old_tag));
   }
 
   void send(ClientManager::ClientId client_id, ClientManager::RequestId request_id,
             td_api::object_ptr<td_api::Function> &&request) {
+    auto it = hibernatable_tds_.find(client_id);
+    if (it != hibernatable_tds_.end()) {
+      return send_closure(it->second, &HibernatableTd<Td>::request, request_id, std::move(request));
+    }
     auto &td = tds_[client_id];
     CHECK(!td.empty());
     send_closure(td, &Td::request, request_id, std::move(request));
   }
 
   void close(int32 td_id) {
-    size_t erased_count = tds_.erase(td_id);
+    size_t erased_count = tds_.erase(td_id) + hibernatable_tds_.erase(td_id);
     CHECK(erased_count > 0);
   }
 
  private:
   Td::Options options_;
   FlatHashMap<int32, ActorOwn<Td>> tds_;
+  FlatHashMap<int32, ActorOwn<HibernatableTd<Td>>> hibernatable_tds_;
 };
 
 class TdReceiver {
@@ -379,10 +412,10 @@ class MultiImpl {
     return static_cast<int32>(result);
   }
 
-  void create(int32 td_id, unique_ptr<TdCallback> callback) {
+  void create(int32 td_id, unique_ptr<TdCallback> callback, double hibernation_timeout) {
     LOG(INFO) << "Initialize client " << td_id;
     auto guard = concurrent_scheduler_->get_send_guard();
-    send_closure(multi_td_, &MultiTd::create, td_id, std::move(callback));
+    send_closure(multi_td_, &MultiTd::create, td_id, std::move(callback), hibernation_timeout);
   }
 
   static bool is_valid_client_id(int32 client_id) {
@@ -484,15 +517,47 @@ class ClientManager::Impl final {
     {
       auto lock = impls_mutex_.lock_write().move_as_ok();
       impls_[client_id];  // create empty MultiImplInfo
+      has_created_clients_ = true;
     }
     return client_id;
   }
 
+  bool set_receive_shard_count(int32 shard_count) {
+    if (shard_count < 1 || shard_count > MAX_RECEIVE_SHARD_COUNT) {
+      return false;
+    }
+    auto lock = impls_mutex_.lock_write().move_as_ok();
+    if (has_created_clients_) {
+      return static_cast<size_t>(shard_count) == receivers_.size();
+    }
+    receivers_.clear();
+    for (int32 i = 0; i < shard_count; i++) {
+      receivers_.push_back(make_unique<TdReceiver>());
+    }
+    return true;
+  }
+
+  int32 get_receive_shard(ClientId client_id) const {
+    return static_cast<int32>(static_cast<uint32>(client_id) % receivers_.size());
+  }
+
+  bool set_hibernation_timeout(double hibernation_timeout) {
+    if (hibernation_timeout < 0) {
+      return false;
+    }
+    auto lock = impls_mutex_.lock_write().move_as_ok();
+    if (has_created_clients_) {
+      return hibernation_timeout == hibernation_timeout_;
+    }
+    hibernation_timeout_ = hibernation_timeout;
+    return true;
+  }
+
   void send(ClientId client_id, RequestId request_id, td_api::object_ptr<td_api::Function> &&request) {
     auto lock = impls_mutex_.lock_read().move_as_ok();
     if (!MultiImpl::is_valid_client_id(client_id)) {
-      receiver_.add_response(client_id, request_id,
-                             td_api::make_object<td_api::error>(400, "Invalid TDLib instance specified"));
+      get_receiver(client_id).add_response(client_id, request_id,
+                                           td_api::make_object<td_api::error>(400, "Invalid TDLib instance specified"));
       return;
     }
 
@@ -504,7 +569,7 @@ class ClientManager::Impl final {
       it = impls_.find(client_id);
       if (it != impls_.end() && it->second.impl == nullptr) {
         it->second.impl = pool_.get();
-        it->second.impl->create(client_id, receiver_.create_callback(client_id));
+        it->second.impl->create(client_id, get_receiver(client_id).create_callback(client_id), hibernation_timeout_);
       }
       write_lock.reset();
 
@@ -512,14 +577,19 @@ class ClientManager::Impl final {
       it = impls_.find(client_id);
     }
     if (it == impls_.end() || it->second.is_closed) {
-      receiver_.add_response(client_id, request_id, td_api::make_object<td_api::error>(500, "Request aborted"));
+      get_receiver(client_id).add_response(client_id, request_id,
+                                           td_api::make_object<td_api::error>(500, "Request aborted"));
       return;
     }
     it->second.impl->send(client_id, request_id, std::move(request));
   }
 
-  Response receive(double timeout) {
-    auto response = receiver_.receive(timeout, true);
+  Response receive(int32 shard, double timeout) {
+    if (shard < 0 || static_cast<size_t>(shard) >= receivers_.size()) {
+      LOG(ERROR) << "Receive from invalid shard " << shard;
+      return {0, 0, nullptr};
+    }
+    auto response = receivers_[shard]->receive(timeout, true);
     if (response.request_id == 0 && response.object != nullptr &&
         response.object->get_id() == td_api::updateAuthorizationState::ID &&
         static_cast<const td_api::updateAuthorizationState *>(response.object.get())->authorization_state_->get_id() ==
@@ -555,14 +625,16 @@ class ClientManager::Impl final {
     if (!it->second.is_closed) {
       it->second.is_closed = true;
       if (it->second.impl == nullptr) {
-        receiver_.add_response(client_id, 0, nullptr);
+        get_receiver(client_id).add_response(client_id, 0, nullptr);
       } else {
         it->second.impl->close(client_id);
       }
     }
   }
 
-  Impl() = default;
+  Impl() {
+    receivers_.push_back(make_unique<TdReceiver>());
+  }
   Impl(const Impl &) = delete;
   Impl &operator=(const Impl &) = delete;
   Impl(Impl &&) = delete;
@@ -575,12 +647,19 @@ class ClientManager::Impl final {
     for (auto &it : impls_) {
       close_impl(it.first);
     }
+    auto shard_count = static_cast<int32>(receivers_.size());
     while (!impls_.empty() && !ExitGuard::is_exited()) {
-      receive(0.1);
+      for (int32 shard = 0; shard < shard_count; shard++) {
+        receive(shard, 0.1 / shard_count);
+      }
     }
   }
 
  private:
+  TdReceiver &get_receiver(ClientId client_id) {
+    return *receivers_[get_receive_shard(client_id)];
+  }
+
   MultiImplPool pool_;
   RwMutex impls_mutex_;
   struct MultiImplInfo {
@@ -588,7 +667,9 @@ class ClientManager::Impl final {
     bool is_closed = false;
   };
   FlatHashMap<ClientId, MultiImplInfo> impls_;
-  TdReceiver receiver_;
+  bool has_created_clients_ = false;
+  double hibernation_timeout_ = 0.0;
+  vector<unique_ptr<TdReceiver>> receivers_;
 };
 
 class Client::Impl final {
@@ -598,7 +679,7 @@ class Client::Impl final {
     multi_impl_ = pool.get();
     td_id_ = MultiImpl::create_id();
     LOG(INFO) << "Create client " << td_id_;
-    multi_impl_->create(td_id_, receiver_.create_callback(td_id_));
+    multi_impl_->create(td_id_, receiver_.create_callback(td_id_), 0.0);
   }
 
   void send(Request request) {
@@ -676,7 +757,23 @@ void ClientManager::send(ClientId client_id, RequestId request_id, td_api::objec
 }
 
 ClientManager::Response ClientManager::receive(double timeout) {
-  return impl_->receive(timeout);
+  return impl_->receive(0, timeout);
+}
+
+bool ClientManager::set_receive_shard_count(int32 shard_count) {
+  return impl_->set_receive_shard_count(shard_count);
+}
+
+int32 ClientManager::get_receive_shard(ClientId client_id) const {
+  return impl_->get_receive_shard(client_id);
+}
+
+ClientManager::Response ClientManager::receive(int32 shard, double timeout) {
+  return impl_->receive(shard, timeout);
+}
+
+bool ClientManager::set_hibernation_timeout(double hibernation_timeout) {
+  return impl_->set_hibernation_timeout(hibernation_timeout);
 }
 
 td_api::object_ptr<td_api::Object> ClientManager::execute(td_api::object_ptr<td_api::Function> &&request) {
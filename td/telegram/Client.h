@@ -108,13 +108,52 @@ class ClientManager final {
 
   /**
    * Receives incoming updates and responses to requests from TDLib. May be called from any thread, but must not be
-   * called simultaneously from two different threads.
+   * called simultaneously from two different threads. If set_receive_shard_count was used, then only updates and
+   * responses to requests of the shard 0 are received.
    * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
    * \return An incoming update or response to a request. The object returned in the response may be a nullptr
    *         if the timeout expires.
    */
   Response receive(double timeout);
 
+  /**
+   * Enables receiving of updates and responses to requests from several threads at once. Updates and responses for
+   * a TDLib client instance are received only through the shard get_receive_shard(client_id) in the order they were
+   * sent by the instance. Must be called before the first TDLib instance is created and must not be called
+   * simultaneously with other methods of the client manager.
+   * \param[in] shard_count The number of receive shards; 1-256.
+   * \return True on success, or false if the number of shards can't be changed anymore.
+   */
+  bool set_receive_shard_count(std::int32_t shard_count);
+
+  /**
+   * Returns the shard through which updates and responses to requests for the TDLib instance are received.
+   * \param[in] client_id TDLib client instance identifier.
+   * \return Receive shard identifier between 0 and shard_count - 1.
+   */
+  std::int32_t get_receive_shard(ClientId client_id) const;
+
+  /**
+   * Receives incoming updates and responses to requests from TDLib for the TDLib instances of the given shard.
+   * May be called from any thread, but must not be called simultaneously from two different threads for the same shard.
+   * \param[in] shard Receive shard identifier.
+   * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+   * \return An incoming update or response to a request. The object returned in the response may be a nullptr
+   *         if the timeout expires.
+   */
+  Response receive(std::int32_t shard, double timeout);
+
+  /**
+   * Enables hibernation of idle TDLib instances. A logged in TDLib instance without running requests, which didn't
+   * receive requests and didn't send updates for the specified time, is closed to free all its resources.
+   * The instance is transparently reopened with the same TDLib parameters on the next request to it. Updates aren't
+   * received by a hibernated instance. Must be called before the first TDLib instance is created.
+   * \param[in] hibernation_timeout The idle time in seconds after which TDLib instances are hibernated, or 0 if
+   *                                the instances must never be hibernated.
+   * \return True on success, or false if hibernation isn't supported or can't be configured anymore.
+   */
+  bool set_hibernation_timeout(double hibernation_timeout);
+
   /**
    * Synchronously executes a TDLib request.
    * A request can be executed synchronously, only if it is documented with "Can be called synchronously".
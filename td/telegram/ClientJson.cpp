@@ -135,8 +135,7 @@ void json_send(int client_id, Slice request) {
   get_manager()->send(client_id, request_id, std::move(parsed_request.first));
 }
 
-const char *json_receive(double timeout) {
-  auto response = get_manager()->receive(timeout);
+static const char *json_response(ClientManager::Response response) {
   if (!response.object) {
     return nullptr;
   }
@@ -153,6 +152,22 @@ const char *json_receive(double timeout) {
   return store_string(from_response(*response.object, extra_str, response.client_id));
 }
 
+const char *json_receive(double timeout) {
+  return json_response(get_manager()->receive(timeout));
+}
+
+bool json_set_receive_shard_count(int shard_count) {
+  return get_manager()->set_receive_shard_count(shard_count);
+}
+
+int json_get_receive_shard(int client_id) {
+  return get_manager()->get_receive_shard(client_id);
+}
+
+const char *json_receive_shard(int shard, double timeout) {
+  return json_response(get_manager()->receive(shard, timeout));
+}
+
 const char *json_execute(Slice request) {
   auto parsed_request = to_request(request);
   return store_string(
@@ -40,6 +40,12 @@ void json_send(int client_id, Slice request);
 
 const char *json_receive(double timeout);
 
+bool json_set_receive_shard_count(int shard_count);
+
+int json_get_receive_shard(int client_id);
+
+const char *json_receive_shard(int shard, double timeout);
+
 const char *json_execute(Slice request);
 
 }  // namespace td
@@ -8,6 +8,7 @@
 
 #include "td/telegram/Version.h"
 
+#include "td/db/BlobDictionaryDb.h"
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteStatement.h"
@@ -15,6 +16,7 @@
 #include "td/actor/actor.h"
 #include "td/actor/SchedulerLocalStorage.h"
 
+#include "td/utils/BlobCompressor.h"
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
@@ -116,6 +118,7 @@ class DialogDbImpl final : public DialogDbSyncInterface {
   }
 
   Status init() {
+    TRY_RESULT_ASSIGN(blob_compressor_, load_blob_compressor(db_));
     TRY_RESULT_ASSIGN(add_dialog_stmt_, db_.get_statement("INSERT OR REPLACE INTO dialogs VALUES(?1, ?2, ?3, ?4)"));
     TRY_RESULT_ASSIGN(add_notification_group_stmt_,
                       db_.get_statement("INSERT OR REPLACE INTO notification_groups VALUES(?1, ?2, ?3)"));
@@ -160,6 +163,7 @@ class DialogDbImpl final : public DialogDbSyncInterface {
     };
     add_dialog_stmt_.bind_int64(1, dialog_id.get()).ensure();
     add_dialog_stmt_.bind_int64(2, order).ensure();
+    data = blob_compressor_.compress(std::move(data));
     add_dialog_stmt_.bind_blob(3, data.as_slice()).ensure();
     if (order > 0) {
       add_dialog_stmt_.bind_int32(4, folder_id.get()).ensure();
@@ -202,7 +206,7 @@ class DialogDbImpl final : public DialogDbSyncInterface {
     if (!get_dialog_stmt_.has_row()) {
       return Status::Error("Not found");
     }
-    return BufferSlice(get_dialog_stmt_.view_blob(0));
+    return blob_compressor_.decompress(get_dialog_stmt_.view_blob(0));
   }
 
   Result<NotificationGroupKey> get_notification_group(NotificationGroupId notification_group_id) final {
@@ -243,11 +247,17 @@ class DialogDbImpl final : public DialogDbSyncInterface {
     result.next_order = order;
     get_dialogs_stmt_.step().ensure();
     while (get_dialogs_stmt_.has_row()) {
-      BufferSlice data(get_dialogs_stmt_.view_blob(0));
+      auto r_data = blob_compressor_.decompress(get_dialogs_stmt_.view_blob(0));
       result.next_dialog_id = DialogId(get_dialogs_stmt_.view_int64(1));
       result.next_order = get_dialogs_stmt_.view_int64(2);
       LOG(INFO) << "Load " << result.next_dialog_id << " with order " << result.next_order;
-      result.dialogs.emplace_back(std::move(data));
+      if (r_data.is_error()) {
+        // the chat will be skipped as a chat with broken data
+        LOG(ERROR) << "Failed to decompress data of " << result.next_dialog_id << ": " << r_data.error();
+        result.dialogs.emplace_back();
+      } else {
+        result.dialogs.push_back(r_data.move_as_ok());
+      }
       get_dialogs_stmt_.step().ensure();
     }
 
@@ -289,6 +299,7 @@ class DialogDbImpl final : public DialogDbSyncInterface {
 
  private:
   SqliteDb db_;
+  BlobCompressor blob_compressor_;
 
   SqliteStatement add_dialog_stmt_;
   SqliteStatement add_notification_group_stmt_;
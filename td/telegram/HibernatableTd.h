@@ -0,0 +1,262 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/td_api.h"
+#include "td/telegram/TdCallback.h"
+
+#include "td/actor/actor.h"
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/logging.h"
+
+#include <limits>
+#include <utility>
+
+namespace td {
+
+// owns a Td, which is closed after a period of inactivity to free all its memory and is transparently reopened
+// with the same parameters on the next request
+template <class TdT>
+class HibernatableTd final : public Actor {
+ public:
+  HibernatableTd(unique_ptr<TdCallback> callback, typename TdT::Options options, double idle_timeout)
+      : callback_(std::move(callback)), options_(std::move(options)), idle_timeout_(idle_timeout) {
+  }
+
+  void request(uint64 id, td_api::object_ptr<td_api::Function> function) {
+    if (function != nullptr) {
+      switch (function->get_id()) {
+        case td_api::setTdlibParameters::ID:
+          tdlib_parameters_ = copy_tdlib_parameters(static_cast<const td_api::setTdlibParameters &>(*function));
+          break;
+        case td_api::setDatabaseEncryptionKey::ID:
+          // the key must be used to reopen the database after it is successfully changed
+          pending_database_encryption_keys_[id] =
+              static_cast<const td_api::setDatabaseEncryptionKey &>(*function).new_encryption_key_;
+          break;
+        case td_api::close::ID:
+        case td_api::logOut::ID:
+        case td_api::destroy::ID:
+          is_closing_ = true;
+          break;
+        default:
+          break;
+      }
+    }
+    if (state_ != State::Active) {
+      pending_requests_.emplace_back(id, std::move(function));
+      if (state_ == State::Hibernated) {
+        resume();
+      }
+      return;
+    }
+    send_request(id, std::move(function));
+  }
+
+ private:
+  static constexpr uint64 RESUME_REQUEST_ID = std::numeric_limits<uint64>::max();
+
+  enum class State : int32 { Active, Hibernating, Hibernated, Resuming };
+
+  class Callback final : public TdCallback {
+   public:
+    explicit Callback(ActorId<HibernatableTd> parent) : parent_(std::move(parent)) {
+    }
+    void on_result(uint64 id, td_api::object_ptr<td_api::Object> result) final {
+      send_closure(parent_, &HibernatableTd::on_td_result, id, std::move(result));
+    }
+    void on_error(uint64 id, td_api::object_ptr<td_api::error> error) final {
+      send_closure(parent_, &HibernatableTd::on_td_error, id, std::move(error));
+    }
+    Callback(const Callback &) = delete;
+    Callback &operator=(const Callback &) = delete;
+    Callback(Callback &&) = delete;
+    Callback &operator=(Callback &&) = delete;
+    ~Callback() final {
+      send_closure(parent_, &HibernatableTd::on_td_closed);
+    }
+
+   private:
+    ActorId<HibernatableTd> parent_;
+  };
+
+  unique_ptr<TdCallback> callback_;
+  typename TdT::Options options_;
+  double idle_timeout_;
+  ActorOwn<TdT> td_;
+  State state_ = State::Active;
+  td_api::object_ptr<td_api::setTdlibParameters> tdlib_parameters_;
+  bool is_ready_ = false;
+  bool is_closing_ = false;
+  int32 running_request_count_ = 0;
+  vector<std::pair<uint64, td_api::object_ptr<td_api::Function>>> pending_requests_;
+  FlatHashMap<uint64, string> pending_database_encryption_keys_;
+
+  static td_api::object_ptr<td_api::setTdlibParameters> copy_tdlib_parameters(
+      const td_api::setTdlibParameters &parameters) {
+    return td_api::make_object<td_api::setTdlibParameters>(
+        parameters.use_test_dc_, parameters.database_directory_, parameters.files_directory_,
+        parameters.database_encryption_key_, parameters.use_file_database_, parameters.use_chat_info_database_,
+        parameters.use_message_database_, parameters.use_secret_chats_, parameters.api_id_, parameters.api_hash_,
+        parameters.system_language_code_, parameters.device_model_, parameters.system_version_,
+        parameters.application_version_);
+  }
+
+  void start_up() final {
+    create_td();
+  }
+
+  void hangup() final {
+    is_closing_ = true;
+    if (td_.empty()) {
+      if (state_ != State::Hibernating) {
+        fail_pending_requests();
+        stop();
+      }
+      return;
+    }
+    td_.reset();
+  }
+
+  void timeout_expired() final {
+    if (state_ != State::Active || !is_ready_ || is_closing_ || running_request_count_ != 0 ||
+        tdlib_parameters_ == nullptr) {
+      return;
+    }
+
+    LOG(INFO) << "Hibernate idle Td";
+    state_ = State::Hibernating;
+    td_.reset();
+  }
+
+  void create_td() {
+    CHECK(td_.empty());
+    td_ = create_actor<TdT>("Td", td::make_unique<Callback>(actor_id(this)), options_);
+  }
+
+  void resume() {
+    CHECK(state_ == State::Hibernated);
+    CHECK(tdlib_parameters_ != nullptr);
+    LOG(INFO) << "Resume hibernated Td";
+    state_ = State::Resuming;
+    create_td();
+    send_closure(td_, &TdT::request, RESUME_REQUEST_ID, copy_tdlib_parameters(*tdlib_parameters_));
+  }
+
+  void on_resumed() {
+    CHECK(state_ == State::Resuming);
+    if (td_.empty()) {
+      // the instance is being closed; pending requests will be failed after the Td is closed
+      return;
+    }
+    state_ = State::Active;
+    auto pending_requests = std::move(pending_requests_);
+    for (auto &request : pending_requests) {
+      send_request(request.first, std::move(request.second));
+    }
+    set_timeout_in(idle_timeout_);
+  }
+
+  // the requests weren't sent to a Td, so they must be answered here
+  void fail_pending_requests() {
+    auto pending_requests = std::move(pending_requests_);
+    for (auto &request : pending_requests) {
+      callback_->on_error(request.first, td_api::make_object<td_api::error>(500, "Request aborted"));
+    }
+  }
+
+  void send_request(uint64 id, td_api::object_ptr<td_api::Function> function) {
+    CHECK(state_ == State::Active);
+    running_request_count_++;
+    send_closure(td_, &TdT::request, id, std::move(function));
+  }
+
+  void on_request_finished(uint64 id, bool is_ok) {
+    auto it = pending_database_encryption_keys_.find(id);
+    if (it == pending_database_encryption_keys_.end()) {
+      return;
+    }
+    if (is_ok && tdlib_parameters_ != nullptr) {
+      tdlib_parameters_->database_encryption_key_ = std::move(it->second);
+    }
+    pending_database_encryption_keys_.erase(it);
+  }
+
+  void on_td_result(uint64 id, td_api::object_ptr<td_api::Object> result) {
+    if (id == RESUME_REQUEST_ID) {
+      if (state_ == State::Resuming) {
+        on_resumed();
+      }
+      return;
+    }
+    if (id == 0 && result != nullptr && result->get_id() == td_api::updateAuthorizationState::ID) {
+      auto authorization_state_id =
+          static_cast<const td_api::updateAuthorizationState &>(*result).authorization_state_->get_id();
+      if (state_ == State::Resuming) {
+        if (authorization_state_id == td_api::authorizationStateWaitTdlibParameters::ID) {
+          return;
+        }
+        // the authorization state has changed while the Td was hibernated
+        is_ready_ = authorization_state_id == td_api::authorizationStateReady::ID;
+        on_resumed();
+        if (is_ready_) {
+          return;
+        }
+      }
+      is_ready_ = authorization_state_id == td_api::authorizationStateReady::ID;
+    }
+    if (state_ != State::Active) {
+      // the instance is being closed or reopened; the client already knows everything
+      return;
+    }
+
+    if (id != 0) {
+      CHECK(running_request_count_ > 0);
+      running_request_count_--;
+      on_request_finished(id, true);
+    }
+    set_timeout_in(idle_timeout_);
+    callback_->on_result(id, std::move(result));
+  }
+
+  void on_td_error(uint64 id, td_api::object_ptr<td_api::error> error) {
+    if (id == RESUME_REQUEST_ID) {
+      LOG_IF(ERROR, !td_.empty()) << "Failed to resume hibernated Td: " << error->code_ << ' ' << error->message_;
+      if (state_ == State::Resuming) {
+        on_resumed();
+      }
+      return;
+    }
+    CHECK(state_ == State::Active);
+    CHECK(running_request_count_ > 0);
+    running_request_count_--;
+    on_request_finished(id, false);
+    set_timeout_in(idle_timeout_);
+    callback_->on_error(id, std::move(error));
+  }
+
+  void on_td_closed() {
+    if (is_closing_) {
+      fail_pending_requests();
+      return stop();
+    }
+    CHECK(state_ == State::Hibernating);
+    state_ = State::Hibernated;
+    is_ready_ = false;
+    running_request_count_ = 0;
+    if (!pending_requests_.empty()) {
+      resume();
+    }
+  }
+};
+
+template <class TdT>
+constexpr uint64 HibernatableTd<TdT>::RESUME_REQUEST_ID;
+
+}  // namespace td
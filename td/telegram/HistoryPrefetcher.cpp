@@ -0,0 +1,151 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/HistoryPrefetcher.h"
+
+#include "td/utils/logging.h"
+
+namespace td {
+
+constexpr size_t HistoryPrefetcher::MAX_PREFETCHES;
+
+uint64 HistoryPrefetcher::on_page_loaded(DialogId dialog_id, MessageId from_message_id, bool from_the_end,
+                                         MessageId next_from_message_id, MessageId last_database_message_id,
+                                         vector<WaitingQuery> &dropped_queries) {
+  bool is_next_page = false;
+  auto it = prefetches_.find(dialog_id);
+  if (it != prefetches_.end()) {
+    auto &prefetch = it->second;
+    if (prefetch.prefetch_id_ != 0 && prefetch.next_page_message_id_ == next_from_message_id) {
+      // the same page was loaded again; the next page is already being prefetched
+      return 0;
+    }
+    is_next_page = !from_the_end && prefetch.next_page_message_id_ == from_message_id;
+    drop_prefetch(dialog_id, prefetch, dropped_queries);
+    prefetches_.erase(it);
+  }
+  if (!next_from_message_id.is_valid()) {
+    return 0;
+  }
+
+  if (prefetches_.size() >= MAX_PREFETCHES) {
+    // forget the oldest chat
+    auto oldest_it = prefetches_.begin();
+    for (auto prefetch_it = prefetches_.begin(); prefetch_it != prefetches_.end(); ++prefetch_it) {
+      if (prefetch_it->second.generation_ < oldest_it->second.generation_) {
+        oldest_it = prefetch_it;
+      }
+    }
+    drop_prefetch(oldest_it->first, oldest_it->second, dropped_queries);
+    prefetches_.erase(oldest_it);
+  }
+
+  auto &prefetch = prefetches_[dialog_id];
+  prefetch.generation_ = ++current_generation_;
+  prefetch.next_page_message_id_ = next_from_message_id;
+  if (!is_next_page) {
+    // the history may be never scrolled further
+    return 0;
+  }
+
+  prefetch.prefetch_id_ = prefetch.generation_;
+  prefetch.old_last_database_message_id_ = last_database_message_id;
+  return prefetch.prefetch_id_;
+}
+
+bool HistoryPrefetcher::on_prefetch_loaded(DialogId dialog_id, uint64 prefetch_id,
+                                           vector<MessageDbDialogMessage> &&messages, WaitingQuery &waiting_query,
+                                           Page &page) {
+  auto it = prefetches_.find(dialog_id);
+  if (it == prefetches_.end() || it->second.prefetch_id_ != prefetch_id) {
+    // the prefetch was dropped, because the database was changed
+    return false;
+  }
+
+  auto &prefetch = it->second;
+  CHECK(!prefetch.is_loaded_);
+  prefetch.is_loaded_ = true;
+  prefetch.messages_ = std::move(messages);
+  if (!prefetch.waiting_promise_) {
+    return false;
+  }
+
+  waiting_query.dialog_id_ = dialog_id;
+  waiting_query.from_message_id_ = prefetch.next_page_message_id_;
+  waiting_query.limit_ = prefetch.waiting_limit_;
+  waiting_query.only_local_ = prefetch.waiting_only_local_;
+  waiting_query.promise_ = std::move(prefetch.waiting_promise_);
+  page = take_page(prefetch, waiting_query.limit_);
+  return true;
+}
+
+HistoryPrefetcher::GetPageResult HistoryPrefetcher::get_page(DialogId dialog_id, MessageId from_message_id,
+                                                             int32 limit, bool only_local, Promise<Unit> &promise,
+                                                             Page &page) {
+  auto it = prefetches_.find(dialog_id);
+  if (it == prefetches_.end() || it->second.prefetch_id_ == 0 || it->second.next_page_message_id_ != from_message_id ||
+      limit > page_size_) {
+    return GetPageResult::NotFound;
+  }
+
+  auto &prefetch = it->second;
+  if (!prefetch.is_loaded_) {
+    if (prefetch.waiting_promise_) {
+      return GetPageResult::NotFound;
+    }
+    prefetch.waiting_limit_ = limit;
+    prefetch.waiting_only_local_ = only_local;
+    prefetch.waiting_promise_ = std::move(promise);
+    return GetPageResult::Waiting;
+  }
+
+  page = take_page(prefetch, limit);
+  return GetPageResult::Found;
+}
+
+vector<HistoryPrefetcher::WaitingQuery> HistoryPrefetcher::drop_prefetch(DialogId dialog_id) {
+  vector<WaitingQuery> dropped_queries;
+  auto it = prefetches_.find(dialog_id);
+  if (it != prefetches_.end()) {
+    // the chat is still scrolled, so the next page can be prefetched again
+    drop_prefetch(dialog_id, it->second, dropped_queries);
+  }
+  return dropped_queries;
+}
+
+void HistoryPrefetcher::drop_prefetch(DialogId dialog_id, Prefetch &prefetch, vector<WaitingQuery> &dropped_queries) {
+  if (prefetch.waiting_promise_) {
+    // the prefetched messages can be outdated, so the waiting query must be repeated
+    WaitingQuery query;
+    query.dialog_id_ = dialog_id;
+    query.from_message_id_ = prefetch.next_page_message_id_;
+    query.limit_ = prefetch.waiting_limit_;
+    query.only_local_ = prefetch.waiting_only_local_;
+    query.promise_ = std::move(prefetch.waiting_promise_);
+    dropped_queries.push_back(std::move(query));
+  }
+  prefetch.prefetch_id_ = 0;
+  prefetch.is_loaded_ = false;
+  prefetch.messages_.clear();
+}
+
+HistoryPrefetcher::Page HistoryPrefetcher::take_page(Prefetch &prefetch, int32 limit) {
+  CHECK(prefetch.is_loaded_);
+  // messages are sorted by decreasing message identifier after the first message,
+  // so the result of the query with a smaller limit is a prefix of the prefetched result
+  Page page;
+  page.old_last_database_message_id_ = prefetch.old_last_database_message_id_;
+  page.messages_ = std::move(prefetch.messages_);
+  if (page.messages_.size() > static_cast<size_t>(limit)) {
+    page.messages_.resize(limit);
+  }
+  prefetch.prefetch_id_ = 0;
+  prefetch.is_loaded_ = false;
+  prefetch.messages_.clear();
+  return page;
+}
+
+}  // namespace td
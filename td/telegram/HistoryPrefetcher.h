@@ -0,0 +1,92 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/DialogId.h"
+#include "td/telegram/MessageDb.h"
+#include "td/telegram/MessageId.h"
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Promise.h"
+
+namespace td {
+
+// keeps raw database messages of the next page of chat history, which is likely to be requested next,
+// because the history is scrolled back page by page
+// the next page is prefetched only after the second consecutive page request, so opening a chat doesn't prefetch
+class HistoryPrefetcher {
+ public:
+  // a query, which was waiting for a dropped prefetch and must be sent to the database again
+  struct WaitingQuery {
+    DialogId dialog_id_;
+    MessageId from_message_id_;
+    int32 limit_ = 0;
+    bool only_local_ = false;
+    Promise<Unit> promise_;
+  };
+
+  struct Page {
+    MessageId old_last_database_message_id_;
+    vector<MessageDbDialogMessage> messages_;
+  };
+
+  enum class GetPageResult : int32 { NotFound, Waiting, Found };
+
+  explicit HistoryPrefetcher(int32 page_size) : page_size_(page_size) {
+  }
+
+  // must be called after a page of history is loaded from the database from the end or with offset -1
+  // next_from_message_id must be the message, from which the next page will be loaded, or empty if there is none
+  // returns identifier of the prefetch of page_size messages from next_from_message_id, which must be started,
+  // or 0 if the next page must not be prefetched
+  uint64 on_page_loaded(DialogId dialog_id, MessageId from_message_id, bool from_the_end,
+                        MessageId next_from_message_id, MessageId last_database_message_id,
+                        vector<WaitingQuery> &dropped_queries);
+
+  // returns true and the page for the waiting query, if the query can be answered now
+  bool on_prefetch_loaded(DialogId dialog_id, uint64 prefetch_id, vector<MessageDbDialogMessage> &&messages,
+                          WaitingQuery &waiting_query, Page &page);
+
+  // returns the prefetched page if it is loaded or takes the promise to wait for the page if it is being loaded
+  GetPageResult get_page(DialogId dialog_id, MessageId from_message_id, int32 limit, bool only_local,
+                         Promise<Unit> &promise, Page &page);
+
+  // must be called whenever messages of the chat are changed in the database
+  vector<WaitingQuery> drop_prefetch(DialogId dialog_id);
+
+ private:
+  static constexpr size_t MAX_PREFETCHES = 16;
+
+  struct Prefetch {
+    uint64 generation_ = 0;
+
+    // the message, from which the next page is expected to be requested
+    MessageId next_page_message_id_;
+
+    // non-zero if the next page is being prefetched
+    uint64 prefetch_id_ = 0;
+    MessageId old_last_database_message_id_;
+    bool is_loaded_ = false;
+    vector<MessageDbDialogMessage> messages_;
+
+    // the query, which is waiting for the prefetch to finish
+    int32 waiting_limit_ = 0;
+    bool waiting_only_local_ = false;
+    Promise<Unit> waiting_promise_;
+  };
+
+  int32 page_size_ = 0;
+  uint64 current_generation_ = 0;
+  FlatHashMap<DialogId, Prefetch, DialogIdHash> prefetches_;
+
+  static void drop_prefetch(DialogId dialog_id, Prefetch &prefetch, vector<WaitingQuery> &dropped_queries);
+
+  static Page take_page(Prefetch &prefetch, int32 limit);
+};
+
+}  // namespace td
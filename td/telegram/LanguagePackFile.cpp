@@ -0,0 +1,209 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/LanguagePackFile.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace td {
+
+constexpr uint32 LanguagePackFile::MAGIC;
+constexpr uint32 LanguagePackFile::FORMAT_VERSION;
+
+// the hash is a part of the file format, so it must not depend on the platform
+uint64 LanguagePackFile::get_key_hash(Slice key) {
+  uint64 hash = 0xcbf29ce484222325ULL;
+  for (auto c : key) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+uint32 LanguagePackFile::get_slot(uint64 hash, uint32 displacement, uint32 slot_count) {
+  uint64 x = hash + static_cast<uint64>(displacement) * 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return static_cast<uint32>(x % slot_count);
+}
+
+Status LanguagePackFile::write(CSlice path, int32 version, int32 key_count,
+                               const vector<std::pair<Slice, Slice>> &strings) {
+  const size_t MAX_STRING_COUNT = 1 << 24;
+  if (strings.size() > MAX_STRING_COUNT) {
+    return Status::Error("Too many strings");
+  }
+  auto string_count = static_cast<uint32>(strings.size());
+  auto bucket_count = td::max(string_count / 4, static_cast<uint32>(1));
+  auto slot_count = string_count + string_count / 8 + 1;
+
+  uint64 data_size = 0;
+  vector<uint64> hashes(string_count);
+  vector<vector<uint32>> buckets(bucket_count);
+  for (uint32 i = 0; i < string_count; i++) {
+    const auto &str = strings[i];
+    if (str.first.empty() || str.second.empty()) {
+      return Status::Error("Have an empty string");
+    }
+    data_size += str.first.size() + str.second.size();
+    hashes[i] = get_key_hash(str.first);
+    buckets[(hashes[i] >> 32) % bucket_count].push_back(i);
+  }
+  if (data_size > std::numeric_limits<uint32>::max()) {
+    return Status::Error("Language pack is too big");
+  }
+
+  // place the biggest buckets first, while almost all slots are free
+  vector<uint32> bucket_order(bucket_count);
+  for (uint32 i = 0; i < bucket_count; i++) {
+    bucket_order[i] = i;
+  }
+  std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                   [&buckets](uint32 lhs, uint32 rhs) { return buckets[lhs].size() > buckets[rhs].size(); });
+
+  const uint32 MAX_DISPLACEMENT = 1 << 20;
+  const uint32 EMPTY_SLOT = std::numeric_limits<uint32>::max();
+  vector<uint32> displacements(bucket_count, 0);
+  vector<uint32> slot_strings(slot_count, EMPTY_SLOT);
+  vector<uint32> bucket_slots;
+  for (auto bucket_id : bucket_order) {
+    const auto &bucket = buckets[bucket_id];
+    if (bucket.empty()) {
+      break;
+    }
+    for (size_t i = 0; i < bucket.size(); i++) {
+      for (size_t j = 0; j < i; j++) {
+        if (hashes[bucket[i]] == hashes[bucket[j]]) {
+          if (strings[bucket[i]].first == strings[bucket[j]].first) {
+            return Status::Error(PSLICE() << "Have duplicate key " << strings[bucket[i]].first);
+          }
+          return Status::Error("Have a key hash collision");
+        }
+      }
+    }
+    uint32 displacement = 0;
+    while (true) {
+      if (displacement == MAX_DISPLACEMENT) {
+        return Status::Error("Failed to build perfect hash");
+      }
+      bucket_slots.clear();
+      bool is_ok = true;
+      for (auto string_id : bucket) {
+        auto slot = get_slot(hashes[string_id], displacement, slot_count);
+        if (slot_strings[slot] != EMPTY_SLOT || td::contains(bucket_slots, slot)) {
+          is_ok = false;
+          break;
+        }
+        bucket_slots.push_back(slot);
+      }
+      if (is_ok) {
+        break;
+      }
+      displacement++;
+    }
+    displacements[bucket_id] = displacement;
+    for (size_t i = 0; i < bucket.size(); i++) {
+      slot_strings[bucket_slots[i]] = bucket[i];
+    }
+  }
+
+  Header header;
+  header.magic = MAGIC;
+  header.format_version = FORMAT_VERSION;
+  header.version = version;
+  header.key_count = key_count;
+  header.bucket_count = bucket_count;
+  header.slot_count = slot_count;
+  header.data_size = static_cast<uint32>(data_size);
+  header.reserved = 0;
+
+  vector<Entry> entries(slot_count);
+  string data;
+  data.reserve(static_cast<size_t>(data_size));
+  for (uint32 slot = 0; slot < slot_count; slot++) {
+    auto &entry = entries[slot];
+    auto string_id = slot_strings[slot];
+    if (string_id == EMPTY_SLOT) {
+      std::memset(&entry, 0, sizeof(entry));
+      continue;
+    }
+    const auto &str = strings[string_id];
+    entry.key_offset = static_cast<uint32>(data.size());
+    entry.key_size = static_cast<uint32>(str.first.size());
+    data.append(str.first.begin(), str.first.size());
+    entry.value_offset = static_cast<uint32>(data.size());
+    entry.value_size = static_cast<uint32>(str.second.size());
+    data.append(str.second.begin(), str.second.size());
+  }
+
+  string file;
+  file.reserve(sizeof(Header) + bucket_count * sizeof(uint32) + slot_count * sizeof(Entry) + data.size());
+  file.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.append(reinterpret_cast<const char *>(displacements.data()), bucket_count * sizeof(uint32));
+  file.append(reinterpret_cast<const char *>(entries.data()), slot_count * sizeof(Entry));
+  file.append(data);
+  return atomic_write_file(path, file);
+}
+
+Status LanguagePackFile::check(Slice file) {
+  if (file.size() < sizeof(Header)) {
+    return Status::Error("File is too small");
+  }
+  Header header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (header.magic != MAGIC || header.format_version != FORMAT_VERSION) {
+    return Status::Error("Wrong file format");
+  }
+  if (header.bucket_count == 0 || header.slot_count == 0) {
+    return Status::Error("Wrong hash table size");
+  }
+  auto expected_size = static_cast<uint64>(sizeof(Header)) + static_cast<uint64>(header.bucket_count) * sizeof(uint32) +
+                       static_cast<uint64>(header.slot_count) * sizeof(Entry) + header.data_size;
+  if (expected_size != file.size()) {
+    return Status::Error(PSLICE() << "Wrong file size " << file.size() << " instead of " << expected_size);
+  }
+  auto entries = reinterpret_cast<const Entry *>(file.data() + sizeof(Header) + header.bucket_count * sizeof(uint32));
+  for (uint32 i = 0; i < header.slot_count; i++) {
+    const auto &entry = entries[i];
+    if (entry.key_size == 0) {
+      continue;
+    }
+    if (static_cast<uint64>(entry.key_offset) + entry.key_size > header.data_size ||
+        static_cast<uint64>(entry.value_offset) + entry.value_size > header.data_size || entry.value_size == 0) {
+      return Status::Error(PSLICE() << "Have wrong entry " << i);
+    }
+  }
+  return Status::OK();
+}
+
+Result<LanguagePackFile> LanguagePackFile::open(CSlice path) {
+  TRY_RESULT(fd, FileFd::open(path, FileFd::Read));
+  TRY_RESULT(mapping, MemoryMapping::create_from_file(fd));
+  fd.close();
+  TRY_STATUS(check(mapping.as_slice()));
+  return LanguagePackFile(std::move(mapping));
+}
+
+Slice LanguagePackFile::get(Slice key) const {
+  const auto &file_header = header();
+  auto hash = get_key_hash(key);
+  auto displacement = displacements()[(hash >> 32) % file_header.bucket_count];
+  const auto &entry = entries()[get_slot(hash, displacement, file_header.slot_count)];
+  if (entry.key_size != key.size() || entry.key_size == 0 || data().substr(entry.key_offset, entry.key_size) != key) {
+    return Slice();
+  }
+  return data().substr(entry.value_offset, entry.value_size);
+}
+
+}  // namespace td
@@ -0,0 +1,103 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/port/MemoryMapping.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+#include <utility>
+
+namespace td {
+
+// immutable memory-mapped snapshot of a full language pack
+// strings are stored in the database format: '1' + value or '2' + six '\0'-separated values
+// keys are indexed by a hash-and-displace perfect hash, so a lookup reads one displacement and one entry
+class LanguagePackFile {
+ public:
+  static Status write(CSlice path, int32 version, int32 key_count, const vector<std::pair<Slice, Slice>> &strings);
+
+  static Result<LanguagePackFile> open(CSlice path);
+
+  int32 get_version() const {
+    return header().version;
+  }
+
+  int32 get_key_count() const {
+    return header().key_count;
+  }
+
+  // returns an empty Slice if there is no such key; the returned Slice is valid while the file is alive
+  Slice get(Slice key) const;
+
+  bool has(Slice key) const {
+    return !get(key).empty();
+  }
+
+  template <class F>
+  void for_each(F &&f) const {
+    auto slot_count = header().slot_count;
+    for (uint32 i = 0; i < slot_count; i++) {
+      const auto &entry = entries()[i];
+      if (entry.key_size != 0) {
+        f(data().substr(entry.key_offset, entry.key_size), data().substr(entry.value_offset, entry.value_size));
+      }
+    }
+  }
+
+ private:
+  struct Header {
+    uint32 magic;
+    uint32 format_version;
+    int32 version;
+    int32 key_count;
+    uint32 bucket_count;
+    uint32 slot_count;
+    uint32 data_size;
+    uint32 reserved;
+  };
+
+  struct Entry {
+    uint32 key_offset;
+    uint32 key_size;
+    uint32 value_offset;
+    uint32 value_size;
+  };
+
+  static constexpr uint32 MAGIC = 0x4b50474c;  // "LGPK"
+  static constexpr uint32 FORMAT_VERSION = 1;
+
+  MemoryMapping mapping_;
+
+  explicit LanguagePackFile(MemoryMapping &&mapping) : mapping_(std::move(mapping)) {
+  }
+
+  static uint64 get_key_hash(Slice key);
+
+  static uint32 get_slot(uint64 hash, uint32 displacement, uint32 slot_count);
+
+  static Status check(Slice file);
+
+  const Header &header() const {
+    return *reinterpret_cast<const Header *>(mapping_.as_slice().data());
+  }
+
+  const uint32 *displacements() const {
+    return reinterpret_cast<const uint32 *>(mapping_.as_slice().data() + sizeof(Header));
+  }
+
+  const Entry *entries() const {
+    return reinterpret_cast<const Entry *>(displacements() + header().bucket_count);
+  }
+
+  Slice data() const {
+    return Slice(reinterpret_cast<const char *>(entries() + header().slot_count), header().data_size);
+  }
+};
+
+}  // namespace td
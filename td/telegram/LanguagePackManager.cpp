@@ -7,6 +7,7 @@
 #include "td/telegram/LanguagePackManager.h"
 
 #include "td/telegram/Global.h"
+#include "td/telegram/LanguagePackFile.h"
 #include "td/telegram/misc.h"
 #include "td/telegram/net/NetQueryDispatcher.h"
 #include "td/telegram/Td.h"
@@ -21,6 +22,7 @@
 #include "td/utils/FlatHashSet.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/port/path.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 
@@ -59,10 +61,13 @@ struct LanguagePackManager::Language {
   bool was_loaded_full_ = false;
   bool has_get_difference_query_ = false;
   vector<Promise<Unit>> get_difference_queries_;
-  FlatHashMap<string, string> ordinary_strings_;
-  FlatHashMap<string, unique_ptr<PluralizedString>> pluralized_strings_;
-  FlatHashSet<string> deleted_strings_;
-  SqliteKeyValue kv_;  // usages must be guarded by database_->mutex_
+  FlatHashMap<string, string, SliceHash, SliceEq> ordinary_strings_;
+  FlatHashMap<string, unique_ptr<PluralizedString>, SliceHash, SliceEq> pluralized_strings_;
+  FlatHashSet<string, SliceHash, SliceEq> deleted_strings_;
+  string file_path_;
+  int32 file_checked_version_ = -1;    // version for which the file was already looked for
+  unique_ptr<LanguagePackFile> file_;  // strings of a full language; the maps above override them
+  SqliteKeyValue kv_;                  // usages must be guarded by database_->mutex_
 };
 
 struct LanguagePackManager::LanguageInfo {
@@ -567,6 +572,11 @@ static string get_database_table_name(const string &language_pack, const string
   return PSTRING() << "\"kv_" << language_pack << '_' << language_code << '"';
 }
 
+static string get_language_file_path(const string &database_path, const string &language_pack,
+                                     const string &language_code) {
+  return PSTRING() << database_path << '.' << language_pack << '.' << language_code << ".langpack";
+}
+
 LanguagePackManager::Language *LanguagePackManager::add_language(LanguageDatabase *database,
                                                                  const string &language_pack,
                                                                  const string &language_code) {
@@ -664,6 +674,10 @@ LanguagePackManager::Language *LanguagePackManager::add_language(LanguageDatabas
       language->version_ = load_database_language_version(&language->kv_);
       language->key_count_ = load_database_language_key_count(&language->kv_);
       language->base_language_code_ = load_database_language_base_language_code(&language->kv_);
+      if (!is_custom_language_code(language_code)) {
+        // custom language packs can be changed without version change, so they are never saved to a file
+        language->file_path_ = get_language_file_path(database->path_, language_pack, language_code);
+      }
       LOG(INFO) << "Loaded language " << language_code << " with version " << language->version_.load()
                 << ", key count " << language->key_count_.load() << " and base language "
                 << language->base_language_code_;
@@ -675,7 +689,14 @@ LanguagePackManager::Language *LanguagePackManager::add_language(LanguageDatabas
 
 bool LanguagePackManager::language_has_string_unsafe(const Language *language, const string &key) {
   return language->ordinary_strings_.count(key) != 0 || language->pluralized_strings_.count(key) != 0 ||
-         language->deleted_strings_.count(key) != 0;
+         language->deleted_strings_.count(key) != 0 || (language->file_ != nullptr && language->file_->has(key));
+}
+
+// checks whether the string is taken from the language pack file, i.e. it isn't overridden in memory
+bool LanguagePackManager::language_file_has_string_unsafe(const Language *language, Slice key) {
+  return language->file_ != nullptr && language->ordinary_strings_.count(key) == 0 &&
+         language->pluralized_strings_.count(key) == 0 && language->deleted_strings_.count(key) == 0 &&
+         language->file_->has(key);
 }
 
 bool LanguagePackManager::language_has_strings(Language *language, const vector<string> &keys) {
@@ -737,6 +758,15 @@ bool LanguagePackManager::load_language_strings(LanguageDatabase *database, Lang
     LOG(DEBUG) << "The language pack has no database";
     return false;
   }
+  if (language->version_ != -1 && language->file_checked_version_ != language->version_) {
+    language->file_checked_version_ = language->version_;
+    if (attach_language_file_unsafe(language)) {
+      language->was_loaded_full_ = true;
+      language->is_full_ = true;
+      language->deleted_strings_.clear();
+      return true;
+    }
+  }
   LOG(DEBUG) << "Begin to load a language pack from database";
   if (keys.empty()) {
     if (language->version_ == -1 && language->was_loaded_full_) {
@@ -763,6 +793,7 @@ bool LanguagePackManager::load_language_strings(LanguageDatabase *database, Lang
 
     language->is_full_ = true;
     language->deleted_strings_.clear();
+    save_language_file_unsafe(language);
     return true;
   }
 
@@ -786,6 +817,93 @@ bool LanguagePackManager::load_language_strings(LanguageDatabase *database, Lang
   return have_all;
 }
 
+bool LanguagePackManager::attach_language_file_unsafe(Language *language) {
+  CHECK(language->file_ == nullptr);
+  if (language->file_path_.empty()) {
+    return false;
+  }
+  auto r_file = LanguagePackFile::open(language->file_path_);
+  if (r_file.is_error()) {
+    LOG(INFO) << "Can't open language pack file " << language->file_path_ << ": " << r_file.error();
+    return false;
+  }
+  auto file = r_file.move_as_ok();
+  if (file.get_version() != language->version_ || file.get_key_count() != language->key_count_) {
+    LOG(INFO) << "Language pack file " << language->file_path_ << " has version " << file.get_version()
+              << " and key count " << file.get_key_count() << " instead of " << language->version_.load() << " and "
+              << language->key_count_.load();
+    return false;
+  }
+  LOG(INFO) << "Use language pack file " << language->file_path_;
+  language->file_ = make_unique<LanguagePackFile>(std::move(file));
+  return true;
+}
+
+void LanguagePackManager::save_language_file_unsafe(Language *language) {
+  CHECK(language->is_full_);
+  if (language->file_path_.empty() || language->file_ != nullptr) {
+    return;
+  }
+
+  vector<string> values;
+  values.reserve(language->ordinary_strings_.size() + language->pluralized_strings_.size());
+  vector<std::pair<Slice, Slice>> strings;
+  strings.reserve(values.capacity());
+  for (auto &str : language->ordinary_strings_) {
+    values.push_back(PSTRING() << '1' << str.second);
+    strings.emplace_back(str.first, values.back());
+  }
+  for (auto &str : language->pluralized_strings_) {
+    values.push_back(get_pluralized_string_database_value(*str.second));
+    strings.emplace_back(str.first, values.back());
+  }
+  auto status = LanguagePackFile::write(language->file_path_, language->version_, language->key_count_, strings);
+  if (status.is_error()) {
+    LOG(WARNING) << "Failed to save language pack file " << language->file_path_ << ": " << status;
+    return;
+  }
+  if (!attach_language_file_unsafe(language)) {
+    return;
+  }
+
+  // all strings are in the file now, so there is no need to keep them in memory
+  language->ordinary_strings_.clear();
+  language->pluralized_strings_.clear();
+}
+
+void LanguagePackManager::detach_language_file_unsafe(Language *language) {
+  CHECK(language->file_ != nullptr);
+  language->file_->for_each([language](Slice key, Slice value) {
+    if (language->ordinary_strings_.count(key) == 0 && language->pluralized_strings_.count(key) == 0 &&
+        language->deleted_strings_.count(key) == 0) {
+      load_language_string_unsafe(language, key.str(), value.str());
+    }
+  });
+  language->file_ = nullptr;
+}
+
+string LanguagePackManager::get_pluralized_string_database_value(const PluralizedString &value) {
+  return PSTRING() << '2' << value.zero_value_ << '\x00' << value.one_value_ << '\x00' << value.two_value_ << '\x00'
+                   << value.few_value_ << '\x00' << value.many_value_ << '\x00' << value.other_value_;
+}
+
+static td_api::object_ptr<td_api::LanguagePackStringValue> get_database_language_pack_string_value_object(
+    Slice value) {
+  CHECK(!value.empty());
+  if (value[0] == '1') {
+    return td_api::make_object<td_api::languagePackStringValueOrdinary>(value.substr(1).str());
+  }
+  if (value[0] == '2') {
+    auto all = full_split(value.substr(1), '\x00');
+    if (all.size() == 6) {
+      return td_api::make_object<td_api::languagePackStringValuePluralized>(
+          all[0].str(), all[1].str(), all[2].str(), all[3].str(), all[4].str(), all[5].str());
+    }
+  }
+  LOG(ERROR) << "Have invalid value \"" << value << '"';
+  return td_api::make_object<td_api::languagePackStringValueDeleted>();
+}
+
 td_api::object_ptr<td_api::LanguagePackStringValue> LanguagePackManager::get_language_pack_string_value_object(
     const string &value) {
   return td_api::make_object<td_api::languagePackStringValueOrdinary>(value);
@@ -826,6 +944,12 @@ td_api::object_ptr<td_api::LanguagePackStringValue> LanguagePackManager::get_lan
   if (pluralized_it != language->pluralized_strings_.end()) {
     return get_language_pack_string_value_object(*pluralized_it->second);
   }
+  if (language->file_ != nullptr && language->deleted_strings_.count(key) == 0) {
+    auto value = language->file_->get(key);
+    if (!value.empty()) {
+      return get_database_language_pack_string_value_object(value);
+    }
+  }
   LOG_IF(ERROR, !language->is_full_ && language->deleted_strings_.count(key) == 0) << "Have no string for key " << key;
   return get_language_pack_string_value_object();
 }
@@ -848,6 +972,14 @@ td_api::object_ptr<td_api::languagePackStrings> LanguagePackManager::get_languag
     for (auto &str : language->pluralized_strings_) {
       strings.push_back(get_language_pack_string_object(str.first, *str.second));
     }
+    if (language->file_ != nullptr) {
+      language->file_->for_each([language, &strings](Slice key, Slice value) {
+        if (language_file_has_string_unsafe(language, key)) {
+          strings.push_back(td_api::make_object<td_api::languagePackString>(
+              key.str(), get_database_language_pack_string_value_object(value)));
+        }
+      });
+    }
   } else {
     for (auto &key : keys) {
       strings.push_back(get_language_pack_string_object(language, key));
@@ -1366,6 +1498,10 @@ void LanguagePackManager::on_get_language_pack_strings(
     if (language->version_ < version || !keys.empty()) {
       auto is_first = language->version_ == -1;
       vector<td_api::object_ptr<td_api::languagePackString>> strings;
+      if (keys.empty() && !is_diff && language->file_ != nullptr) {
+        // the whole language pack is received, so the file will be replaced with a new one
+        detach_language_file_unsafe(language);
+      }
       if (language->version_ < version) {
         LOG(INFO) << "Set language pack " << language_code << " version to " << version;
         language->version_ = version;
@@ -1382,9 +1518,10 @@ void LanguagePackManager::on_get_language_pack_strings(
               LOG(ERROR) << "Receive invalid key \"" << str->key_ << '"';
               break;
             }
+            auto is_in_file = language_file_has_string_unsafe(language, str->key_);
             auto it = language->ordinary_strings_.find(str->key_);
             if (it == language->ordinary_strings_.end()) {
-              key_count_delta++;
+              key_count_delta += static_cast<int32>(!is_in_file);
               it = language->ordinary_strings_.emplace(str->key_, std::move(str->value_)).first;
             } else {
               it->second = std::move(str->value_);
@@ -1406,9 +1543,10 @@ void LanguagePackManager::on_get_language_pack_strings(
             auto value = td::make_unique<PluralizedString>(std::move(str->zero_value_), std::move(str->one_value_),
                                                            std::move(str->two_value_), std::move(str->few_value_),
                                                            std::move(str->many_value_), std::move(str->other_value_));
+            auto is_in_file = language_file_has_string_unsafe(language, str->key_);
             auto it = language->pluralized_strings_.find(str->key_);
             if (it == language->pluralized_strings_.end()) {
-              key_count_delta++;
+              key_count_delta += static_cast<int32>(!is_in_file);
               it = language->pluralized_strings_.emplace(str->key_, std::move(value)).first;
             } else {
               it->second = std::move(value);
@@ -1418,11 +1556,7 @@ void LanguagePackManager::on_get_language_pack_strings(
             if (is_diff) {
               strings.push_back(get_language_pack_string_object(it->first, *it->second));
             }
-            database_strings.emplace_back(
-                std::move(str->key_), PSTRING()
-                                          << '2' << it->second->zero_value_ << '\x00' << it->second->one_value_
-                                          << '\x00' << it->second->two_value_ << '\x00' << it->second->few_value_
-                                          << '\x00' << it->second->many_value_ << '\x00' << it->second->other_value_);
+            database_strings.emplace_back(std::move(str->key_), get_pluralized_string_database_value(*it->second));
             break;
           }
           case telegram_api::langPackStringDeleted::ID: {
@@ -1431,6 +1565,7 @@ void LanguagePackManager::on_get_language_pack_strings(
               LOG(ERROR) << "Receive invalid key \"" << str->key_ << '"';
               break;
             }
+            key_count_delta -= static_cast<int32>(language_file_has_string_unsafe(language, str->key_));
             key_count_delta -= static_cast<int32>(language->ordinary_strings_.erase(str->key_));
             key_count_delta -= static_cast<int32>(language->pluralized_strings_.erase(str->key_));
             language->deleted_strings_.insert(str->key_);
@@ -1467,6 +1602,7 @@ void LanguagePackManager::on_get_language_pack_strings(
         CHECK(new_database_version >= 0);
         language->is_full_ = true;
         language->deleted_strings_.clear();
+        save_language_file_unsafe(language);
       }
       new_is_full = language->is_full_;
 
@@ -1856,6 +1992,11 @@ Status LanguagePackManager::do_delete_language(const string &language_code) {
   language->ordinary_strings_.clear();
   language->pluralized_strings_.clear();
   language->deleted_strings_.clear();
+  language->file_checked_version_ = -1;
+  language->file_ = nullptr;
+  if (!language->file_path_.empty()) {
+    unlink(language->file_path_).ignore();
+  }
 
   if (!pack->pack_kv_.empty()) {
     pack->pack_kv_.erase(language_code);
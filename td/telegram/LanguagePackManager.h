@@ -116,11 +116,18 @@ class LanguagePackManager final : public NetQueryCallback {
   static Language *add_language(LanguageDatabase *database, const string &language_pack, const string &language_code);
 
   static bool language_has_string_unsafe(const Language *language, const string &key);
+  static bool language_file_has_string_unsafe(const Language *language, Slice key);
   static bool language_has_strings(Language *language, const vector<string> &keys);
 
   static void load_language_string_unsafe(Language *language, const string &key, const string &value);
   static bool load_language_strings(LanguageDatabase *database, Language *language, const vector<string> &keys);
 
+  static bool attach_language_file_unsafe(Language *language);
+  static void save_language_file_unsafe(Language *language);
+  static void detach_language_file_unsafe(Language *language);
+
+  static string get_pluralized_string_database_value(const PluralizedString &value);
+
   static td_api::object_ptr<td_api::LanguagePackStringValue> get_language_pack_string_value_object(const string &value);
   static td_api::object_ptr<td_api::LanguagePackStringValue> get_language_pack_string_value_object(
       const PluralizedString &value);
@@ -0,0 +1,96 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashSet.h"
+#include "td/utils/WaitFreeHashMap.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace td {
+
+// returns keys of the least recently used objects, which must be unloaded to keep their total size at most max_size
+// objects must have the fields last_used_time and estimated_size; objects for which can_unload returns false
+// are never chosen
+template <class KeyT, class ObjectT, class HashT, class CanUnloadT>
+vector<KeyT> get_least_recently_used_keys(const WaitFreeHashMap<KeyT, unique_ptr<ObjectT>, HashT> &objects,
+                                          size_t total_size, size_t max_size, const CanUnloadT &can_unload) {
+  if (total_size <= max_size) {
+    return {};
+  }
+
+  vector<std::pair<double, KeyT>> candidates;
+  objects.foreach([&](const KeyT &key, const unique_ptr<ObjectT> &object) {
+    if (can_unload(key, object.get())) {
+      candidates.emplace_back(object->last_used_time, key);
+    }
+  });
+  auto is_less = [](const std::pair<double, KeyT> &lhs, const std::pair<double, KeyT> &rhs) {
+    return lhs.first < rhs.first;
+  };
+  std::sort(candidates.begin(), candidates.end(), is_less);
+
+  vector<KeyT> result;
+  for (auto &candidate : candidates) {
+    if (total_size <= max_size) {
+      break;
+    }
+    auto object_size = objects.get_pointer(candidate.second)->estimated_size;
+    total_size -= min(total_size, object_size);
+    result.push_back(candidate.second);
+  }
+  return result;
+}
+
+// keeps the total estimated size of loaded objects and remembers keys of unloaded objects
+// to count how many unloaded objects are loaded again
+template <class KeyT, class HashT>
+class UnloadedObjects {
+ public:
+  // must be called whenever the estimated size of a loaded object changes
+  void on_size_changed(size_t &object_size, size_t new_size) {
+    total_size_ -= object_size;
+    total_size_ += new_size;
+    object_size = new_size;
+  }
+
+  // must be called before the object is erased
+  void on_unload(KeyT key, size_t &object_size) {
+    on_size_changed(object_size, 0);
+    keys_.insert(key);
+    unload_count_++;
+  }
+
+  // must be called before an object is loaded from the database
+  void on_load(KeyT key) {
+    if (keys_.erase(key) > 0) {
+      reload_count_++;
+    }
+  }
+
+  size_t get_total_size() const {
+    return total_size_;
+  }
+
+  int64 get_unload_count() const {
+    return unload_count_;
+  }
+
+  int64 get_reload_count() const {
+    return reload_count_;
+  }
+
+ private:
+  FlatHashSet<KeyT, HashT> keys_;
+  size_t total_size_ = 0;
+  int64 unload_count_ = 0;
+  int64 reload_count_ = 0;
+};
+
+}  // namespace td
@@ -36,9 +36,13 @@
 #include "td/utils/misc.h"
 #include "td/utils/NullLog.h"
 #include "td/utils/port/detail/NativeFd.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/ScopeGuard.h"
+#include "td/utils/ThreadBufferedLog.h"
 #include "td/utils/TsLog.h"
 
 #include <atomic>
+#include <cstdlib>
 #include <map>
 #include <mutex>
 
@@ -46,7 +50,18 @@ namespace td {
 
 static std::mutex logging_mutex;
 static FileLog file_log;
-static TsLog ts_log(&file_log);
+#if TD_THREAD_UNSUPPORTED
+static TsLog file_log_interface(&file_log);
+#else
+// the object is never destroyed, because it can be used by other threads during static destruction;
+// its writer thread is stopped explicitly instead
+static ThreadBufferedLog &file_log_interface = *new ThreadBufferedLog();
+static bool is_file_log_writer_stop_registered = false;
+
+static void stop_file_log_writer() {
+  file_log_interface.stop();
+}
+#endif
 static NullLog null_log;
 static ExitGuard exit_guard;
 
@@ -66,6 +81,14 @@ Status Logging::set_current_stream(td_api::object_ptr<td_api::LogStream> stream)
   }
 
   std::lock_guard<std::mutex> lock(logging_mutex);
+#if !TD_THREAD_UNSUPPORTED
+  SCOPE_EXIT {
+    if (log_interface != &file_log_interface) {
+      // the writer thread isn't needed anymore
+      file_log_interface.stop();
+    }
+  };
+#endif
   switch (stream->get_id()) {
     case td_api::logStreamDefault::ID:
       log_interface = default_log_interface;
@@ -78,9 +101,20 @@ Status Logging::set_current_stream(td_api::object_ptr<td_api::LogStream> stream)
       }
       auto redirect_stderr = file_stream->redirect_stderr_;
 
+#if TD_THREAD_UNSUPPORTED
       TRY_STATUS(file_log.init(file_stream->path_, max_log_file_size, redirect_stderr));
+#else
+      // the file log can be used by the writer thread, so it must be reinited under the ThreadBufferedLog lock
+      TRY_STATUS(file_log_interface.init(
+          &file_log, [&] { return file_log.init(file_stream->path_, max_log_file_size, redirect_stderr); }));
+      if (!is_file_log_writer_stop_registered) {
+        // the writer thread must not be joined during static destruction, so it is stopped before it
+        is_file_log_writer_stop_registered = true;
+        std::atexit(stop_file_log_writer);
+      }
+#endif
       std::atomic_thread_fence(std::memory_order_release);  // better than nothing
-      log_interface = &ts_log;
+      log_interface = &file_log_interface;
       return Status::OK();
     }
     case td_api::logStreamEmpty::ID:
@@ -100,7 +134,7 @@ Result<td_api::object_ptr<td_api::LogStream>> Logging::get_current_stream() {
   if (log_interface == &null_log) {
     return td_api::make_object<td_api::logStreamEmpty>();
   }
-  if (log_interface == &ts_log) {
+  if (log_interface == &file_log_interface) {
     return td_api::make_object<td_api::logStreamFile>(file_log.get_path().str(), file_log.get_rotate_threshold(),
                                                       file_log.get_redirect_stderr());
   }
@@ -10,6 +10,7 @@
 #include "td/telegram/UserId.h"
 #include "td/telegram/Version.h"
 
+#include "td/db/BlobDictionaryDb.h"
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteStatement.h"
@@ -17,6 +18,8 @@
 #include "td/actor/actor.h"
 #include "td/actor/SchedulerLocalStorage.h"
 
+#include "td/utils/BlobCompressor.h"
+#include "td/utils/FlatHashMap.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/ScopeGuard.h"
@@ -41,6 +44,11 @@ namespace td {
 static constexpr int32 MESSAGE_DB_INDEX_COUNT = 30;
 static constexpr int32 MESSAGE_DB_INDEX_COUNT_OLD = 9;
 
+// rowids of messages_dialog_fts are allocated in per-chat ranges of this size,
+// so full-text search in a chat reads only the part of posting lists, which belongs to the chat;
+// inside a range the rowid of a message is its message_id, so rowids are unique and the search is paginated by them
+static constexpr int32 MESSAGE_DB_DIALOG_FTS_RANGE_BITS = 40;
+
 // NB: must happen inside a transaction
 Status init_message_db(SqliteDb &db, int32 version) {
   LOG(INFO) << "Init message database " << tag("version", version);
@@ -87,6 +95,26 @@ Status init_message_db(SqliteDb &db, int32 version) {
 
     return Status::OK();
   };
+  auto add_dialog_fts = [&db] {
+    TRY_STATUS(db.exec("CREATE TABLE IF NOT EXISTS message_fts_dialogs (dialog_id INT8 PRIMARY KEY)"));
+
+    TRY_STATUS(
+        db.exec("CREATE INDEX IF NOT EXISTS message_by_dialog_search_id ON messages "
+                "(dialog_id, dialog_search_id) WHERE dialog_search_id IS NOT NULL"));
+
+    TRY_STATUS(
+        db.exec("CREATE VIRTUAL TABLE IF NOT EXISTS messages_dialog_fts USING fts5(text, content='messages', "
+                "content_rowid='dialog_search_id', tokenize = \"unicode61 remove_diacritics 0 tokenchars '\a'\")"));
+    TRY_STATUS(
+        db.exec("CREATE TRIGGER IF NOT EXISTS trigger_dialog_fts_delete BEFORE DELETE ON messages WHEN "
+                "OLD.dialog_search_id IS NOT NULL BEGIN INSERT INTO messages_dialog_fts(messages_dialog_fts, rowid, "
+                "text) VALUES(\'delete\', OLD.dialog_search_id, OLD.text); END"));
+    TRY_STATUS(
+        db.exec("CREATE TRIGGER IF NOT EXISTS trigger_dialog_fts_insert AFTER INSERT ON messages WHEN "
+                "NEW.dialog_search_id IS NOT NULL BEGIN INSERT INTO messages_dialog_fts(rowid, text) "
+                "VALUES(NEW.dialog_search_id, NEW.text); END"));
+    return Status::OK();
+  };
   auto add_call_index = [&db] {
     for (int i = static_cast<int>(MessageSearchFilter::Call) - 1; i < static_cast<int>(MessageSearchFilter::MissedCall);
          i++) {
@@ -116,7 +144,8 @@ Status init_message_db(SqliteDb &db, int32 version) {
     TRY_STATUS(
         db.exec("CREATE TABLE IF NOT EXISTS messages (dialog_id INT8, message_id INT8, unique_message_id INT4, "
                 "sender_user_id INT8, random_id INT8, data BLOB, ttl_expires_at INT4, index_mask INT4, search_id INT8, "
-                "text STRING, notification_id INT4, top_thread_message_id INT8, PRIMARY KEY (dialog_id, message_id))"));
+                "text STRING, notification_id INT4, top_thread_message_id INT8, dialog_search_id INT8, PRIMARY KEY "
+                "(dialog_id, message_id))"));
 
     TRY_STATUS(
         db.exec("CREATE INDEX IF NOT EXISTS message_by_random_id ON messages (dialog_id, random_id) "
@@ -134,6 +163,8 @@ Status init_message_db(SqliteDb &db, int32 version) {
 
     TRY_STATUS(add_fts());
 
+    TRY_STATUS(add_dialog_fts());
+
     TRY_STATUS(add_call_index());
 
     TRY_STATUS(add_notification_id_index());
@@ -167,6 +198,15 @@ Status init_message_db(SqliteDb &db, int32 version) {
   if (version < static_cast<int32>(DbVersion::AddMessageThreadSupport)) {
     TRY_STATUS(db.exec("ALTER TABLE messages ADD COLUMN top_thread_message_id INT8"));
   }
+  if (version < static_cast<int32>(DbVersion::AddMessageDbDialogFts)) {
+    TRY_STATUS(db.exec("ALTER TABLE messages ADD COLUMN dialog_search_id INT8"));
+    TRY_STATUS(add_dialog_fts());
+
+    // existing messages are added to messages_dialog_fts in background by MessageDbImpl::migrate_dialog_fts
+    TRY_STATUS(
+        db.exec("CREATE INDEX IF NOT EXISTS message_by_dialog_fts_migration ON messages (search_id) WHERE search_id "
+                "IS NOT NULL AND dialog_search_id IS NULL"));
+  }
   return Status::OK();
 }
 
@@ -174,6 +214,8 @@ Status init_message_db(SqliteDb &db, int32 version) {
 Status drop_message_db(SqliteDb &db, int32 version) {
   LOG(WARNING) << "Drop message database " << tag("version", version)
                << tag("current_db_version", current_db_version());
+  TRY_STATUS(db.exec("DROP TABLE IF EXISTS messages_dialog_fts"));
+  TRY_STATUS(db.exec("DROP TABLE IF EXISTS message_fts_dialogs"));
   return db.exec("DROP TABLE IF EXISTS messages");
 }
 
@@ -184,9 +226,11 @@ class MessageDbImpl final : public MessageDbSyncInterface {
   }
 
   Status init() {
+    TRY_RESULT_ASSIGN(blob_compressor_, load_blob_compressor(db_));
     TRY_RESULT_ASSIGN(
         add_message_stmt_,
-        db_.get_statement("INSERT OR REPLACE INTO messages VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12)"));
+        db_.get_statement(
+            "INSERT OR REPLACE INTO messages VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13)"));
     TRY_RESULT_ASSIGN(delete_message_stmt_,
                       db_.get_statement("DELETE FROM messages WHERE dialog_id = ?1 AND message_id = ?2"));
     TRY_RESULT_ASSIGN(delete_all_dialog_messages_stmt_,
@@ -224,6 +268,30 @@ class MessageDbImpl final : public MessageDbSyncInterface {
                       db_.get_statement("SELECT dialog_id, message_id, data, search_id FROM messages WHERE search_id "
                                         "IN (SELECT rowid FROM messages_fts WHERE messages_fts MATCH ?1 AND rowid < ?2 "
                                         "ORDER BY rowid DESC LIMIT ?3) ORDER BY search_id DESC"));
+    TRY_RESULT_ASSIGN(
+        get_dialog_messages_fts_stmt_,
+        db_.get_statement("SELECT dialog_id, message_id, data, dialog_search_id FROM messages WHERE dialog_id = ?4 "
+                          "AND dialog_search_id IN (SELECT rowid FROM messages_dialog_fts WHERE messages_dialog_fts "
+                          "MATCH ?1 AND rowid >= ?5 AND rowid < ?2 ORDER BY rowid DESC LIMIT ?3) ORDER BY "
+                          "dialog_search_id DESC"));
+
+    TRY_RESULT_ASSIGN(get_fts_dialog_stmt_,
+                      db_.get_statement("SELECT rowid FROM message_fts_dialogs WHERE dialog_id = ?1"));
+    TRY_RESULT_ASSIGN(add_fts_dialog_stmt_, db_.get_statement("INSERT INTO message_fts_dialogs VALUES(?1)"));
+
+    TRY_RESULT(has_dialog_fts_migration, has_dialog_fts_migration_index());
+    if (has_dialog_fts_migration) {
+      TRY_RESULT_ASSIGN(get_dialog_fts_migration_messages_stmt_,
+                        db_.get_statement("SELECT dialog_id, message_id, text FROM messages WHERE search_id IS "
+                                          "NOT NULL AND dialog_search_id IS NULL LIMIT ?1"));
+      TRY_RESULT_ASSIGN(set_dialog_search_id_stmt_,
+                        db_.get_statement("UPDATE messages SET dialog_search_id = ?3 WHERE dialog_id = ?1 AND "
+                                          "message_id = ?2"));
+      TRY_RESULT_ASSIGN(add_dialog_fts_stmt_,
+                        db_.get_statement("INSERT INTO messages_dialog_fts(rowid, text) VALUES(?1, ?2)"));
+    } else {
+      is_dialog_fts_migrated_ = true;
+    }
 
     for (int32 i = 0; i < MESSAGE_DB_INDEX_COUNT; i++) {
       TRY_RESULT_ASSIGN(
@@ -319,6 +387,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       add_message_stmt_.bind_null(5).ensure();
     }
 
+    data = blob_compressor_.compress(std::move(data));
     add_message_stmt_.bind_blob(6, data.as_slice()).ensure();
 
     if (ttl_expires_at != 0) {
@@ -362,6 +431,11 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     } else {
       add_message_stmt_.bind_null(12).ensure();
     }
+    if (search_id != 0) {
+      add_message_stmt_.bind_int64(13, get_dialog_search_id(dialog_id, message_id)).ensure();
+    } else {
+      add_message_stmt_.bind_null(13).ensure();
+    }
 
     add_message_stmt_.step().ensure();
   }
@@ -384,6 +458,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       add_scheduled_message_stmt_.bind_null(3).ensure();
     }
 
+    data = blob_compressor_.compress(std::move(data));
     add_scheduled_message_stmt_.bind_blob(4, data.as_slice()).ensure();
 
     add_scheduled_message_stmt_.step().ensure();
@@ -463,16 +538,17 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       return Status::Error("Not found");
     }
     MessageId received_message_id(stmt.view_int64(0));
-    Slice data = stmt.view_blob(1);
+    auto data = decompress_message_data(stmt.view_blob(1));
     if (is_scheduled_server) {
       CHECK(received_message_id.is_scheduled());
       CHECK(received_message_id.is_scheduled_server());
       CHECK(received_message_id.get_scheduled_server_message_id() == message_id.get_scheduled_server_message_id());
     } else {
       LOG_CHECK(received_message_id == message_id)
-          << received_message_id << ' ' << message_id << ' ' << get_message_info(received_message_id, data, true).first;
+          << received_message_id << ' ' << message_id << ' '
+          << get_message_info(received_message_id, data.as_slice(), true).first;
     }
-    return MessageDbDialogMessage{received_message_id, BufferSlice(data)};
+    return MessageDbDialogMessage{received_message_id, std::move(data)};
   }
 
   Result<MessageDbMessage> get_message_by_unique_message_id(ServerMessageId unique_message_id) final {
@@ -489,7 +565,8 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     }
     DialogId dialog_id(get_message_by_unique_message_id_stmt_.view_int64(0));
     MessageId message_id(get_message_by_unique_message_id_stmt_.view_int64(1));
-    return MessageDbMessage{dialog_id, message_id, BufferSlice(get_message_by_unique_message_id_stmt_.view_blob(2))};
+    return MessageDbMessage{dialog_id, message_id,
+                            decompress_message_data(get_message_by_unique_message_id_stmt_.view_blob(2))};
   }
 
   Result<MessageDbDialogMessage> get_message_by_random_id(DialogId dialog_id, int64 random_id) final {
@@ -503,7 +580,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
       return Status::Error("Not found");
     }
     MessageId message_id(get_message_by_random_id_stmt_.view_int64(0));
-    return MessageDbDialogMessage{message_id, BufferSlice(get_message_by_random_id_stmt_.view_blob(1))};
+    return MessageDbDialogMessage{message_id, decompress_message_data(get_message_by_random_id_stmt_.view_blob(1))};
   }
 
   Result<MessageDbDialogMessage> get_dialog_message_by_date(DialogId dialog_id, MessageId first_message_id,
@@ -581,7 +658,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     while (get_expiring_messages_stmt_.has_row()) {
       DialogId dialog_id(get_expiring_messages_stmt_.view_int64(0));
       MessageId message_id(get_expiring_messages_stmt_.view_int64(1));
-      BufferSlice data(get_expiring_messages_stmt_.view_blob(2));
+      auto data = decompress_message_data(get_expiring_messages_stmt_.view_blob(2));
       messages.push_back(MessageDbMessage{dialog_id, message_id, std::move(data)});
       get_expiring_messages_stmt_.step().ensure();
     }
@@ -604,16 +681,16 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     stmt.step().ensure();
     int32 current_day = std::numeric_limits<int32>::max();
     while (stmt.has_row()) {
-      auto data_slice = stmt.view_blob(0);
+      auto data = decompress_message_data(stmt.view_blob(0));
       MessageId message_id(stmt.view_int64(1));
-      auto info = get_message_info(message_id, data_slice, false);
+      auto info = get_message_info(message_id, data.as_slice(), false);
       auto day = (query.tz_offset + info.second) / 86400;
       if (day >= current_day) {
         CHECK(!total_counts.empty());
         total_counts.back()++;
       } else {
         current_day = day;
-        messages.push_back(MessageDbDialogMessage{message_id, BufferSlice(data_slice)});
+        messages.push_back(MessageDbDialogMessage{message_id, std::move(data)});
         total_counts.push_back(1);
       }
       stmt.step().ensure();
@@ -679,9 +756,8 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     vector<MessageDbDialogMessage> result;
     stmt.step().ensure();
     while (stmt.has_row()) {
-      auto data_slice = stmt.view_blob(0);
       MessageId message_id(stmt.view_int64(1));
-      result.push_back(MessageDbDialogMessage{message_id, BufferSlice(data_slice)});
+      result.push_back(MessageDbDialogMessage{message_id, decompress_message_data(stmt.view_blob(0))});
       LOG(INFO) << "Load " << message_id << " in " << dialog_id << " from database";
       stmt.step().ensure();
     }
@@ -738,6 +814,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
   MessageDbFtsResult get_messages_fts(MessageDbFtsQuery query) final {
     SCOPE_EXIT {
       get_messages_fts_stmt_.reset();
+      get_dialog_messages_fts_stmt_.reset();
     };
 
     LOG(INFO) << tag("query", query.query) << query.dialog_id << tag("filter", query.filter)
@@ -745,24 +822,44 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     string words = prepare_query(query.query);
     LOG(INFO) << tag("from", query.query) << tag("to", words);
 
-    // dialog_id kludge
-    if (query.dialog_id.is_valid()) {
-      words += PSTRING() << " \"\a" << query.dialog_id.get() << "\"";
-    }
-
     // index_mask kludge
     if (query.filter != MessageSearchFilter::Empty) {
       words += PSTRING() << " \"\a\a" << message_search_filter_index(query.filter) << "\"";
     }
 
-    auto &stmt = get_messages_fts_stmt_;
-    stmt.bind_string(1, words).ensure();
     if (query.from_search_id == 0) {
       query.from_search_id = std::numeric_limits<int64>::max();
     }
+
+    MessageDbFtsResult result;
+    bool use_dialog_fts = query.dialog_id.is_valid() && is_dialog_fts_migrated_;
+    int64 range = 0;
+    if (use_dialog_fts) {
+      range = get_fts_dialog_range(query.dialog_id, false);
+      if (range == 0) {
+        // there are no messages with text in the chat
+        return result;
+      }
+      if (query.from_search_id == std::numeric_limits<int64>::max()) {
+        query.from_search_id = (range + 1) << MESSAGE_DB_DIALOG_FTS_RANGE_BITS;
+      } else if ((query.from_search_id >> MESSAGE_DB_DIALOG_FTS_RANGE_BITS) != range) {
+        // the offset was returned before the end of migration to the per-chat index and is a search_id,
+        // so the search must be continued in the global index to keep the order of results
+        use_dialog_fts = false;
+      }
+    }
+    if (use_dialog_fts) {
+      get_dialog_messages_fts_stmt_.bind_int64(4, query.dialog_id.get()).ensure();
+      get_dialog_messages_fts_stmt_.bind_int64(5, range << MESSAGE_DB_DIALOG_FTS_RANGE_BITS).ensure();
+    } else if (query.dialog_id.is_valid()) {
+      // dialog_id kludge
+      words += PSTRING() << " \"\a" << query.dialog_id.get() << "\"";
+    }
+
+    auto &stmt = use_dialog_fts ? get_dialog_messages_fts_stmt_ : get_messages_fts_stmt_;
+    stmt.bind_string(1, words).ensure();
     stmt.bind_int64(2, query.from_search_id).ensure();
     stmt.bind_int32(3, query.limit).ensure();
-    MessageDbFtsResult result;
     auto status = stmt.step();
     if (status.is_error()) {
       LOG(ERROR) << status;
@@ -771,15 +868,87 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     while (stmt.has_row()) {
       DialogId dialog_id(stmt.view_int64(0));
       MessageId message_id(stmt.view_int64(1));
-      auto data_slice = stmt.view_blob(2);
       auto search_id = stmt.view_int64(3);
       result.next_search_id = search_id;
-      result.messages.push_back(MessageDbMessage{dialog_id, message_id, BufferSlice(data_slice)});
+      result.messages.push_back(MessageDbMessage{dialog_id, message_id, decompress_message_data(stmt.view_blob(2))});
       stmt.step().ensure();
     }
     return result;
   }
 
+  Result<bool> migrate_dialog_fts(int32 limit) final {
+    if (is_dialog_fts_migrated_) {
+      return true;
+    }
+
+    struct MessageText {
+      DialogId dialog_id;
+      MessageId message_id;
+      string text;
+    };
+    vector<MessageText> messages;
+    {
+      auto &stmt = get_dialog_fts_migration_messages_stmt_;
+      SCOPE_EXIT {
+        stmt.reset();
+      };
+      stmt.bind_int32(1, limit).ensure();
+      TRY_STATUS(stmt.step());
+      while (stmt.has_row()) {
+        messages.push_back(
+            MessageText{DialogId(stmt.view_int64(0)), MessageId(stmt.view_int64(1)), stmt.view_string(2).str()});
+        TRY_STATUS(stmt.step());
+      }
+    }
+
+    if (messages.empty()) {
+      get_dialog_fts_migration_messages_stmt_ = SqliteStatement();
+      set_dialog_search_id_stmt_ = SqliteStatement();
+      add_dialog_fts_stmt_ = SqliteStatement();
+      TRY_STATUS(db_.exec("DROP INDEX IF EXISTS message_by_dialog_fts_migration"));
+      LOG(INFO) << "Finished migration of messages to per-chat full-text search index";
+      is_dialog_fts_migrated_ = true;
+      return true;
+    }
+
+    LOG(INFO) << "Add " << messages.size() << " messages to per-chat full-text search index";
+    // a failed batch must be rolled back as a whole, because the migration continues from unmigrated messages
+    TRY_STATUS(db_.exec("SAVEPOINT dialog_fts_migration"));
+    auto add_messages = [&]() -> Status {
+      for (auto &message : messages) {
+        auto dialog_search_id = get_dialog_search_id(message.dialog_id, message.message_id);
+        {
+          SCOPE_EXIT {
+            set_dialog_search_id_stmt_.reset();
+          };
+          set_dialog_search_id_stmt_.bind_int64(1, message.dialog_id.get()).ensure();
+          set_dialog_search_id_stmt_.bind_int64(2, message.message_id.get()).ensure();
+          set_dialog_search_id_stmt_.bind_int64(3, dialog_search_id).ensure();
+          TRY_STATUS(set_dialog_search_id_stmt_.step());
+        }
+        {
+          SCOPE_EXIT {
+            add_dialog_fts_stmt_.reset();
+          };
+          add_dialog_fts_stmt_.bind_int64(1, dialog_search_id).ensure();
+          add_dialog_fts_stmt_.bind_string(2, message.text).ensure();
+          TRY_STATUS(add_dialog_fts_stmt_.step());
+        }
+      }
+      return Status::OK();
+    };
+    auto status = add_messages();
+    if (status.is_error()) {
+      // ranges of rowids, which were allocated in the batch, are rolled back too
+      fts_dialog_ranges_.clear();
+      db_.exec("ROLLBACK TO dialog_fts_migration").ignore();
+      db_.exec("RELEASE dialog_fts_migration").ignore();
+      return std::move(status);
+    }
+    TRY_STATUS(db_.exec("RELEASE dialog_fts_migration"));
+    return false;
+  }
+
   vector<MessageDbDialogMessage> get_messages_from_index(DialogId dialog_id, MessageId from_message_id,
                                                          MessageSearchFilter filter, int32 offset, int32 limit) {
     auto &stmt = get_messages_from_index_stmts_[message_search_filter_index(filter)];
@@ -809,8 +978,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     while (stmt.has_row()) {
       DialogId dialog_id(stmt.view_int64(0));
       MessageId message_id(stmt.view_int64(1));
-      auto data_slice = stmt.view_blob(2);
-      result.messages.push_back(MessageDbMessage{dialog_id, message_id, BufferSlice(data_slice)});
+      result.messages.push_back(MessageDbMessage{dialog_id, message_id, decompress_message_data(stmt.view_blob(2))});
       stmt.step().ensure();
     }
     return result;
@@ -825,6 +993,7 @@ class MessageDbImpl final : public MessageDbSyncInterface {
 
  private:
   SqliteDb db_;
+  BlobCompressor blob_compressor_;
 
   SqliteStatement add_message_stmt_;
 
@@ -850,6 +1019,16 @@ class MessageDbImpl final : public MessageDbSyncInterface {
   std::array<SqliteStatement, 2> get_calls_stmts_;
 
   SqliteStatement get_messages_fts_stmt_;
+  SqliteStatement get_dialog_messages_fts_stmt_;
+
+  SqliteStatement get_fts_dialog_stmt_;
+  SqliteStatement add_fts_dialog_stmt_;
+  FlatHashMap<DialogId, int64, DialogIdHash> fts_dialog_ranges_;
+
+  bool is_dialog_fts_migrated_ = false;
+  SqliteStatement get_dialog_fts_migration_messages_stmt_;
+  SqliteStatement set_dialog_search_id_stmt_;
+  SqliteStatement add_dialog_fts_stmt_;
 
   SqliteStatement add_scheduled_message_stmt_;
   SqliteStatement get_scheduled_message_stmt_;
@@ -857,8 +1036,59 @@ class MessageDbImpl final : public MessageDbSyncInterface {
   SqliteStatement delete_scheduled_message_stmt_;
   SqliteStatement delete_scheduled_server_message_stmt_;
 
-  static vector<MessageDbDialogMessage> get_messages_impl(GetMessagesStmt &stmt, DialogId dialog_id,
-                                                          MessageId from_message_id, int32 offset, int32 limit) {
+  Result<bool> has_dialog_fts_migration_index() {
+    TRY_RESULT(stmt, db_.get_statement("SELECT count(*) FROM sqlite_master WHERE type='index' AND "
+                                       "name='message_by_dialog_fts_migration'"));
+    TRY_STATUS(stmt.step());
+    CHECK(stmt.has_row());
+    return stmt.view_int32(0) == 1;
+  }
+
+  // returns 0 if the chat has no range of rowids in messages_dialog_fts and create == false
+  int64 get_fts_dialog_range(DialogId dialog_id, bool create) {
+    auto it = fts_dialog_ranges_.find(dialog_id);
+    if (it != fts_dialog_ranges_.end()) {
+      return it->second;
+    }
+
+    auto load_range = [&] {
+      SCOPE_EXIT {
+        get_fts_dialog_stmt_.reset();
+      };
+      get_fts_dialog_stmt_.bind_int64(1, dialog_id.get()).ensure();
+      get_fts_dialog_stmt_.step().ensure();
+      return get_fts_dialog_stmt_.has_row() ? get_fts_dialog_stmt_.view_int64(0) : static_cast<int64>(0);
+    };
+    auto range = load_range();
+    if (range == 0) {
+      if (!create) {
+        return 0;
+      }
+      {
+        SCOPE_EXIT {
+          add_fts_dialog_stmt_.reset();
+        };
+        add_fts_dialog_stmt_.bind_int64(1, dialog_id.get()).ensure();
+        add_fts_dialog_stmt_.step().ensure();
+      }
+      range = load_range();
+      CHECK(range > 0);
+    }
+    LOG_CHECK(range < (static_cast<int64>(1) << (62 - MESSAGE_DB_DIALOG_FTS_RANGE_BITS))) << dialog_id << ' ' << range;
+    fts_dialog_ranges_.emplace(dialog_id, range);
+    return range;
+  }
+
+  int64 get_dialog_search_id(DialogId dialog_id, MessageId message_id) {
+    auto range = get_fts_dialog_range(dialog_id, true);
+    // only messages from secret chats are indexed and their local identifiers are much smaller than the range size
+    LOG_CHECK(message_id.get() > 0 && message_id.get() < (static_cast<int64>(1) << MESSAGE_DB_DIALOG_FTS_RANGE_BITS))
+        << dialog_id << ' ' << message_id;
+    return (range << MESSAGE_DB_DIALOG_FTS_RANGE_BITS) | message_id.get();
+  }
+
+  vector<MessageDbDialogMessage> get_messages_impl(GetMessagesStmt &stmt, DialogId dialog_id, MessageId from_message_id,
+                                                   int32 offset, int32 limit) {
     LOG_CHECK(dialog_id.is_valid()) << dialog_id;
     CHECK(from_message_id.is_valid());
 
@@ -909,8 +1139,8 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     return right;
   }
 
-  static vector<MessageDbDialogMessage> get_messages_inner(SqliteStatement &stmt, DialogId dialog_id,
-                                                           int64 from_message_id, int32 limit) {
+  vector<MessageDbDialogMessage> get_messages_inner(SqliteStatement &stmt, DialogId dialog_id, int64 from_message_id,
+                                                    int32 limit) {
     SCOPE_EXIT {
       stmt.reset();
     };
@@ -923,15 +1153,24 @@ class MessageDbImpl final : public MessageDbSyncInterface {
     vector<MessageDbDialogMessage> result;
     stmt.step().ensure();
     while (stmt.has_row()) {
-      auto data_slice = stmt.view_blob(0);
       MessageId message_id(stmt.view_int64(1));
-      result.push_back(MessageDbDialogMessage{message_id, BufferSlice(data_slice)});
+      result.push_back(MessageDbDialogMessage{message_id, decompress_message_data(stmt.view_blob(0))});
       LOG(INFO) << "Loaded " << message_id << " in " << dialog_id << " from database";
       stmt.step().ensure();
     }
     return result;
   }
 
+  BufferSlice decompress_message_data(Slice data) {
+    auto r_data = blob_compressor_.decompress(data);
+    if (r_data.is_error()) {
+      // the message will be deleted as a message, which can't be parsed
+      LOG(ERROR) << "Failed to decompress message data: " << r_data.error();
+      return BufferSlice();
+    }
+    return r_data.move_as_ok();
+  }
+
   static std::pair<MessageId, int32> get_message_info(const MessageDbDialogMessage &message, bool from_data = false) {
     return get_message_info(message.message_id, message.data.as_slice(), from_data);
   }
@@ -1162,6 +1401,20 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
       add_read_query();
       promise.set_value(sync_db_->get_messages_fts(std::move(query)));
     }
+    void migrate_dialog_fts() {
+      add_read_query();
+      sync_db_->begin_write_transaction().ensure();
+      auto r_is_finished = sync_db_->migrate_dialog_fts(MIGRATE_DIALOG_FTS_BATCH_SIZE);
+      sync_db_->commit_transaction().ensure();
+      if (r_is_finished.is_error()) {
+        LOG(ERROR) << "Failed to migrate messages to per-chat full-text search index: " << r_is_finished.error();
+        return;
+      }
+      if (!r_is_finished.ok()) {
+        // let other queries run between batches
+        send_closure_later(actor_id(this), &Impl::migrate_dialog_fts);
+      }
+    }
     void get_expiring_messages(int32 expires_till, int32 limit, Promise<vector<MessageDbMessage>> promise) {
       add_read_query();
       promise.set_value(sync_db_->get_expiring_messages(expires_till, limit));
@@ -1186,6 +1439,7 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
 
     static constexpr size_t MAX_PENDING_QUERIES_COUNT{50};
     static constexpr double MAX_PENDING_QUERIES_DELAY{0.01};
+    static constexpr int32 MIGRATE_DIALOG_FTS_BATCH_SIZE{500};
 
     //NB: order is important, destructor of pending_writes_ will change finished_writes_
     vector<Promise<Unit>> finished_writes_;
@@ -1224,6 +1478,7 @@ class MessageDbAsync final : public MessageDbAsyncInterface {
 
     void start_up() final {
       sync_db_ = &sync_db_safe_->get();
+      send_closure_later(actor_id(this), &Impl::migrate_dialog_fts);
     }
   };
   ActorOwn<Impl> impl_;
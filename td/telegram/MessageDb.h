@@ -134,6 +134,9 @@ class MessageDbSyncInterface {
   virtual MessageDbCallsResult get_calls(MessageDbCallsQuery query) = 0;
   virtual MessageDbFtsResult get_messages_fts(MessageDbFtsQuery query) = 0;
 
+  // adds at most limit old messages to the per-chat full-text search index; returns true if all messages were added
+  virtual Result<bool> migrate_dialog_fts(int32 limit) = 0;
+
   virtual Status begin_write_transaction() = 0;
   virtual Status commit_transaction() = 0;
 };
@@ -27,6 +27,7 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/unicode.h"
+#include "td/utils/Utf16OffsetIndex.h"
 #include "td/utils/utf8.h"
 
 #include <algorithm>
@@ -1643,44 +1644,83 @@ static void fix_entity_offsets(Slice text, vector<MessageEntity> &entities) {
 
   remove_intersecting_entities(entities);
 
-  const unsigned char *begin = text.ubegin();
-  const unsigned char *ptr = begin;
-  const unsigned char *end = text.uend();
-
+  // entities are sorted and non-intersecting, so the text between them is counted only once and without decoding
+  int32 pos = 0;
   int32 utf16_pos = 0;
+  auto get_utf16_pos = [&](int32 new_pos) {
+    CHECK(pos <= new_pos && static_cast<size_t>(new_pos) <= text.size());
+    utf16_pos += narrow_cast<int32>(utf8_utf16_length(text.substr(pos, new_pos - pos)));
+    pos = new_pos;
+    return utf16_pos;
+  };
   for (auto &entity : entities) {
-    int cnt = 2;
-    auto entity_begin = entity.offset;
     auto entity_end = entity.offset + entity.length;
+    entity.offset = get_utf16_pos(entity.offset);
+    entity.length = get_utf16_pos(entity_end) - entity.offset;
+  }
+}
 
-    auto pos = static_cast<int32>(ptr - begin);
-    if (entity_begin == pos) {
-      cnt--;
-      entity.offset = utf16_pos;
-    }
+static constexpr uint8 ENTITY_TRIGGER_AT = 1 << 0;
+static constexpr uint8 ENTITY_TRIGGER_SLASH = 1 << 1;
+static constexpr uint8 ENTITY_TRIGGER_HASH = 1 << 2;
+static constexpr uint8 ENTITY_TRIGGER_DOLLAR = 1 << 3;
+static constexpr uint8 ENTITY_TRIGGER_DIGIT = 1 << 4;
+static constexpr uint8 ENTITY_TRIGGER_COLON = 1 << 5;
+static constexpr uint8 ENTITY_TRIGGER_DOT = 1 << 6;
+static constexpr uint8 ENTITY_TRIGGER_ALL = (1 << 7) - 1;
+
+static const uint8 *get_entity_trigger_table() {
+  static uint8 char_to_trigger[256];
+  static bool is_inited = [] {
+    char_to_trigger[static_cast<unsigned char>('@')] = ENTITY_TRIGGER_AT;
+    char_to_trigger[static_cast<unsigned char>('/')] = ENTITY_TRIGGER_SLASH;
+    char_to_trigger[static_cast<unsigned char>('#')] = ENTITY_TRIGGER_HASH;
+    char_to_trigger[static_cast<unsigned char>('$')] = ENTITY_TRIGGER_DOLLAR;
+    for (unsigned char c = '0'; c <= '9'; c++) {
+      char_to_trigger[c] = ENTITY_TRIGGER_DIGIT;
+    }
+    char_to_trigger[static_cast<unsigned char>(':')] = ENTITY_TRIGGER_COLON;
+    char_to_trigger[static_cast<unsigned char>('.')] = ENTITY_TRIGGER_DOT;
+    return true;
+  }();
+  CHECK(is_inited);
+  return char_to_trigger;
+}
 
-    uint32 skipped_code = 0;
-    while (ptr != end && cnt > 0) {
-      unsigned char c = ptr[0];
-      utf16_pos += 1 + (c >= 0xf0);
-      ptr = next_utf8_unsafe(ptr, &skipped_code);
+// returns mask of characters, without which the corresponding entities can't be found in the text
+static uint8 get_entity_triggers(Slice text) {
+  auto table = get_entity_trigger_table();
+  const unsigned char *ptr = text.ubegin();
+  const unsigned char *end = text.uend();
 
-      pos = static_cast<int32>(ptr - begin);
-      if (entity_begin == pos) {
-        cnt--;
-        entity.offset = utf16_pos;
-      } else if (entity_end == pos) {
-        cnt--;
-        entity.length = utf16_pos - entity.offset;
-      }
+  uint8 result = 0;
+  while (end - ptr >= 64) {
+    // branchless inner loop, which can be vectorized by the compiler
+    uint8 chunk_result = 0;
+    for (size_t i = 0; i < 64; i++) {
+      chunk_result |= table[ptr[i]];
+    }
+    ptr += 64;
+    result |= chunk_result;
+    if (result == ENTITY_TRIGGER_ALL) {
+      return result;
     }
-    CHECK(cnt == 0);
   }
+  while (ptr != end) {
+    result |= table[*ptr++];
+  }
+  return result;
 }
 
 vector<MessageEntity> find_entities(Slice text, bool skip_bot_commands, bool skip_media_timestamps) {
   vector<MessageEntity> entities;
 
+  // all recognizers look for some of the trigger characters, so recognizers without them in the text can be skipped
+  auto triggers = get_entity_triggers(text);
+  auto has_triggers = [triggers](uint8 mask) {
+    return (triggers & mask) == mask;
+  };
+
   auto add_entities = [&entities, &text](MessageEntity::Type type, vector<Slice> (*find_entities_f)(Slice)) mutable {
     auto new_entities = find_entities_f(text);
     for (auto &entity : new_entities) {
@@ -1689,23 +1729,35 @@ vector<MessageEntity> find_entities(Slice text, bool skip_bot_commands, bool ski
       entities.emplace_back(type, offset, length);
     }
   };
-  add_entities(MessageEntity::Type::Mention, find_mentions);
-  if (!skip_bot_commands) {
+  if (has_triggers(ENTITY_TRIGGER_AT)) {
+    add_entities(MessageEntity::Type::Mention, find_mentions);
+  }
+  if (!skip_bot_commands && has_triggers(ENTITY_TRIGGER_SLASH)) {
     add_entities(MessageEntity::Type::BotCommand, find_bot_commands);
   }
-  add_entities(MessageEntity::Type::Hashtag, find_hashtags);
-  add_entities(MessageEntity::Type::Cashtag, find_cashtags);
+  if (has_triggers(ENTITY_TRIGGER_HASH)) {
+    add_entities(MessageEntity::Type::Hashtag, find_hashtags);
+  }
+  if (has_triggers(ENTITY_TRIGGER_DOLLAR)) {
+    add_entities(MessageEntity::Type::Cashtag, find_cashtags);
+  }
   // TODO find_phone_numbers
-  add_entities(MessageEntity::Type::BankCardNumber, find_bank_card_numbers);
-  add_entities(MessageEntity::Type::Url, find_tg_urls);
-  auto urls = find_urls(text);
-  for (auto &url : urls) {
-    auto type = url.second ? MessageEntity::Type::EmailAddress : MessageEntity::Type::Url;
-    auto offset = narrow_cast<int32>(url.first.begin() - text.begin());
-    auto length = narrow_cast<int32>(url.first.size());
-    entities.emplace_back(type, offset, length);
-  }
-  if (!skip_media_timestamps) {
+  if (has_triggers(ENTITY_TRIGGER_DIGIT)) {
+    add_entities(MessageEntity::Type::BankCardNumber, find_bank_card_numbers);
+  }
+  if (has_triggers(ENTITY_TRIGGER_COLON | ENTITY_TRIGGER_SLASH)) {
+    add_entities(MessageEntity::Type::Url, find_tg_urls);
+  }
+  if (has_triggers(ENTITY_TRIGGER_DOT)) {
+    auto urls = find_urls(text);
+    for (auto &url : urls) {
+      auto type = url.second ? MessageEntity::Type::EmailAddress : MessageEntity::Type::Url;
+      auto offset = narrow_cast<int32>(url.first.begin() - text.begin());
+      auto length = narrow_cast<int32>(url.first.size());
+      entities.emplace_back(type, offset, length);
+    }
+  }
+  if (!skip_media_timestamps && has_triggers(ENTITY_TRIGGER_COLON | ENTITY_TRIGGER_DIGIT)) {
     auto media_timestamps = find_media_timestamps(text);
     for (auto &entity : media_timestamps) {
       auto offset = narrow_cast<int32>(entity.first.begin() - text.begin());
@@ -1771,6 +1823,7 @@ static bool is_plain_domain(Slice url) {
 }
 
 Slice get_first_url(const FormattedText &text) {
+  unique_ptr<Utf16OffsetIndex> offset_index;  // created only if there are Url entities
   for (auto &entity : text.entities) {
     switch (entity.type) {
       case MessageEntity::Type::Mention:
@@ -1783,7 +1836,10 @@ Slice get_first_url(const FormattedText &text) {
         if (entity.length <= 4) {
           continue;
         }
-        auto url = utf8_utf16_substr(text.text, entity.offset, entity.length);
+        if (offset_index == nullptr) {
+          offset_index = td::make_unique<Utf16OffsetIndex>(text.text);
+        }
+        auto url = offset_index->substr(entity.offset, entity.length);
         string scheme = to_lower(url.substr(0, 4));
         if (scheme == "ton:" || begins_with(scheme, "tg:") || scheme == "ftp:" || is_plain_domain(url)) {
           continue;
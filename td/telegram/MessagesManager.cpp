@@ -10582,6 +10582,7 @@ void MessagesManager::delete_dialog_messages_by_sender(DialogId dialog_id, Dialo
 
   if (G()->use_message_database()) {
     LOG(INFO) << "Delete all messages from " << sender_dialog_id << " in " << dialog_id << " from database";
+    drop_history_prefetch(dialog_id);
     G()->td_db()->get_message_db_async()->delete_dialog_messages_by_sender(dialog_id, sender_dialog_id,
                                                                            Auto());  // TODO Promise
   }
@@ -15805,6 +15806,29 @@ vector<DialogId> MessagesManager::get_dialogs(DialogListId dialog_list_id, Dialo
   }
 }
 
+vector<DialogId> MessagesManager::get_startup_snapshot_dialog_ids(size_t limit) const {
+  CHECK(!td_->auth_manager_->is_bot());
+  vector<DialogId> result;
+  const auto *list = get_dialog_list(DialogListId(FolderId::main()));
+  if (list != nullptr) {
+    for (const auto &pinned_dialog : list->pinned_dialogs_) {
+      if (result.size() == limit) {
+        return result;
+      }
+      result.push_back(pinned_dialog.get_dialog_id());
+    }
+  }
+  for (const auto &dialog_date : get_dialog_folder(FolderId::main())->ordered_dialogs_) {
+    if (result.size() == limit || dialog_date.get_order() == DEFAULT_ORDER) {
+      break;
+    }
+    if (!td::contains(result, dialog_date.get_dialog_id())) {
+      result.push_back(dialog_date.get_dialog_id());
+    }
+  }
+  return result;
+}
+
 void MessagesManager::load_dialog_list(DialogList &list, int32 limit, Promise<Unit> &&promise) {
   CHECK(!td_->auth_manager_->is_bot());
   if (limit > MAX_GET_DIALOGS + 2) {
@@ -22011,9 +22035,119 @@ void MessagesManager::on_get_history_from_database(DialogId dialog_id, MessageId
     send_update_chat_last_message(d, "on_get_history_from_database 7");
   }
 
+  if (offset == -1 || from_the_end) {
+    // if the history is scrolled back, then the next request is likely to be for older messages
+    prefetch_history_from_database(d, from_message_id, from_the_end, first_added_message_id);
+  }
+
   promise.set_value(Unit());
 }
 
+void MessagesManager::send_get_history_from_database_query(const Dialog *d, MessageId from_message_id, int32 offset,
+                                                           int32 limit, bool only_local, Promise<Unit> &&promise) {
+  MessageDbMessagesQuery db_query;
+  db_query.dialog_id = d->dialog_id;
+  db_query.from_message_id = from_message_id;
+  db_query.offset = offset;
+  db_query.limit = limit;
+  G()->td_db()->get_message_db_async()->get_messages(
+      db_query, PromiseCreator::lambda([actor_id = actor_id(this), dialog_id = d->dialog_id, from_message_id,
+                                        old_last_database_message_id = d->last_database_message_id, offset, limit,
+                                        only_local, promise = std::move(promise)](
+                                           vector<MessageDbDialogMessage> messages) mutable {
+        send_closure(actor_id, &MessagesManager::on_get_history_from_database, dialog_id, from_message_id,
+                     old_last_database_message_id, offset, limit, only_local, std::move(messages), std::move(promise));
+      }));
+}
+
+void MessagesManager::prefetch_history_from_database(const Dialog *d, MessageId from_message_id, bool from_the_end,
+                                                     MessageId next_from_message_id) {
+  if (!G()->use_message_database() || G()->close_flag()) {
+    return;
+  }
+  if (!d->have_full_history && (!d->first_database_message_id.is_valid() ||
+                                next_from_message_id <= d->first_database_message_id)) {
+    // there are no more messages in the database
+    next_from_message_id = MessageId();
+  }
+
+  auto dialog_id = d->dialog_id;
+  vector<HistoryPrefetcher::WaitingQuery> dropped_queries;
+  auto prefetch_id = history_prefetcher_.on_page_loaded(dialog_id, from_message_id, from_the_end, next_from_message_id,
+                                                        d->last_database_message_id, dropped_queries);
+  resend_get_history_from_database_queries(std::move(dropped_queries));
+  if (prefetch_id == 0) {
+    return;
+  }
+
+  LOG(INFO) << "Prefetch history in " << dialog_id << " from " << next_from_message_id << " from database";
+  MessageDbMessagesQuery db_query;
+  db_query.dialog_id = dialog_id;
+  db_query.from_message_id = next_from_message_id;
+  db_query.offset = -1;
+  db_query.limit = MAX_GET_HISTORY;
+  G()->td_db()->get_message_db_async()->get_messages(
+      db_query, PromiseCreator::lambda([actor_id = actor_id(this), dialog_id,
+                                        prefetch_id](vector<MessageDbDialogMessage> messages) {
+        send_closure(actor_id, &MessagesManager::on_prefetch_history_from_database, dialog_id, prefetch_id,
+                     std::move(messages));
+      }));
+}
+
+void MessagesManager::on_prefetch_history_from_database(DialogId dialog_id, uint64 prefetch_id,
+                                                        vector<MessageDbDialogMessage> &&messages) {
+  HistoryPrefetcher::WaitingQuery query;
+  HistoryPrefetcher::Page page;
+  if (history_prefetcher_.on_prefetch_loaded(dialog_id, prefetch_id, std::move(messages), query, page)) {
+    on_get_history_from_prefetch(std::move(query), std::move(page));
+  }
+}
+
+bool MessagesManager::get_history_from_prefetch(const Dialog *d, MessageId from_message_id, int32 limit,
+                                                bool only_local, Promise<Unit> &promise) {
+  CHECK(d != nullptr);
+  HistoryPrefetcher::Page page;
+  switch (history_prefetcher_.get_page(d->dialog_id, from_message_id, limit, only_local, promise, page)) {
+    case HistoryPrefetcher::GetPageResult::NotFound:
+      return false;
+    case HistoryPrefetcher::GetPageResult::Waiting:
+      return true;
+    case HistoryPrefetcher::GetPageResult::Found: {
+      HistoryPrefetcher::WaitingQuery query;
+      query.dialog_id_ = d->dialog_id;
+      query.from_message_id_ = from_message_id;
+      query.limit_ = limit;
+      query.only_local_ = only_local;
+      query.promise_ = std::move(promise);
+      on_get_history_from_prefetch(std::move(query), std::move(page));
+      return true;
+    }
+    default:
+      UNREACHABLE();
+      return false;
+  }
+}
+
+void MessagesManager::on_get_history_from_prefetch(HistoryPrefetcher::WaitingQuery &&query,
+                                                   HistoryPrefetcher::Page &&page) {
+  LOG(INFO) << "Use prefetched " << page.messages_.size() << " history messages in " << query.dialog_id_ << " from "
+            << query.from_message_id_;
+  send_closure_later(actor_id(this), &MessagesManager::on_get_history_from_database, query.dialog_id_,
+                     query.from_message_id_, page.old_last_database_message_id_, -1, query.limit_, query.only_local_,
+                     std::move(page.messages_), std::move(query.promise_));
+}
+
+void MessagesManager::resend_get_history_from_database_queries(vector<HistoryPrefetcher::WaitingQuery> &&queries) {
+  for (auto &query : queries) {
+    send_get_history_from_database_query(get_dialog(query.dialog_id_), query.from_message_id_, -1, query.limit_,
+                                         query.only_local_, std::move(query.promise_));
+  }
+}
+
+void MessagesManager::drop_history_prefetch(DialogId dialog_id) {
+  resend_get_history_from_database_queries(history_prefetcher_.drop_prefetch(dialog_id));
+}
+
 void MessagesManager::load_last_dialog_message_later(DialogId dialog_id) {
   if (G()->close_flag()) {
     return;
@@ -22108,20 +22242,10 @@ void MessagesManager::get_history_impl(const Dialog *d, MessageId from_message_i
       send_closure(actor_id, &MessagesManager::on_get_history_finished, query, std::move(result));
     });
 
-    MessageDbMessagesQuery db_query;
-    db_query.dialog_id = dialog_id;
-    db_query.from_message_id = from_message_id;
-    db_query.offset = offset;
-    db_query.limit = limit;
-    G()->td_db()->get_message_db_async()->get_messages(
-        db_query,
-        PromiseCreator::lambda([actor_id = actor_id(this), dialog_id, from_message_id,
-                                old_last_database_message_id = d->last_database_message_id, offset, limit, only_local,
-                                promise = std::move(query_promise)](vector<MessageDbDialogMessage> messages) mutable {
-          send_closure(actor_id, &MessagesManager::on_get_history_from_database, dialog_id, from_message_id,
-                       old_last_database_message_id, offset, limit, only_local, std::move(messages),
-                       std::move(promise));
-        }));
+    if (offset == -1 && get_history_from_prefetch(d, from_message_id, limit, only_local, query_promise)) {
+      return;
+    }
+    send_get_history_from_database_query(d, from_message_id, offset, limit, only_local, std::move(query_promise));
   } else {
     if (only_local || dialog_id.get_type() == DialogType::SecretChat ||
         (from_the_end && d->last_message_id.is_valid())) {
@@ -33239,6 +33363,7 @@ void MessagesManager::add_message_to_database(const Dialog *d, const Message *m,
   LOG_CHECK(message_id.is_server() || message_id.is_local()) << source;
 
   LOG(INFO) << "Add " << MessageFullId(d->dialog_id, message_id) << " to database from " << source;
+  drop_history_prefetch(d->dialog_id);
 
   ServerMessageId unique_message_id;
   int64 random_id = 0;
@@ -33328,6 +33453,7 @@ void MessagesManager::delete_all_dialog_messages_from_database(Dialog *d, Messag
     }
   }
   */
+  drop_history_prefetch(dialog_id);
   G()->td_db()->get_message_db_async()->delete_all_dialog_messages(dialog_id, max_message_id, Auto());  // TODO Promise
 }
 
@@ -33498,6 +33624,10 @@ void MessagesManager::delete_message_from_database(Dialog *d, MessageId message_
   }
 
   if (G()->use_message_database()) {
+    if (!message_id.is_scheduled()) {
+      drop_history_prefetch(d->dialog_id);
+    }
+
     DeleteMessageLogEvent log_event;
 
     log_event.message_full_id_ = {d->dialog_id, message_id};
@@ -24,6 +24,7 @@
 #include "td/telegram/files/FileId.h"
 #include "td/telegram/files/FileSourceId.h"
 #include "td/telegram/FolderId.h"
+#include "td/telegram/HistoryPrefetcher.h"
 #include "td/telegram/InputGroupCallId.h"
 #include "td/telegram/logevent/LogEventHelper.h"
 #include "td/telegram/MessageContentType.h"
@@ -537,6 +538,8 @@ class MessagesManager final : public Actor {
   vector<DialogId> get_dialogs(DialogListId dialog_list_id, DialogDate offset, int32 limit, bool exact_limit,
                                bool force, Promise<Unit> &&promise);
 
+  vector<DialogId> get_startup_snapshot_dialog_ids(size_t limit) const;
+
   void get_dialogs_from_list(DialogListId dialog_list_id, int32 limit,
                              Promise<td_api::object_ptr<td_api::chats>> &&promise);
 
@@ -2119,6 +2122,24 @@ class MessagesManager final : public Actor {
                                     MessageId old_last_database_message_id, int32 offset, int32 limit, bool only_local,
                                     vector<MessageDbDialogMessage> &&messages, Promise<Unit> &&promise);
 
+  void send_get_history_from_database_query(const Dialog *d, MessageId from_message_id, int32 offset, int32 limit,
+                                            bool only_local, Promise<Unit> &&promise);
+
+  void prefetch_history_from_database(const Dialog *d, MessageId from_message_id, bool from_the_end,
+                                      MessageId next_from_message_id);
+
+  void on_prefetch_history_from_database(DialogId dialog_id, uint64 prefetch_id,
+                                         vector<MessageDbDialogMessage> &&messages);
+
+  bool get_history_from_prefetch(const Dialog *d, MessageId from_message_id, int32 limit, bool only_local,
+                                 Promise<Unit> &promise);
+
+  void on_get_history_from_prefetch(HistoryPrefetcher::WaitingQuery &&query, HistoryPrefetcher::Page &&page);
+
+  void resend_get_history_from_database_queries(vector<HistoryPrefetcher::WaitingQuery> &&queries);
+
+  void drop_history_prefetch(DialogId dialog_id);
+
   void get_history_impl(const Dialog *d, MessageId from_message_id, int32 offset, int32 limit, bool from_database,
                         bool only_local, Promise<Unit> &&promise, const char *source);
 
@@ -3494,6 +3515,8 @@ class MessagesManager final : public Actor {
 
   FlatHashMap<PendingGetHistoryQuery, vector<Promise<Unit>>, PendingGetHistoryQueryHash> get_history_queries_;
 
+  HistoryPrefetcher history_prefetcher_{MAX_GET_HISTORY};
+
   uint32 scheduled_messages_sync_generation_ = 1;
 
   int64 authorization_date_ = 0;
@@ -252,7 +252,7 @@ void OptionManager::set_option_string(Slice name, Slice value) {
 }
 
 bool OptionManager::have_option(Slice name) const {
-  return options_->isset(name.str());
+  return options_->isset(name);
 }
 
 bool OptionManager::get_option_boolean(Slice name, bool default_value) const {
@@ -325,7 +325,7 @@ void OptionManager::set_option(Slice name, Slice value) {
 }
 
 string OptionManager::get_option(Slice name) const {
-  return options_->get(name.str());
+  return options_->get(name);
 }
 
 td_api::object_ptr<td_api::OptionValue> OptionManager::get_unix_time_option_value_object() {
@@ -686,10 +686,30 @@ void OptionManager::get_option(const string &name, Promise<td_api::object_ptr<td
         return promise.set_value(td_api::make_object<td_api::optionValueBoolean>(td_->is_online()));
       }
       break;
+    case 'r':
+      if (name == "reloaded_full_info_count") {
+        if (is_td_inited_) {
+          promise.set_value(td_api::make_object<td_api::optionValueInteger>(
+              td_->user_manager_->get_reloaded_full_info_count() + td_->chat_manager_->get_reloaded_full_info_count()));
+        } else {
+          pending_get_options_.emplace_back(name, std::move(promise));
+        }
+        return;
+      }
+      break;
     case 'u':
       if (name == "unix_time") {
         return promise.set_value(get_unix_time_option_value_object());
       }
+      if (name == "unloaded_full_info_count") {
+        if (is_td_inited_) {
+          promise.set_value(td_api::make_object<td_api::optionValueInteger>(
+              td_->user_manager_->get_unloaded_full_info_count() + td_->chat_manager_->get_unloaded_full_info_count()));
+        } else {
+          pending_get_options_.emplace_back(name, std::move(promise));
+        }
+        return;
+      }
       break;
   }
   wrap_promise().set_value(Unit());
@@ -896,6 +916,9 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
       }
       break;
     case 'm':
+      if (set_integer_option("max_cached_full_info_size")) {
+        return;
+      }
       if (set_integer_option("message_unload_delay", 60, 86400)) {
         return;
       }
@@ -943,6 +966,12 @@ void OptionManager::set_option(const string &name, td_api::object_ptr<td_api::Op
       }
       break;
     case 's':
+      if (set_string_option("shared_file_cache_directory", [](Slice value) { return true; })) {
+        return;
+      }
+      if (set_integer_option("shared_file_cache_max_size", 0, std::numeric_limits<int64>::max())) {
+        return;
+      }
       if (set_integer_option("storage_max_files_size")) {
         return;
       }
@@ -7,23 +7,32 @@
 #include "td/telegram/QueryMerger.h"
 
 #include "td/utils/logging.h"
+#include "td/utils/Time.h"
 
 namespace td {
 
-QueryMerger::QueryMerger(Slice name, size_t max_concurrent_query_count, size_t max_merged_query_count)
-    : max_concurrent_query_count_(max_concurrent_query_count), max_merged_query_count_(max_merged_query_count) {
+QueryMerger::QueryMerger(Slice name, size_t max_concurrent_query_count, size_t max_merged_query_count,
+                         double merge_delay)
+    : max_concurrent_query_count_(max_concurrent_query_count)
+    , max_merged_query_count_(max_merged_query_count)
+    , merge_delay_(merge_delay) {
   register_actor(name, this).release();
 }
 
 void QueryMerger::add_query(int64 query_id, Promise<Unit> &&promise, const char *source) {
   LOG(INFO) << "Add query " << query_id << " with" << (promise ? "" : "out") << " promise from " << source;
   CHECK(query_id != 0);
+  added_query_count_++;
   auto &query = queries_[query_id];
   query.promises_.push_back(std::move(promise));
   if (query.promises_.size() != 1) {
     // duplicate query, just wait
+    duplicate_query_count_++;
     return;
   }
+  if (pending_queries_.empty()) {
+    first_pending_query_time_ = Time::now();
+  }
   pending_queries_.push(query_id);
   loop();
 }
@@ -32,6 +41,12 @@ void QueryMerger::send_query(vector<int64> query_ids) {
   CHECK(merge_function_ != nullptr);
   LOG(INFO) << "Send queries " << query_ids;
   query_count_++;
+  sent_query_count_ += query_ids.size();
+  sent_request_count_++;
+  if (sent_request_count_ % 100 == 0) {
+    LOG(INFO) << "Sent " << sent_request_count_ << " requests for " << sent_query_count_ << " queries out of "
+              << added_query_count_ << " added queries with " << duplicate_query_count_ << " duplicates";
+  }
   merge_function_(query_ids, PromiseCreator::lambda([actor_id = actor_id(this), query_ids](Result<Unit> &&result) {
                     send_closure(actor_id, &QueryMerger::on_get_query_result, std::move(query_ids), std::move(result));
                   }));
@@ -56,9 +71,16 @@ void QueryMerger::on_get_query_result(vector<int64> query_ids, Result<Unit> &&re
 }
 
 void QueryMerger::loop() {
-  if (query_count_ == max_concurrent_query_count_) {
+  if (query_count_ == max_concurrent_query_count_ || pending_queries_.empty()) {
     return;
   }
+  if (merge_delay_ > 0 && pending_queries_.size() < max_merged_query_count_) {
+    auto send_time = first_pending_query_time_ + merge_delay_;
+    if (Time::now() < send_time) {
+      set_timeout_at(send_time);
+      return;
+    }
+  }
 
   vector<int64> query_ids;
   while (!pending_queries_.empty()) {
@@ -20,9 +20,10 @@
 namespace td {
 
 // merges queries into a single request
+// if merge_delay is positive, a query waits up to merge_delay seconds for other queries to be merged with
 class QueryMerger final : public Actor {
  public:
-  QueryMerger(Slice name, size_t max_concurrent_query_count, size_t max_merged_query_count);
+  QueryMerger(Slice name, size_t max_concurrent_query_count, size_t max_merged_query_count, double merge_delay = 0.0);
 
   using MergeFunction = std::function<void(vector<int64> query_ids, Promise<Unit> &&promise)>;
   void set_merge_function(MergeFunction merge_function) {
@@ -39,6 +40,14 @@ class QueryMerger final : public Actor {
   size_t query_count_ = 0;
   size_t max_concurrent_query_count_;
   size_t max_merged_query_count_;
+  double merge_delay_;
+  double first_pending_query_time_ = 0.0;
+
+  // statistics
+  uint64 added_query_count_ = 0;
+  uint64 duplicate_query_count_ = 0;
+  uint64 sent_query_count_ = 0;
+  uint64 sent_request_count_ = 0;
 
   MergeFunction merge_function_;
   std::queue<int64> pending_queries_;
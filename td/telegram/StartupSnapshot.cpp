@@ -0,0 +1,83 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/StartupSnapshot.h"
+
+#include "td/utils/crypto.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/path.h"
+#include "td/utils/Random.h"
+
+namespace td {
+
+namespace {
+
+struct StartupSnapshotFile {
+  static constexpr int32 CURRENT_VERSION = 1;
+
+  int32 version = 0;
+  string token;
+  int32 data_crc32 = 0;
+  string data;
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    td::store(version, storer);
+    td::store(token, storer);
+    td::store(data_crc32, storer);
+    td::store(data, storer);
+  }
+
+  template <class ParserT>
+  void parse(ParserT &parser) {
+    td::parse(version, parser);
+    if (version != CURRENT_VERSION) {
+      return parser.set_error("Unsupported version");
+    }
+    td::parse(token, parser);
+    td::parse(data_crc32, parser);
+    td::parse(data, parser);
+  }
+};
+
+constexpr int32 StartupSnapshotFile::CURRENT_VERSION;
+
+}  // namespace
+
+Result<string> write_startup_snapshot_file(CSlice path, string data) {
+  StartupSnapshotFile file;
+  file.version = StartupSnapshotFile::CURRENT_VERSION;
+  file.token = to_string(Random::secure_uint64());
+  file.data_crc32 = static_cast<int32>(crc32(data));
+  file.data = std::move(data);
+  TRY_STATUS(atomic_write_file(path, serialize(file)));
+  return std::move(file.token);
+}
+
+string read_startup_snapshot_file(CSlice path, Slice token) {
+  auto r_content = read_file_str(path);
+  unlink(path).ignore();
+  if (r_content.is_error()) {
+    LOG(INFO) << "Failed to read startup snapshot: " << r_content.error();
+    return string();
+  }
+
+  StartupSnapshotFile file;
+  auto status = unserialize(file, r_content.ok());
+  if (status.is_error()) {
+    LOG(WARNING) << "Failed to parse startup snapshot: " << status;
+    return string();
+  }
+  if (file.token != token || static_cast<uint32>(file.data_crc32) != crc32(file.data)) {
+    LOG(WARNING) << "Ignore outdated or broken startup snapshot";
+    return string();
+  }
+  return std::move(file.data);
+}
+
+}  // namespace td
@@ -0,0 +1,51 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/ChannelId.h"
+#include "td/telegram/ChatId.h"
+#include "td/telegram/UserId.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+#include "td/utils/tl_helpers.h"
+
+#include <utility>
+
+namespace td {
+
+// database values of users, basic groups and supergroups from the first chats of the main chat list,
+// which are loaded at once on the next start instead of being loaded one by one from the database
+struct StartupSnapshot {
+  vector<std::pair<UserId, string>> users;
+  vector<std::pair<ChatId, string>> chats;
+  vector<std::pair<ChannelId, string>> channels;
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    td::store(users, storer);
+    td::store(chats, storer);
+    td::store(channels, storer);
+  }
+
+  template <class ParserT>
+  void parse(ParserT &parser) {
+    td::parse(users, parser);
+    td::parse(chats, parser);
+    td::parse(channels, parser);
+  }
+};
+
+// the file isn't encrypted, so it must not be written for an encrypted database
+// returns a random token, which must be saved together with the file and passed to read_startup_snapshot_file
+Result<string> write_startup_snapshot_file(CSlice path, string data);
+
+// reads and deletes the file; returns an empty string if the file is missing, broken or was written with another token
+string read_startup_snapshot_file(CSlice path, Slice token);
+
+}  // namespace td
@@ -85,6 +85,7 @@
 #include "td/telegram/LanguagePackManager.h"
 #include "td/telegram/LinkManager.h"
 #include "td/telegram/Location.h"
+#include "td/telegram/logevent/LogEvent.h"
 #include "td/telegram/Logging.h"
 #include "td/telegram/MessageCopyOptions.h"
 #include "td/telegram/MessageEffectId.h"
@@ -144,6 +145,7 @@
 #include "td/telegram/SentEmailCode.h"
 #include "td/telegram/SponsoredMessageManager.h"
 #include "td/telegram/StarManager.h"
+#include "td/telegram/StartupSnapshot.h"
 #include "td/telegram/StateManager.h"
 #include "td/telegram/StatisticsManager.h"
 #include "td/telegram/StickerFormat.h"
@@ -201,6 +203,7 @@
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/Time.h"
 #include "td/utils/Timer.h"
 #include "td/utils/utf8.h"
 
@@ -3327,6 +3330,9 @@ void Td::close_impl(bool destroy_flag) {
   G()->set_close_flag();
   send_closure(auth_manager_actor_, &AuthManager::on_closing, destroy_flag);
   updates_manager_->timeout_expired();  // save PTS and QTS
+  if (!destroy_flag_) {
+    save_startup_snapshot();
+  }
 
   // wait till all request_actors will stop
   request_actors_.clear();
@@ -3532,6 +3538,7 @@ void Td::init(Parameters parameters, Result<TdDb::OpenedDatabase> r_opened_datab
 
 void Td::process_binlog_events(TdDb::OpenedDatabase &&events) {
   VLOG(td_init) << "Send binlog events";
+  auto start_time = Time::now();
   for (auto &event : events.user_events) {
     user_manager_->on_binlog_user_event(std::move(event));
   }
@@ -3549,6 +3556,10 @@ void Td::process_binlog_events(TdDb::OpenedDatabase &&events) {
     user_manager_->on_binlog_secret_chat_event(std::move(event));
   }
 
+  // must be loaded after binlog events, which can contain newer versions of the same objects
+  auto startup_snapshot_size = events.startup_snapshot.size();
+  load_startup_snapshot(std::move(events.startup_snapshot));
+
   for (auto &event : events.web_page_events) {
     web_pages_manager_->on_binlog_web_page_event(std::move(event));
   }
@@ -3556,6 +3567,10 @@ void Td::process_binlog_events(TdDb::OpenedDatabase &&events) {
   for (auto &event : events.save_app_log_events) {
     on_save_app_log_binlog_event(this, std::move(event));
   }
+  LOG(INFO) << "Processed binlog events " << tag("users", events.user_events.size())
+            << tag("chats", events.chat_events.size()) << tag("channels", events.channel_events.size())
+            << tag("secret_chats", events.secret_chat_events.size()) << tag("web_pages", events.web_page_events.size())
+            << tag("snapshot_size", startup_snapshot_size) << tag("time", format::as_time(Time::now() - start_time));
 
   // Send binlog events to managers
   //
@@ -3596,6 +3611,62 @@ void Td::process_binlog_events(TdDb::OpenedDatabase &&events) {
   send_closure(secret_chats_manager_, &SecretChatsManager::binlog_replay_finish);
 }
 
+void Td::load_startup_snapshot(string &&startup_snapshot) {
+  if (startup_snapshot.empty()) {
+    return;
+  }
+  StartupSnapshot snapshot;
+  auto status = log_event_parse(snapshot, startup_snapshot);
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to parse startup snapshot: " << status;
+    return;
+  }
+  LOG(INFO) << "Load startup snapshot with " << snapshot.users.size() << " users, " << snapshot.chats.size()
+            << " basic groups and " << snapshot.channels.size() << " supergroups";
+
+  // chats may contain links to channels, so should be loaded after
+  user_manager_->on_load_startup_snapshot_users(std::move(snapshot.users));
+  chat_manager_->on_load_startup_snapshot_channels(std::move(snapshot.channels));
+  chat_manager_->on_load_startup_snapshot_chats(std::move(snapshot.chats));
+}
+
+void Td::save_startup_snapshot() {
+  if (!G()->use_chat_info_database() || !auth_manager_->is_authorized() || auth_manager_->is_bot() ||
+      G()->td_db()->is_encrypted()) {
+    return;
+  }
+
+  static constexpr size_t MAX_STARTUP_SNAPSHOT_DIALOGS = 100;
+  vector<UserId> user_ids{user_manager_->get_my_id()};
+  vector<ChatId> chat_ids;
+  vector<ChannelId> channel_ids;
+  for (auto dialog_id : messages_manager_->get_startup_snapshot_dialog_ids(MAX_STARTUP_SNAPSHOT_DIALOGS)) {
+    switch (dialog_id.get_type()) {
+      case DialogType::User:
+        user_ids.push_back(dialog_id.get_user_id());
+        break;
+      case DialogType::Chat:
+        chat_ids.push_back(dialog_id.get_chat_id());
+        break;
+      case DialogType::Channel:
+        channel_ids.push_back(dialog_id.get_channel_id());
+        break;
+      case DialogType::SecretChat:
+        user_ids.push_back(user_manager_->get_secret_chat_user_id(dialog_id.get_secret_chat_id()));
+        break;
+      case DialogType::None:
+      default:
+        UNREACHABLE();
+    }
+  }
+
+  StartupSnapshot snapshot;
+  snapshot.users = user_manager_->get_startup_snapshot_users(user_ids);
+  snapshot.chats = chat_manager_->get_startup_snapshot_chats(chat_ids);
+  snapshot.channels = chat_manager_->get_startup_snapshot_channels(channel_ids);
+  G()->td_db()->set_startup_snapshot(log_event_store(snapshot).as_slice().str());
+}
+
 void Td::init_options_and_network() {
   VLOG(td_init) << "Create StateManager";
   class StateManagerCallback final : public StateManager::Callback {
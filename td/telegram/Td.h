@@ -2051,6 +2051,10 @@ class Td final : public Actor {
 
   void process_binlog_events(TdDb::OpenedDatabase &&events);
 
+  void load_startup_snapshot(string &&startup_snapshot);
+
+  void save_startup_snapshot();
+
   void clear();
 
   void close_impl(bool destroy_flag);
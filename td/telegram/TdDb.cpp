@@ -13,6 +13,7 @@
 #include "td/telegram/logevent/LogEvent.h"
 #include "td/telegram/MessageDb.h"
 #include "td/telegram/MessageThreadDb.h"
+#include "td/telegram/StartupSnapshot.h"
 #include "td/telegram/StoryDb.h"
 #include "td/telegram/Td.h"
 #include "td/telegram/Version.h"
@@ -20,6 +21,7 @@
 #include "td/db/binlog/Binlog.h"
 #include "td/db/binlog/ConcurrentBinlog.h"
 #include "td/db/BinlogKeyValue.h"
+#include "td/db/BlobDictionaryDb.h"
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteKeyValue.h"
@@ -29,6 +31,8 @@
 #include "td/actor/actor.h"
 #include "td/actor/MultiPromise.h"
 
+#include "td/utils/algorithm.h"
+#include "td/utils/BlobCompressor.h"
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
@@ -39,6 +43,7 @@
 #include "td/utils/Random.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/StringBuilder.h"
+#include "td/utils/Time.h"
 
 #include <algorithm>
 
@@ -50,11 +55,34 @@ std::string get_binlog_path(const TdDb::Parameters &parameters) {
   return PSTRING() << parameters.database_directory_ << "td" << (parameters.is_test_dc_ ? "_test" : "") << ".binlog";
 }
 
+std::string get_startup_snapshot_path(const TdDb::Parameters &parameters) {
+  return PSTRING() << parameters.database_directory_ << "td" << (parameters.is_test_dc_ ? "_test" : "") << ".snapshot";
+}
+
 std::string get_sqlite_path(const TdDb::Parameters &parameters) {
   const string db_name = "db" + (parameters.is_test_dc_ ? string("_test") : string());
   return parameters.database_directory_ + db_name + ".sqlite";
 }
 
+// the snapshot is valid only if it was saved together with the token in the binlog, and it can be used only once,
+// because the database is changed after the snapshot is loaded
+string load_startup_snapshot(const TdDb::Parameters &parameters, bool is_encrypted,
+                             BinlogKeyValue<Binlog> &binlog_pmc) {
+  auto path = get_startup_snapshot_path(parameters);
+  auto token = binlog_pmc.get("startup_snapshot");
+  if (token.empty()) {
+    unlink(path).ignore();
+    return string();
+  }
+  binlog_pmc.erase("startup_snapshot");
+
+  auto data = read_startup_snapshot_file(path, token);
+  if (!parameters.use_chat_info_database_ || is_encrypted) {
+    return string();
+  }
+  return data;
+}
+
 Status init_binlog(Binlog &binlog, string path, BinlogKeyValue<Binlog> &binlog_pmc, BinlogKeyValue<Binlog> &config_pmc,
                    TdDb::OpenedDatabase &events, DbKey key) {
   auto r_binlog_stat = stat(path);
@@ -179,6 +207,70 @@ Status init_binlog(Binlog &binlog, string path, BinlogKeyValue<Binlog> &binlog_p
   return Status::OK();
 }
 
+// NB: must happen inside a transaction
+Status init_blob_dictionary(SqliteDb &db, bool use_message_database, BinlogKeyValue<Binlog> &binlog_pmc) {
+  // the dictionary is retrained from time to time, because typical content of the blobs changes
+  constexpr int32 DICTIONARY_LIFETIME = 90 * 86400;
+  // training reads thousands of blobs, so it isn't retried on every start if there was not enough data
+  constexpr int32 TRAINING_RETRY_DELAY = 86400;
+  constexpr size_t MIN_TRAINING_DATA_SIZE = 256 << 10;
+
+  TRY_STATUS(init_blob_dictionary_db(db));
+  TRY_RESULT(dictionary_date, get_blob_dictionary_date(db));
+  auto now = static_cast<int32>(Clocks::system());
+  if (dictionary_date != 0 && dictionary_date > now - DICTIONARY_LIFETIME) {
+    return Status::OK();
+  }
+  auto training_date = to_integer<int32>(binlog_pmc.get("blob_dictionary_training_date"));
+  if (training_date > now - TRAINING_RETRY_DELAY && training_date <= now) {
+    return Status::OK();
+  }
+  binlog_pmc.set("blob_dictionary_training_date", to_string(now));
+
+  // train the dictionary on the latest blobs, which can be already compressed with the previous dictionary
+  TRY_RESULT(compressor, load_blob_compressor(db));
+  vector<BufferSlice> samples;
+  size_t total_size = 0;
+  auto add_samples = [&](CSlice query) -> Status {
+    TRY_RESULT(stmt, db.get_statement(query));
+    TRY_STATUS(stmt.step());
+    while (stmt.has_row()) {
+      auto r_sample = compressor.decompress(stmt.view_blob(0));
+      if (r_sample.is_ok() && r_sample.ok().size() >= BlobCompressor::MIN_COMPRESSED_SIZE) {
+        total_size += r_sample.ok().size();
+        samples.push_back(r_sample.move_as_ok());
+      }
+      TRY_STATUS(stmt.step());
+    }
+    return Status::OK();
+  };
+  if (use_message_database) {
+    TRY_STATUS(add_samples("SELECT data FROM messages ORDER BY rowid DESC LIMIT 4000"));
+    TRY_STATUS(add_samples("SELECT data FROM dialogs ORDER BY rowid DESC LIMIT 1000"));
+  }
+  TRY_RESULT(has_common_table, db.has_table("common"));
+  if (has_common_table) {
+    TRY_STATUS(
+        add_samples("SELECT v FROM common WHERE (k >= CAST('ch' AS BLOB) AND k < CAST('ci' AS BLOB)) OR "
+                    "(k >= CAST('gr' AS BLOB) AND k < CAST('gs' AS BLOB)) OR "
+                    "(k >= CAST('us' AS BLOB) AND k < CAST('ut' AS BLOB)) LIMIT 2000"));
+  }
+  if (total_size < MIN_TRAINING_DATA_SIZE) {
+    LOG(INFO) << "Have only " << total_size << " bytes of data to train compression dictionary";
+    return Status::OK();
+  }
+
+  auto begin_time = Time::now();
+  auto dictionary = BlobCompressor::train_dictionary(
+      transform(samples, [](const BufferSlice &sample) { return sample.as_slice(); }));
+  LOG(INFO) << "Trained compression dictionary of size " << dictionary.size() << " on " << samples.size()
+            << " samples of total size " << total_size << " in " << Time::now() - begin_time;
+  if (dictionary.empty()) {
+    return Status::OK();
+  }
+  return add_blob_dictionary(db, now, dictionary);
+}
+
 }  // namespace
 
 std::shared_ptr<FileDbInterface> TdDb::get_file_db_shared() {
@@ -274,6 +366,34 @@ void TdDb::flush_all() {
   binlog_->force_flush();
 }
 
+void TdDb::set_startup_snapshot(string startup_snapshot) {
+  startup_snapshot_ = std::move(startup_snapshot);
+}
+
+void TdDb::save_startup_snapshot() {
+  if (startup_snapshot_.empty()) {
+    return;
+  }
+  if (is_encrypted_) {
+    // the snapshot contains personal data, which must not be written unencrypted
+    startup_snapshot_.clear();
+    return;
+  }
+
+  auto size = startup_snapshot_.size();
+  auto r_token = write_startup_snapshot_file(get_startup_snapshot_path(parameters_), std::move(startup_snapshot_));
+  if (r_token.is_error()) {
+    LOG(ERROR) << "Failed to save startup snapshot: " << r_token.error();
+    return;
+  }
+  LOG(INFO) << "Saved startup snapshot of size " << size;
+  binlog_pmc_->set("startup_snapshot", r_token.ok());
+}
+
+bool TdDb::is_encrypted() const {
+  return is_encrypted_;
+}
+
 void TdDb::close(int32 scheduler_id, bool destroy_flag, Promise<Unit> on_finished) {
   Scheduler::instance()->run_on_scheduler(scheduler_id,
                                           [this, destroy_flag, on_finished = std::move(on_finished)](Unit) mutable {
@@ -333,6 +453,12 @@ void TdDb::do_close(bool destroy_flag, Promise<Unit> on_finished) {
     story_db_async_->close(mpas.get_promise());
   }
 
+  if (destroy_flag) {
+    unlink(get_startup_snapshot_path(parameters_)).ignore();
+  } else {
+    save_startup_snapshot();
+  }
+
   // binlog_pmc is dependent on binlog_ and anyway it doesn't support close_and_destroy
   CHECK(binlog_pmc_.unique());
   binlog_pmc_.reset();
@@ -425,6 +551,11 @@ Status TdDb::init_sqlite(const Parameters &parameters, const DbKey &key, const D
     TRY_STATUS(drop_file_db(db, user_version));
   }
 
+  // init blob compression dictionaries
+  if (parameters.use_chat_info_database_) {
+    TRY_STATUS(init_blob_dictionary(db, use_message_database, binlog_pmc));
+  }
+
   // Update 'PRAGMA user_version'
   auto db_version = current_db_version();
   if (db_version != user_version) {
@@ -459,7 +590,9 @@ Status TdDb::init_sqlite(const Parameters &parameters, const DbKey &key, const D
 
   file_db_ = create_file_db(sql_connection_);
 
-  common_kv_safe_ = std::make_shared<SqliteKeyValueSafe>("common", sql_connection_);
+  // values of users, basic groups, supergroups and their full info are compressed
+  common_kv_safe_ = std::make_shared<SqliteKeyValueSafe>(
+      "common", sql_connection_, vector<string>{"us", "usf", "gr", "grf", "ch", "chf"});
   common_kv_async_ = create_sqlite_key_value_async(common_kv_safe_);
 
   if (was_dialog_db_created_) {
@@ -514,6 +647,7 @@ void TdDb::open_impl(Parameters parameters, Promise<OpenedDatabase> &&promise) {
   config_pmc->external_init_begin(static_cast<int32>(LogEvent::HandlerType::ConfigPmcMagic));
 
   bool encrypt_binlog = !parameters.encryption_key_.is_empty();
+  auto start_time = Time::now();
   VLOG(td_init) << "Start binlog loading";
   TRY_STATUS_PROMISE(promise, init_binlog(*binlog, get_binlog_path(parameters), *binlog_pmc, *config_pmc, result,
                                           std::move(parameters.encryption_key_)));
@@ -524,6 +658,9 @@ void TdDb::open_impl(Parameters parameters, Promise<OpenedDatabase> &&promise) {
   config_pmc->external_init_finish(binlog);
   VLOG(td_init) << "Finish initialization of config PMC";
 
+  result.startup_snapshot = load_startup_snapshot(parameters, encrypt_binlog, *binlog_pmc);
+  auto binlog_time = Time::now() - start_time;
+
   if (parameters.use_file_database_ && binlog_pmc->get("auth").empty()) {
     LOG(INFO) << "Destroy SQLite database, because wasn't authorized yet";
     SqliteDb::destroy(get_sqlite_path(parameters)).ignore();
@@ -551,6 +688,7 @@ void TdDb::open_impl(Parameters parameters, Promise<OpenedDatabase> &&promise) {
     }
   }
   VLOG(td_init) << "Start to init database";
+  auto sqlite_start_time = Time::now();
   auto db = make_unique<TdDb>();
   auto init_sqlite_status = db->init_sqlite(parameters, new_sqlite_key, old_sqlite_key, *binlog_pmc);
   VLOG(td_init) << "Finish to init database";
@@ -569,6 +707,7 @@ void TdDb::open_impl(Parameters parameters, Promise<OpenedDatabase> &&promise) {
     binlog_pmc->erase("sqlite_key");
     binlog_pmc->force_sync(Auto(), "TdDb::open_impl 2");
   }
+  auto sqlite_time = Time::now() - sqlite_start_time;
 
   VLOG(td_init) << "Create concurrent_binlog_pmc";
   auto concurrent_binlog_pmc = std::make_shared<BinlogKeyValue<ConcurrentBinlog>>();
@@ -594,9 +733,11 @@ void TdDb::open_impl(Parameters parameters, Promise<OpenedDatabase> &&promise) {
   concurrent_config_pmc->external_init_finish(concurrent_binlog);
 
   LOG(INFO) << "Successfully inited database in directory " << parameters.database_directory_ << " and files directory "
-            << parameters.files_directory_;
+            << parameters.files_directory_ << " in " << format::as_time(Time::now() - start_time)
+            << tag("binlog_time", format::as_time(binlog_time)) << tag("sqlite_time", format::as_time(sqlite_time));
 
   db->parameters_ = std::move(parameters);
+  db->is_encrypted_ = encrypt_binlog;
   db->binlog_pmc_ = std::move(concurrent_binlog_pmc);
   db->config_pmc_ = std::move(concurrent_config_pmc);
   db->binlog_ = std::move(concurrent_binlog);
@@ -663,10 +804,12 @@ Status TdDb::check_parameters(Parameters &parameters) {
 }
 
 void TdDb::change_key(DbKey key, Promise<> promise) {
+  is_encrypted_ = !key.is_empty();
   get_binlog()->change_key(std::move(key), std::move(promise));
 }
 
 Status TdDb::destroy(const Parameters &parameters) {
+  unlink(get_startup_snapshot_path(parameters)).ignore();
   SqliteDb::destroy(get_sqlite_path(parameters)).ignore();
   Binlog::destroy(get_binlog_path(parameters)).ignore();
   return Status::OK();
@@ -80,6 +80,8 @@ class TdDb {
     vector<BinlogEvent> to_story_manager;
 
     int64 since_last_open = 0;
+
+    string startup_snapshot;  // serialized StartupSnapshot or an empty string
   };
   static void open(int32 scheduler_id, Parameters parameters, Promise<OpenedDatabase> &&promise);
 
@@ -134,6 +136,9 @@ class TdDb {
 
   void flush_all();
 
+  // the snapshot will be saved on close and can be used only during the next open
+  void set_startup_snapshot(string startup_snapshot);
+
   void close(int32 scheduler_id, bool destroy_flag, Promise<Unit> on_finished);
 
   MessageDbSyncInterface *get_message_db_sync();
@@ -150,6 +155,8 @@ class TdDb {
 
   void change_key(DbKey key, Promise<> promise);
 
+  bool is_encrypted() const;
+
   void with_db_path(const std::function<void(CSlice)> &callback);
 
   Result<string> get_stats();
@@ -182,6 +189,9 @@ class TdDb {
   std::shared_ptr<BinlogKeyValue<ConcurrentBinlog>> config_pmc_;
   std::shared_ptr<ConcurrentBinlog> binlog_;
 
+  bool is_encrypted_ = false;
+  string startup_snapshot_;
+
   static void open_impl(Parameters parameters, Promise<OpenedDatabase> &&promise);
 
   static Status check_parameters(Parameters &parameters);
@@ -190,6 +200,8 @@ class TdDb {
                      BinlogKeyValue<Binlog> &binlog_pmc);
 
   void do_close(bool destroy_flag, Promise<Unit> on_finished);
+
+  void save_startup_snapshot();
 };
 
 }  // namespace td
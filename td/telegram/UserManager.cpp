@@ -3759,6 +3759,26 @@ void UserManager::on_load_user_from_database(UserId user_id, string value, bool
   set_promises(promises);
 }
 
+vector<std::pair<UserId, string>> UserManager::get_startup_snapshot_users(const vector<UserId> &user_ids) const {
+  vector<std::pair<UserId, string>> result;
+  for (auto user_id : user_ids) {
+    const User *u = get_user(user_id);
+    // only users, which are saved to the database, can be loaded from the snapshot instead of the database
+    if (u != nullptr && u->is_saved && u->is_status_saved && u->log_event_id == 0) {
+      result.emplace_back(user_id, get_user_database_value(u));
+    }
+  }
+  return result;
+}
+
+void UserManager::on_load_startup_snapshot_users(vector<std::pair<UserId, string>> &&users) {
+  for (auto &user : users) {
+    if (user.first.is_valid()) {
+      on_load_user_from_database(user.first, std::move(user.second), true);
+    }
+  }
+}
+
 bool UserManager::have_user_force(UserId user_id, const char *source) {
   return get_user_force(user_id, source) != nullptr;
 }
@@ -6707,6 +6727,7 @@ UserManager::UserFull *UserManager::add_user_full(UserId user_id) {
   auto &user_full_ptr = users_full_[user_id];
   if (user_full_ptr == nullptr) {
     user_full_ptr = make_unique<UserFull>();
+    user_full_ptr->last_used_time = Time::now();
     user_full_contact_require_premium_.erase(user_id);
   }
   return user_full_ptr.get();
@@ -6719,6 +6740,7 @@ UserManager::UserFull *UserManager::get_user_full_force(UserId user_id, const ch
 
   UserFull *user_full = get_user_full(user_id);
   if (user_full != nullptr) {
+    user_full->last_used_time = Time::now();
     return user_full;
   }
   if (!G()->use_chat_info_database()) {
@@ -6727,6 +6749,7 @@ UserManager::UserFull *UserManager::get_user_full_force(UserId user_id, const ch
   if (!unavailable_user_fulls_.insert(user_id).second) {
     return nullptr;
   }
+  unloaded_user_fulls_.on_load(user_id);
 
   LOG(INFO) << "Trying to load full " << user_id << " from database from " << source;
   on_load_user_full_from_database(user_id,
@@ -6734,6 +6757,67 @@ UserManager::UserFull *UserManager::get_user_full_force(UserId user_id, const ch
   return get_user_full(user_id);
 }
 
+void UserManager::try_unload_user_fulls() {
+  if (is_unload_user_fulls_scheduled_ || !G()->use_chat_info_database()) {
+    return;
+  }
+  auto max_size = G()->get_option_integer("max_cached_full_info_size");
+  if (max_size <= 0 || unloaded_user_fulls_.get_total_size() <= static_cast<size_t>(max_size + max_size / 8)) {
+    return;
+  }
+
+  // objects must not be unloaded while pointers to them can be used
+  is_unload_user_fulls_scheduled_ = true;
+  send_closure_later(actor_id(this), &UserManager::unload_user_fulls);
+}
+
+void UserManager::unload_user_fulls() {
+  is_unload_user_fulls_scheduled_ = false;
+  if (G()->close_flag()) {
+    return;
+  }
+  auto max_size = G()->get_option_integer("max_cached_full_info_size");
+  if (max_size <= 0) {
+    return;
+  }
+
+  auto user_ids = get_least_recently_used_keys(
+      users_full_, unloaded_user_fulls_.get_total_size(), static_cast<size_t>(max_size),
+      [this](UserId user_id, const UserFull *user_full) { return can_unload_user_full(user_full, user_id); });
+  for (auto user_id : user_ids) {
+    unload_user_full(user_id);
+  }
+  LOG(INFO) << "Unloaded " << user_ids.size() << " full users; totally unloaded " << get_unloaded_full_info_count()
+            << " and reloaded " << get_reloaded_full_info_count() << " full users";
+}
+
+int64 UserManager::get_unloaded_full_info_count() const {
+  return unloaded_user_fulls_.get_unload_count();
+}
+
+int64 UserManager::get_reloaded_full_info_count() const {
+  return unloaded_user_fulls_.get_reload_count();
+}
+
+bool UserManager::can_unload_user_full(const UserFull *user_full, UserId user_id) const {
+  return !user_full->is_being_updated && !user_full->is_changed && !user_full->need_send_update &&
+         !user_full->need_save_to_database && user_id != get_my_id();
+}
+
+void UserManager::unload_user_full(UserId user_id) {
+  auto user_full = get_user_full(user_id);
+  CHECK(user_full != nullptr);
+  LOG(DEBUG) << "Unload full " << user_id;
+  if (user_full->file_source_id.is_valid()) {
+    // keep the file source to reuse it after the full user is loaded again
+    td_->file_manager_->change_files_source(user_full->file_source_id, user_full->registered_file_ids, {});
+    user_full_file_source_ids_.set(user_id, user_full->file_source_id);
+  }
+  unloaded_user_fulls_.on_unload(user_id, user_full->estimated_size);
+  users_full_.erase(user_id);
+  unavailable_user_fulls_.erase(user_id);
+}
+
 void UserManager::load_user_full(UserId user_id, bool force, Promise<Unit> &&promise, const char *source) {
   auto u = get_user(user_id);
   if (u == nullptr) {
@@ -7012,15 +7096,17 @@ FileSourceId UserManager::get_user_full_file_source_id(UserId user_id) {
   return source_id;
 }
 
-void UserManager::save_user_full(const UserFull *user_full, UserId user_id) {
+void UserManager::save_user_full(UserFull *user_full, UserId user_id) {
   if (!G()->use_chat_info_database()) {
     return;
   }
 
   LOG(INFO) << "Trying to save to database full " << user_id;
   CHECK(user_full != nullptr);
-  G()->td_db()->get_sqlite_pmc()->set(get_user_full_database_key(user_id), get_user_full_database_value(user_full),
-                                      Auto());
+  auto value = get_user_full_database_value(user_full);
+  unloaded_user_fulls_.on_size_changed(user_full->estimated_size, sizeof(UserFull) + value.size());
+  G()->td_db()->get_sqlite_pmc()->set(get_user_full_database_key(user_id), std::move(value), Auto());
+  try_unload_user_fulls();
 }
 
 string UserManager::get_user_full_database_key(UserId user_id) {
@@ -7080,6 +7166,7 @@ void UserManager::on_load_user_full_from_database(UserId user_id, string value)
 
   td_->group_call_manager_->on_update_dialog_about(DialogId(user_id), user_full->about, false);
 
+  unloaded_user_fulls_.on_size_changed(user_full->estimated_size, sizeof(UserFull) + value.size());
   user_full->is_update_user_full_sent = true;
   update_user_full(user_full, user_id, "on_load_user_full_from_database", true);
 
@@ -7761,6 +7848,7 @@ void UserManager::update_user_full(UserFull *user_full, UserId user_id, const ch
   user_full->is_changed = false;
   if (user_full->need_send_update || user_full->need_save_to_database) {
     LOG(INFO) << "Update full " << user_id << " from " << source;
+    user_full->last_used_time = Time::now();
   }
   if (user_full->need_send_update) {
     {
@@ -21,6 +21,7 @@
 #include "td/telegram/files/FileId.h"
 #include "td/telegram/files/FileSourceId.h"
 #include "td/telegram/FolderId.h"
+#include "td/telegram/LeastRecentlyUsed.h"
 #include "td/telegram/MessageFullId.h"
 #include "td/telegram/Photo.h"
 #include "td/telegram/PremiumGiftOption.h"
@@ -113,6 +114,10 @@ class UserManager final : public Actor {
 
   void on_binlog_secret_chat_event(BinlogEvent &&event);
 
+  vector<std::pair<UserId, string>> get_startup_snapshot_users(const vector<UserId> &user_ids) const;
+
+  void on_load_startup_snapshot_users(vector<std::pair<UserId, string>> &&users);
+
   void on_update_user_name(UserId user_id, string &&first_name, string &&last_name, Usernames &&usernames);
 
   void on_update_user_phone_number(UserId user_id, string &&phone_number);
@@ -465,6 +470,10 @@ class UserManager final : public Actor {
 
   td_api::object_ptr<td_api::secretChat> get_secret_chat_object(SecretChatId secret_chat_id);
 
+  int64 get_unloaded_full_info_count() const;
+
+  int64 get_reloaded_full_info_count() const;
+
   void get_current_state(vector<td_api::object_ptr<td_api::Update>> &updates) const;
 
  private:
@@ -614,6 +623,8 @@ class UserManager final : public Actor {
     bool is_update_user_full_sent = false;
 
     double expires_at = 0.0;
+    double last_used_time = 0.0;
+    size_t estimated_size = 0;  // the size of the object in memory, estimated by the size of its database value
 
     bool is_expired() const {
       return expires_at < Time::now();
@@ -920,10 +931,18 @@ class UserManager final : public Actor {
 
   UserFull *get_user_full_force(UserId user_id, const char *source);
 
+  void try_unload_user_fulls();
+
+  void unload_user_fulls();
+
+  bool can_unload_user_full(const UserFull *user_full, UserId user_id) const;
+
+  void unload_user_full(UserId user_id);
+
   void send_get_user_full_query(UserId user_id, telegram_api::object_ptr<telegram_api::InputUser> &&input_user,
                                 Promise<Unit> &&promise, const char *source);
 
-  static void save_user_full(const UserFull *user_full, UserId user_id);
+  void save_user_full(UserFull *user_full, UserId user_id);
 
   static string get_user_full_database_key(UserId user_id);
 
@@ -1030,13 +1049,15 @@ class UserManager final : public Actor {
   FlatHashMap<UserId, vector<Promise<Unit>>, UserIdHash> load_user_from_database_queries_;
   FlatHashSet<UserId, UserIdHash> loaded_from_database_users_;
   FlatHashSet<UserId, UserIdHash> unavailable_user_fulls_;
+  UnloadedObjects<UserId, UserIdHash> unloaded_user_fulls_;
+  bool is_unload_user_fulls_scheduled_ = false;
 
   FlatHashMap<SecretChatId, vector<Promise<Unit>>, SecretChatIdHash> load_secret_chat_from_database_queries_;
   FlatHashSet<SecretChatId, SecretChatIdHash> loaded_from_database_secret_chats_;
 
-  QueryMerger get_user_queries_{"GetUserMerger", 3, 50};
+  QueryMerger get_user_queries_{"GetUserMerger", 3, 100, 0.01};
 
-  QueryMerger get_is_premium_required_to_contact_queries_{"GetIsPremiumRequiredToContactMerger", 3, 100};
+  QueryMerger get_is_premium_required_to_contact_queries_{"GetIsPremiumRequiredToContactMerger", 3, 100, 0.05};
 
   QueryCombiner get_user_full_queries_{"GetUserFullCombiner", 2.0};
   class UploadProfilePhotoCallback;
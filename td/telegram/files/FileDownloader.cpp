@@ -9,12 +9,15 @@
 #include "td/telegram/FileReferenceManager.h"
 #include "td/telegram/files/FileLoaderUtils.h"
 #include "td/telegram/files/FileType.h"
+#include "td/telegram/files/PartsManager.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/SecureStorage.h"
 #include "td/telegram/telegram_api.h"
 #include "td/telegram/UniqueId.h"
 
+#include "td/actor/actor.h"
+
 #include "td/utils/as.h"
 #include "td/utils/base64.h"
 #include "td/utils/buffer.h"
@@ -25,6 +28,7 @@
 #include "td/utils/misc.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/Stat.h"
+#include "td/utils/Promise.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/UInt.h"
@@ -35,7 +39,8 @@ namespace td {
 
 FileDownloader::FileDownloader(const FullRemoteFileLocation &remote, const LocalFileLocation &local, int64 size,
                                string name, const FileEncryptionKey &encryption_key, bool is_small,
-                               bool need_search_file, int64 offset, int64 limit, unique_ptr<Callback> callback)
+                               bool need_search_file, int64 offset, int64 limit, size_t preferred_part_size,
+                               unique_ptr<Callback> callback)
     : remote_(remote)
     , local_(local)
     , size_(size)
@@ -45,7 +50,8 @@ FileDownloader::FileDownloader(const FullRemoteFileLocation &remote, const Local
     , is_small_(is_small)
     , need_search_file_(need_search_file)
     , offset_(offset)
-    , limit_(limit) {
+    , limit_(limit)
+    , preferred_part_size_(preferred_part_size) {
   if (encryption_key.is_secret()) {
     set_ordered_flag(true);
   }
@@ -105,6 +111,13 @@ Result<FileLoader::FileInfo> FileDownloader::init() {
     }
   }
 
+  if (part_size == 0 && preferred_part_size_ != 0 && size_ > 0 && !remote_.is_web() &&
+      (size_ + static_cast<int64>(preferred_part_size_) - 1) / static_cast<int64>(preferred_part_size_) <=
+          PartsManager::MAX_PART_COUNT) {
+    part_size = narrow_cast<int32>(preferred_part_size_);
+    LOG(INFO) << "Use preferred part size " << part_size;
+  }
+
   FileInfo res;
   res.size = size_;
   res.is_size_final = true;
@@ -425,53 +438,61 @@ Result<FileLoader::CheckInfo> FileDownloader::check_loop(int64 checked_prefix_si
   SCOPE_EXIT {
     try_release_fd();
   };
+  if (hash_check_status_.is_error()) {
+    return hash_check_status_.clone();
+  }
   CheckInfo info;
-  while (checked_prefix_size < ready_prefix_size) {
-    //LOG(ERROR) << "NEED TO CHECK: " << checked_prefix_size << "->" << ready_prefix_size - checked_prefix_size;
-    HashInfo search_info;
-    search_info.offset = checked_prefix_size;
-    auto it = hash_info_.upper_bound(search_info);
-    if (it != hash_info_.begin()) {
-      --it;
+  while (true) {
+    auto it = checked_hash_ranges_.find(checked_prefix_size);
+    if (it == checked_hash_ranges_.end()) {
+      break;
     }
-    if (it != hash_info_.end() && it->offset <= checked_prefix_size &&
-        it->offset + narrow_cast<int64>(it->size) > checked_prefix_size) {
-      int64 begin_offset = it->offset;
-      int64 end_offset = it->offset + narrow_cast<int64>(it->size);
-      if (ready_prefix_size < end_offset) {
-        if (!is_ready) {
-          break;
-        }
-        end_offset = ready_prefix_size;
+    checked_prefix_size = it->second;
+    checked_hash_ranges_.erase(it);
+    info.changed = true;
+  }
+  hash_check_offset_ = max(hash_check_offset_, checked_prefix_size);
+
+  while (hash_check_offset_ < ready_prefix_size && pending_hash_check_count_ < MAX_PENDING_HASH_CHECKS) {
+    //LOG(ERROR) << "NEED TO CHECK: " << hash_check_offset_ << "->" << ready_prefix_size - hash_check_offset_;
+    vector<FilePartHash> part_hashes;
+    size_t total_size = 0;
+    int64 end_offset = hash_check_offset_;
+    bool has_hash = false;
+    while (end_offset < ready_prefix_size && total_size < MAX_HASH_CHECK_BATCH_SIZE) {
+      HashInfo search_info;
+      search_info.offset = end_offset;
+      auto it = hash_info_.upper_bound(search_info);
+      if (it != hash_info_.begin()) {
+        --it;
       }
-      auto size = narrow_cast<size_t>(end_offset - begin_offset);
-      auto slice = BufferSlice(size);
-      TRY_STATUS(acquire_fd());
-      TRY_RESULT(read_size, fd_.pread(slice.as_mutable_slice(), begin_offset));
-      if (size != read_size) {
-        return Status::Error("Failed to read file to check hash");
+      has_hash = it != hash_info_.end() && it->offset <= end_offset &&
+                 it->offset + narrow_cast<int64>(it->size) > end_offset;
+      if (!has_hash) {
+        break;
       }
-      string hash(32, ' ');
-      sha256(slice.as_slice(), hash);
-
-      if (hash != it->hash) {
-        if (only_check_) {
-          return Status::Error("FILE_DOWNLOAD_RESTART");
+      int64 range_end_offset = it->offset + narrow_cast<int64>(it->size);
+      if (ready_prefix_size < range_end_offset) {
+        if (!is_ready) {
+          break;
         }
-        return Status::Error("Hash mismatch");
+        range_end_offset = ready_prefix_size;
       }
-
-      checked_prefix_size = end_offset;
-      info.changed = true;
+      auto part_size = narrow_cast<size_t>(range_end_offset - it->offset);
+      total_size += part_size;
+      part_hashes.emplace_back(it->offset, part_size, it->hash);
+      end_offset = range_end_offset;
+    }
+    if (!part_hashes.empty()) {
+      start_hash_check(std::move(part_hashes), end_offset);
       continue;
     }
-    if (!has_hash_query_) {
+    if (!has_hash && !has_hash_query_) {
       has_hash_query_ = true;
-      auto query = telegram_api::upload_getFileHashes(remote_.as_input_file_location(), checked_prefix_size);
+      auto query = telegram_api::upload_getFileHashes(remote_.as_input_file_location(), hash_check_offset_);
       auto net_query_type = is_small_ ? NetQuery::Type::DownloadSmall : NetQuery::Type::Download;
       auto net_query = G()->net_query_creator().create(query, {}, remote_.get_dc_id(), net_query_type);
       info.queries.push_back(std::move(net_query));
-      break;
     }
     // Should fail?
     break;
@@ -481,6 +502,40 @@ Result<FileLoader::CheckInfo> FileDownloader::check_loop(int64 checked_prefix_si
   return std::move(info);
 }
 
+void FileDownloader::start_hash_check(vector<FilePartHash> part_hashes, int64 end_offset) {
+  // hashes are checked on another scheduler, so new parts can be downloaded and saved in the meantime
+  auto begin_offset = hash_check_offset_;
+  CHECK(begin_offset < end_offset);
+  CHECK(!path_.empty());
+  hash_check_offset_ = end_offset;
+  pending_hash_check_count_++;
+  auto promise =
+      PromiseCreator::lambda([actor_id = actor_id(this), begin_offset, end_offset](Result<bool> r_is_valid) {
+        send_closure(actor_id, &FileDownloader::on_hash_check, begin_offset, end_offset, std::move(r_is_valid));
+      });
+  check_file_part_hashes(G()->get_gc_scheduler_id(), path_, std::move(part_hashes), std::move(promise));
+}
+
+void FileDownloader::on_hash_check(int64 begin_offset, int64 end_offset, Result<bool> r_is_valid) {
+  CHECK(pending_hash_check_count_ > 0);
+  pending_hash_check_count_--;
+  if (r_is_valid.is_error()) {
+    LOG(INFO) << "Failed to check hash of bytes " << begin_offset << " ... " << end_offset << ": "
+              << r_is_valid.error();
+    if (hash_check_status_.is_ok()) {
+      hash_check_status_ = r_is_valid.move_as_error();
+    }
+  } else if (!r_is_valid.ok()) {
+    LOG(INFO) << "Hash mismatch for bytes " << begin_offset << " ... " << end_offset;
+    if (hash_check_status_.is_ok()) {
+      hash_check_status_ = Status::Error(only_check_ ? Slice("FILE_DOWNLOAD_RESTART") : Slice("Hash mismatch"));
+    }
+  } else {
+    checked_hash_ranges_.emplace(begin_offset, end_offset);
+  }
+  yield();
+}
+
 void FileDownloader::add_hash_info(const std::vector<telegram_api::object_ptr<telegram_api::fileHash>> &hashes) {
   for (auto &hash : hashes) {
     //LOG(ERROR) << "ADD HASH " << hash->offset_ << "->" << hash->limit_;
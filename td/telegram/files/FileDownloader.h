@@ -8,6 +8,7 @@
 
 #include "td/telegram/files/FileEncryptionKey.h"
 #include "td/telegram/files/FileLoader.h"
+#include "td/telegram/files/FileLoaderUtils.h"
 #include "td/telegram/files/FileLocation.h"
 #include "td/telegram/net/DcId.h"
 #include "td/telegram/net/NetQuery.h"
@@ -34,7 +35,7 @@ class FileDownloader final : public FileLoader {
 
   FileDownloader(const FullRemoteFileLocation &remote, const LocalFileLocation &local, int64 size, string name,
                  const FileEncryptionKey &encryption_key, bool is_small, bool need_search_file, int64 offset,
-                 int64 limit, unique_ptr<Callback> callback);
+                 int64 limit, size_t preferred_part_size, unique_ptr<Callback> callback);
 
   // Should just implement all parent pure virtual methods.
   // Must not call any of them...
@@ -58,6 +59,7 @@ class FileDownloader final : public FileLoader {
   bool need_search_file_{false};
   int64 offset_;
   int64 limit_;
+  size_t preferred_part_size_;
 
   bool use_cdn_ = false;
   DcId cdn_dc_id_;
@@ -80,6 +82,13 @@ class FileDownloader final : public FileLoader {
   std::set<HashInfo> hash_info_;
   bool has_hash_query_ = false;
 
+  static constexpr size_t MAX_HASH_CHECK_BATCH_SIZE = 1 << 22;
+  static constexpr int32 MAX_PENDING_HASH_CHECKS = 4;
+  int64 hash_check_offset_ = 0;  // all hashes before the offset are checked or being checked
+  int32 pending_hash_check_count_ = 0;
+  std::map<int64, int64> checked_hash_ranges_;
+  Status hash_check_status_;
+
   Result<FileInfo> init() final TD_WARN_UNUSED_RESULT;
   Status on_ok(int64 size) final TD_WARN_UNUSED_RESULT;
   void on_error(Status status) final;
@@ -92,6 +101,8 @@ class FileDownloader final : public FileLoader {
   Status process_check_query(NetQueryPtr net_query) final;
   Result<CheckInfo> check_loop(int64 checked_prefix_size, int64 ready_prefix_size, bool is_ready) final;
   void add_hash_info(const std::vector<telegram_api::object_ptr<telegram_api::fileHash>> &hashes);
+  void start_hash_check(vector<FilePartHash> part_hashes, int64 end_offset);
+  void on_hash_check(int64 begin_offset, int64 end_offset, Result<bool> r_is_valid);
 
   bool keep_fd_ = false;
   void keep_fd_flag(bool keep_fd) final;
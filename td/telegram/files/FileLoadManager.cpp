@@ -6,12 +6,14 @@
 //
 #include "td/telegram/files/FileLoadManager.h"
 
+#include "td/telegram/files/FileLoaderUtils.h"
 #include "td/telegram/Global.h"
 #include "td/telegram/net/DcId.h"
 
 #include "td/utils/common.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/format.h"
+#include "td/utils/logging.h"
 #include "td/utils/port/path.h"
 #include "td/utils/SliceBuilder.h"
 
@@ -34,9 +36,13 @@ void FileLoadManager::start_up() {
 ActorOwn<ResourceManager> &FileLoadManager::get_download_resource_manager(bool is_small, DcId dc_id) {
   auto &actor = is_small ? download_small_resource_manager_map_[dc_id] : download_resource_manager_map_[dc_id];
   if (actor.empty()) {
+    unique_ptr<ResourceManager::Callback> callback;
+    if (!is_small) {
+      callback = make_unique<ResourceManagerCallback>(actor_id(this), dc_id);
+    }
     actor = create_actor<ResourceManager>(
         PSLICE() << "DownloadResourceManager " << tag("is_small", is_small) << tag("dc_id", dc_id),
-        max_download_resource_limit_, ResourceManager::Mode::Baseline);
+        max_download_resource_limit_, ResourceManager::Mode::Baseline, std::move(callback));
   }
   return actor;
 }
@@ -52,17 +58,170 @@ void FileLoadManager::download(QueryId query_id, const FullRemoteFileLocation &r
   Node *node = nodes_container_.get(node_id);
   CHECK(node);
   node->query_id_ = query_id;
+  bool is_inserted = query_id_to_node_id_.emplace(query_id, node_id).second;
+  CHECK(is_inserted);
+
+  DownloadQuery query{remote_location, local,  size,  std::move(name), encryption_key,
+                      search_file,     offset, limit, priority};
+  if (try_download_shared_file(node_id, query)) {
+    return;
+  }
+  start_download(node_id, query);
+}
+
+void FileLoadManager::start_download(NodeId node_id, const DownloadQuery &query) {
+  Node *node = nodes_container_.get(node_id);
+  CHECK(node);
   auto callback = make_unique<FileDownloaderCallback>(actor_shared(this, node_id));
-  bool is_small = size < 20 * 1024;
-  node->loader_ =
-      create_actor<FileDownloader>("Downloader", remote_location, local, size, std::move(name), encryption_key,
-                                   is_small, search_file, offset, limit, std::move(callback));
-  DcId dc_id = remote_location.is_web() ? G()->get_webfile_dc_id() : remote_location.get_dc_id();
+  bool is_small = query.size_ < 20 * 1024;
+  DcId dc_id = query.remote_location_.is_web() ? G()->get_webfile_dc_id() : query.remote_location_.get_dc_id();
   auto &resource_manager = get_download_resource_manager(is_small, dc_id);
+  size_t preferred_part_size = 0;
+  if (!is_small) {
+    auto it = download_preferred_part_sizes_.find(dc_id);
+    if (it != download_preferred_part_sizes_.end()) {
+      preferred_part_size = it->second;
+    }
+  }
+  node->loader_ = create_actor<FileDownloader>("Downloader", query.remote_location_, query.local_, query.size_,
+                                               query.name_, query.encryption_key_, is_small, query.search_file_,
+                                               query.offset_, query.limit_, preferred_part_size, std::move(callback));
   send_closure(resource_manager, &ResourceManager::register_worker,
-               ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), priority);
-  bool is_inserted = query_id_to_node_id_.emplace(query_id, node_id).second;
-  CHECK(is_inserted);
+               ActorShared<FileLoaderActor>(node->loader_.get(), static_cast<uint64>(-1)), query.priority_);
+}
+
+void FileLoadManager::on_preferred_part_size_changed(DcId dc_id, size_t preferred_part_size) {
+  download_preferred_part_sizes_[dc_id] = preferred_part_size;
+}
+
+std::shared_ptr<SharedFileCache> FileLoadManager::get_shared_file_cache() {
+  auto directory = G()->get_option_string("shared_file_cache_directory");
+  if (directory != shared_file_cache_directory_) {
+    shared_file_cache_directory_ = std::move(directory);
+    if (shared_file_cache_directory_.empty()) {
+      shared_file_cache_ = nullptr;
+    } else {
+      shared_file_cache_ = SharedFileCache::get(shared_file_cache_directory_);
+    }
+  }
+  if (shared_file_cache_ != nullptr) {
+    shared_file_cache_->set_max_size(G()->get_option_integer("shared_file_cache_max_size"));
+  }
+  return shared_file_cache_;
+}
+
+ActorId<SharedFileCacheWorker> FileLoadManager::get_shared_file_cache_worker() {
+  if (shared_file_cache_worker_.empty()) {
+    shared_file_cache_worker_ =
+        create_actor_on_scheduler<SharedFileCacheWorker>("SharedFileCacheWorker", G()->get_gc_scheduler_id());
+  }
+  return shared_file_cache_worker_.get();
+}
+
+bool FileLoadManager::try_download_shared_file(NodeId node_id, DownloadQuery &query) {
+  if (!SharedFileCache::is_shareable_download(query.local_, query.size_, query.encryption_key_, query.offset_,
+                                              query.limit_)) {
+    return false;
+  }
+  auto shared_file_cache = get_shared_file_cache();
+  if (shared_file_cache == nullptr) {
+    return false;
+  }
+
+  Node *node = nodes_container_.get(node_id);
+  CHECK(node);
+  auto key = SharedFileCache::get_file_key(query.remote_location_);
+  string cached_path;
+  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), node_id](Result<string> r_cached_path) {
+    send_closure(actor_id, &FileLoadManager::on_shared_file_downloaded, node_id, std::move(r_cached_path));
+  });
+  switch (shared_file_cache->lookup(key, query.size_, cached_path, promise)) {
+    case SharedFileCache::LookupResult::Found:
+      node->waiting_download_query_ = make_unique<DownloadQuery>(std::move(query));
+      import_shared_file(node_id, std::move(cached_path));
+      return true;
+    case SharedFileCache::LookupResult::Wait:
+      node->waiting_download_query_ = make_unique<DownloadQuery>(std::move(query));
+      node->is_waiting_shared_download_ = true;
+      return true;
+    case SharedFileCache::LookupResult::Download:
+      node->shared_file_cache_ = std::move(shared_file_cache);
+      node->shared_file_key_ = std::move(key);
+      return false;
+    default:
+      UNREACHABLE();
+      return false;
+  }
+}
+
+void FileLoadManager::on_shared_file_downloaded(NodeId node_id, Result<string> r_cached_path) {
+  auto node = nodes_container_.get(node_id);
+  // the promise is lost if the node didn't wait for the download
+  if (node == nullptr || !node->is_waiting_shared_download_ || stop_flag_) {
+    return;
+  }
+  node->is_waiting_shared_download_ = false;
+  CHECK(node->waiting_download_query_ != nullptr);
+  if (r_cached_path.is_ok()) {
+    return import_shared_file(node_id, r_cached_path.move_as_ok());
+  }
+
+  // the download by another client has failed or has been canceled; the file can still be downloaded by the client
+  // or by another waiting client
+  auto query = std::move(node->waiting_download_query_);
+  if (try_download_shared_file(node_id, *query)) {
+    return;
+  }
+  start_download(node_id, *query);
+}
+
+void FileLoadManager::import_shared_file(NodeId node_id, string cached_path) {
+  Node *node = nodes_container_.get(node_id);
+  CHECK(node);
+  CHECK(node->waiting_download_query_ != nullptr);
+  auto r_temp_file = open_temp_file(node->waiting_download_query_->remote_location_.file_type_);
+  if (r_temp_file.is_error()) {
+    LOG(WARNING) << "Failed to create temporary file for cached file " << cached_path << ": " << r_temp_file.error();
+    auto query = std::move(node->waiting_download_query_);
+    return start_download(node_id, *query);
+  }
+  auto temp_file = r_temp_file.move_as_ok();
+  temp_file.first.close();
+  auto temp_path = std::move(temp_file.second);
+  // the temporary file must be replaced with the hard link
+  unlink(temp_path).ignore();
+
+  VLOG(file_loader) << "Use cached file " << cached_path << " for " << node->waiting_download_query_->remote_location_;
+  auto promise = PromiseCreator::lambda([actor_id = actor_id(this), node_id, temp_path](Result<Unit> result) {
+    send_closure(actor_id, &FileLoadManager::on_shared_file_imported, node_id, temp_path, std::move(result));
+  });
+  send_closure(get_shared_file_cache_worker(), &SharedFileCacheWorker::import_file, std::move(cached_path), temp_path,
+               std::move(promise));
+}
+
+void FileLoadManager::on_shared_file_imported(NodeId node_id, string temp_path, Result<Unit> result) {
+  auto node = nodes_container_.get(node_id);
+  if (node == nullptr || node->waiting_download_query_ == nullptr || stop_flag_) {
+    unlink(temp_path).ignore();
+    return;
+  }
+  auto query = std::move(node->waiting_download_query_);
+  auto file_type = query->remote_location_.file_type_;
+  Result<string> r_path;
+  if (result.is_ok()) {
+    r_path = create_from_temp(file_type, temp_path, query->name_);
+  } else {
+    r_path = result.move_as_error();
+  }
+  if (r_path.is_error()) {
+    LOG(WARNING) << "Failed to import cached file for " << query->remote_location_ << ": " << r_path.error();
+    unlink(temp_path).ignore();
+    return start_download(node_id, *query);
+  }
+
+  send_closure(callback_, &Callback::on_download_ok, node->query_id_,
+               FullLocalFileLocation(file_type, r_path.move_as_ok(), 0), query->size_, true);
+  close_node(node_id);
 }
 
 void FileLoadManager::upload(QueryId query_id, const LocalFileLocation &local_location,
@@ -200,8 +359,17 @@ void FileLoadManager::update_downloaded_part(QueryId query_id, int64 offset, int
 }
 
 void FileLoadManager::hangup() {
-  nodes_container_.for_each([](auto query_id, auto &node) { node.loader_.reset(); });
+  vector<NodeId> waiting_node_ids;
+  nodes_container_.for_each([&waiting_node_ids](auto node_id, auto &node) {
+    if (node.waiting_download_query_ != nullptr) {
+      waiting_node_ids.push_back(node_id);
+    }
+    node.loader_.reset();
+  });
   stop_flag_ = true;
+  for (auto node_id : waiting_node_ids) {
+    close_node(node_id);
+  }
   loop();
 }
 
@@ -256,6 +424,10 @@ void FileLoadManager::on_ok_download(FullLocalFileLocation local, int64 size, bo
   if (node == nullptr) {
     return;
   }
+  if (node->shared_file_cache_ != nullptr) {
+    send_closure(get_shared_file_cache_worker(), &SharedFileCacheWorker::finish_download,
+                 std::move(node->shared_file_cache_), node->shared_file_key_, local.path_);
+  }
   if (!stop_flag_) {
     send_closure(callback_, &Callback::on_download_ok, node->query_id_, std::move(local), size, is_new);
   }
@@ -321,6 +493,9 @@ void FileLoadManager::loop() {
 void FileLoadManager::close_node(NodeId node_id) {
   auto node = nodes_container_.get(node_id);
   CHECK(node);
+  if (node->shared_file_cache_ != nullptr) {
+    node->shared_file_cache_->finish_download(node->shared_file_key_, Status::Error("Download failed"));
+  }
   query_id_to_node_id_.erase(node->query_id_);
   nodes_container_.erase(node_id);
 }
@@ -15,6 +15,7 @@
 #include "td/telegram/files/FileType.h"
 #include "td/telegram/files/FileUploader.h"
 #include "td/telegram/files/ResourceManager.h"
+#include "td/telegram/files/SharedFileCache.h"
 #include "td/telegram/net/DcId.h"
 
 #include "td/actor/actor.h"
@@ -26,6 +27,7 @@
 #include "td/utils/Status.h"
 
 #include <map>
+#include <memory>
 
 namespace td {
 
@@ -71,15 +73,36 @@ class FileLoadManager final : public Actor {
   void check_partial_local_location(PartialLocalFileLocation partial, Promise<Unit> promise);
 
  private:
+  struct DownloadQuery {
+    FullRemoteFileLocation remote_location_;
+    LocalFileLocation local_;
+    int64 size_;
+    string name_;
+    FileEncryptionKey encryption_key_;
+    bool search_file_;
+    int64 offset_;
+    int64 limit_;
+    int8 priority_;
+  };
+
   struct Node {
     QueryId query_id_;
     ActorOwn<FileLoaderActor> loader_;
     ResourceState resource_state_;
+
+    // the shared file cache and the key of the file in it, if the file is downloaded for the cache by the node
+    std::shared_ptr<SharedFileCache> shared_file_cache_;
+    string shared_file_key_;
+
+    // the query waiting for the file to be downloaded by another client or to be imported from the shared file cache
+    unique_ptr<DownloadQuery> waiting_download_query_;
+    bool is_waiting_shared_download_ = false;
   };
   using NodeId = uint64;
 
   std::map<DcId, ActorOwn<ResourceManager>> download_resource_manager_map_;
   std::map<DcId, ActorOwn<ResourceManager>> download_small_resource_manager_map_;
+  std::map<DcId, size_t> download_preferred_part_sizes_;
   ActorOwn<ResourceManager> upload_resource_manager_;
 
   Container<Node> nodes_container_;
@@ -87,6 +110,9 @@ class FileLoadManager final : public Actor {
   ActorShared<> parent_;
   std::map<QueryId, NodeId> query_id_to_node_id_;
   int64 max_download_resource_limit_ = 1 << 21;
+  string shared_file_cache_directory_;
+  std::shared_ptr<SharedFileCache> shared_file_cache_;
+  ActorOwn<SharedFileCacheWorker> shared_file_cache_worker_;
   bool stop_flag_ = false;
 
   void start_up() final;
@@ -97,6 +123,22 @@ class FileLoadManager final : public Actor {
   void close_node(NodeId node_id);
   ActorOwn<ResourceManager> &get_download_resource_manager(bool is_small, DcId dc_id);
 
+  std::shared_ptr<SharedFileCache> get_shared_file_cache();
+
+  ActorId<SharedFileCacheWorker> get_shared_file_cache_worker();
+
+  bool try_download_shared_file(NodeId node_id, DownloadQuery &query);
+
+  void on_shared_file_downloaded(NodeId node_id, Result<string> r_cached_path);
+
+  void import_shared_file(NodeId node_id, string cached_path);
+
+  void on_shared_file_imported(NodeId node_id, string temp_path, Result<Unit> result);
+
+  void start_download(NodeId node_id, const DownloadQuery &query);
+
+  void on_preferred_part_size_changed(DcId dc_id, size_t preferred_part_size);
+
   void on_start_download();
   void on_partial_download(PartialLocalFileLocation partial_local, int64 ready_size, int64 size);
   void on_partial_upload(PartialRemoteFileLocation partial_remote, int64 ready_size);
@@ -107,6 +149,20 @@ class FileLoadManager final : public Actor {
   void on_error(Status status);
   void on_error_impl(NodeId node_id, Status status);
 
+  class ResourceManagerCallback final : public ResourceManager::Callback {
+   public:
+    ResourceManagerCallback(ActorId<FileLoadManager> actor_id, DcId dc_id) : actor_id_(actor_id), dc_id_(dc_id) {
+    }
+
+   private:
+    ActorId<FileLoadManager> actor_id_;
+    DcId dc_id_;
+
+    void on_preferred_part_size_changed(size_t preferred_part_size) final {
+      send_closure(actor_id_, &FileLoadManager::on_preferred_part_size_changed, dc_id_, preferred_part_size);
+    }
+  };
+
   class FileDownloaderCallback final : public FileDownloader::Callback {
    public:
     explicit FileDownloaderCallback(ActorShared<FileLoadManager> actor_id) : actor_id_(std::move(actor_id)) {
@@ -17,6 +17,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/Time.h"
 
 #include <tuple>
 
@@ -81,9 +82,10 @@ void FileLoader::update_downloaded_part(int64 offset, int64 limit, int64 max_res
     auto end_part_id = begin_part_id + td::min(max_parts, new_end_part_id - begin_part_id);
     VLOG(file_loader) << "Protect parts " << begin_part_id << " ... " << end_part_id - 1;
     for (auto &it : part_map_) {
-      if (!it.second.second.empty() && !(begin_part_id <= it.second.first.id && it.second.first.id < end_part_id)) {
-        VLOG(file_loader) << "Cancel part " << it.second.first.id;
-        it.second.second.reset();  // cancel_query(it.second.second);
+      auto &part_info = it.second;
+      if (!part_info.cancel_signal.empty() && !(begin_part_id <= part_info.part.id && part_info.part.id < end_part_id)) {
+        VLOG(file_loader) << "Cancel part " << part_info.part.id;
+        part_info.cancel_signal.reset();  // cancel_query(part_info.cancel_signal);
       }
     }
   } else {
@@ -215,8 +217,10 @@ Status FileLoader::do_loop() {
       CHECK(blocking_id_ == 0);
       blocking_id_ = unique_id;
     }
-    part_map_[unique_id] = std::make_pair(part, query->cancel_slot_.get_signal_new());
-    // part_map_[unique_id] = std::make_pair(part, query.get_weak());
+    auto &part_info = part_map_[unique_id];
+    part_info.part = part;
+    part_info.cancel_signal = query->cancel_slot_.get_signal_new();
+    part_info.start_time = Time::now();
 
     auto callback = actor_shared(this, unique_id);
     if (delay_dispatcher_.empty()) {
@@ -233,7 +237,7 @@ Status FileLoader::do_loop() {
 
 void FileLoader::tear_down() {
   for (auto &it : part_map_) {
-    it.second.second.reset();  // cancel_query(it.second.second);
+    it.second.cancel_signal.reset();  // cancel_query(it.second.cancel_signal);
   }
   ordered_parts_.clear([](auto &&part) { part.second->clear(); });
   if (!delay_dispatcher_.empty()) {
@@ -272,8 +276,9 @@ void FileLoader::on_result(NetQueryPtr query) {
     return;
   }
 
-  Part part = it->second.first;
-  it->second.second.release();
+  Part part = it->second.part;
+  auto load_time = Time::now() - it->second.start_time;
+  it->second.cancel_signal.release();
   CHECK(query->is_ready());
   part_map_.erase(it);
 
@@ -283,6 +288,15 @@ void FileLoader::on_result(NetQueryPtr query) {
     if (query->is_error() && query->error().code() == NetQuery::Error::Canceled) {
       should_restart = true;
     }
+    if (!resource_manager_.empty()) {
+      if (query->is_error()) {
+        if (query->error().code() != NetQuery::Error::Canceled) {
+          send_closure(resource_manager_, &ResourceManager::on_part_failed, query->error().clone());
+        }
+      } else if (!should_restart) {
+        send_closure(resource_manager_, &ResourceManager::on_part_loaded, static_cast<int64>(part.size), load_time);
+      }
+    }
     if (should_restart) {
       VLOG(file_loader) << "Restart part " << tag("id", part.id) << tag("size", part.size);
       resource_state_.stop_use(static_cast<int64>(part.size));
@@ -115,7 +115,12 @@ class FileLoader : public FileLoaderActor {
   ResourceState resource_state_;
   PartsManager parts_manager_;
   uint64 blocking_id_{0};
-  std::map<uint64, std::pair<Part, ActorShared<>>> part_map_;
+  struct PartInfo {
+    Part part;
+    ActorShared<> cancel_signal;
+    double start_time = 0.0;
+  };
+  std::map<uint64, PartInfo> part_map_;
   bool ordered_flag_ = false;
   OrderedEventsProcessor<std::pair<Part, NetQueryPtr>> ordered_parts_;
   ActorOwn<DelayDispatcher> delay_dispatcher_;
@@ -9,7 +9,11 @@
 #include "td/telegram/Global.h"
 #include "td/telegram/TdDb.h"
 
+#include "td/actor/actor.h"
+
+#include "td/utils/buffer.h"
 #include "td/utils/common.h"
+#include "td/utils/crypto.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/format.h"
 #include "td/utils/misc.h"
@@ -357,4 +361,33 @@ Status check_partial_local_location(const PartialLocalFileLocation &location) {
   return Status::OK();
 }
 
+static Result<bool> do_check_file_part_hashes(CSlice path, const vector<FilePartHash> &part_hashes) {
+  TRY_RESULT(fd, FileFd::open(path, FileFd::Read));
+  BufferSlice buffer;
+  for (auto &part_hash : part_hashes) {
+    if (buffer.size() < part_hash.size_) {
+      buffer = BufferSlice(part_hash.size_);
+    }
+    auto data = buffer.as_mutable_slice().substr(0, part_hash.size_);
+    TRY_RESULT(read_size, fd.pread(data, part_hash.offset_));
+    if (read_size != part_hash.size_) {
+      return Status::Error("Failed to read file to check hash");
+    }
+    string hash(32, ' ');
+    sha256(data, hash);
+    if (hash != part_hash.hash_) {
+      LOG(INFO) << "Hash mismatch for " << part_hash.size_ << " bytes at offset " << part_hash.offset_ << " of \""
+                << path << '"';
+      return false;
+    }
+  }
+  return true;
+}
+
+void check_file_part_hashes(int32 sched_id, string path, vector<FilePartHash> part_hashes, Promise<bool> promise) {
+  Scheduler::instance()->run_on_scheduler(
+      sched_id, [path = std::move(path), part_hashes = std::move(part_hashes), promise = std::move(promise)](
+                    Unit) mutable { promise.set_result(do_check_file_part_hashes(path, part_hashes)); });
+}
+
 }  // namespace td
@@ -13,6 +13,7 @@
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/Promise.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 
@@ -52,4 +53,16 @@ Result<FullLocalLocationInfo> check_full_local_location(FullLocalLocationInfo lo
 
 Status check_partial_local_location(const PartialLocalFileLocation &location);
 
+struct FilePartHash {
+  int64 offset_ = 0;
+  size_t size_ = 0;
+  string hash_;  // SHA-256 of the part
+
+  FilePartHash(int64 offset, size_t size, string hash) : offset_(offset), size_(size), hash_(std::move(hash)) {
+  }
+};
+
+// checks hashes of the file parts on the scheduler and returns whether all of them match
+void check_file_part_hashes(int32 sched_id, string path, vector<FilePartHash> part_hashes, Promise<bool> promise);
+
 }  // namespace td
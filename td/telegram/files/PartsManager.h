@@ -22,6 +22,9 @@ struct Part {
 
 class PartsManager {
  public:
+  static constexpr int MAX_PART_COUNT = 4000;
+  static constexpr size_t MAX_PART_SIZE = 512 << 10;
+
   Status init(int64 size, int64 expected_size, bool is_size_final, size_t part_size,
               const std::vector<int> &ready_parts, bool use_part_count_limit, bool is_upload) TD_WARN_UNUSED_RESULT;
   bool may_finish();
@@ -55,9 +58,7 @@ class PartsManager {
   int32 get_pending_count() const;
 
  private:
-  static constexpr int MAX_PART_COUNT = 4000;
   static constexpr int MAX_PART_COUNT_PREMIUM = 8000;
-  static constexpr size_t MAX_PART_SIZE = 512 << 10;
   static constexpr int64 MAX_FILE_SIZE = static_cast<int64>(MAX_PART_SIZE) * MAX_PART_COUNT_PREMIUM;
 
   enum class PartStatus : int32 { Empty, Pending, Ready };
@@ -7,12 +7,14 @@
 #include "td/telegram/files/ResourceManager.h"
 
 #include "td/telegram/files/FileLoaderUtils.h"
+#include "td/telegram/files/PartsManager.h"
 
 #include "td/utils/common.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/Time.h"
 
 #include <algorithm>
 
@@ -65,6 +67,99 @@ void ResourceManager::update_resources(const ResourceState &resource_state) {
   loop();
 }
 
+void ResourceManager::on_part_loaded(int64 size, double load_time) {
+  if (stop_flag_) {
+    return;
+  }
+  auto now = Time::now();
+  if (min_load_time_ == 0.0 || load_time < min_load_time_) {
+    min_load_time_ = load_time;
+  }
+  if (next_min_load_time_ == 0.0 || load_time < next_min_load_time_) {
+    next_min_load_time_ = load_time;
+  }
+  if (min_load_time_expire_at_ < now) {
+    // forget old minimum to adapt to a route change
+    min_load_time_ = next_min_load_time_;
+    next_min_load_time_ = 0.0;
+    min_load_time_expire_at_ = now + MIN_LOAD_TIME_EXPIRE_TIME;
+  }
+
+  if (measurement_start_time_ == 0.0) {
+    measurement_start_time_ = now - load_time;
+  }
+  measured_size_ += size;
+  auto passed_time = now - measurement_start_time_;
+  if (passed_time < SPEED_MEASUREMENT_PERIOD) {
+    return;
+  }
+  auto speed = static_cast<double>(measured_size_) / passed_time;
+  speed_ = speed_ == 0.0 ? speed : 0.75 * speed_ + 0.25 * speed;
+  measured_size_ = 0;
+  measurement_start_time_ = now;
+  update_max_resource_limit();
+  update_preferred_part_size();
+}
+
+bool ResourceManager::is_congestion_error(const Status &error) {
+  // internal server errors and timeouts; flood and file reference errors aren't related to the network load
+  return error.code() >= 500 || error.code() == -503;
+}
+
+void ResourceManager::on_part_failed(Status error) {
+  if (stop_flag_ || !is_congestion_error(error)) {
+    return;
+  }
+  // the speed is measured again after the failure
+  measured_size_ = 0;
+  measurement_start_time_ = 0.0;
+
+  auto new_limit = max(min_resource_limit_, max_resource_limit_ / 2);
+  if (new_limit != max_resource_limit_) {
+    VLOG(file_loader) << "Decrease resource limit from " << max_resource_limit_ << " to " << new_limit
+                      << " after a failed part: " << error;
+    max_resource_limit_ = new_limit;
+    loop();
+  }
+}
+
+void ResourceManager::update_max_resource_limit() {
+  auto bandwidth_delay_product = static_cast<int64>(speed_ * min_load_time_);
+  auto new_limit = clamp(2 * bandwidth_delay_product, min_resource_limit_,
+                         min_resource_limit_ * MAX_RESOURCE_LIMIT_MULTIPLIER);
+  new_limit -= new_limit % min_resource_limit_;
+  VLOG(file_loader) << "Receive " << tag("speed", static_cast<int64>(speed_)) << tag("min_load_time", min_load_time_)
+                    << tag("bandwidth_delay_product", bandwidth_delay_product) << tag("old_limit", max_resource_limit_)
+                    << tag("new_limit", new_limit);
+  if (new_limit != max_resource_limit_) {
+    max_resource_limit_ = new_limit;
+    loop();
+  }
+}
+
+size_t ResourceManager::get_preferred_part_size() const {
+  auto bandwidth_delay_product = static_cast<int64>(speed_ * min_load_time_);
+  size_t part_size = 64 << 10;
+  while (part_size < PartsManager::MAX_PART_SIZE && static_cast<int64>(part_size) * 16 < bandwidth_delay_product) {
+    part_size *= 2;
+  }
+  if (part_size == (64 << 10)) {
+    return 0;
+  }
+  return part_size;
+}
+
+void ResourceManager::update_preferred_part_size() {
+  auto preferred_part_size = get_preferred_part_size();
+  if (preferred_part_size == preferred_part_size_) {
+    return;
+  }
+  preferred_part_size_ = preferred_part_size;
+  if (callback_ != nullptr) {
+    callback_->on_preferred_part_size_changed(preferred_part_size);
+  }
+}
+
 void ResourceManager::hangup_shared() {
   auto node_id = get_link_token();
   auto node_ptr = nodes_container_.get(node_id);
@@ -115,7 +210,7 @@ bool ResourceManager::satisfy_node(NodeId file_node_id) {
   give = min(need, give);
   give -= give % part_size;
   VLOG(file_loader) << tag("give", give);
-  if (give == 0) {
+  if (give <= 0) {
     return false;
   }
   resource_state_.start_use(give);
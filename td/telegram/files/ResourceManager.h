@@ -14,6 +14,7 @@
 #include "td/utils/common.h"
 #include "td/utils/Container.h"
 #include "td/utils/Heap.h"
+#include "td/utils/Status.h"
 
 #include <utility>
 
@@ -22,18 +23,57 @@ namespace td {
 class ResourceManager final : public Actor {
  public:
   enum class Mode : int32 { Baseline, Greedy };
-  ResourceManager(int64 max_resource_limit, Mode mode) : max_resource_limit_(max_resource_limit), mode_(mode) {
+
+  class Callback {
+   public:
+    Callback() = default;
+    Callback(const Callback &) = delete;
+    Callback &operator=(const Callback &) = delete;
+    virtual ~Callback() = default;
+
+    // preferred_part_size is 0 if there is no preferred part size
+    virtual void on_preferred_part_size_changed(size_t preferred_part_size) = 0;
+  };
+
+  ResourceManager(int64 max_resource_limit, Mode mode, unique_ptr<Callback> callback = nullptr)
+      : min_resource_limit_(max_resource_limit)
+      , max_resource_limit_(max_resource_limit)
+      , mode_(mode)
+      , callback_(std::move(callback)) {
   }
   // use through ActorShared
   void update_priority(int8 priority);
   void update_resources(const ResourceState &resource_state);
+  void on_part_loaded(int64 size, double load_time);
+  void on_part_failed(Status error);
 
   void register_worker(ActorShared<FileLoaderActor> callback, int8 priority);
 
+  // must be called from the same scheduler
+  int64 get_max_resource_limit() const {
+    return max_resource_limit_;
+  }
+
  private:
+  static constexpr int64 MAX_RESOURCE_LIMIT_MULTIPLIER = 8;
+  static constexpr double SPEED_MEASUREMENT_PERIOD = 1.0;
+  static constexpr double MIN_LOAD_TIME_EXPIRE_TIME = 10.0;
+
+  int64 min_resource_limit_ = 0;
   int64 max_resource_limit_ = 0;
   Mode mode_;
 
+  // the limit is adjusted to twice the measured bandwidth-delay product
+  double speed_ = 0.0;
+  double min_load_time_ = 0.0;
+  double min_load_time_expire_at_ = 0.0;
+  double next_min_load_time_ = 0.0;
+  int64 measured_size_ = 0;
+  double measurement_start_time_ = 0.0;
+
+  unique_ptr<Callback> callback_;
+  size_t preferred_part_size_ = 0;
+
   using NodeId = uint64;
   struct Node final : public HeapNode {
     NodeId node_id = 0;
@@ -61,6 +101,14 @@ class ResourceManager final : public Actor {
 
   void loop() final;
 
+  void update_max_resource_limit();
+
+  size_t get_preferred_part_size() const;
+
+  void update_preferred_part_size();
+
+  static bool is_congestion_error(const Status &error);
+
   void add_to_heap(Node *node);
   bool satisfy_node(NodeId file_node_id);
   void add_node(NodeId node_id, int8 priority);
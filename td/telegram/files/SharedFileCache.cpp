@@ -0,0 +1,270 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/SharedFileCache.h"
+
+#include "td/telegram/files/FileLoaderUtils.h"
+#include "td/telegram/files/FileLocation.hpp"
+
+#include "td/utils/base64.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/PathView.h"
+#include "td/utils/port/Clocks.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/tl_helpers.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace td {
+
+SharedFileCache::SharedFileCache(string directory) : directory_(std::move(directory)) {
+  if (!directory_.empty() && directory_.back() != TD_DIR_SLASH) {
+    directory_ += TD_DIR_SLASH;
+  }
+}
+
+std::shared_ptr<SharedFileCache> SharedFileCache::get(const string &directory) {
+  static std::mutex caches_mutex;
+  static std::map<string, std::weak_ptr<SharedFileCache>> caches;
+
+  std::lock_guard<std::mutex> lock(caches_mutex);
+  auto &weak_cache = caches[directory];
+  auto cache = weak_cache.lock();
+  if (cache == nullptr) {
+    cache = std::make_shared<SharedFileCache>(directory);
+    weak_cache = cache;
+  }
+  return cache;
+}
+
+string SharedFileCache::get_file_key(const FullRemoteFileLocation &remote) {
+  return base64url_encode(zero_encode(serialize(remote.as_unique())));
+}
+
+bool SharedFileCache::is_shareable_download(const LocalFileLocation &local, int64 size,
+                                            const FileEncryptionKey &encryption_key, int64 offset, int64 limit) {
+  return encryption_key.empty() && local.type() == LocalFileLocation::Type::Empty && size > 0 && offset == 0 &&
+         limit == 0;
+}
+
+void SharedFileCache::set_max_size(int64 max_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_size_ = max(max_size, static_cast<int64>(0));
+}
+
+SharedFileCache::LookupResult SharedFileCache::lookup(const string &key, int64 size, string &path,
+                                                      Promise<string> &promise) {
+  CHECK(!key.empty());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = active_downloads_.find(key);
+    if (it != active_downloads_.end()) {
+      it->second.push_back(std::move(promise));
+      return LookupResult::Wait;
+    }
+  }
+
+  // the file system is accessed without the lock
+  auto cached_path = get_cached_path(key);
+  auto r_stat = stat(cached_path);
+  bool is_found = r_stat.is_ok() && r_stat.ok().is_reg_ && r_stat.ok().size_ == size;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = active_downloads_.find(key);
+    if (it != active_downloads_.end()) {
+      // the download has been started by another client after the first check
+      it->second.push_back(std::move(promise));
+      return LookupResult::Wait;
+    }
+    if (is_found) {
+      set_cached_file(key, size, Clocks::system());
+      path = std::move(cached_path);
+      return LookupResult::Found;
+    }
+    erase_cached_file(key);
+    active_downloads_[key];
+  }
+
+  if (r_stat.is_ok()) {
+    LOG(WARNING) << "Remove cached file " << cached_path << " of size " << r_stat.ok().size_ << " instead of " << size;
+    unlink(cached_path).ignore();
+  }
+  return LookupResult::Download;
+}
+
+void SharedFileCache::finish_download(const string &key, Result<string> r_downloaded_path) {
+  Result<string> r_cached_path;
+  if (r_downloaded_path.is_ok()) {
+    r_cached_path = add_file(key, r_downloaded_path.ok());
+    if (r_cached_path.is_error()) {
+      LOG(WARNING) << "Failed to add file to the shared cache: " << r_cached_path.error();
+    }
+  } else {
+    r_cached_path = r_downloaded_path.move_as_error();
+  }
+
+  vector<Promise<string>> promises;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = active_downloads_.find(key);
+    CHECK(it != active_downloads_.end());
+    promises = std::move(it->second);
+    active_downloads_.erase(it);
+  }
+
+  for (auto &promise : promises) {
+    if (r_cached_path.is_ok()) {
+      promise.set_value(string(r_cached_path.ok()));
+    } else {
+      promise.set_error(r_cached_path.error().clone());
+    }
+  }
+}
+
+Status SharedFileCache::import_file(CSlice cached_path, CSlice path) {
+  auto status = link(cached_path, path);
+  if (status.is_error()) {
+    VLOG(file_loader) << "Copy cached file " << cached_path << ", because " << status;
+    status = copy_file(cached_path, path);
+    if (status.is_error()) {
+      unlink(path).ignore();
+    }
+  }
+  return status;
+}
+
+string SharedFileCache::get_cached_path(const string &key) const {
+  return PSTRING() << directory_ << key;
+}
+
+Result<string> SharedFileCache::add_file(const string &key, CSlice path) {
+  TRY_STATUS(mkpath(directory_, 0750));
+  load_cached_files();
+
+  auto cached_path = get_cached_path(key);
+  if (link(path, cached_path).is_error()) {
+    // hard links can't be created between different file systems
+    auto temp_path = PSTRING() << cached_path << ".tmp";
+    auto status = copy_file(path, temp_path);
+    if (status.is_ok()) {
+      status = rename(temp_path, cached_path);
+    }
+    if (status.is_error()) {
+      unlink(temp_path).ignore();
+      return std::move(status);
+    }
+  }
+  TRY_RESULT(stat, stat(cached_path));
+
+  vector<string> evicted_keys;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    set_cached_file(key, stat.size_, Clocks::system());
+    evicted_keys = get_evicted_keys(key);
+    for (auto &evicted_key : evicted_keys) {
+      erase_cached_file(evicted_key);
+    }
+  }
+  for (auto &evicted_key : evicted_keys) {
+    VLOG(file_loader) << "Remove least recently used cached file " << evicted_key;
+    unlink(get_cached_path(evicted_key)).ignore();
+  }
+  return std::move(cached_path);
+}
+
+void SharedFileCache::load_cached_files() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (are_cached_files_loaded_) {
+      return;
+    }
+  }
+
+  // files cached by previous runs of the process are used in the order of their modification
+  vector<std::pair<string, CachedFile>> cached_files;
+  walk_path(directory_, [&](CSlice path, WalkPath::Type type) {
+    if (type != WalkPath::Type::RegularFile || ends_with(path, ".tmp")) {
+      return WalkPath::Action::Continue;
+    }
+    auto r_stat = stat(path);
+    if (r_stat.is_ok()) {
+      CachedFile cached_file;
+      cached_file.size_ = r_stat.ok().size_;
+      cached_file.last_used_time_ = static_cast<double>(r_stat.ok().mtime_nsec_) * 1e-9;
+      cached_files.emplace_back(PathView(path).file_name().str(), cached_file);
+    }
+    return WalkPath::Action::Continue;
+  }).ignore();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (are_cached_files_loaded_) {
+    return;
+  }
+  are_cached_files_loaded_ = true;
+  for (auto &cached_file : cached_files) {
+    if (cached_files_.count(cached_file.first) == 0) {
+      set_cached_file(cached_file.first, cached_file.second.size_, cached_file.second.last_used_time_);
+    }
+  }
+}
+
+void SharedFileCache::set_cached_file(const string &key, int64 size, double last_used_time) {
+  auto &cached_file = cached_files_[key];
+  total_size_ += size - cached_file.size_;
+  cached_file.size_ = size;
+  cached_file.last_used_time_ = last_used_time;
+}
+
+void SharedFileCache::erase_cached_file(const string &key) {
+  auto it = cached_files_.find(key);
+  if (it != cached_files_.end()) {
+    total_size_ -= it->second.size_;
+    cached_files_.erase(it);
+  }
+}
+
+vector<string> SharedFileCache::get_evicted_keys(const string &added_key) const {
+  if (max_size_ <= 0 || total_size_ <= max_size_) {
+    return {};
+  }
+
+  vector<std::pair<double, const string *>> candidates;
+  for (auto &it : cached_files_) {
+    if (it.first != added_key && active_downloads_.count(it.first) == 0) {
+      candidates.emplace_back(it.second.last_used_time_, &it.first);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  vector<string> result;
+  auto size = total_size_;
+  for (auto &candidate : candidates) {
+    if (size <= max_size_) {
+      break;
+    }
+    size -= cached_files_.find(*candidate.second)->second.size_;
+    result.push_back(*candidate.second);
+  }
+  return result;
+}
+
+void SharedFileCacheWorker::finish_download(std::shared_ptr<SharedFileCache> shared_file_cache, string key,
+                                            Result<string> r_downloaded_path) {
+  shared_file_cache->finish_download(key, std::move(r_downloaded_path));
+}
+
+void SharedFileCacheWorker::import_file(string cached_path, string path, Promise<Unit> promise) {
+  TRY_STATUS_PROMISE(promise, SharedFileCache::import_file(cached_path, path));
+  promise.set_value(Unit());
+}
+
+}  // namespace td
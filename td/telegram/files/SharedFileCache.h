@@ -0,0 +1,99 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/telegram/files/FileEncryptionKey.h"
+#include "td/telegram/files/FileLocation.h"
+
+#include "td/actor/actor.h"
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+#include <memory>
+#include <mutex>
+
+namespace td {
+
+// process-wide cache of downloaded files, which is shared by all clients using the same cache directory
+// files are identified by their unique remote location; a cached file is hard linked or copied to the files directory
+// of a client, so a file is downloaded only once even if it is requested by many clients simultaneously
+// cached files aren't deleted by deleteFile or the storage optimizer of clients; instead, least recently used files
+// are deleted when the total size of the cache exceeds its maximum size
+class SharedFileCache {
+ public:
+  explicit SharedFileCache(string directory);
+
+  // returns the cache for the directory; the cache is kept while there are clients using it
+  static std::shared_ptr<SharedFileCache> get(const string &directory);
+
+  static string get_file_key(const FullRemoteFileLocation &remote);
+
+  // sets the maximum total size of cached files in bytes, which is checked whenever a file is added; 0 means no limit
+  void set_max_size(int64 max_size);
+
+  // only whole unencrypted files, which aren't partially downloaded yet, can be shared
+  // ranged and streaming downloads must neither download the file for the cache nor wait for it
+  static bool is_shareable_download(const LocalFileLocation &local, int64 size,
+                                    const FileEncryptionKey &encryption_key, int64 offset, int64 limit);
+
+  enum class LookupResult : int32 { Found, Wait, Download };
+
+  // Found: the file is in the cache and its path is returned
+  // Wait: the file is being downloaded by another client and the promise will receive the path after the download
+  // Download: the caller must download the file and call finish_download after that
+  LookupResult lookup(const string &key, int64 size, string &path, Promise<string> &promise);
+
+  // adds the downloaded file to the cache and passes its cached path to the waiting clients
+  // in case of an error the waiting clients receive the error and must download the file themselves
+  // the file can be copied, so the method must be called through SharedFileCacheWorker after a successful download
+  void finish_download(const string &key, Result<string> r_downloaded_path);
+
+  // hard links or copies the cached file to the given path, which must not exist
+  static Status import_file(CSlice cached_path, CSlice path);
+
+ private:
+  struct CachedFile {
+    int64 size_ = 0;
+    double last_used_time_ = 0.0;
+  };
+
+  string directory_;
+
+  std::mutex mutex_;
+  FlatHashMap<string, vector<Promise<string>>> active_downloads_;
+  int64 max_size_ = 0;
+  bool are_cached_files_loaded_ = false;
+  FlatHashMap<string, CachedFile> cached_files_;
+  int64 total_size_ = 0;
+
+  string get_cached_path(const string &key) const;
+
+  Result<string> add_file(const string &key, CSlice path);
+
+  void load_cached_files();
+
+  void set_cached_file(const string &key, int64 size, double last_used_time);
+
+  void erase_cached_file(const string &key);
+
+  vector<string> get_evicted_keys(const string &added_key) const;
+};
+
+// performs file operations of the shared file cache, which can copy whole files, outside of the file load actor thread
+class SharedFileCacheWorker final : public Actor {
+ public:
+  void finish_download(std::shared_ptr<SharedFileCache> shared_file_cache, string key,
+                       Result<string> r_downloaded_path);
+
+  void import_file(string cached_path, string path, Promise<Unit> promise);
+};
+
+}  // namespace td
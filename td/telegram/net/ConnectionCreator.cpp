@@ -530,7 +530,12 @@ void ConnectionCreator::on_network(bool network_flag, uint32 network_generation)
     resolve_proxy_query_token_ = 0;
     resolve_proxy_timestamp_ = Timestamp();
 
+    bool is_network_changed = old_generation != network_generation_;
     for (auto &client : clients_) {
+      if (is_network_changed) {
+        // previously working DC option may be unavailable in the new network
+        client.second.race_connections_until = Time::now() + ClientInfo::RACE_CONNECTIONS_DURATION;
+      }
       client.second.backoff.clear();
       client.second.sanity_flood_control.clear_events();
       client.second.flood_control.clear_events();
@@ -538,7 +543,7 @@ void ConnectionCreator::on_network(bool network_flag, uint32 network_generation)
       client_loop(client.second);
     }
 
-    if (old_generation != network_generation_) {
+    if (is_network_changed) {
       loop();
     }
   }
@@ -843,7 +848,9 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
   }
 
   // Main loop. Create new connections till needed
-  bool check_mode = client.checking_connections != 0 && !proxy.use_proxy();
+  // In check mode up to 3 connections to the best DC options are created in parallel
+  bool check_mode = (client.checking_connections != 0 || client.race_connections_until > Time::now_cached()) &&
+                    !proxy.use_proxy();
   while (true) {
     // Check if we need new connections
     if (client.queries.empty()) {
@@ -916,10 +923,11 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
 
     auto promise = PromiseCreator::lambda(
         [actor_id = actor_id(this), check_mode, transport_type = extra.transport_type, hash = client.hash,
-         debug_str = extra.debug_str,
-         network_generation = network_generation_](Result<ConnectionData> r_connection_data) mutable {
+         debug_str = extra.debug_str, network_generation = network_generation_,
+         option_stat = extra.stat](Result<ConnectionData> r_connection_data) mutable {
           send_closure(actor_id, &ConnectionCreator::client_create_raw_connection, std::move(r_connection_data),
-                       check_mode, std::move(transport_type), hash, std::move(debug_str), network_generation);
+                       check_mode, std::move(transport_type), hash, std::move(debug_str), network_generation,
+                       option_stat);
         });
 
     auto stats_callback =
@@ -937,7 +945,8 @@ void ConnectionCreator::client_loop(ClientInfo &client) {
 
 void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_connection_data, bool check_mode,
                                                      mtproto::TransportType transport_type, uint32 hash,
-                                                     string debug_str, uint32 network_generation) {
+                                                     string debug_str, uint32 network_generation,
+                                                     DcOptionsSet::Stat *option_stat) {
   unique_ptr<mtproto::AuthData> auth_data;
   uint64 auth_data_generation{0};
   uint64 session_id{0};
@@ -953,7 +962,8 @@ void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_co
     }
   }
   auto promise = PromiseCreator::lambda([actor_id = actor_id(this), hash, check_mode, auth_data_generation, session_id,
-                                         debug_str](Result<unique_ptr<mtproto::RawConnection>> result) mutable {
+                                         debug_str,
+                                         option_stat](Result<unique_ptr<mtproto::RawConnection>> result) mutable {
     if (result.is_ok()) {
       VLOG(connections) << "Ready connection (" << (check_mode ? "" : "un") << "checked) " << result.ok().get() << ' '
                         << tag("rtt", format::as_time(result.ok()->extra().rtt)) << ' ' << debug_str;
@@ -962,7 +972,7 @@ void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_co
                         << debug_str;
     }
     send_closure(actor_id, &ConnectionCreator::client_add_connection, hash, std::move(result), check_mode,
-                 auth_data_generation, session_id);
+                 auth_data_generation, session_id, option_stat);
   });
 
   if (r_connection_data.is_error()) {
@@ -998,7 +1008,8 @@ void ConnectionCreator::client_set_timeout_at(ClientInfo &client, double wakeup_
 }
 
 void ConnectionCreator::client_add_connection(uint32 hash, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection,
-                                              bool check_flag, uint64 auth_data_generation, uint64 session_id) {
+                                              bool check_flag, uint64 auth_data_generation, uint64 session_id,
+                                              DcOptionsSet::Stat *option_stat) {
   auto &client = clients_[hash];
   client.add_session_id(session_id);
   CHECK(client.pending_connections > 0);
@@ -1011,8 +1022,18 @@ void ConnectionCreator::client_add_connection(uint32 hash, Result<unique_ptr<mtp
     VLOG(connections) << "Add ready connection " << r_raw_connection.ok().get() << " for "
                       << tag("client", format::as_hex(hash));
     client.backoff.clear();
+    client.race_connections_until = 0;
+    auto rtt = r_raw_connection.ok()->extra().rtt;
+    if (option_stat != nullptr && rtt > 0 && active_proxy_id_ == 0) {
+      option_stat->on_rtt(rtt);
+      need_save_dc_option_stats_ = true;
+      loop();
+    }
     client.ready_connections.emplace_back(r_raw_connection.move_as_ok(), Time::now_cached());
   } else {
+    if (!check_flag) {
+      client.race_connections_until = Time::now_cached() + ClientInfo::RACE_CONNECTIONS_DURATION;
+    }
     if (r_raw_connection.error().code() == -404 && client.auth_data &&
         client.auth_data_generation == auth_data_generation) {
       VLOG(connections) << "Drop auth data from " << tag("client", format::as_hex(hash));
@@ -1023,6 +1044,22 @@ void ConnectionCreator::client_add_connection(uint32 hash, Result<unique_ptr<mtp
   client_loop(client);
 }
 
+void ConnectionCreator::save_dc_option_stats(double delay) {
+  if (!need_save_dc_option_stats_) {
+    return;
+  }
+
+  auto now = Time::now();
+  if (dc_option_stats_saved_at_ != 0 && now < dc_option_stats_saved_at_ + delay) {
+    return;
+  }
+  LOG(DEBUG) << "Save DC option statistics";
+
+  need_save_dc_option_stats_ = false;
+  dc_option_stats_saved_at_ = now;
+  G()->td_db()->get_binlog_pmc()->set("dc_option_stats", dc_options_set_.get_serialized_option_stats());
+}
+
 void ConnectionCreator::client_wakeup(uint32 hash) {
   VLOG(connections) << tag("hash", format::as_hex(hash)) << " wakeup";
   G()->save_server_time();
@@ -1097,6 +1134,7 @@ void ConnectionCreator::start_up() {
   } else {
     add_dc_options(std::move(dc_options));
   }
+  dc_options_set_.set_serialized_option_stats(G()->td_db()->get_binlog_pmc()->get("dc_option_stats"));
 
   if (G()->td_db()->get_binlog_pmc()->get("proxy_max_id") != "2" ||
       !G()->td_db()->get_binlog_pmc()->get(get_proxy_database_key(1)).empty()) {
@@ -1189,6 +1227,7 @@ ActorShared<ConnectionCreator> ConnectionCreator::create_reference(int64 token)
 void ConnectionCreator::hangup() {
   close_flag_ = true;
   save_proxy_last_used_date(0);
+  save_dc_option_stats(0);
   ref_cnt_guard_.reset();
   for (auto &child : children_) {
     child.second.second.reset();
@@ -1265,12 +1304,14 @@ void ConnectionCreator::loop() {
   if (!is_inited_) {
     return;
   }
-  if (!network_flag_) {
-    return;
-  }
 
   Timestamp timeout;
-  if (active_proxy_id_ != 0) {
+  save_dc_option_stats(DC_OPTION_STATS_SAVE_DELAY);
+  if (need_save_dc_option_stats_) {
+    timeout.relax(Timestamp::at(dc_option_stats_saved_at_ + DC_OPTION_STATS_SAVE_DELAY));
+  }
+
+  if (network_flag_ && active_proxy_id_ != 0) {
     if (resolve_proxy_timestamp_.is_in_past()) {
       if (resolve_proxy_query_token_ == 0) {
         resolve_proxy_query_token_ = next_token();
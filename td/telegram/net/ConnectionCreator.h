@@ -106,6 +106,10 @@ class ConnectionCreator final : public NetQueryCallback {
   bool is_inited_ = false;
 
   static constexpr int32 MAX_PROXY_LAST_USED_SAVE_DELAY = 60;
+  static constexpr double DC_OPTION_STATS_SAVE_DELAY = 60;
+  double dc_option_stats_saved_at_ = 0;
+  bool need_save_dc_option_stats_ = false;
+
   std::map<int32, Proxy> proxies_;
   FlatHashMap<int32, int32> proxy_last_used_date_;
   FlatHashMap<int32, int32> proxy_last_used_saved_date_;
@@ -157,6 +161,10 @@ class ConnectionCreator final : public NetQueryCallback {
     std::vector<Promise<unique_ptr<mtproto::RawConnection>>> queries;
 
     static constexpr double READY_CONNECTIONS_TIMEOUT = 10;
+    static constexpr double RACE_CONNECTIONS_DURATION = 10;
+
+    // connections to several DC options are created in parallel until the time
+    double race_connections_until{0};
 
     bool inited{false};
     uint32 hash{0};
@@ -222,11 +230,13 @@ class ConnectionCreator final : public NetQueryCallback {
   void client_loop(ClientInfo &client);
   void client_create_raw_connection(Result<ConnectionData> r_connection_data, bool check_mode,
                                     mtproto::TransportType transport_type, uint32 hash, string debug_str,
-                                    uint32 network_generation);
+                                    uint32 network_generation, DcOptionsSet::Stat *option_stat);
   void client_add_connection(uint32 hash, Result<unique_ptr<mtproto::RawConnection>> r_raw_connection, bool check_flag,
-                             uint64 auth_data_generation, uint64 session_id);
+                             uint64 auth_data_generation, uint64 session_id, DcOptionsSet::Stat *option_stat);
   void client_set_timeout_at(ClientInfo &client, double wakeup_at);
 
+  void save_dc_option_stats(double delay);
+
   void on_proxy_resolved(Result<IPAddress> ip_address, bool dummy);
 
   struct FindConnectionExtra {
@@ -14,7 +14,9 @@
 #include "td/utils/algorithm.h"
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/tl_helpers.h"
 
 #include <algorithm>
 #include <set>
@@ -160,6 +162,13 @@ Result<DcOptionsSet::ConnectionInfo> DcOptionsSet::find_connection(DcId dc_id, b
       return a_state < b_state;
     }
     if (a_state == Stat::State::Ok) {
+      // prefer options with known smaller RTT
+      if ((a.rtt == 0) != (b.rtt == 0)) {
+        return a.rtt != 0;
+      }
+      if (a.rtt != b.rtt) {
+        return a.rtt < b.rtt;
+      }
       if (a_option.order == b_option.order) {
         return a_option.use_http < b_option.use_http;
       }
@@ -178,6 +187,48 @@ void DcOptionsSet::reset() {
   ordered_options_.clear();
 }
 
+string DcOptionsSet::get_serialized_option_stats() const {
+  // TCP and HTTP RTTs of an IP address are saved separately, because they can differ a lot
+  vector<std::pair<string, std::pair<double, double>>> rtts;
+  for (auto &option_stat : option_stats_) {
+    const auto &ip_address = option_stat.first;
+    auto tcp_rtt = option_stat.second->tcp_stat.rtt;
+    auto http_rtt = option_stat.second->http_stat.rtt;
+    if ((tcp_rtt != 0 || http_rtt != 0) && ip_address.is_valid()) {
+      rtts.emplace_back(PSTRING() << ip_address.get_ip_host() << ':' << ip_address.get_port(),
+                        std::make_pair(tcp_rtt, http_rtt));
+    }
+  }
+  return serialize(rtts);
+}
+
+void DcOptionsSet::set_serialized_option_stats(Slice serialized_option_stats) {
+  if (serialized_option_stats.empty()) {
+    return;
+  }
+  vector<std::pair<string, std::pair<double, double>>> rtts;
+  auto status = unserialize(rtts, serialized_option_stats);
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to parse DC option statistics: " << status;
+    return;
+  }
+  auto is_valid_rtt = [](double rtt) {
+    return rtt == 0.0 || (rtt > 0.0 && rtt < 100.0);
+  };
+  for (auto &rtt : rtts) {
+    auto tcp_rtt = rtt.second.first;
+    auto http_rtt = rtt.second.second;
+    IPAddress ip_address;
+    if (ip_address.init_host_port(rtt.first).is_error() || !is_valid_rtt(tcp_rtt) || !is_valid_rtt(http_rtt)) {
+      LOG(ERROR) << "Receive invalid RTTs " << tcp_rtt << " and " << http_rtt << " for " << rtt.first;
+      continue;
+    }
+    auto &option_stat = option_stats_[get_option_stat_id(ip_address)].second;
+    option_stat->tcp_stat.rtt = tcp_rtt;
+    option_stat->http_stat.rtt = http_rtt;
+  }
+}
+
 DcOptionsSet::DcOptionInfo *DcOptionsSet::register_dc_option(DcOption &&option) {
   auto info = make_unique<DcOptionInfo>(std::move(option), options_.size());
   init_option_stat(info.get());
@@ -187,15 +238,17 @@ DcOptionsSet::DcOptionInfo *DcOptionsSet::register_dc_option(DcOption &&option)
 }
 
 void DcOptionsSet::init_option_stat(DcOptionInfo *option_info) {
-  const auto &ip_address = option_info->option.get_ip_address();
+  option_info->stat_id = get_option_stat_id(option_info->option.get_ip_address());
+}
+
+size_t DcOptionsSet::get_option_stat_id(const IPAddress &ip_address) {
   for (size_t i = 0; i < option_stats_.size(); i++) {
     if (option_stats_[i].first == ip_address) {
-      option_info->stat_id = i;
-      return;
+      return i;
     }
   }
   option_stats_.emplace_back(ip_address, make_unique<OptionStat>());
-  option_info->stat_id = option_stats_.size() - 1;
+  return option_stats_.size() - 1;
 }
 
 DcOptionsSet::OptionStat *DcOptionsSet::get_option_stat(const DcOptionInfo *option_info) {
@@ -11,6 +11,7 @@
 
 #include "td/utils/common.h"
 #include "td/utils/port/IPAddress.h"
+#include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 #include "td/utils/Time.h"
 
@@ -28,6 +29,7 @@ class DcOptionsSet {
     double ok_at{-1000};
     double error_at{-1001};
     double check_at{-1002};
+    double rtt{0};  // 0 if unknown
     enum class State : int32 { Ok, Error, Checking };
 
     void on_ok() {
@@ -39,6 +41,9 @@ class DcOptionsSet {
     void on_check() {
       check_at = Time::now_cached();
     }
+    void on_rtt(double new_rtt) {
+      rtt = rtt == 0 ? new_rtt : 0.7 * rtt + 0.3 * new_rtt;
+    }
     bool is_ok() const {
       return state() == State::Ok;
     }
@@ -68,6 +73,9 @@ class DcOptionsSet {
                                          bool only_http);
   void reset();
 
+  string get_serialized_option_stats() const;
+  void set_serialized_option_stats(Slice serialized_option_stats);
+
  private:
   enum class State : int32 { Error, Ok, Checking };
 
@@ -109,6 +117,7 @@ class DcOptionsSet {
 
   DcOptionInfo *register_dc_option(DcOption &&option);
   void init_option_stat(DcOptionInfo *option_info);
+  size_t get_option_stat_id(const IPAddress &ip_address);
   OptionStat *get_option_stat(const DcOptionInfo *option_info);
 };
 
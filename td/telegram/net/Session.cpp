@@ -214,21 +214,31 @@ TD_THREAD_LOCAL Semaphore *GenAuthKeyActor::semaphore_{};
 
 void Session::PriorityQueue::push(NetQueryPtr query) {
   auto priority = query->priority();
-  queries_[priority].push(std::move(query));
+  auto it = queries_.begin();
+  while (it != queries_.end() && it->first > priority) {
+    ++it;
+  }
+  if (it == queries_.end() || it->first != priority) {
+    it = queries_.emplace(it, priority, VectorQueue<NetQueryPtr>());
+  }
+  it->second.push(std::move(query));
+  size_++;
 }
 
 NetQueryPtr Session::PriorityQueue::pop() {
   CHECK(!empty());
-  auto it = queries_.begin();
-  auto res = it->second.pop();
-  if (it->second.empty()) {
-    queries_.erase(it);
+  for (auto &queue : queries_) {
+    if (!queue.second.empty()) {
+      size_--;
+      return queue.second.pop();
+    }
   }
-  return res;
+  UNREACHABLE();
+  return NetQueryPtr();
 }
 
 bool Session::PriorityQueue::empty() const {
-  return queries_.empty();
+  return size_ == 0;
 }
 
 Session::Session(unique_ptr<Callback> callback, std::shared_ptr<AuthDataShared> shared_auth_data, int32 raw_dc_id,
@@ -508,11 +518,10 @@ void Session::close() {
   connection_close(&main_connection_);
   connection_close(&long_poll_connection_);
 
-  for (auto &it : sent_queries_) {
-    auto &query = it.second.net_query_;
-    query->set_message_id(0);
-    pending_queries_.push(std::move(query));
-  }
+  sent_queries_.foreach([&](mtproto::MessageId, Query &query) {
+    query.net_query_->set_message_id(0);
+    pending_queries_.push(std::move(query.net_query_));
+  });
   sent_queries_.clear();
   sent_containers_.clear();
 
@@ -535,18 +544,18 @@ void Session::hangup() {
 
 void Session::raw_event(const Event::Raw &event) {
   auto message_id = mtproto::MessageId(event.u64);
-  auto it = sent_queries_.find(message_id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.get(message_id);
+  if (query_ptr == nullptr) {
     return;
   }
 
-  dec_container(it->first, &it->second);
-  mark_as_known(it->first, &it->second);
+  dec_container(message_id, query_ptr);
+  mark_as_known(message_id, query_ptr);
 
-  auto query = std::move(it->second.net_query_);
+  auto query = std::move(query_ptr->net_query_);
   LOG(DEBUG) << "Drop answer for " << query;
   query->set_message_id(0);
-  sent_queries_.erase(it);
+  sent_queries_.erase(message_id);
   return_query(std::move(query));
 
   if (main_connection_.state_ == ConnectionInfo::State::Ready) {
@@ -669,31 +678,31 @@ void Session::on_closed(Status status) {
   }
 
   // resend all queries without ack
-  for (auto it = sent_queries_.begin(); it != sent_queries_.end();) {
-    if (!it->second.is_acknowledged_ && it->second.connection_id_ == current_info_->connection_id_) {
-      // container vector leak otherwise
-      cleanup_container(it->first, &it->second);
-
-      // mark query as unknown
-      if (status.is_error() && status.code() == 500) {
-        cleanup_container(it->first, &it->second);
-        mark_as_known(it->first, &it->second);
-
-        auto &query = it->second.net_query_;
-        VLOG(net_query) << "Resend query (on_disconnected, no ack) " << query;
-        query->set_message_id(0);
-        query->set_error(Status::Error(500, PSLICE() << "Session failed: " << status.message()),
-                         current_info_->connection_->get_name().str());
-        return_query(std::move(query));
-        it = sent_queries_.erase(it);
-      } else {
-        mark_as_unknown(it->first, &it->second);
-        ++it;
-      }
-    } else {
-      ++it;
+  sent_queries_.remove_if([&](mtproto::MessageId message_id, Query &query) {
+    if (query.is_acknowledged_ || query.connection_id_ != current_info_->connection_id_) {
+      return false;
     }
-  }
+
+    // container vector leak otherwise
+    cleanup_container(message_id, &query);
+
+    // mark query as unknown
+    if (status.is_error() && status.code() == 500) {
+      cleanup_container(message_id, &query);
+      mark_as_known(message_id, &query);
+
+      auto &net_query = query.net_query_;
+      VLOG(net_query) << "Resend query (on_disconnected, no ack) " << net_query;
+      net_query->set_message_id(0);
+      net_query->set_error(Status::Error(500, PSLICE() << "Session failed: " << status.message()),
+                           current_info_->connection_->get_name().str());
+      return_query(std::move(net_query));
+      return true;
+    }
+
+    mark_as_unknown(message_id, &query);
+    return false;
+  });
 
   current_info_->connection_.reset();
   current_info_->state_ = ConnectionInfo::State::Empty;
@@ -711,25 +720,23 @@ void Session::on_new_session_created(uint64 unique_id, mtproto::MessageId first_
     last_activity_timestamp_ = Time::now();
     callback_->on_update(std::move(packet), auth_data_.get_auth_key().id());
   }
-  auto first_query_it = sent_queries_.find(first_message_id);
-  if (first_query_it != sent_queries_.end()) {
-    first_message_id = first_query_it->second.container_message_id_;
+  auto first_query_ptr = sent_queries_.get(first_message_id);
+  if (first_query_ptr != nullptr) {
+    first_message_id = first_query_ptr->container_message_id_;
     LOG(INFO) << "Update first message to container's " << first_message_id;
   } else {
     LOG(INFO) << "Failed to find sent " << first_message_id << " from the new session";
   }
-  for (auto it = sent_queries_.begin(); it != sent_queries_.end();) {
-    Query *query_ptr = &it->second;
-    if (query_ptr->container_message_id_ < first_message_id) {
+  sent_queries_.remove_if([&](mtproto::MessageId message_id, Query &query) {
+    if (query.container_message_id_ < first_message_id) {
       // container vector leak otherwise
-      cleanup_container(it->first, query_ptr);
-      mark_as_known(it->first, query_ptr);
-      resend_query(std::move(query_ptr->net_query_));
-      it = sent_queries_.erase(it);
-    } else {
-      ++it;
+      cleanup_container(message_id, &query);
+      mark_as_known(message_id, &query);
+      resend_query(std::move(query.net_query_));
+      return true;
     }
-  }
+    return false;
+  });
 }
 
 void Session::on_session_failed(Status status) {
@@ -747,11 +754,11 @@ void Session::on_container_sent(mtproto::MessageId container_message_id, vector<
   CHECK(container_message_id != mtproto::MessageId());
 
   td::remove_if(message_ids, [&](mtproto::MessageId message_id) {
-    auto it = sent_queries_.find(message_id);
-    if (it == sent_queries_.end()) {
+    auto query_ptr = sent_queries_.get(message_id);
+    if (query_ptr == nullptr) {
       return true;  // remove
     }
-    it->second.container_message_id_ = container_message_id;
+    query_ptr->container_message_id_ = container_message_id;
     return false;
   });
   if (message_ids.empty()) {
@@ -781,21 +788,21 @@ void Session::on_message_ack_impl(mtproto::MessageId container_message_id, int32
 }
 
 void Session::on_message_ack_impl_inner(mtproto::MessageId message_id, int32 type, bool in_container) {
-  auto it = sent_queries_.find(message_id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.get(message_id);
+  if (query_ptr == nullptr) {
     return;
   }
-  VLOG(net_query) << "Ack " << it->second.net_query_;
-  it->second.is_acknowledged_ = true;
+  VLOG(net_query) << "Ack " << query_ptr->net_query_;
+  query_ptr->is_acknowledged_ = true;
   {
-    auto lock = it->second.net_query_->lock();
-    it->second.net_query_->get_data_unsafe().ack_state_ |= type;
+    auto lock = query_ptr->net_query_->lock();
+    query_ptr->net_query_->get_data_unsafe().ack_state_ |= type;
   }
-  it->second.net_query_->quick_ack_promise_.set_value(Unit());
+  query_ptr->net_query_->quick_ack_promise_.set_value(Unit());
   if (!in_container) {
-    cleanup_container(message_id, &it->second);
+    cleanup_container(message_id, query_ptr);
   }
-  mark_as_known(it->first, &it->second);
+  mark_as_known(message_id, query_ptr);
 }
 
 void Session::dec_container(mtproto::MessageId container_message_id, Query *query) {
@@ -874,8 +881,8 @@ Status Session::on_message_result_ok(mtproto::MessageId message_id, BufferSlice
   TlParser parser(packet.as_slice());
   int32 response_tl_id = parser.fetch_int();
 
-  auto it = sent_queries_.find(message_id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.get(message_id);
+  if (query_ptr == nullptr) {
     LOG(DEBUG) << "Drop result to " << message_id << tag("original_size", original_size)
                << tag("response_tl", format::as_hex(response_tl_id));
 
@@ -892,7 +899,6 @@ Status Session::on_message_result_ok(mtproto::MessageId message_id, BufferSlice
   }
 
   auth_data_.on_api_response();
-  Query *query_ptr = &it->second;
   VLOG(net_query) << "Return query result " << query_ptr->net_query_;
 
   if (!parser.get_error()) {
@@ -916,7 +922,7 @@ Status Session::on_message_result_ok(mtproto::MessageId message_id, BufferSlice
   query_ptr->net_query_->set_message_id(0);
   return_query(std::move(query_ptr->net_query_));
 
-  sent_queries_.erase(it);
+  sent_queries_.erase(message_id);
   return Status::OK();
 }
 
@@ -982,13 +988,12 @@ void Session::on_message_result_error(mtproto::MessageId message_id, int error_c
                  << auth_data_.get_session_id() << " for auth key " << auth_data_.get_auth_key().id() << " with "
                  << sent_queries_.size() << " pending requests";
   }
-  auto it = sent_queries_.find(message_id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.get(message_id);
+  if (query_ptr == nullptr) {
     current_info_->connection_->force_ack();
     return;
   }
 
-  Query *query_ptr = &it->second;
   VLOG(net_query) << "Return query error " << query_ptr->net_query_;
 
   cleanup_container(message_id, query_ptr);
@@ -997,17 +1002,16 @@ void Session::on_message_result_error(mtproto::MessageId message_id, int error_c
   query_ptr->net_query_->set_message_id(0);
   return_query(std::move(query_ptr->net_query_));
 
-  sent_queries_.erase(it);
+  sent_queries_.erase(message_id);
 }
 
 void Session::on_message_failed_inner(mtproto::MessageId message_id, bool in_container) {
   LOG(INFO) << "Message inner failed for " << message_id;
-  auto it = sent_queries_.find(message_id);
-  if (it == sent_queries_.end()) {
+  auto query_ptr = sent_queries_.get(message_id);
+  if (query_ptr == nullptr) {
     return;
   }
 
-  Query *query_ptr = &it->second;
   if (!in_container) {
     cleanup_container(message_id, query_ptr);
   }
@@ -1015,7 +1019,7 @@ void Session::on_message_failed_inner(mtproto::MessageId message_id, bool in_con
 
   query_ptr->net_query_->debug_send_failed();
   resend_query(std::move(query_ptr->net_query_));
-  sent_queries_.erase(it);
+  sent_queries_.erase(message_id);
 }
 
 void Session::on_message_failed(mtproto::MessageId message_id, Status status) {
@@ -1038,15 +1042,15 @@ void Session::on_message_failed(mtproto::MessageId message_id, Status status) {
 
 void Session::on_message_info(mtproto::MessageId message_id, int32 state, mtproto::MessageId answer_message_id,
                               int32 answer_size, int32 source) {
-  auto it = sent_queries_.find(message_id);
-  if (it != sent_queries_.end()) {
-    if (it->second.net_query_->update_is_ready()) {
-      dec_container(it->first, &it->second);
-      mark_as_known(it->first, &it->second);
+  auto query_ptr = sent_queries_.get(message_id);
+  if (query_ptr != nullptr) {
+    if (query_ptr->net_query_->update_is_ready()) {
+      dec_container(message_id, query_ptr);
+      mark_as_known(message_id, query_ptr);
 
-      auto query = std::move(it->second.net_query_);
+      auto query = std::move(query_ptr->net_query_);
       query->set_message_id(0);
-      sent_queries_.erase(it);
+      sent_queries_.erase(message_id);
       return_query(std::move(query));
       return;
     }
@@ -1054,7 +1058,7 @@ void Session::on_message_info(mtproto::MessageId message_id, int32 state, mtprot
   LOG(INFO) << "Receive info about " << message_id << " with state = " << state << " and answer " << answer_message_id
             << " from " << source;
   if (message_id != mtproto::MessageId()) {
-    if (it == sent_queries_.end()) {
+    if (query_ptr == nullptr) {
       return;
     }
     switch (state & 7) {
@@ -1082,10 +1086,11 @@ void Session::on_message_info(mtproto::MessageId message_id, int32 state, mtprot
 
   // ok, we are waiting for result of message_id. let's ask to resend it
   if (answer_message_id != mtproto::MessageId()) {
-    if (it != sent_queries_.end()) {
+    query_ptr = sent_queries_.get(message_id);
+    if (query_ptr != nullptr) {
       VLOG_IF(net_query, message_id != mtproto::MessageId())
-          << "Resend answer " << answer_message_id << ": " << tag("answer_size", answer_size) << it->second.net_query_;
-      it->second.net_query_->debug(PSTRING() << get_name() << ": resend answer");
+          << "Resend answer " << answer_message_id << ": " << tag("answer_size", answer_size) << query_ptr->net_query_;
+      query_ptr->net_query_->debug(PSTRING() << get_name() << ": resend answer");
     }
     current_info_->connection_->resend_answer(answer_message_id);
   }
@@ -1178,7 +1183,7 @@ void Session::connection_send_query(ConnectionInfo *info, NetQueryPtr &&net_quer
   auto status =
       sent_queries_.emplace(message_id, Query{message_id, std::move(net_query), main_connection_.connection_id_, now});
   LOG_CHECK(status.second) << message_id;
-  sent_queries_list_.put(status.first->second.get_list_node());
+  sent_queries_list_.put(status.first->get_list_node());
   if (!status.second) {
     LOG(FATAL) << "Duplicate " << message_id;
   }
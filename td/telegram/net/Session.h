@@ -26,14 +26,13 @@
 #include "td/utils/FlatHashSet.h"
 #include "td/utils/List.h"
 #include "td/utils/Promise.h"
+#include "td/utils/SlidingWindowMap.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/VectorQueue.h"
 
 #include <array>
 #include <deque>
-#include <functional>
-#include <map>
 #include <memory>
 #include <utility>
 
@@ -136,18 +135,20 @@ class Session final
   FlatHashSet<mtproto::MessageId, mtproto::MessageIdHash> unknown_queries_;
   vector<mtproto::MessageId> to_cancel_message_ids_;
 
-  // Do not invalidate iterators of these two containers!
-  // TODO: better data structures
   struct PriorityQueue {
     void push(NetQueryPtr query);
     NetQueryPtr pop();
     bool empty() const;
 
    private:
-    std::map<int8, VectorQueue<NetQueryPtr>, std::greater<>> queries_;
+    // there are only a few different priorities, so queues are never deleted and are kept sorted by priority
+    vector<std::pair<int8, VectorQueue<NetQueryPtr>>> queries_;
+    size_t size_ = 0;
   };
   PriorityQueue pending_queries_;
-  std::map<mtproto::MessageId, Query> sent_queries_;
+  // message identifiers are increasing, so queries are stored sorted by them in a ring buffer
+  // pointers to queries are invalidated by any change of the container
+  SlidingWindowMap<mtproto::MessageId, Query> sent_queries_;
   std::deque<NetQueryPtr> pending_invoke_after_queries_;
   ListNode sent_queries_list_;
 
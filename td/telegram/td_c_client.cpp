@@ -25,8 +25,7 @@ void TdCClientSend(int client_id, struct TdRequest request) {
   TdDestroyObjectFunction(request.function);
 }
 
-TdResponse TdCClientReceive(double timeout) {
-  auto response = GetClientManager()->receive(timeout);
+static TdResponse TdConvertResponse(td::ClientManager::Response response) {
   TdResponse c_response;
   c_response.client_id = response.client_id;
   c_response.request_id = response.request_id;
@@ -34,6 +33,22 @@ TdResponse TdCClientReceive(double timeout) {
   return c_response;
 }
 
+TdResponse TdCClientReceive(double timeout) {
+  return TdConvertResponse(GetClientManager()->receive(timeout));
+}
+
+int TdCClientSetReceiveShardCount(int shard_count) {
+  return GetClientManager()->set_receive_shard_count(shard_count) ? 1 : 0;
+}
+
+int TdCClientGetReceiveShard(int client_id) {
+  return GetClientManager()->get_receive_shard(client_id);
+}
+
+TdResponse TdCClientReceiveShard(int shard, double timeout) {
+  return TdConvertResponse(GetClientManager()->receive(shard, timeout));
+}
+
 TdObject *TdCClientExecute(TdFunction *function) {
   auto result = td::ClientManager::execute(TdConvertToInternal(function));
   TdDestroyObjectFunction(function);
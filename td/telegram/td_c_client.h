@@ -34,6 +34,12 @@ void TdCClientSend(int client_id, struct TdRequest request);
 
 struct TdResponse TdCClientReceive(double timeout);
 
+int TdCClientSetReceiveShardCount(int shard_count);
+
+int TdCClientGetReceiveShard(int client_id);
+
+struct TdResponse TdCClientReceiveShard(int shard, double timeout);
+
 struct TdObject *TdCClientExecute(struct TdFunction *function);
 
 #ifdef __cplusplus
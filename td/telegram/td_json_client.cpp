@@ -43,6 +43,18 @@ const char *td_receive(double timeout) {
   return td::json_receive(timeout);
 }
 
+int td_set_receive_shard_count(int shard_count) {
+  return td::json_set_receive_shard_count(shard_count) ? 1 : 0;
+}
+
+int td_get_receive_shard(int client_id) {
+  return td::json_get_receive_shard(client_id);
+}
+
+const char *td_receive_shard(int shard, double timeout) {
+  return td::json_receive_shard(shard, timeout);
+}
+
 const char *td_execute(const char *request) {
   return td::json_execute(td::Slice(request == nullptr ? "" : request));
 }
@@ -70,12 +70,40 @@ TDJSON_EXPORT void td_send(int client_id, const char *request);
 
 /**
  * Receives incoming updates and request responses. Must not be called simultaneously from two different threads.
+ * If td_set_receive_shard_count was used, then only updates and request responses of the shard 0 are received.
  * The returned pointer can be used until the next call to td_receive or td_execute, after which it will be deallocated by TDLib.
  * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
  * \return JSON-serialized null-terminated incoming update or request response. May be NULL if the timeout expires.
  */
 TDJSON_EXPORT const char *td_receive(double timeout);
 
+/**
+ * Enables receiving of incoming updates and request responses from several threads at once. Updates and responses
+ * for a TDLib instance are received only through the shard td_get_receive_shard(client_id) in the order they were sent.
+ * Must be called before the first TDLib instance is created, and must not be called simultaneously with other functions.
+ * \param[in] shard_count The number of receive shards; 1-256.
+ * \return 1 on success, or 0 if the number of shards can't be changed anymore.
+ */
+TDJSON_EXPORT int td_set_receive_shard_count(int shard_count);
+
+/**
+ * Returns the receive shard through which updates and request responses for the TDLib instance are received.
+ * \param[in] client_id TDLib client identifier.
+ * \return Receive shard identifier between 0 and shard_count - 1.
+ */
+TDJSON_EXPORT int td_get_receive_shard(int client_id);
+
+/**
+ * Receives incoming updates and request responses for TDLib instances of the given receive shard.
+ * Must not be called simultaneously from two different threads for the same shard.
+ * The returned pointer can be used until the next call to td_receive_shard, td_receive or td_execute in the same thread,
+ * after which it will be deallocated by TDLib.
+ * \param[in] shard Receive shard identifier.
+ * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+ * \return JSON-serialized null-terminated incoming update or request response. May be NULL if the timeout expires.
+ */
+TDJSON_EXPORT const char *td_receive_shard(int shard, double timeout);
+
 /**
  * Synchronously executes a TDLib request.
  * A request can be executed synchronously, only if it is documented with "Can be called synchronously".
@@ -11,64 +11,41 @@
 namespace td {
 
 bool MultiTimeout::has_timeout(int64 key) const {
-  return items_.count(Item(key)) > 0;
+  return timer_wheel_.has_timeout(key);
 }
 
 void MultiTimeout::set_timeout_at(int64 key, double timeout) {
   LOG(DEBUG) << "Set " << get_name() << " for " << key << " in " << timeout - Time::now();
-  auto item = items_.emplace(key);
-  auto heap_node = static_cast<HeapNode *>(const_cast<Item *>(&*item.first));
-  if (heap_node->in_heap()) {
-    CHECK(!item.second);
-    bool need_update_timeout = heap_node->is_top();
-    timeout_queue_.fix(timeout, heap_node);
-    if (need_update_timeout || heap_node->is_top()) {
-      update_timeout("set_timeout");
-    }
-  } else {
-    CHECK(item.second);
-    timeout_queue_.insert(timeout, heap_node);
-    if (heap_node->is_top()) {
-      update_timeout("set_timeout 2");
-    }
-  }
+  prepare_timer_wheel();
+  timer_wheel_.set_timeout(key, timeout);
+  update_timeout("set_timeout");
 }
 
 void MultiTimeout::add_timeout_at(int64 key, double timeout) {
   LOG(DEBUG) << "Add " << get_name() << " for " << key << " in " << timeout - Time::now();
-  auto item = items_.emplace(key);
-  auto heap_node = static_cast<HeapNode *>(const_cast<Item *>(&*item.first));
-  if (heap_node->in_heap()) {
-    CHECK(!item.second);
-  } else {
-    CHECK(item.second);
-    timeout_queue_.insert(timeout, heap_node);
-    if (heap_node->is_top()) {
-      update_timeout("add_timeout");
-    }
+  prepare_timer_wheel();
+  if (timer_wheel_.add_timeout(key, timeout)) {
+    update_timeout("add_timeout");
   }
 }
 
 void MultiTimeout::cancel_timeout(int64 key, const char *source) {
   LOG(DEBUG) << "Cancel " << get_name() << " for " << key;
-  auto item = items_.find(Item(key));
-  if (item != items_.end()) {
-    auto heap_node = static_cast<HeapNode *>(const_cast<Item *>(&*item));
-    CHECK(heap_node->in_heap());
-    bool need_update_timeout = heap_node->is_top();
-    timeout_queue_.erase(heap_node);
-    items_.erase(item);
+  if (timer_wheel_.cancel_timeout(key)) {
+    update_timeout(source);
+  }
+}
 
-    if (need_update_timeout) {
-      update_timeout(source);
-    }
+void MultiTimeout::prepare_timer_wheel() {
+  if (timer_wheel_.empty()) {
+    // advance time of the empty wheel, so that new timeouts are stored at the lowest levels
+    timer_wheel_.get_expired_keys(Time::now_cached());
   }
 }
 
 void MultiTimeout::update_timeout(const char *source) {
-  if (items_.empty()) {
+  if (timer_wheel_.empty()) {
     LOG(DEBUG) << "Cancel timeout of " << get_name();
-    LOG_CHECK(timeout_queue_.empty()) << get_name() << ' ' << source;
     if (!Actor::has_timeout()) {
       bool has_pending_timeout = false;
       for (auto &event : get_info()->mailbox_) {
@@ -81,24 +58,19 @@ void MultiTimeout::update_timeout(const char *source) {
       Actor::cancel_timeout();
     }
   } else {
-    LOG(DEBUG) << "Set timeout of " << get_name() << " in " << timeout_queue_.top_key() - Time::now_cached();
-    Actor::set_timeout_at(timeout_queue_.top_key());
-  }
-}
-
-vector<int64> MultiTimeout::get_expired_keys(double now) {
-  vector<int64> expired_keys;
-  while (!timeout_queue_.empty() && timeout_queue_.top_key() < now) {
-    int64 key = static_cast<Item *>(timeout_queue_.pop())->key;
-    items_.erase(Item(key));
-    expired_keys.push_back(key);
+    // the wakeup time changes only when the earliest non-empty slot changes
+    auto wakeup_time = timer_wheel_.get_wakeup_time();
+    if (wakeup_time != actor_timeout_at_ || !Actor::has_timeout()) {
+      LOG(DEBUG) << "Set timeout of " << get_name() << " in " << wakeup_time - Time::now_cached();
+      actor_timeout_at_ = wakeup_time;
+      Actor::set_timeout_at(wakeup_time);
+    }
   }
-  return expired_keys;
 }
 
 void MultiTimeout::timeout_expired() {
-  vector<int64> expired_keys = get_expired_keys(Time::now_cached());
-  if (!items_.empty()) {
+  vector<int64> expired_keys = timer_wheel_.get_expired_keys(Time::now_cached());
+  if (!timer_wheel_.empty()) {
     update_timeout("timeout_expired");
   }
   for (auto key : expired_keys) {
@@ -107,7 +79,7 @@ void MultiTimeout::timeout_expired() {
 }
 
 void MultiTimeout::run_all() {
-  vector<int64> expired_keys = get_expired_keys(Time::now_cached() + 1e10);
+  vector<int64> expired_keys = timer_wheel_.pop_all_keys();
   if (!expired_keys.empty()) {
     update_timeout("run_all");
   }
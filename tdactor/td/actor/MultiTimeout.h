@@ -9,27 +9,13 @@
 #include "td/actor/actor.h"
 
 #include "td/utils/common.h"
-#include "td/utils/Heap.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Time.h"
-
-#include <set>
+#include "td/utils/TimerWheel.h"
 
 namespace td {
 
-// TODO optimize
 class MultiTimeout final : public Actor {
-  struct Item final : public HeapNode {
-    int64 key;
-
-    explicit Item(int64 key) : key(key) {
-    }
-
-    bool operator<(const Item &other) const {
-      return key < other.key;
-    }
-  };
-
  public:
   using Data = void *;
   using Callback = void (*)(Data, int64);
@@ -68,14 +54,14 @@ class MultiTimeout final : public Actor {
   Callback callback_;
   Data data_;
 
-  KHeap<double> timeout_queue_;
-  std::set<Item> items_;
+  TimerWheel timer_wheel_;
+  double actor_timeout_at_ = 0.0;
 
   void update_timeout(const char *source);
 
   void timeout_expired() final;
 
-  vector<int64> get_expired_keys(double now);
+  void prepare_timer_wheel();
 };
 
 }  // namespace td
@@ -198,12 +198,12 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
     binlog_->add_raw_event(BinlogDebugInfo{__FILE__, __LINE__}, seq_no, std::move(event));
   }
 
-  bool isset(const string &key) final {
+  bool isset(Slice key) final {
     auto lock = rw_mutex_.lock_read().move_as_ok();
     return map_.count(key) > 0;
   }
 
-  string get(const string &key) final {
+  string get(Slice key) final {
     auto lock = rw_mutex_.lock_read().move_as_ok();
     auto it = map_.find(key);
     if (it == map_.end()) {
@@ -276,7 +276,7 @@ class BinlogKeyValue final : public KeyValueSyncInterface {
   }
 
  private:
-  FlatHashMap<string, std::pair<string, uint64>> map_;
+  FlatHashMap<string, std::pair<string, uint64>, SliceHash, SliceEq> map_;
   std::shared_ptr<BinlogT> binlog_;
   RwMutex rw_mutex_;
   int32 magic_ = MAGIC;
@@ -0,0 +1,58 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/BlobDictionaryDb.h"
+
+#include "td/db/SqliteStatement.h"
+
+#include "td/utils/logging.h"
+
+namespace td {
+
+Status init_blob_dictionary_db(SqliteDb &db) {
+  return db.exec(
+      "CREATE TABLE IF NOT EXISTS blob_dictionaries (dictionary_id INT4 PRIMARY KEY, date INT4, dictionary BLOB)");
+}
+
+Result<int32> get_blob_dictionary_date(SqliteDb &db) {
+  TRY_RESULT(stmt, db.get_statement("SELECT date FROM blob_dictionaries ORDER BY dictionary_id DESC LIMIT 1"));
+  TRY_STATUS(stmt.step());
+  if (!stmt.has_row()) {
+    return 0;
+  }
+  return stmt.view_int32(0);
+}
+
+Status add_blob_dictionary(SqliteDb &db, int32 date, Slice dictionary) {
+  TRY_RESULT(stmt, db.get_statement("INSERT INTO blob_dictionaries SELECT COALESCE(MAX(dictionary_id), 0) + 1, ?1, ?2 "
+                                    "FROM blob_dictionaries"));
+  TRY_STATUS(stmt.bind_int32(1, date));
+  TRY_STATUS(stmt.bind_blob(2, dictionary));
+  return stmt.step();
+}
+
+Result<BlobCompressor> load_blob_compressor(SqliteDb &db) {
+  BlobCompressor compressor;
+  TRY_RESULT(has_table, db.has_table("blob_dictionaries"));
+  if (!has_table) {
+    return std::move(compressor);
+  }
+
+  TRY_RESULT(stmt, db.get_statement("SELECT dictionary_id, dictionary FROM blob_dictionaries"));
+  TRY_STATUS(stmt.step());
+  while (stmt.has_row()) {
+    auto dictionary_id = stmt.view_int32(0);
+    if (dictionary_id > 0) {
+      compressor.add_dictionary(dictionary_id, stmt.view_blob(1).str());
+    } else {
+      LOG(ERROR) << "Skip compression dictionary " << dictionary_id;
+    }
+    TRY_STATUS(stmt.step());
+  }
+  return std::move(compressor);
+}
+
+}  // namespace td
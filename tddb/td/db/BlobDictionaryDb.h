@@ -0,0 +1,32 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/db/SqliteDb.h"
+
+#include "td/utils/BlobCompressor.h"
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+// compression dictionaries are stored in the table blob_dictionaries and are never changed or deleted,
+// because there can be blobs compressed with any of them
+
+// NB: must happen inside a transaction
+Status init_blob_dictionary_db(SqliteDb &db) TD_WARN_UNUSED_RESULT;
+
+// returns the creation date of the newest dictionary or 0 if there are no dictionaries
+Result<int32> get_blob_dictionary_date(SqliteDb &db);
+
+Status add_blob_dictionary(SqliteDb &db, int32 date, Slice dictionary) TD_WARN_UNUSED_RESULT;
+
+// returns a compressor with all dictionaries from the database
+Result<BlobCompressor> load_blob_compressor(SqliteDb &db);
+
+}  // namespace td
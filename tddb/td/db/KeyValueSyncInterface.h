@@ -32,9 +32,9 @@ class KeyValueSyncInterface {
 
   virtual SeqNo set(string key, string value) = 0;
 
-  virtual bool isset(const string &key) = 0;
+  virtual bool isset(Slice key) = 0;
 
-  virtual string get(const string &key) = 0;
+  virtual string get(Slice key) = 0;
 
   virtual void for_each(std::function<void(Slice, Slice)> func) = 0;
 
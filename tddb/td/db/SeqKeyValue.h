@@ -34,7 +34,7 @@ class SeqKeyValue {
     return next_seq_no();
   }
 
-  SeqNo erase(const string &key) {
+  SeqNo erase(Slice key) {
     auto it = map_.find(key);
     if (it == map_.end()) {
       return 0;
@@ -64,7 +64,7 @@ class SeqKeyValue {
     return current_id_ + 1;
   }
 
-  string get(const string &key) const {
+  string get(Slice key) const {
     auto it = map_.find(key);
     if (it == map_.end()) {
       return string();
@@ -72,7 +72,7 @@ class SeqKeyValue {
     return it->second;
   }
 
-  bool isset(const string &key) const {
+  bool isset(Slice key) const {
     auto it = map_.find(key);
     if (it == map_.end()) {
       return false;
@@ -94,7 +94,7 @@ class SeqKeyValue {
   }
 
  private:
-  FlatHashMap<string, string> map_;
+  FlatHashMap<string, string, SliceHash, SliceEq> map_;
   SeqNo current_id_ = 0;
 
   SeqNo next_seq_no() {
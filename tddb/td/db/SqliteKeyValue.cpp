@@ -6,13 +6,18 @@
 //
 #include "td/db/SqliteKeyValue.h"
 
+#include "td/db/BlobDictionaryDb.h"
+
 #include "td/utils/base64.h"
+#include "td/utils/buffer.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
 
 namespace td {
 
-Status SqliteKeyValue::init_with_connection(SqliteDb connection, string table_name) {
+Status SqliteKeyValue::init_with_connection(SqliteDb connection, string table_name,
+                                            vector<string> compressed_key_prefixes) {
   auto init_guard = ScopeExit() + [&] {
     close();
   };
@@ -36,6 +41,11 @@ Status SqliteKeyValue::init_with_connection(SqliteDb connection, string table_na
   TRY_RESULT_ASSIGN(get_by_prefix_rare_stmt_,
                     db_.get_statement(PSLICE() << "SELECT k, v FROM " << table_name_ << " WHERE ?1 <= k"));
 
+  compressed_key_prefixes_ = std::move(compressed_key_prefixes);
+  if (!compressed_key_prefixes_.empty()) {
+    TRY_RESULT_ASSIGN(blob_compressor_, load_blob_compressor(db_));
+  }
+
   init_guard.dismiss();
   return Status::OK();
 }
@@ -51,6 +61,11 @@ Status SqliteKeyValue::drop() {
 }
 
 void SqliteKeyValue::set(Slice key, Slice value) {
+  BufferSlice compressed_value;
+  if (is_compressed_key(key)) {
+    compressed_value = blob_compressor_.compress(BufferSlice(value));
+    value = compressed_value.as_slice();
+  }
   set_stmt_.bind_blob(1, key).ensure();
   set_stmt_.bind_blob(2, value).ensure();
   auto status = set_stmt_.step();
@@ -77,7 +92,7 @@ string SqliteKeyValue::get(Slice key) {
   if (!get_stmt_.has_row()) {
     return string();
   }
-  auto data = get_stmt_.view_blob(0).str();
+  auto data = is_compressed_key(key) ? decompress_value(key, get_stmt_.view_blob(0)) : get_stmt_.view_blob(0).str();
   get_stmt_.step().ignore();
   return data;
 }
@@ -112,6 +127,25 @@ void SqliteKeyValue::erase_by_prefix(Slice prefix) {
   }
 }
 
+bool SqliteKeyValue::is_compressed_key(Slice key) const {
+  for (auto &prefix : compressed_key_prefixes_) {
+    if (key.size() > prefix.size() && begins_with(key, prefix) && is_digit(key[prefix.size()])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+string SqliteKeyValue::decompress_value(Slice key, Slice value) {
+  auto r_value = blob_compressor_.decompress(value);
+  if (r_value.is_error()) {
+    // the value is treated as missing and will be fetched again
+    LOG(ERROR) << "Failed to decompress value of \"" << base64_encode(key) << "\": " << r_value.error();
+    return string();
+  }
+  return r_value.ok().as_slice().str();
+}
+
 string SqliteKeyValue::next_prefix(Slice prefix) {
   string next = prefix.str();
   size_t pos = next.size();
@@ -9,6 +9,7 @@
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteStatement.h"
 
+#include "td/utils/BlobCompressor.h"
 #include "td/utils/common.h"
 #include "td/utils/FlatHashMap.h"
 #include "td/utils/Slice.h"
@@ -31,7 +32,10 @@ class SqliteKeyValue {
     return db_.empty();
   }
 
-  Status init_with_connection(SqliteDb connection, string table_name) TD_WARN_UNUSED_RESULT;
+  // values of keys, consisting of one of the compressed key prefixes and a number, must be TL-serialized
+  // and are compressed with dictionaries from the table blob_dictionaries
+  Status init_with_connection(SqliteDb connection, string table_name,
+                              vector<string> compressed_key_prefixes = {}) TD_WARN_UNUSED_RESULT;
 
   void close() {
     *this = SqliteKeyValue();
@@ -107,10 +111,16 @@ class SqliteKeyValue {
     stmt->step().ensure();
     while (stmt->has_row()) {
       auto key = stmt->view_blob(0);
+      auto value = stmt->view_blob(1);
+      string decompressed_value;
+      if (is_compressed_key(key)) {
+        decompressed_value = decompress_value(key, value);
+        value = decompressed_value;
+      }
       if (strip_key_prefix) {
         key.remove_prefix(from.size());
       }
-      if (!callback(key, stmt->view_blob(1))) {
+      if (!callback(key, value)) {
         return;
       }
       stmt->step().ensure();
@@ -128,6 +138,13 @@ class SqliteKeyValue {
   SqliteStatement get_by_prefix_stmt_;
   SqliteStatement get_by_prefix_rare_stmt_;
 
+  vector<string> compressed_key_prefixes_;
+  BlobCompressor blob_compressor_;
+
+  bool is_compressed_key(Slice key) const;
+
+  string decompress_value(Slice key, Slice value);
+
   static string next_prefix(Slice prefix);
 };
 
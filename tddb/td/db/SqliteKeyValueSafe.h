@@ -19,10 +19,12 @@ namespace td {
 
 class SqliteKeyValueSafe {
  public:
-  SqliteKeyValueSafe(string name, std::shared_ptr<SqliteConnectionSafe> safe_connection)
-      : lsls_kv_([name = std::move(name), safe_connection = std::move(safe_connection)] {
+  SqliteKeyValueSafe(string name, std::shared_ptr<SqliteConnectionSafe> safe_connection,
+                     vector<string> compressed_key_prefixes = {})
+      : lsls_kv_([name = std::move(name), safe_connection = std::move(safe_connection),
+                  compressed_key_prefixes = std::move(compressed_key_prefixes)] {
         SqliteKeyValue kv;
-        kv.init_with_connection(safe_connection->get().clone(), name).ensure();
+        kv.init_with_connection(safe_connection->get().clone(), name, compressed_key_prefixes).ensure();
         return kv;
       }) {
   }
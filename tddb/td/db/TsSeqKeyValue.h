@@ -55,12 +55,12 @@ class TsSeqKeyValue {
     return std::make_pair(kv_.erase(key), std::move(lock));
   }
 
-  string get(const string &key) const {
+  string get(Slice key) const {
     auto lock = rw_mutex_.lock_read().move_as_ok();
     return kv_.get(key);
   }
 
-  bool isset(const string &key) const {
+  bool isset(Slice key) const {
     auto lock = rw_mutex_.lock_read().move_as_ok();
     return kv_.isset(key);
   }
@@ -18,6 +18,7 @@
 #include "td/utils/port/PollFlags.h"
 #include "td/utils/port/sleep.h"
 #include "td/utils/port/Stat.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
@@ -141,7 +142,7 @@ class BinlogReader {
     event->debug_info_ = BinlogDebugInfo{__FILE__, __LINE__};
     auto buffer_slice = input_->cut_head(size_).move_as_buffer_slice();
     event->init(buffer_slice.as_slice().str());
-    TRY_STATUS(event->validate());
+    // the event isn't validated here; CRC of loaded events is checked in batches by validate_binlog_events
     offset_ += size_;
     event->offset_ = offset_;
     state_ = State::ReadLength;
@@ -158,6 +159,73 @@ class BinlogReader {
   bool is_encrypted_{false};
 };
 
+static size_t get_binlog_validation_thread_count(size_t events_size) {
+#if TD_THREAD_UNSUPPORTED
+  return 1;
+#else
+  constexpr size_t MIN_THREAD_EVENTS_SIZE = 1 << 18;
+  auto max_thread_count = static_cast<size_t>(clamp(thread::hardware_concurrency(), 1u, 8u));
+  return clamp(events_size / MIN_THREAD_EVENTS_SIZE, static_cast<size_t>(1), max_thread_count);
+#endif
+}
+
+// checks CRC of the events in parallel; returns the first error and the number of valid events before it
+static Status validate_binlog_events(const vector<BinlogEvent> &events, size_t events_size, size_t thread_count,
+                                     size_t &valid_event_count) {
+  // split the events into parts of approximately equal total size
+  vector<size_t> part_begins{0};
+  size_t prefix_size = 0;
+  for (size_t i = 0; i + 1 < events.size() && part_begins.size() < thread_count; i++) {
+    prefix_size += events[i].raw_event_.size();
+    if (prefix_size * thread_count >= events_size * part_begins.size()) {
+      part_begins.push_back(i + 1);
+    }
+  }
+  part_begins.push_back(events.size());
+
+  auto part_count = part_begins.size() - 1;
+  vector<size_t> part_valid_ends(part_count);
+  vector<Status> part_errors(part_count);
+  auto validate_part = [&](size_t part) {
+    auto end = part_begins[part + 1];
+    for (auto i = part_begins[part]; i < end; i++) {
+      auto status = events[i].validate();
+      if (status.is_error()) {
+        part_valid_ends[part] = i;
+        part_errors[part] = std::move(status);
+        return;
+      }
+    }
+    part_valid_ends[part] = end;
+  };
+
+#if TD_THREAD_UNSUPPORTED
+  for (size_t part = 0; part < part_count; part++) {
+    validate_part(part);
+  }
+#else
+  vector<thread> threads;
+  for (size_t part = 1; part < part_count; part++) {
+    threads.emplace_back(validate_part, part);
+  }
+  if (part_count > 0) {
+    validate_part(0);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+#endif
+
+  for (size_t part = 0; part < part_count; part++) {
+    if (part_errors[part].is_error()) {
+      valid_event_count = part_valid_ends[part];
+      return std::move(part_errors[part]);
+    }
+  }
+  valid_event_count = events.size();
+  return Status::OK();
+}
+
 static int64 file_size(CSlice path) {
   auto r_stat = stat(path);
   if (r_stat.is_error()) {
@@ -514,10 +582,54 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
 
   fd_.get_poll_info().add_flags(PollFlags::Read());
   info_.wrong_password = false;
+
+  auto start_time = Time::now();
+  double validate_time = 0.0;
+  double process_time = 0.0;
+  size_t max_thread_count = 1;
+  uint64 loaded_events = 0;
+
+  // events are validated in batches, which end before service events, because they can change read encryption
+  constexpr size_t MAX_BATCH_SIZE = 1 << 22;
+  vector<BinlogEvent> batch_events;
+  size_t batch_size = 0;
+  auto flush_batch = [&] {
+    if (batch_events.empty()) {
+      return true;
+    }
+    auto validate_start_time = Time::now();
+    auto thread_count = detail::get_binlog_validation_thread_count(batch_size);
+    max_thread_count = max(max_thread_count, thread_count);
+    size_t valid_event_count = 0;
+    auto status = detail::validate_binlog_events(batch_events, batch_size, thread_count, valid_event_count);
+    auto process_start_time = Time::now();
+    validate_time += process_start_time - validate_start_time;
+
+    for (size_t i = 0; i < valid_event_count; i++) {
+      if (debug_callback) {
+        debug_callback(batch_events[i]);
+      }
+      do_add_event(std::move(batch_events[i]));
+    }
+    loaded_events += valid_event_count;
+    batch_events.clear();
+    batch_size = 0;
+    process_time += Time::now() - process_start_time;
+
+    if (status.is_error()) {
+      LOG(ERROR) << status;
+      return false;
+    }
+    return true;
+  };
+
   while (true) {
     BinlogEvent event;
     auto r_need_size = reader.read_next(&event);
     if (r_need_size.is_error()) {
+      if (!flush_batch()) {
+        break;
+      }
       if (r_need_size.error().code() == -2) {
         auto old_size = detail::file_size(path_);
         auto offset = reader.offset();
@@ -536,15 +648,20 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
     auto need_size = r_need_size.move_as_ok();
     // LOG(ERROR) << "Need size = " << need_size;
     if (need_size == 0) {
-      if (debug_callback) {
-        debug_callback(event);
+      bool is_service_event = event.type_ < 0;
+      if (is_service_event && !flush_batch()) {
+        break;
+      }
+      batch_size += event.raw_event_.size();
+      batch_events.push_back(std::move(event));
+      if ((is_service_event || batch_size >= MAX_BATCH_SIZE) && !flush_batch()) {
+        break;
       }
-      do_add_event(std::move(event));
       if (info_.wrong_password) {
         return Status::OK();
       }
     } else {
-      TRY_STATUS(fd_.flush_read(max(need_size, static_cast<size_t>(4096))));
+      TRY_STATUS(fd_.flush_read(max(need_size, static_cast<size_t>(1 << 16))));
       buffer_reader_.sync_with_writer();
       if (byte_flow_flag_) {
         byte_flow_source_.wakeup();
@@ -554,15 +671,26 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
       }
     }
   }
+  flush_batch();
 
   auto offset = processor_->offset();
   CHECK(offset >= 0);
+  auto replay_start_time = Time::now();
+  // reading includes decryption and splitting of the file into events
+  auto read_time = replay_start_time - start_time - validate_time - process_time;
   processor_->for_each([&](BinlogEvent &event) {
     VLOG(binlog) << "Replay binlog event: " << event.public_to_string();
     if (callback) {
       callback(event);
     }
   });
+  auto finish_time = Time::now();
+
+  LOG(INFO) << "Load binlog " << tag("name", path_) << tag("size", format::as_size(offset))
+            << tag("events", loaded_events) << tag("time", format::as_time(finish_time - start_time))
+            << tag("read", format::as_time(read_time)) << tag("validate", format::as_time(validate_time))
+            << tag("threads", max_thread_count) << tag("process", format::as_time(process_time))
+            << tag("replay", format::as_time(finish_time - replay_start_time));
 
   TRY_RESULT(fd_size, fd_.get_size());
   if (offset != fd_size) {
@@ -66,6 +66,80 @@ void HttpConnectionBase::write_next(BufferSlice buffer) {
   loop();
 }
 
+void HttpConnectionBase::write_next_file(FileFd file, int64 offset, int64 size) {
+  CHECK(state_ == State::Write);
+  CHECK(write_file_.empty());
+  CHECK(offset >= 0 && size >= 0);
+  if (size == 0) {
+    return;
+  }
+  write_file_ = std::move(file);
+  write_file_offset_ = offset;
+  write_file_size_ = size;
+  loop();
+}
+
+Status HttpConnectionBase::flush_write_file() {
+  while (!write_file_.empty()) {
+    if (write_file_size_ == 0) {
+      write_file_.close();
+      // the next query could have been delayed until the whole file is sent
+      yield();
+      break;
+    }
+
+    if (use_send_file_ && !ssl_stream_) {
+      // everything written before the file must be sent first
+      write_buffer_reader_.sync_with_writer();
+      if (!write_buffer_reader_.empty() || fd_.need_flush_write() || !can_write_local(fd_)) {
+        break;
+      }
+      auto size = static_cast<size_t>(min(write_file_size_, static_cast<int64>(MAX_SEND_FILE_CHUNK_SIZE)));
+      auto r_size = fd_.send_file(write_file_.get_native_fd(), write_file_offset_, size);
+      if (r_size.is_error()) {
+        if (r_size.error().code() != SocketFd::SEND_FILE_UNSUPPORTED_ERROR_CODE) {
+          return r_size.move_as_error();
+        }
+        LOG(INFO) << "Fall back to buffered file sending: " << r_size.error();
+        use_send_file_ = false;
+        continue;
+      }
+      auto sent_size = r_size.ok();
+      if (sent_size == 0) {
+        break;
+      }
+      write_file_offset_ += static_cast<int64>(sent_size);
+      write_file_size_ -= static_cast<int64>(sent_size);
+      live_event();
+      continue;
+    }
+
+    // read the next chunk only after the previous one has been sent to avoid buffering of the whole file
+    if (fd_.need_flush_write()) {
+      break;
+    }
+    auto size = static_cast<size_t>(min(write_file_size_, static_cast<int64>(MAX_READ_FILE_CHUNK_SIZE)));
+    BufferSlice chunk(size);
+    TRY_RESULT(read_size, write_file_.pread(chunk.as_mutable_slice(), write_file_offset_));
+    if (read_size == 0) {
+      return Status::Error("File was truncated while being sent");
+    }
+    chunk.truncate(read_size);
+    write_file_offset_ += static_cast<int64>(read_size);
+    write_file_size_ -= static_cast<int64>(read_size);
+    write_buffer_.append(std::move(chunk));
+    live_event();
+    write_source_.wakeup();
+    if (can_write_local(fd_)) {
+      TRY_STATUS(fd_.flush_write());
+    }
+    if (!can_write_local(fd_)) {
+      break;
+    }
+  }
+  return Status::OK();
+}
+
 void HttpConnectionBase::write_ok() {
   CHECK(state_ == State::Write);
   current_query_ = make_unique<HttpQuery>();
@@ -115,7 +189,10 @@ void HttpConnectionBase::loop() {
 
   bool want_read = false;
   bool can_be_slow = slow_scheduler_id_ == -1;
-  if (state_ == State::Read) {
+  if (state_ == State::Read && !write_file_.empty()) {
+    // the response to the previous query isn't sent yet
+    want_read = true;
+  } else if (state_ == State::Read) {
     auto res = reader_.read_next(current_query_.get(), can_be_slow);
     if (res.is_error()) {
       if (res.error().message() == "SLOW") {
@@ -159,7 +236,15 @@ void HttpConnectionBase::loop() {
       LOG(INFO) << "Receive flush_write error: " << r.error();
       on_error(Status::Error(r.error().public_message()));
     }
-    if (close_after_write_ && !fd_.need_flush_write()) {
+    if (r.is_ok() && !write_file_.empty()) {
+      auto status = flush_write_file();
+      if (status.is_error()) {
+        LOG(INFO) << "Failed to send file: " << status;
+        on_error(Status::Error(status.public_message()));
+        state_ = State::Close;
+      }
+    }
+    if (close_after_write_ && write_file_.empty() && !fd_.need_flush_write()) {
       return stop();
     }
   }
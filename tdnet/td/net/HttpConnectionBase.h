@@ -15,6 +15,8 @@
 #include "td/utils/buffer.h"
 #include "td/utils/BufferedFd.h"
 #include "td/utils/ByteFlow.h"
+#include "td/utils/common.h"
+#include "td/utils/port/FileFd.h"
 #include "td/utils/port/IPAddress.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Status.h"
@@ -27,6 +29,9 @@ class HttpConnectionBase : public Actor {
  public:
   void write_next_noflush(BufferSlice buffer);
   void write_next(BufferSlice buffer);
+  // appends size bytes of the file starting from the offset to the response;
+  // the file is sent directly from the page cache whenever possible
+  void write_next_file(FileFd file, int64 offset, int64 size);
   void write_ok();
   void write_error(Status error);
 
@@ -50,6 +55,14 @@ class HttpConnectionBase : public Actor {
   ByteFlowSource write_source_{&write_buffer_reader_};
   ByteFlowMoveSink write_sink_{&fd_.output_buffer()};
 
+  static constexpr size_t MAX_SEND_FILE_CHUNK_SIZE = 1 << 20;
+  static constexpr size_t MAX_READ_FILE_CHUNK_SIZE = 1 << 17;
+
+  FileFd write_file_;
+  int64 write_file_offset_ = 0;
+  int64 write_file_size_ = 0;
+  bool use_send_file_ = true;
+
   size_t max_post_size_;
   size_t max_files_;
   int32 idle_timeout_;
@@ -61,6 +74,8 @@ class HttpConnectionBase : public Actor {
 
   void live_event();
 
+  Status flush_write_file() TD_WARN_UNUSED_RESULT;
+
   void start_up() final;
   void tear_down() final;
   void timeout_expired() final;
@@ -8,6 +8,7 @@
 
 #include "td/utils/logging.h"
 #include "td/utils/port/detail/PollableFd.h"
+#include "td/utils/port/platform.h"
 
 namespace td {
 
@@ -61,4 +62,53 @@ void TcpListener::loop() {
   }
 }
 
+class ShardedTcpListener::Shard final : public TcpListener::Callback {
+ public:
+  Shard(int port, AcceptCallback accept_callback, string server_address)
+      : port_(port), accept_callback_(std::move(accept_callback)), server_address_(std::move(server_address)) {
+  }
+
+  void accept(SocketFd fd) final {
+    accept_callback_(std::move(fd));
+  }
+
+ private:
+  int port_;
+  AcceptCallback accept_callback_;
+  string server_address_;
+  ActorOwn<TcpListener> listener_;
+
+  void start_up() final {
+    listener_ = create_actor<TcpListener>("TcpListener", port_, actor_shared(this), server_address_);
+  }
+
+  void hangup() final {
+    stop();
+  }
+};
+
+ShardedTcpListener::ShardedTcpListener(int port, vector<int32> scheduler_ids, AcceptCallback accept_callback,
+                                       Slice server_address)
+    : port_(port)
+    , scheduler_ids_(std::move(scheduler_ids))
+    , accept_callback_(std::move(accept_callback))
+    , server_address_(server_address.str()) {
+  CHECK(!scheduler_ids_.empty());
+#if !TD_LINUX && !TD_ANDROID
+  scheduler_ids_.resize(1);
+#endif
+}
+
+void ShardedTcpListener::start_up() {
+  for (auto scheduler_id : scheduler_ids_) {
+    // every shard has its own copy of the callback
+    shards_.push_back(create_actor_on_scheduler<Shard>("TcpListenerShard", scheduler_id, port_, accept_callback_,
+                                                       server_address_));
+  }
+}
+
+void ShardedTcpListener::hangup() {
+  stop();
+}
+
 }  // namespace td
@@ -13,6 +13,8 @@
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Slice.h"
 
+#include <functional>
+
 namespace td {
 
 class TcpListener final : public Actor {
@@ -35,4 +37,29 @@ class TcpListener final : public Actor {
   void loop() final;
 };
 
+// Listens on the same port with a separate server socket on each of the given schedulers.
+// Connections are balanced between the sockets by the kernel and are accepted and handled on the scheduler
+// of the socket, so there is no need to migrate them. The kernel balances connections only on Linux,
+// so on other systems only the first scheduler is used.
+class ShardedTcpListener final : public Actor {
+ public:
+  // called on the scheduler of the shard, which accepted the connection
+  using AcceptCallback = std::function<void(SocketFd fd)>;
+
+  ShardedTcpListener(int port, vector<int32> scheduler_ids, AcceptCallback accept_callback,
+                     Slice server_address = Slice("0.0.0.0"));
+
+ private:
+  class Shard;
+
+  int port_;
+  vector<int32> scheduler_ids_;
+  AcceptCallback accept_callback_;
+  const string server_address_;
+  vector<ActorOwn<Shard>> shards_;
+
+  void start_up() final;
+  void hangup() final;
+};
+
 }  // namespace td
@@ -0,0 +1,375 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/BlobCompressor.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+#if TD_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace td {
+
+constexpr size_t BlobCompressor::MIN_COMPRESSED_SIZE;
+constexpr size_t BlobCompressor::MAX_DICTIONARY_SIZE;
+
+namespace {
+
+// uncompressed size and dictionary identifier
+constexpr size_t TRAILER_SIZE = 8;
+constexpr size_t MAX_PADDING_SIZE = 4;
+constexpr size_t MAX_UNCOMPRESSED_SIZE = 1 << 26;
+
+#if TD_HAVE_ZLIB
+// keeps the size of a block allocated for zlib and aligns the block
+constexpr size_t BLOCK_HEADER_SIZE = 16;
+#endif
+
+void store_uint32(uint32 value, char *ptr) {
+  for (int i = 0; i < 4; i++) {
+    ptr[i] = static_cast<char>(static_cast<unsigned char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+uint32 load_uint32(const char *ptr) {
+  uint32 result = 0;
+  for (int i = 0; i < 4; i++) {
+    result |= static_cast<uint32>(static_cast<unsigned char>(ptr[i])) << (8 * i);
+  }
+  return result;
+}
+
+}  // namespace
+
+class BlobCompressor::Impl {
+ public:
+#if TD_HAVE_ZLIB
+  z_stream primed_deflate_stream_;
+  z_stream deflate_stream_;
+  z_stream inflate_stream_;
+  int32 primed_dictionary_id_ = 0;
+  bool is_deflate_inited_ = false;
+  bool is_inflate_inited_ = false;
+  vector<void *> free_blocks_;
+
+  Impl() {
+    std::memset(&primed_deflate_stream_, 0, sizeof(primed_deflate_stream_));
+    std::memset(&deflate_stream_, 0, sizeof(deflate_stream_));
+    std::memset(&inflate_stream_, 0, sizeof(inflate_stream_));
+    primed_deflate_stream_.zalloc = &Impl::allocate;
+    primed_deflate_stream_.zfree = &Impl::deallocate;
+    primed_deflate_stream_.opaque = this;
+  }
+  Impl(const Impl &) = delete;
+  Impl &operator=(const Impl &) = delete;
+  Impl(Impl &&) = delete;
+  Impl &operator=(Impl &&) = delete;
+  ~Impl() {
+    if (is_deflate_inited_) {
+      deflateEnd(&deflate_stream_);
+    }
+    if (primed_dictionary_id_ != 0) {
+      deflateEnd(&primed_deflate_stream_);
+    }
+    if (is_inflate_inited_) {
+      inflateEnd(&inflate_stream_);
+    }
+    for (auto *block : free_blocks_) {
+      std::free(block);
+    }
+  }
+
+  // a copy of the deflate state is created for each blob, so its memory blocks are reused to avoid page faults
+  static voidpf allocate(voidpf opaque, uInt items, uInt size) {
+    auto *impl = static_cast<Impl *>(opaque);
+    auto block_size = static_cast<size_t>(items) * size;
+    for (auto &block : impl->free_blocks_) {
+      if (*static_cast<size_t *>(block) == block_size) {
+        auto *result = block;
+        block = impl->free_blocks_.back();
+        impl->free_blocks_.pop_back();
+        return static_cast<char *>(result) + BLOCK_HEADER_SIZE;
+      }
+    }
+    auto *result = std::malloc(block_size + BLOCK_HEADER_SIZE);
+    if (result == nullptr) {
+      return Z_NULL;
+    }
+    *static_cast<size_t *>(result) = block_size;
+    return static_cast<char *>(result) + BLOCK_HEADER_SIZE;
+  }
+
+  static void deallocate(voidpf opaque, voidpf address) {
+    static_cast<Impl *>(opaque)->free_blocks_.push_back(static_cast<char *>(address) - BLOCK_HEADER_SIZE);
+  }
+
+  // setting a dictionary is much slower than deflating a small blob, so each blob is deflated
+  // by a copy of the stream, which is primed with the dictionary once
+  bool prepare_deflate(int32 dictionary_id, Slice dictionary) {
+    if (primed_dictionary_id_ != dictionary_id) {
+      if (primed_dictionary_id_ != 0) {
+        deflateEnd(&primed_deflate_stream_);
+        primed_dictionary_id_ = 0;
+      }
+      auto ret = deflateInit2(&primed_deflate_stream_, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+      if (ret != Z_OK) {
+        LOG(ERROR) << "Failed to init zlib deflate stream: " << ret;
+        return false;
+      }
+      ret = deflateSetDictionary(&primed_deflate_stream_, reinterpret_cast<const Bytef *>(dictionary.data()),
+                                 static_cast<uInt>(dictionary.size()));
+      if (ret != Z_OK) {
+        LOG(ERROR) << "Failed to set zlib deflate dictionary: " << ret;
+        deflateEnd(&primed_deflate_stream_);
+        return false;
+      }
+      primed_dictionary_id_ = dictionary_id;
+    }
+
+    if (is_deflate_inited_) {
+      deflateEnd(&deflate_stream_);
+      is_deflate_inited_ = false;
+    }
+    auto ret = deflateCopy(&deflate_stream_, &primed_deflate_stream_);
+    if (ret != Z_OK) {
+      LOG(ERROR) << "Failed to copy zlib deflate stream: " << ret;
+      return false;
+    }
+    is_deflate_inited_ = true;
+    return true;
+  }
+
+  bool prepare_inflate(Slice dictionary) {
+    int ret;
+    if (is_inflate_inited_) {
+      ret = inflateReset(&inflate_stream_);
+    } else {
+      ret = inflateInit2(&inflate_stream_, -MAX_WBITS);
+      is_inflate_inited_ = ret == Z_OK;
+    }
+    if (ret == Z_OK) {
+      // raw inflate streams accept the dictionary before any input
+      ret = inflateSetDictionary(&inflate_stream_, reinterpret_cast<const Bytef *>(dictionary.data()),
+                                 static_cast<uInt>(dictionary.size()));
+    }
+    return ret == Z_OK;
+  }
+#endif
+};
+
+BlobCompressor::BlobCompressor() : impl_(make_unique<Impl>()) {
+}
+
+BlobCompressor::BlobCompressor(BlobCompressor &&other) noexcept = default;
+
+BlobCompressor &BlobCompressor::operator=(BlobCompressor &&other) noexcept = default;
+
+BlobCompressor::~BlobCompressor() = default;
+
+void BlobCompressor::add_dictionary(int32 dictionary_id, string dictionary) {
+  CHECK(dictionary_id > 0);
+  if (dictionary.size() > MAX_DICTIONARY_SIZE) {
+    dictionary = dictionary.substr(dictionary.size() - MAX_DICTIONARY_SIZE);
+  }
+  dictionaries_[dictionary_id] = std::move(dictionary);
+  dictionary_id_ = max(dictionary_id_, dictionary_id);
+}
+
+BufferSlice BlobCompressor::compress(BufferSlice blob) {
+  if (dictionary_id_ == 0 || blob.size() < MIN_COMPRESSED_SIZE || blob.size() % 4 != 0 ||
+      blob.size() > MAX_UNCOMPRESSED_SIZE) {
+    return blob;
+  }
+#if TD_HAVE_ZLIB
+  if (!impl_->prepare_deflate(dictionary_id_, dictionaries_[dictionary_id_])) {
+    return blob;
+  }
+
+  // compression must save at least 1/8 of the size; otherwise, the blob isn't worth decompression
+  auto max_compressed_size = blob.size() - blob.size() / 8 - TRAILER_SIZE - MAX_PADDING_SIZE;
+  BufferSlice result(max_compressed_size + TRAILER_SIZE + MAX_PADDING_SIZE);
+  auto &stream = impl_->deflate_stream_;
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(blob.as_slice().data()));
+  stream.avail_in = static_cast<uInt>(blob.size());
+  stream.next_out = reinterpret_cast<Bytef *>(result.as_mutable_slice().data());
+  stream.avail_out = static_cast<uInt>(max_compressed_size);
+  if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+    return blob;
+  }
+
+  auto size = max_compressed_size - stream.avail_out;
+  auto *ptr = result.as_mutable_slice().data();
+  store_uint32(static_cast<uint32>(blob.size()), ptr + size);
+  store_uint32(static_cast<uint32>(dictionary_id_), ptr + size + 4);
+  size += TRAILER_SIZE;
+  auto padding = (5 - size % 4) % 4;
+  if (padding == 0) {
+    padding = 4;
+  }
+  std::memset(ptr + size, static_cast<int>(padding), padding);
+  size += padding;
+  CHECK(is_compressed(Slice(ptr, size)));
+  result.truncate(size);
+  return result;
+#else
+  return blob;
+#endif
+}
+
+Result<BufferSlice> BlobCompressor::decompress(Slice blob) {
+  if (!is_compressed(blob)) {
+    return BufferSlice(blob);
+  }
+
+  auto padding = static_cast<size_t>(static_cast<unsigned char>(blob.back()));
+  if (padding == 0 || padding > MAX_PADDING_SIZE || blob.size() < padding + TRAILER_SIZE) {
+    return Status::Error("Invalid compressed blob");
+  }
+  for (size_t i = 1; i <= padding; i++) {
+    if (static_cast<size_t>(static_cast<unsigned char>(blob[blob.size() - i])) != padding) {
+      return Status::Error("Invalid compressed blob padding");
+    }
+  }
+  blob.remove_suffix(padding + TRAILER_SIZE);
+  auto *trailer = blob.end();
+  auto size = static_cast<size_t>(load_uint32(trailer));
+  auto dictionary_id = static_cast<int32>(load_uint32(trailer + 4));
+  if (size > MAX_UNCOMPRESSED_SIZE) {
+    return Status::Error("Invalid uncompressed blob size");
+  }
+  auto it = dictionaries_.find(dictionary_id);
+  if (dictionary_id <= 0 || it == dictionaries_.end()) {
+    return Status::Error(PSLICE() << "Unknown compression dictionary " << dictionary_id);
+  }
+
+#if TD_HAVE_ZLIB
+  if (!impl_->prepare_inflate(it->second)) {
+    return Status::Error("Failed to prepare zlib inflate stream");
+  }
+  BufferSlice result(size);
+  auto &stream = impl_->inflate_stream_;
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(blob.data()));
+  stream.avail_in = static_cast<uInt>(blob.size());
+  stream.next_out = reinterpret_cast<Bytef *>(result.as_mutable_slice().data());
+  stream.avail_out = static_cast<uInt>(size);
+  auto ret = inflate(&stream, Z_FINISH);
+  if (ret != Z_STREAM_END || stream.avail_out != 0 || stream.avail_in != 0) {
+    return Status::Error(PSLICE() << "Failed to decompress blob: " << ret);
+  }
+  return std::move(result);
+#else
+  return Status::Error("Compressed blobs aren't supported");
+#endif
+}
+
+string BlobCompressor::train_dictionary(const vector<Slice> &samples, size_t max_size) {
+  // a segment is scored by the number of samples containing each of its k-mers, excluding already chosen k-mers
+  constexpr size_t KMER_SIZE = 8;
+  constexpr size_t SEGMENT_SIZE = 64;
+  constexpr int HASH_BITS = 20;
+
+  max_size = min(max_size, MAX_DICTIONARY_SIZE);
+  auto get_hash = [](const char *ptr) {
+    uint64 value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return static_cast<size_t>((value * static_cast<uint64>(0x9E3779B97F4A7C15)) >> (64 - HASH_BITS));
+  };
+
+  vector<uint32> frequencies(static_cast<size_t>(1) << HASH_BITS);
+  vector<uint32> last_sample_ids(frequencies.size(), std::numeric_limits<uint32>::max());
+  size_t total_size = 0;
+  for (size_t i = 0; i < samples.size(); i++) {
+    auto sample = samples[i];
+    if (sample.size() < SEGMENT_SIZE) {
+      continue;
+    }
+    for (size_t pos = 0; pos + KMER_SIZE <= sample.size(); pos++) {
+      auto hash = get_hash(sample.data() + pos);
+      if (last_sample_ids[hash] != i) {
+        last_sample_ids[hash] = static_cast<uint32>(i);
+        frequencies[hash]++;
+      }
+    }
+    total_size += sample.size();
+  }
+  if (total_size == 0 || max_size < SEGMENT_SIZE) {
+    return string();
+  }
+
+  // k-mers, which are present in a single sample, are useless for the dictionary
+  auto get_score = [&](size_t hash) {
+    return frequencies[hash] >= 2 ? static_cast<uint64>(frequencies[hash]) : static_cast<uint64>(0);
+  };
+
+  // the samples are split into epochs of equal total size and the best segment is chosen from each epoch
+  auto segment_count = max_size / SEGMENT_SIZE;
+  auto epoch_size = max(total_size / segment_count, SEGMENT_SIZE);
+  vector<std::tuple<uint64, size_t, size_t>> segments;  // score, sample index, offset
+  std::tuple<uint64, size_t, size_t> best_segment{0, 0, 0};
+  size_t current_epoch_size = 0;
+  auto finish_epoch = [&] {
+    if (std::get<0>(best_segment) != 0) {
+      auto sample = samples[std::get<1>(best_segment)];
+      auto offset = std::get<2>(best_segment);
+      for (size_t pos = offset; pos + KMER_SIZE <= offset + SEGMENT_SIZE; pos++) {
+        frequencies[get_hash(sample.data() + pos)] = 0;
+      }
+      segments.push_back(best_segment);
+    }
+    best_segment = std::make_tuple(0, 0, 0);
+    current_epoch_size = 0;
+  };
+  for (size_t i = 0; i < samples.size() && segments.size() < segment_count; i++) {
+    auto sample = samples[i];
+    if (sample.size() < SEGMENT_SIZE) {
+      continue;
+    }
+    uint64 score = 0;
+    for (size_t pos = 0; pos + KMER_SIZE <= SEGMENT_SIZE; pos++) {
+      score += get_score(get_hash(sample.data() + pos));
+    }
+    for (size_t offset = 0;; offset++) {
+      if (score > std::get<0>(best_segment)) {
+        best_segment = std::make_tuple(score, i, offset);
+      }
+      if (offset + SEGMENT_SIZE == sample.size()) {
+        break;
+      }
+      score -= get_score(get_hash(sample.data() + offset));
+      score += get_score(get_hash(sample.data() + offset + SEGMENT_SIZE - KMER_SIZE + 1));
+    }
+    current_epoch_size += sample.size();
+    if (current_epoch_size >= epoch_size) {
+      finish_epoch();
+    }
+  }
+  if (segments.size() < segment_count) {
+    finish_epoch();
+  }
+
+  // deflate encodes shorter distances more efficiently, so the best segments go to the end
+  std::stable_sort(segments.begin(), segments.end(),
+                   [](const std::tuple<uint64, size_t, size_t> &lhs, const std::tuple<uint64, size_t, size_t> &rhs) {
+                     return std::get<0>(lhs) < std::get<0>(rhs);
+                   });
+  string result;
+  result.reserve(segments.size() * SEGMENT_SIZE);
+  for (auto &segment : segments) {
+    result.append(samples[std::get<1>(segment)].substr(std::get<2>(segment), SEGMENT_SIZE).str());
+  }
+  return result;
+}
+
+}  // namespace td
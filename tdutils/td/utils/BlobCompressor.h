@@ -0,0 +1,65 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+// compresses small TL-serialized blobs with raw deflate, using preset dictionaries
+// sizes of TL-serialized blobs are divisible by 4, while a compressed blob has size 4 * k + 1, so compressed and
+// uncompressed blobs can be stored together; a compressed blob consists of the deflate stream,
+// the uncompressed size, the dictionary identifier and 1-4 bytes of padding, each of which is equal to the padding size
+// the class isn't thread-safe
+class BlobCompressor {
+ public:
+  // smaller blobs are stored as is
+  static constexpr size_t MIN_COMPRESSED_SIZE = 128;
+
+  // the part of a dictionary, which fits into the deflate window
+  static constexpr size_t MAX_DICTIONARY_SIZE = 32000;
+
+  BlobCompressor();
+  BlobCompressor(const BlobCompressor &) = delete;
+  BlobCompressor &operator=(const BlobCompressor &) = delete;
+  BlobCompressor(BlobCompressor &&other) noexcept;
+  BlobCompressor &operator=(BlobCompressor &&other) noexcept;
+  ~BlobCompressor();
+
+  // dictionary identifiers must be positive; new blobs are compressed with the dictionary with the largest identifier
+  void add_dictionary(int32 dictionary_id, string dictionary);
+
+  int32 get_dictionary_id() const {
+    return dictionary_id_;
+  }
+
+  static bool is_compressed(Slice blob) {
+    return blob.size() % 4 == 1;
+  }
+
+  // returns the blob as is if it is small, has no dictionary to use or can't be compressed well
+  BufferSlice compress(BufferSlice blob);
+
+  // returns a copy of the blob if it isn't compressed
+  Result<BufferSlice> decompress(Slice blob);
+
+  // chooses the most frequent segments of the samples, placing the most useful segments at the end of the dictionary
+  static string train_dictionary(const vector<Slice> &samples, size_t max_size = MAX_DICTIONARY_SIZE);
+
+ private:
+  class Impl;
+  unique_ptr<Impl> impl_;
+
+  FlatHashMap<int32, string> dictionaries_;
+  int32 dictionary_id_ = 0;
+};
+
+}  // namespace td
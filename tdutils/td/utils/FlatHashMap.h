@@ -8,6 +8,7 @@
 
 //#include "td/utils/FlatHashMapChunks.h"
 #include "td/utils/FlatHashTable.h"
+//#include "td/utils/FlatHashTableSwiss.h"
 #include "td/utils/HashTableUtils.h"
 #include "td/utils/MapNode.h"
 
@@ -19,6 +20,7 @@ namespace td {
 template <class KeyT, class ValueT, class HashT = Hash<KeyT>, class EqT = std::equal_to<KeyT>>
 using FlatHashMap = FlatHashTable<MapNode<KeyT, ValueT, EqT>, HashT, EqT>;
 //using FlatHashMap = FlatHashMapChunks<KeyT, ValueT, HashT, EqT>;
+//using FlatHashMap = FlatHashMapSwiss<KeyT, ValueT, HashT, EqT>;
 //using FlatHashMap = std::unordered_map<KeyT, ValueT, HashT, EqT>;
 
 }  // namespace td
@@ -274,6 +274,20 @@ class FlatHashTable {
     return ConstNodePointer(const_cast<FlatHashTable *>(this)->find_impl(key));
   }
 
+  // lookup by a key of another type, for example, by Slice in a table with string keys, is allowed
+  // only if both HashT and EqT are transparent
+  template <class LookupKeyT, class H = HashT, class E = EqT, class = typename H::is_transparent,
+            class = typename E::is_transparent>
+  NodePointer find(const LookupKeyT &key) {
+    return NodePointer(find_impl(key));
+  }
+
+  template <class LookupKeyT, class H = HashT, class E = EqT, class = typename H::is_transparent,
+            class = typename E::is_transparent>
+  ConstNodePointer find(const LookupKeyT &key) const {
+    return ConstNodePointer(const_cast<FlatHashTable *>(this)->find_impl(key));
+  }
+
   size_t size() const {
     return used_node_count_;
   }
@@ -352,19 +366,25 @@ class FlatHashTable {
   }
 
   size_t erase(const KeyT &key) {
-    auto *node = find_impl(key);
-    if (node == nullptr) {
-      return 0;
-    }
-    erase_node(node);
-    try_shrink();
-    return 1;
+    return erase_impl(key);
+  }
+
+  template <class LookupKeyT, class H = HashT, class E = EqT, class = typename H::is_transparent,
+            class = typename E::is_transparent>
+  size_t erase(const LookupKeyT &key) {
+    return erase_impl(key);
   }
 
   size_t count(const KeyT &key) const {
     return const_cast<FlatHashTable *>(this)->find_impl(key) != nullptr;
   }
 
+  template <class LookupKeyT, class H = HashT, class E = EqT, class = typename H::is_transparent,
+            class = typename E::is_transparent>
+  size_t count(const LookupKeyT &key) const {
+    return const_cast<FlatHashTable *>(this)->find_impl(key) != nullptr;
+  }
+
   void clear() {
     if (nodes_ != nullptr) {
       clear_nodes(nodes_);
@@ -446,8 +466,20 @@ class FlatHashTable {
     return nodes_ + begin_bucket_;
   }
 
-  NodeT *find_impl(const KeyT &key) {
-    if (unlikely(nodes_ == nullptr) || is_hash_table_key_empty<EqT>(key)) {
+  template <class LookupKeyT>
+  size_t erase_impl(const LookupKeyT &key) {
+    auto *node = find_impl(key);
+    if (node == nullptr) {
+      return 0;
+    }
+    erase_node(node);
+    try_shrink();
+    return 1;
+  }
+
+  template <class LookupKeyT>
+  NodeT *find_impl(const LookupKeyT &key) {
+    if (unlikely(nodes_ == nullptr) || is_hash_table_lookup_key_empty<EqT, KeyT>(key)) {
       return nullptr;
     }
     auto bucket = calc_bucket(key);
@@ -471,7 +503,8 @@ class FlatHashTable {
     invalidate_iterators();
   }
 
-  uint32 calc_bucket(const KeyT &key) const {
+  template <class LookupKeyT>
+  uint32 calc_bucket(const LookupKeyT &key) const {
     return HashT()(key) & bucket_count_mask_;
   }
 
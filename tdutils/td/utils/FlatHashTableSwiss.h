@@ -0,0 +1,651 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+#include "td/utils/HashTableUtils.h"
+#include "td/utils/MapNode.h"
+#include "td/utils/SetNode.h"
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#if !defined(TD_SSE2) && (defined(__SSE2__) || (TD_MSVC && (defined(_M_X64) || (defined(_M_IX86) && _M_IX86_FP >= 2))))
+#define TD_SSE2 1
+#endif
+
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
+
+#if TD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace td {
+
+namespace detail {
+
+// Control bytes of a group of 16 consecutive slots.
+// 0x00 - empty slot, 0x80 | (hash & 0x7F) - used slot.
+struct FlatHashTableSwissGroup {
+  static constexpr uint32 SIZE = 16;
+
+  uint8 ctrl[SIZE];
+
+#ifdef __aarch64__
+  // every byte is represented by 4 bits of the mask
+  static constexpr int MASK_SHIFT = 4;
+
+  uint64 match(uint8 tag) const {
+    auto eq_mask = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(tag));
+    auto shifted_eq_mask = vshrn_n_u16(vreinterpretq_u16_u8(eq_mask), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(shifted_eq_mask), 0) & 0x1111111111111111;
+  }
+#elif TD_SSE2
+  static constexpr int MASK_SHIFT = 1;
+
+  uint64 match(uint8 tag) const {
+    auto eq_mask = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl)), _mm_set1_epi8(tag));
+    return static_cast<uint32>(_mm_movemask_epi8(eq_mask));
+  }
+#else
+  static constexpr int MASK_SHIFT = 1;
+
+  uint64 match(uint8 tag) const {
+    uint64 res = 0;
+    for (uint32 i = 0; i < SIZE; i++) {
+      res |= static_cast<uint64>(ctrl[i] == tag) << i;
+    }
+    return res;
+  }
+#endif
+
+  uint64 match_empty() const {
+    return match(0);
+  }
+
+  static uint32 first_pos(uint64 mask) {
+    return count_trailing_zeroes_non_zero64(mask) / MASK_SHIFT;
+  }
+
+  static void next_pos(uint64 &mask) {
+    mask &= mask - 1;
+  }
+};
+
+}  // namespace detail
+
+// Open addressing hash table with SIMD probing of groups of 16 slots.
+// Every slot has a control byte with 7 bits of the key hash, which allows to compare keys only for slots
+// with matching hash tags. Groups are probed quadratically. Each group stores the number of keys, which were
+// inserted after the group, because the group was full. Lookup stops at the first group without a matching key
+// and with zero counter, so no tombstones are needed on erase and the table can be kept 7/8 full.
+// The interface is the same as of FlatHashTable.
+template <class NodeT, class HashT, class EqT>
+class FlatHashTableSwiss {
+  using Group = detail::FlatHashTableSwissGroup;
+  static constexpr uint32 GROUP_SIZE = Group::SIZE;
+
+  void allocate_nodes(uint32 size) {
+    DCHECK(size >= GROUP_SIZE);
+    DCHECK((size & (size - 1)) == 0);
+    CHECK(size <= min(static_cast<uint32>(1) << 29, static_cast<uint32>(0x7FFFFFFF / sizeof(NodeT))));
+    nodes_ = new NodeT[size];
+    groups_ = new Group[size / GROUP_SIZE]();
+    overflow_counts_ = new uint16[size / GROUP_SIZE]();
+    group_count_mask_ = size / GROUP_SIZE - 1;
+    bucket_count_ = size;
+  }
+
+  static void clear_nodes(NodeT *nodes, Group *groups, uint16 *overflow_counts) {
+    delete[] nodes;
+    delete[] groups;
+    delete[] overflow_counts;
+  }
+
+ public:
+  using KeyT = typename NodeT::public_key_type;
+  using key_type = typename NodeT::public_key_type;
+  using value_type = typename NodeT::public_type;
+
+  struct Iterator {
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = typename NodeT::public_type;
+    using pointer = value_type *;
+    using reference = value_type &;
+
+    Iterator &operator++() {
+      DCHECK(it_ != nullptr);
+      do {
+        if (unlikely(++it_ == end_)) {
+          it_ = nullptr;
+          break;
+        }
+      } while (it_->empty());
+      return *this;
+    }
+    reference operator*() {
+      return it_->get_public();
+    }
+    const value_type &operator*() const {
+      return it_->get_public();
+    }
+    pointer operator->() {
+      return &it_->get_public();
+    }
+    const value_type *operator->() const {
+      return &it_->get_public();
+    }
+
+    NodeT *get() {
+      return it_;
+    }
+
+    bool operator==(const Iterator &other) const {
+      DCHECK(other.it_ == nullptr);
+      return it_ == nullptr;
+    }
+    bool operator!=(const Iterator &other) const {
+      DCHECK(other.it_ == nullptr);
+      return it_ != nullptr;
+    }
+
+    Iterator() = default;
+    Iterator(NodeT *it, NodeT *end) : it_(it), end_(end) {
+    }
+
+   private:
+    NodeT *it_ = nullptr;
+    NodeT *end_ = nullptr;
+  };
+
+  struct ConstIterator {
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = typename NodeT::public_type;
+    using pointer = const value_type *;
+    using reference = const value_type &;
+
+    ConstIterator &operator++() {
+      ++it_;
+      return *this;
+    }
+    reference operator*() const {
+      return *it_;
+    }
+    pointer operator->() const {
+      return &*it_;
+    }
+    bool operator==(const ConstIterator &other) const {
+      return it_ == other.it_;
+    }
+    bool operator!=(const ConstIterator &other) const {
+      return it_ != other.it_;
+    }
+
+    ConstIterator() = default;
+    ConstIterator(Iterator it) : it_(std::move(it)) {
+    }
+
+   private:
+    Iterator it_;
+  };
+  using iterator = Iterator;
+  using const_iterator = ConstIterator;
+
+  struct NodePointer {
+    value_type &operator*() {
+      return it_->get_public();
+    }
+    const value_type &operator*() const {
+      return it_->get_public();
+    }
+    value_type *operator->() {
+      return &it_->get_public();
+    }
+    const value_type *operator->() const {
+      return &it_->get_public();
+    }
+
+    NodeT *get() {
+      return it_;
+    }
+
+    bool operator==(const Iterator &) const {
+      return it_ == nullptr;
+    }
+    bool operator!=(const Iterator &) const {
+      return it_ != nullptr;
+    }
+
+    explicit NodePointer(NodeT *it) : it_(it) {
+    }
+
+   private:
+    NodeT *it_ = nullptr;
+  };
+
+  struct ConstNodePointer {
+    const value_type &operator*() const {
+      return it_->get_public();
+    }
+    const value_type *operator->() const {
+      return &it_->get_public();
+    }
+
+    bool operator==(const ConstIterator &) const {
+      return it_ == nullptr;
+    }
+    bool operator!=(const ConstIterator &) const {
+      return it_ != nullptr;
+    }
+
+    const NodeT *get() const {
+      return it_;
+    }
+
+    explicit ConstNodePointer(const NodeT *it) : it_(it) {
+    }
+
+   private:
+    const NodeT *it_ = nullptr;
+  };
+
+  FlatHashTableSwiss() = default;
+  FlatHashTableSwiss(const FlatHashTableSwiss &) = delete;
+  FlatHashTableSwiss &operator=(const FlatHashTableSwiss &) = delete;
+
+  FlatHashTableSwiss(std::initializer_list<NodeT> nodes) {
+    if (nodes.size() == 0) {
+      return;
+    }
+    reserve(nodes.size());
+    for (auto &new_node : nodes) {
+      CHECK(!new_node.empty());
+      if (find_impl(new_node.key()) != nullptr) {
+        continue;
+      }
+      auto &node = *insert_slot(calc_hash(new_node.key()));
+      node.copy_from(new_node);
+      used_node_count_++;
+    }
+  }
+
+  template <class T>
+  FlatHashTableSwiss(std::initializer_list<T> keys) {
+    for (auto &key : keys) {
+      emplace(KeyT(key));
+    }
+  }
+
+  FlatHashTableSwiss(FlatHashTableSwiss &&other) noexcept
+      : nodes_(other.nodes_)
+      , groups_(other.groups_)
+      , overflow_counts_(other.overflow_counts_)
+      , used_node_count_(other.used_node_count_)
+      , group_count_mask_(other.group_count_mask_)
+      , bucket_count_(other.bucket_count_) {
+    other.drop();
+  }
+  void operator=(FlatHashTableSwiss &&other) noexcept {
+    clear();
+    nodes_ = other.nodes_;
+    groups_ = other.groups_;
+    overflow_counts_ = other.overflow_counts_;
+    used_node_count_ = other.used_node_count_;
+    group_count_mask_ = other.group_count_mask_;
+    bucket_count_ = other.bucket_count_;
+    other.drop();
+  }
+  ~FlatHashTableSwiss() {
+    clear_nodes(nodes_, groups_, overflow_counts_);
+  }
+
+  void swap(FlatHashTableSwiss &other) noexcept {
+    std::swap(nodes_, other.nodes_);
+    std::swap(groups_, other.groups_);
+    std::swap(overflow_counts_, other.overflow_counts_);
+    std::swap(used_node_count_, other.used_node_count_);
+    std::swap(group_count_mask_, other.group_count_mask_);
+    std::swap(bucket_count_, other.bucket_count_);
+  }
+
+  uint32 bucket_count() const {
+    return bucket_count_;
+  }
+
+  NodePointer find(const KeyT &key) {
+    return NodePointer(find_impl(key));
+  }
+
+  ConstNodePointer find(const KeyT &key) const {
+    return ConstNodePointer(const_cast<FlatHashTableSwiss *>(this)->find_impl(key));
+  }
+
+  // lookup by a key of another type, for example, by Slice in a table with string keys, is allowed
+  // only if both HashT and EqT are transparent
+  template <class LookupKeyT, class H = HashT, class E = EqT, class = typename H::is_transparent,
+            class = typename E::is_transparent>
+  NodePointer find(const LookupKeyT &key) {
+    return NodePointer(find_impl(key));
+  }
+
+  template <class LookupKeyT, class H = HashT, class E = EqT, class = typename H::is_transparent,
+            class = typename E::is_transparent>
+  ConstNodePointer find(const LookupKeyT &key) const {
+    return ConstNodePointer(const_cast<FlatHashTableSwiss *>(this)->find_impl(key));
+  }
+
+  size_t size() const {
+    return used_node_count_;
+  }
+
+  bool empty() const {
+    return used_node_count_ == 0;
+  }
+
+  Iterator begin() {
+    if (empty()) {
+      return end();
+    }
+    auto it = nodes_;
+    while (it->empty()) {
+      ++it;
+    }
+    return Iterator(it, nodes_ + bucket_count_);
+  }
+  Iterator end() {
+    return Iterator();
+  }
+  ConstIterator begin() const {
+    return ConstIterator(const_cast<FlatHashTableSwiss *>(this)->begin());
+  }
+  ConstIterator end() const {
+    return ConstIterator();
+  }
+
+  void reserve(size_t size) {
+    if (size == 0) {
+      return;
+    }
+    CHECK(size <= (1u << 29));
+    uint32 want_size = normalize_size(static_cast<uint32>(size) / 7 * 8 + 8);
+    if (want_size > bucket_count()) {
+      resize(want_size);
+    }
+  }
+
+  template <class... ArgsT>
+  std::pair<NodePointer, bool> emplace(KeyT key, ArgsT &&...args) {
+    CHECK(!is_hash_table_key_empty<EqT>(key));
+    auto *found_node = find_impl(key);
+    if (found_node != nullptr) {
+      return {NodePointer(found_node), false};
+    }
+    if (unlikely(should_grow(used_node_count_ + 1, bucket_count_))) {
+      resize(bucket_count_ == 0 ? GROUP_SIZE : 2 * bucket_count_);
+    }
+    auto *node = insert_slot(calc_hash(key));
+    node->emplace(std::move(key), std::forward<ArgsT>(args)...);
+    used_node_count_++;
+    return {NodePointer(node), true};
+  }
+
+  std::pair<NodePointer, bool> insert(KeyT key) {
+    return emplace(std::move(key));
+  }
+
+  template <class ItT>
+  void insert(ItT begin, ItT end) {
+    for (; begin != end; ++begin) {
+      emplace(*begin);
+    }
+  }
+
+  template <class T = typename NodeT::second_type>
+  T &operator[](const KeyT &key) {
+    return emplace(key).first->second;
+  }
+
+  size_t erase(const KeyT &key) {
+    return erase_impl(key);
+  }
+
+  template <class LookupKeyT, class H = HashT, class E = EqT, class = typename H::is_transparent,
+            class = typename E::is_transparent>
+  size_t erase(const LookupKeyT &key) {
+    return erase_impl(key);
+  }
+
+  size_t count(const KeyT &key) const {
+    return const_cast<FlatHashTableSwiss *>(this)->find_impl(key) != nullptr;
+  }
+
+  template <class LookupKeyT, class H = HashT, class E = EqT, class = typename H::is_transparent,
+            class = typename E::is_transparent>
+  size_t count(const LookupKeyT &key) const {
+    return const_cast<FlatHashTableSwiss *>(this)->find_impl(key) != nullptr;
+  }
+
+  void clear() {
+    if (nodes_ != nullptr) {
+      clear_nodes(nodes_, groups_, overflow_counts_);
+      drop();
+    }
+  }
+
+  void erase(Iterator it) {
+    DCHECK(it != end());
+    erase_node(it.get());
+    try_shrink();
+  }
+
+  void erase(NodePointer it) {
+    DCHECK(it != end());
+    erase_node(it.get());
+    try_shrink();
+  }
+
+  template <class F>
+  void remove_if(F &&f) {
+    if (empty()) {
+      return;
+    }
+
+    // erase_node doesn't move other nodes, so a single pass is enough
+    auto end = nodes_ + bucket_count_;
+    for (auto it = nodes_; it != end; ++it) {
+      if (!it->empty() && f(it->get_public())) {
+        erase_node(it);
+      }
+    }
+    try_shrink();
+  }
+
+ private:
+  NodeT *nodes_ = nullptr;
+  Group *groups_ = nullptr;
+  uint16 *overflow_counts_ = nullptr;
+  uint32 used_node_count_ = 0;
+  uint32 group_count_mask_ = 0;
+  uint32 bucket_count_ = 0;
+
+  struct HashInfo {
+    uint32 group_i;
+    uint8 tag;
+  };
+
+  struct ProbeSequence {
+    uint32 group_i;
+    uint32 group_count_mask;
+    uint32 step;
+
+    void next() {
+      // triangular numbers visit every group, because the number of groups is a power of 2
+      step++;
+      group_i = (group_i + step) & group_count_mask;
+    }
+  };
+
+  void drop() {
+    nodes_ = nullptr;
+    groups_ = nullptr;
+    overflow_counts_ = nullptr;
+    used_node_count_ = 0;
+    group_count_mask_ = 0;
+    bucket_count_ = 0;
+  }
+
+  static uint32 normalize_size(uint32 size) {
+    return td::max(static_cast<uint32>(1) << (32 - count_leading_zeroes32(size - 1)), GROUP_SIZE);
+  }
+
+  static bool should_grow(uint32 used_count, uint32 bucket_count) {
+    return used_count > bucket_count / 8 * 7;
+  }
+
+  template <class LookupKeyT>
+  HashInfo calc_hash(const LookupKeyT &key) const {
+    auto hash = HashT()(key);
+    return {(hash >> 7) & group_count_mask_, static_cast<uint8>(0x80 | (hash & 0x7F))};
+  }
+
+  ProbeSequence get_probe_sequence(uint32 group_i) const {
+    return ProbeSequence{group_i, group_count_mask_, 0};
+  }
+
+  template <class LookupKeyT>
+  size_t erase_impl(const LookupKeyT &key) {
+    auto *node = find_impl(key);
+    if (node == nullptr) {
+      return 0;
+    }
+    erase_node(node);
+    try_shrink();
+    return 1;
+  }
+
+  template <class LookupKeyT>
+  NodeT *find_impl(const LookupKeyT &key) {
+    if (unlikely(nodes_ == nullptr) || is_hash_table_lookup_key_empty<EqT, KeyT>(key)) {
+      return nullptr;
+    }
+    auto hash = calc_hash(key);
+    auto probe = get_probe_sequence(hash.group_i);
+    while (true) {
+      const auto &group = groups_[probe.group_i];
+      auto mask = group.match(hash.tag);
+      while (mask != 0) {
+        auto *node = nodes_ + probe.group_i * GROUP_SIZE + Group::first_pos(mask);
+        if (likely(EqT()(node->key(), key))) {
+          return node;
+        }
+        Group::next_pos(mask);
+      }
+      if (overflow_counts_[probe.group_i] == 0) {
+        return nullptr;
+      }
+      probe.next();
+    }
+  }
+
+  // returns an empty node for a key, which is known to be absent in the table
+  NodeT *insert_slot(HashInfo hash) {
+    auto probe = get_probe_sequence(hash.group_i);
+    while (true) {
+      auto &group = groups_[probe.group_i];
+      auto mask = group.match_empty();
+      if (mask != 0) {
+        auto pos = Group::first_pos(mask);
+        DCHECK(group.ctrl[pos] == 0);
+        group.ctrl[pos] = hash.tag;
+        auto *node = nodes_ + probe.group_i * GROUP_SIZE + pos;
+        DCHECK(node->empty());
+        return node;
+      }
+      auto &overflow_count = overflow_counts_[probe.group_i];
+      CHECK(overflow_count != std::numeric_limits<uint16>::max());
+      overflow_count++;
+      probe.next();
+    }
+  }
+
+  void try_shrink() {
+    DCHECK(nodes_ != nullptr);
+    if (unlikely(used_node_count_ * 10 < bucket_count_ && bucket_count_ > GROUP_SIZE)) {
+      resize(normalize_size((used_node_count_ + 1) * 5 / 3 + 1));
+    }
+  }
+
+  void resize(uint32 new_size) {
+    if (unlikely(nodes_ == nullptr)) {
+      allocate_nodes(new_size);
+      used_node_count_ = 0;
+      return;
+    }
+
+    auto old_nodes = nodes_;
+    auto old_groups = groups_;
+    auto old_overflow_counts = overflow_counts_;
+    uint32 old_bucket_count = bucket_count_;
+    allocate_nodes(new_size);
+
+    // there are no erased slots in the new table, so groups are filled from the beginning;
+    // tracking group sizes separately avoids reloading control bytes, which have just been written
+    vector<uint8> group_sizes(group_count_mask_ + 1, 0);
+    auto old_nodes_end = old_nodes + old_bucket_count;
+    for (NodeT *old_node = old_nodes; old_node != old_nodes_end; ++old_node) {
+      if (old_node->empty()) {
+        continue;
+      }
+      auto hash = calc_hash(old_node->key());
+      auto probe = get_probe_sequence(hash.group_i);
+      while (group_sizes[probe.group_i] == GROUP_SIZE) {
+        auto &overflow_count = overflow_counts_[probe.group_i];
+        CHECK(overflow_count != std::numeric_limits<uint16>::max());
+        overflow_count++;
+        probe.next();
+      }
+      auto pos = group_sizes[probe.group_i]++;
+      groups_[probe.group_i].ctrl[pos] = hash.tag;
+      nodes_[probe.group_i * GROUP_SIZE + pos] = std::move(*old_node);
+    }
+    clear_nodes(old_nodes, old_groups, old_overflow_counts);
+  }
+
+  void erase_node(NodeT *it) {
+    DCHECK(nodes_ <= it && static_cast<size_t>(it - nodes_) < bucket_count());
+    auto node_i = static_cast<uint32>(it - nodes_);
+    auto node_group_i = node_i / GROUP_SIZE;
+    auto hash = calc_hash(it->key());
+    auto probe = get_probe_sequence(hash.group_i);
+    while (probe.group_i != node_group_i) {
+      DCHECK(overflow_counts_[probe.group_i] > 0);
+      overflow_counts_[probe.group_i]--;
+      probe.next();
+    }
+    DCHECK(groups_[node_group_i].ctrl[node_i % GROUP_SIZE] == hash.tag);
+    groups_[node_group_i].ctrl[node_i % GROUP_SIZE] = 0;
+    it->clear();
+    used_node_count_--;
+  }
+};
+
+template <class KeyT, class ValueT, class HashT = Hash<KeyT>, class EqT = std::equal_to<KeyT>>
+using FlatHashMapSwiss = FlatHashTableSwiss<MapNode<KeyT, ValueT, EqT>, HashT, EqT>;
+
+template <class KeyT, class HashT = Hash<KeyT>, class EqT = std::equal_to<KeyT>>
+using FlatHashSetSwiss = FlatHashTableSwiss<SetNode<KeyT, EqT>, HashT, EqT>;
+
+}  // namespace td
@@ -154,7 +154,52 @@ Gzip::~Gzip() {
   clear();
 }
 
+// the gzip trailer contains the size of the uncompressed data modulo 2^32
+static size_t get_gzip_decoded_size_hint(Slice s) {
+  if (s.size() < 18 || s.ubegin()[0] != 0x1f || s.ubegin()[1] != 0x8b) {
+    return 0;
+  }
+  auto trailer = s.ubegin() + s.size() - 4;
+  auto size = static_cast<size_t>(trailer[0]) | (static_cast<size_t>(trailer[1]) << 8) |
+              (static_cast<size_t>(trailer[2]) << 16) | (static_cast<size_t>(trailer[3]) << 24);
+  // deflate can't compress data more than 1032 times
+  if (size / 1032 > s.size()) {
+    return 0;
+  }
+  return size;
+}
+
+// decodes the whole data into a buffer of the exact size, so the data is written only once
+static bool gzdecode_exact(Slice s, size_t size, BufferSlice &result) {
+  Gzip gzip;
+  gzip.init_decode().ensure();
+  gzip.set_input(s);
+  gzip.close_input();
+  // an additional byte allows to finish decoding of the trailer
+  BufferWriter message{size + 1};
+  gzip.set_output(message.prepare_append());
+  auto r_state = gzip.run();
+  if (r_state.is_error() || r_state.ok() != Gzip::State::Done) {
+    return false;
+  }
+  auto decoded_size = gzip.flush_output();
+  if (decoded_size != size) {
+    return false;
+  }
+  message.confirm_append(decoded_size);
+  result = message.as_buffer_slice();
+  return true;
+}
+
 BufferSlice gzdecode(Slice s) {
+  auto size_hint = get_gzip_decoded_size_hint(s);
+  if (size_hint > 0) {
+    BufferSlice result;
+    if (gzdecode_exact(s, size_hint, result)) {
+      return result;
+    }
+  }
+
   Gzip gzip;
   gzip.init_decode().ensure();
   ChainBufferWriter message;
@@ -9,6 +9,7 @@
 #include "td/utils/common.h"
 
 #include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace td {
@@ -18,6 +19,12 @@ bool is_hash_table_key_empty(const KeyT &key) {
   return EqT()(key, KeyT());
 }
 
+// checks whether a key of a different type, passed to a table with transparent HashT and EqT, is empty
+template <class EqT, class KeyT, class LookupKeyT>
+bool is_hash_table_lookup_key_empty(const LookupKeyT &key) {
+  return EqT()(key, KeyT());
+}
+
 inline uint32 randomize_hash(uint32 h) {
   h ^= h >> 16;
   h *= 0x85ebca6b;
@@ -27,6 +34,28 @@ inline uint32 randomize_hash(uint32 h) {
   return h;
 }
 
+// fast non-cryptographic hash of a byte string; the result isn't stable between platforms and must not be persisted
+inline uint32 hash_bytes(const char *data, size_t size) {
+  uint64 h = 0x9E3779B97F4A7C15ULL ^ static_cast<uint64>(size);
+  while (size >= 8) {
+    uint64 word;
+    std::memcpy(&word, data, 8);
+    h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 32;
+    data += 8;
+    size -= 8;
+  }
+  if (size > 0) {
+    uint64 word = 0;
+    std::memcpy(&word, data, size);
+    h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+  }
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 29;
+  return static_cast<uint32>(h);
+}
+
 template <class Type>
 struct Hash {
   uint32 operator()(const Type &value) const;
@@ -66,7 +95,7 @@ inline uint32 Hash<uint64>::operator()(const uint64 &value) const {
 
 template <>
 inline uint32 Hash<string>::operator()(const string &value) const {
-  return static_cast<uint32>(std::hash<string>()(value));
+  return hash_bytes(value.data(), value.size());
 }
 
 inline uint32 combine_hashes(uint32 first_hash, uint32 second_hash) {
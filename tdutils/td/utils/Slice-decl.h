@@ -205,8 +205,17 @@ class CSlice : public Slice {
   }
 };
 
+// SliceHash and SliceEq can be used for tables with string keys to find them by Slice without creating a string
 struct SliceHash {
+  using is_transparent = void;
+
   uint32 operator()(Slice slice) const;
 };
 
+struct SliceEq {
+  using is_transparent = void;
+
+  bool operator()(Slice lhs, Slice rhs) const;
+};
+
 }  // namespace td
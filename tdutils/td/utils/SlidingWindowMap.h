@@ -0,0 +1,244 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+#include <map>
+#include <new>
+#include <utility>
+
+namespace td {
+
+// map for keys, which are inserted in increasing order and are erased in roughly the same order
+// entries are kept sorted by key in a ring buffer, so lookup is a binary search over contiguous memory,
+// and insertion and deletion don't allocate memory in a steady state
+// erased entries leave holes, which are dropped from the front immediately and from the middle on ring rebuild
+// rare keys, which are inserted out of order, are kept in a separate std::map
+// emplace and erase may move stored values, invalidating all pointers to them
+template <class KeyT, class ValueT>
+class SlidingWindowMap {
+ public:
+  SlidingWindowMap() = default;
+  SlidingWindowMap(const SlidingWindowMap &) = delete;
+  SlidingWindowMap &operator=(const SlidingWindowMap &) = delete;
+  SlidingWindowMap(SlidingWindowMap &&other) noexcept = default;
+  SlidingWindowMap &operator=(SlidingWindowMap &&other) noexcept = default;
+  ~SlidingWindowMap() = default;
+
+  ValueT *get(const KeyT &key) {
+    auto slot = find_slot(key);
+    if (slot != nullptr) {
+      return slot->is_used ? &slot->value() : nullptr;
+    }
+    if (overflow_.empty()) {
+      return nullptr;
+    }
+    auto it = overflow_.find(key);
+    return it == overflow_.end() ? nullptr : &it->second;
+  }
+
+  const ValueT *get(const KeyT &key) const {
+    return const_cast<SlidingWindowMap *>(this)->get(key);
+  }
+
+  std::pair<ValueT *, bool> emplace(KeyT key, ValueT &&value) {
+    if (!overflow_.empty()) {
+      auto it = overflow_.find(key);
+      if (it != overflow_.end()) {
+        return {&it->second, false};
+      }
+    }
+    if (length_ != 0 && !(slot_at(length_ - 1).key < key)) {
+      auto slot = find_slot(key);
+      if (slot == nullptr) {
+        auto it = overflow_.emplace(std::move(key), std::move(value)).first;
+        return {&it->second, true};
+      }
+      if (slot->is_used) {
+        return {&slot->value(), false};
+      }
+      // reuse the hole left by the same key
+      slot->construct(std::move(value));
+      window_size_++;
+      return {&slot->value(), true};
+    }
+
+    if (length_ == slots_.size()) {
+      auto new_capacity = window_size_ * 2 >= slots_.size() ? td::max(slots_.size() * 2, MIN_CAPACITY) : slots_.size();
+      rebuild(new_capacity);
+    }
+    auto &slot = slot_at(length_++);
+    slot.key = std::move(key);
+    slot.construct(std::move(value));
+    window_size_++;
+    return {&slot.value(), true};
+  }
+
+  bool erase(const KeyT &key) {
+    auto slot = find_slot(key);
+    if (slot == nullptr || !slot->is_used) {
+      return !overflow_.empty() && overflow_.erase(key) != 0;
+    }
+    slot->destroy();
+    window_size_--;
+    drop_holes();
+    return true;
+  }
+
+  template <class F>
+  void foreach(const F &f) {
+    for (size_t i = 0; i < length_; i++) {
+      auto &slot = slot_at(i);
+      if (slot.is_used) {
+        f(slot.key, slot.value());
+      }
+    }
+    for (auto &it : overflow_) {
+      f(it.first, it.second);
+    }
+  }
+
+  // f must not modify the map
+  template <class F>
+  void remove_if(const F &f) {
+    for (size_t i = 0; i < length_; i++) {
+      auto &slot = slot_at(i);
+      if (slot.is_used && f(slot.key, slot.value())) {
+        slot.destroy();
+        window_size_--;
+      }
+    }
+    drop_holes();
+    for (auto it = overflow_.begin(); it != overflow_.end();) {
+      if (f(it->first, it->second)) {
+        it = overflow_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  size_t size() const {
+    return window_size_ + overflow_.size();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  void clear() {
+    slots_ = vector<Slot>();
+    begin_ = 0;
+    length_ = 0;
+    window_size_ = 0;
+    overflow_.clear();
+  }
+
+ private:
+  static constexpr size_t MIN_CAPACITY = 16;
+
+  class Slot {
+   public:
+    KeyT key{};
+    bool is_used = false;
+
+    Slot() = default;
+    Slot(const Slot &) = delete;
+    Slot &operator=(const Slot &) = delete;
+    Slot(Slot &&) = delete;
+    Slot &operator=(Slot &&) = delete;
+    ~Slot() {
+      if (is_used) {
+        destroy();
+      }
+    }
+
+    ValueT &value() {
+      return *reinterpret_cast<ValueT *>(&storage_);
+    }
+
+    void construct(ValueT &&value) {
+      new (&storage_) ValueT(std::move(value));
+      is_used = true;
+    }
+
+    void destroy() {
+      value().~ValueT();
+      is_used = false;
+    }
+
+   private:
+    alignas(ValueT) unsigned char storage_[sizeof(ValueT)];
+  };
+
+  vector<Slot> slots_;  // ring buffer with power of two size
+  size_t begin_ = 0;
+  size_t length_ = 0;       // number of slots in the window, including holes
+  size_t window_size_ = 0;  // number of used slots
+  std::map<KeyT, ValueT> overflow_;
+
+  Slot &slot_at(size_t pos) {
+    return slots_[(begin_ + pos) & (slots_.size() - 1)];
+  }
+
+  Slot *find_slot(const KeyT &key) {
+    if (length_ == 0 || key < slot_at(0).key || slot_at(length_ - 1).key < key) {
+      return nullptr;
+    }
+    size_t left = 0;
+    size_t right = length_ - 1;
+    while (left < right) {
+      auto middle = left + (right - left) / 2;
+      if (slot_at(middle).key < key) {
+        left = middle + 1;
+      } else {
+        right = middle;
+      }
+    }
+    auto &slot = slot_at(left);
+    return key < slot.key ? nullptr : &slot;
+  }
+
+  void drop_holes() {
+    while (length_ != 0 && !slot_at(0).is_used) {
+      begin_ = (begin_ + 1) & (slots_.size() - 1);
+      length_--;
+    }
+    while (length_ != 0 && !slot_at(length_ - 1).is_used) {
+      length_--;
+    }
+    if (length_ == 0) {
+      begin_ = 0;
+    }
+    if (slots_.size() > MIN_CAPACITY && window_size_ * 8 < slots_.size()) {
+      rebuild(slots_.size() / 2);
+    }
+  }
+
+  // moves used slots to the beginning of a new ring buffer, dropping all holes
+  void rebuild(size_t new_capacity) {
+    CHECK(window_size_ <= new_capacity);
+    vector<Slot> new_slots(new_capacity);
+    size_t new_length = 0;
+    for (size_t i = 0; i < length_; i++) {
+      auto &slot = slot_at(i);
+      if (slot.is_used) {
+        auto &new_slot = new_slots[new_length++];
+        new_slot.key = std::move(slot.key);
+        new_slot.construct(std::move(slot.value()));
+        slot.destroy();
+      }
+    }
+    CHECK(new_length == window_size_);
+    slots_ = std::move(new_slots);
+    begin_ = 0;
+    length_ = new_length;
+  }
+};
+
+}  // namespace td
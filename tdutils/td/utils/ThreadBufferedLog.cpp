@@ -0,0 +1,225 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/ThreadBufferedLog.h"
+
+char disable_linker_warning_about_empty_file_thread_buffered_log_cpp TD_UNUSED;
+
+#if !TD_THREAD_UNSUPPORTED
+
+#include "td/utils/port/thread_local.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace td {
+
+constexpr size_t ThreadBufferedLog::MAX_THREAD_ID;
+constexpr size_t ThreadBufferedLog::RECORD_HEADER_SIZE;
+constexpr int32 ThreadBufferedLog::FLUSH_PERIOD_MS;
+
+ThreadBufferedLog::ThreadBufferedLog(size_t buffer_size) : buffer_size_(1024) {
+  while (buffer_size_ < buffer_size) {
+    buffer_size_ *= 2;
+  }
+}
+
+ThreadBufferedLog::~ThreadBufferedLog() {
+  stop();
+}
+
+void ThreadBufferedLog::init(LogInterface *log) {
+  init(log, [] { return Status::OK(); }).ensure();
+}
+
+Status ThreadBufferedLog::init(LogInterface *log, const std::function<Status()> &init_log) {
+  CHECK(log != nullptr);
+  {
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    if (log_ != nullptr) {
+      flush_buffers();
+    }
+    TRY_STATUS(init_log());
+    log_ = log;
+  }
+  start_writer();
+  return Status::OK();
+}
+
+void ThreadBufferedLog::after_rotation() {
+  std::lock_guard<std::mutex> lock(flush_mutex_);
+  flush_buffers();
+  if (log_ != nullptr) {
+    log_->after_rotation();
+  }
+}
+
+vector<string> ThreadBufferedLog::get_file_paths() {
+  std::lock_guard<std::mutex> lock(flush_mutex_);
+  if (log_ == nullptr) {
+    return {};
+  }
+  return log_->get_file_paths();
+}
+
+void ThreadBufferedLog::flush() {
+  std::lock_guard<std::mutex> lock(flush_mutex_);
+  flush_buffers();
+}
+
+void ThreadBufferedLog::stop() {
+  {
+    std::lock_guard<std::mutex> writer_lock(writer_mutex_);
+    if (is_writer_started_) {
+      is_writer_active_.store(false, std::memory_order_relaxed);
+      {
+        std::lock_guard<std::mutex> lock(wakeup_mutex_);
+        is_closing_ = true;
+      }
+      wakeup_cv_.notify_one();
+      writer_thread_.join();
+      is_writer_started_ = false;
+    }
+  }
+  flush();
+}
+
+void ThreadBufferedLog::start_writer() {
+  std::lock_guard<std::mutex> writer_lock(writer_mutex_);
+  if (is_writer_started_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(wakeup_mutex_);
+    is_closing_ = false;
+  }
+  is_writer_started_ = true;
+  writer_thread_ = thread([this] { run_writer(); });
+  is_writer_active_.store(true, std::memory_order_relaxed);
+}
+
+void ThreadBufferedLog::do_append(int log_level, CSlice slice) {
+  bool is_shared = false;
+  auto &buffer = get_current_buffer(is_shared);
+  std::unique_lock<std::mutex> shared_lock(shared_buffer_mutex_, std::defer_lock);
+  if (is_shared) {
+    shared_lock.lock();
+  }
+  if (log_level != VERBOSITY_NAME(FATAL) && is_writer_active_.load(std::memory_order_relaxed) &&
+      try_append(buffer, log_level, slice)) {
+    return;
+  }
+
+  // the buffer is full, the writer is stopped or the log line must be written before the process is aborted
+  std::lock_guard<std::mutex> lock(flush_mutex_);
+  flush_buffers();
+  if (log_ != nullptr) {
+    log_->do_append(log_level, slice);
+  }
+}
+
+ThreadBufferedLog::Buffer &ThreadBufferedLog::get_current_buffer(bool &is_shared) {
+  auto thread_id = get_thread_id();
+  if (thread_id <= 0 || static_cast<size_t>(thread_id) >= MAX_THREAD_ID) {
+    thread_id = 0;
+    is_shared = true;
+  }
+  auto &buffer = buffers_[thread_id];
+  if (!buffer.is_inited_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(init_mutex_);
+    if (!buffer.is_inited_.load(std::memory_order_relaxed)) {
+      buffer.data_ = string(buffer_size_, '\0');
+      buffer.is_inited_.store(true, std::memory_order_release);
+    }
+  }
+  return buffer;
+}
+
+bool ThreadBufferedLog::try_append(Buffer &buffer, int log_level, CSlice slice) {
+  auto record_size = RECORD_HEADER_SIZE + slice.size() + 1;
+  auto write_pos = buffer.write_pos_.load(std::memory_order_relaxed);
+  auto read_pos = buffer.read_pos_.load(std::memory_order_acquire);
+  auto used_size = static_cast<size_t>(write_pos - read_pos);
+  if (used_size + record_size > buffer_size_) {
+    return false;
+  }
+
+  uint32 header[2] = {static_cast<uint32>(slice.size() + 1), static_cast<uint32>(log_level)};
+  write_bytes(buffer, write_pos, reinterpret_cast<const char *>(header), RECORD_HEADER_SIZE);
+  write_bytes(buffer, write_pos + RECORD_HEADER_SIZE, slice.c_str(), slice.size() + 1);
+  buffer.write_pos_.store(write_pos + record_size, std::memory_order_release);
+
+  // wake up the writer early if the buffer is filled quicker than it is flushed
+  if (2 * (used_size + record_size) > buffer_size_ && !need_wakeup_.exchange(true, std::memory_order_relaxed)) {
+    wakeup_cv_.notify_one();
+  }
+  return true;
+}
+
+void ThreadBufferedLog::write_bytes(Buffer &buffer, uint64 pos, const char *data, size_t size) const {
+  auto offset = static_cast<size_t>(pos & (buffer_size_ - 1));
+  auto first_part_size = min(size, buffer_size_ - offset);
+  std::memcpy(&buffer.data_[0] + offset, data, first_part_size);
+  std::memcpy(&buffer.data_[0], data + first_part_size, size - first_part_size);
+}
+
+void ThreadBufferedLog::read_bytes(const Buffer &buffer, uint64 pos, char *data, size_t size) const {
+  auto offset = static_cast<size_t>(pos & (buffer_size_ - 1));
+  auto first_part_size = min(size, buffer_size_ - offset);
+  std::memcpy(data, &buffer.data_[0] + offset, first_part_size);
+  std::memcpy(data + first_part_size, &buffer.data_[0], size - first_part_size);
+}
+
+void ThreadBufferedLog::flush_buffers() {
+  for (auto &buffer : buffers_) {
+    if (buffer.is_inited_.load(std::memory_order_acquire)) {
+      flush_buffer(buffer);
+    }
+  }
+}
+
+void ThreadBufferedLog::flush_buffer(Buffer &buffer) {
+  auto read_pos = buffer.read_pos_.load(std::memory_order_relaxed);
+  auto write_pos = buffer.write_pos_.load(std::memory_order_acquire);
+  while (read_pos != write_pos) {
+    uint32 header[2];
+    read_bytes(buffer, read_pos, reinterpret_cast<char *>(header), RECORD_HEADER_SIZE);
+    auto size = static_cast<size_t>(header[0]);
+    auto log_level = static_cast<int>(header[1]);
+    auto offset = static_cast<size_t>((read_pos + RECORD_HEADER_SIZE) & (buffer_size_ - 1));
+    if (log_ != nullptr) {
+      if (offset + size <= buffer_size_) {
+        auto *begin = &buffer.data_[0] + offset;
+        log_->do_append(log_level, CSlice(begin, begin + size - 1));
+      } else {
+        record_.resize(size);
+        read_bytes(buffer, read_pos + RECORD_HEADER_SIZE, &record_[0], size);
+        log_->do_append(log_level, CSlice(record_.data(), record_.data() + size - 1));
+      }
+    }
+    read_pos += RECORD_HEADER_SIZE + size;
+    buffer.read_pos_.store(read_pos, std::memory_order_release);
+  }
+}
+
+void ThreadBufferedLog::run_writer() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(wakeup_mutex_);
+      wakeup_cv_.wait_for(lock, std::chrono::milliseconds(FLUSH_PERIOD_MS),
+                          [&] { return is_closing_ || need_wakeup_.load(std::memory_order_relaxed); });
+      if (is_closing_) {
+        break;
+      }
+    }
+    need_wakeup_.store(false, std::memory_order_relaxed);
+    flush();
+  }
+}
+
+}  // namespace td
+
+#endif
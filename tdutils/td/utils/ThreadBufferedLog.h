@@ -0,0 +1,110 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+namespace td {
+
+#if !TD_THREAD_UNSUPPORTED
+
+// copies log lines to per-thread lock-free ring buffers, which are written to the underlying log by a background thread,
+// so logging threads wait neither for each other nor for the underlying log
+// log lines from different threads can be reordered within a flush period; fatal log lines are written synchronously
+// threads without identifier and threads with too big identifiers share one buffer under a mutex
+class ThreadBufferedLog final : public LogInterface {
+ public:
+  explicit ThreadBufferedLog(size_t buffer_size = 1 << 18);
+  ThreadBufferedLog(const ThreadBufferedLog &) = delete;
+  ThreadBufferedLog &operator=(const ThreadBufferedLog &) = delete;
+  ThreadBufferedLog(ThreadBufferedLog &&) = delete;
+  ThreadBufferedLog &operator=(ThreadBufferedLog &&) = delete;
+  ~ThreadBufferedLog() final;
+
+  // can be called again to replace the underlying log; the underlying log must not be used directly after the call
+  void init(LogInterface *log);
+
+  // the same as init, but calls init_log after all buffered log lines are written to the previous underlying log,
+  // while no other thread can write to an underlying log; the underlying log isn't replaced if init_log fails
+  Status init(LogInterface *log, const std::function<Status()> &init_log);
+
+  void after_rotation() final;
+
+  vector<string> get_file_paths() final;
+
+  // synchronously writes all buffered log lines to the underlying log
+  void flush();
+
+  // stops the background writer and writes all buffered log lines to the underlying log
+  // the object remains usable: log lines are written synchronously until the next init
+  void stop();
+
+ private:
+  static constexpr size_t MAX_THREAD_ID = 128;
+  static constexpr size_t RECORD_HEADER_SIZE = 8;
+  static constexpr int32 FLUSH_PERIOD_MS = 10;
+
+  // a ring buffer with a single writer, which is the owning thread, and a single reader, which holds flush_mutex_
+  // each record consists of the length of the log line with the trailing zero, the log level and the log line
+  struct Buffer {
+    string data_;
+    std::atomic<uint64> write_pos_{0};
+    std::atomic<uint64> read_pos_{0};
+    std::atomic<bool> is_inited_{false};
+  };
+
+  size_t buffer_size_;
+  std::array<Buffer, MAX_THREAD_ID> buffers_;
+  std::mutex init_mutex_;
+  std::mutex shared_buffer_mutex_;
+
+  std::mutex flush_mutex_;
+  LogInterface *log_ = nullptr;
+  string record_;
+
+  std::mutex wakeup_mutex_;
+  std::condition_variable wakeup_cv_;
+  bool is_closing_ = false;
+  std::atomic<bool> need_wakeup_{false};
+
+  std::mutex writer_mutex_;
+  std::atomic<bool> is_writer_active_{false};
+  bool is_writer_started_ = false;
+  thread writer_thread_;
+
+  void do_append(int log_level, CSlice slice) final;
+
+  Buffer &get_current_buffer(bool &is_shared);
+
+  bool try_append(Buffer &buffer, int log_level, CSlice slice);
+
+  void write_bytes(Buffer &buffer, uint64 pos, const char *data, size_t size) const;
+
+  void read_bytes(const Buffer &buffer, uint64 pos, char *data, size_t size) const;
+
+  void flush_buffers();
+
+  void flush_buffer(Buffer &buffer);
+
+  void start_writer();
+
+  void run_writer();
+};
+
+#endif
+
+}  // namespace td
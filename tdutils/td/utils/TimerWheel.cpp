@@ -0,0 +1,281 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/TimerWheel.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/bits.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace td {
+
+constexpr int32 TimerWheel::LEVEL_BITS;
+constexpr int32 TimerWheel::SLOT_COUNT;
+constexpr int32 TimerWheel::LEVEL_COUNT;
+constexpr uint32 TimerWheel::INVALID_NODE_ID;
+constexpr int64 TimerWheel::MAX_TICK;
+
+TimerWheel::TimerWheel(double tick_duration) : tick_duration_(tick_duration) {
+  CHECK(tick_duration_ > 0);
+  std::fill(std::begin(slot_heads_), std::end(slot_heads_), INVALID_NODE_ID);
+}
+
+void TimerWheel::set_timeout(int64 key, double timeout) {
+  auto node_id = get_node_id(key);
+  if (node_id == INVALID_NODE_ID) {
+    node_id = create_node(key, timeout);
+  } else {
+    unlink_node(node_id);
+    nodes_[node_id].timeout = timeout;
+  }
+  link_node(node_id);
+}
+
+bool TimerWheel::add_timeout(int64 key, double timeout) {
+  if (has_timeout(key)) {
+    return false;
+  }
+  link_node(create_node(key, timeout));
+  return true;
+}
+
+bool TimerWheel::cancel_timeout(int64 key) {
+  auto node_id = get_node_id(key);
+  if (node_id == INVALID_NODE_ID) {
+    return false;
+  }
+  unlink_node(node_id);
+  destroy_node(node_id);
+  return true;
+}
+
+double TimerWheel::get_wakeup_time() const {
+  CHECK(!empty());
+  if ((slot_masks_[0] >> (current_tick_ & (SLOT_COUNT - 1))) & 1) {
+    return static_cast<double>(current_tick_ + 1) * tick_duration_;
+  }
+  // keys from a slot of the level 0 expire at the end of the slot tick
+  // slots of the other levels must be cascaded at the beginning of their first tick
+  auto wakeup_tick = get_next_slot_tick(0);
+  if (wakeup_tick != std::numeric_limits<int64>::max()) {
+    wakeup_tick++;
+  }
+  for (int32 level = 1; level < LEVEL_COUNT; level++) {
+    wakeup_tick = td::min(wakeup_tick, get_next_slot_tick(level));
+  }
+  CHECK(wakeup_tick != std::numeric_limits<int64>::max());
+  return static_cast<double>(wakeup_tick) * tick_duration_;
+}
+
+vector<int64> TimerWheel::get_expired_keys(double now) {
+  vector<std::pair<double, int64>> expired;
+  auto target_tick = get_tick(now);
+  while (true) {
+    auto slot_id = static_cast<uint32>(current_tick_ & (SLOT_COUNT - 1));
+    auto node_id = slot_heads_[slot_id];
+    while (node_id != INVALID_NODE_ID) {
+      auto &node = nodes_[node_id];
+      auto next_node_id = node.next;
+      if (node.timeout < now) {
+        expired.emplace_back(node.timeout, node.key);
+        unlink_node(node_id);
+        destroy_node(node_id);
+      }
+      node_id = next_node_id;
+    }
+
+    if (current_tick_ >= target_tick) {
+      break;
+    }
+    auto next_tick = empty() ? std::numeric_limits<int64>::max() : get_next_event_tick();
+    if (next_tick > target_tick) {
+      current_tick_ = target_tick;
+      break;
+    }
+
+    current_tick_ = next_tick;
+    for (int32 level = LEVEL_COUNT - 1; level > 0; level--) {
+      if ((current_tick_ & ((static_cast<int64>(1) << (level * LEVEL_BITS)) - 1)) == 0) {
+        cascade(level);
+      }
+    }
+  }
+
+  std::sort(expired.begin(), expired.end());
+  return transform(expired, [](const std::pair<double, int64> &timeout) { return timeout.second; });
+}
+
+vector<int64> TimerWheel::pop_all_keys() {
+  vector<std::pair<double, int64>> timeouts;
+  timeouts.reserve(size_);
+  for (auto &node : nodes_) {
+    if (node.slot_id != INVALID_NODE_ID) {
+      timeouts.emplace_back(node.timeout, node.key);
+    }
+  }
+  CHECK(timeouts.size() == size_);
+
+  nodes_.clear();
+  free_node_ids_.clear();
+  node_ids_.clear();
+  zero_key_node_id_ = INVALID_NODE_ID;
+  std::fill(std::begin(slot_heads_), std::end(slot_heads_), INVALID_NODE_ID);
+  std::fill(std::begin(slot_masks_), std::end(slot_masks_), 0);
+  size_ = 0;
+
+  std::sort(timeouts.begin(), timeouts.end());
+  return transform(timeouts, [](const std::pair<double, int64> &timeout) { return timeout.second; });
+}
+
+int64 TimerWheel::get_tick(double time) const {
+  auto tick = time / tick_duration_;
+  if (!(tick < static_cast<double>(MAX_TICK))) {
+    return MAX_TICK;
+  }
+  if (tick < 0) {
+    return 0;
+  }
+  return static_cast<int64>(tick);
+}
+
+uint32 TimerWheel::get_node_id(int64 key) const {
+  if (key == 0) {
+    return zero_key_node_id_;
+  }
+  auto it = node_ids_.find(key);
+  return it == node_ids_.end() ? INVALID_NODE_ID : it->second;
+}
+
+uint32 TimerWheel::create_node(int64 key, double timeout) {
+  uint32 node_id;
+  if (free_node_ids_.empty()) {
+    node_id = narrow_cast<uint32>(nodes_.size());
+    nodes_.emplace_back();
+  } else {
+    node_id = free_node_ids_.back();
+    free_node_ids_.pop_back();
+  }
+  auto &node = nodes_[node_id];
+  node.key = key;
+  node.timeout = timeout;
+  if (key == 0) {
+    zero_key_node_id_ = node_id;
+  } else {
+    node_ids_[key] = node_id;
+  }
+  size_++;
+  return node_id;
+}
+
+void TimerWheel::destroy_node(uint32 node_id) {
+  auto &node = nodes_[node_id];
+  CHECK(node.slot_id == INVALID_NODE_ID);
+  if (node.key == 0) {
+    zero_key_node_id_ = INVALID_NODE_ID;
+  } else {
+    node_ids_.erase(node.key);
+  }
+  free_node_ids_.push_back(node_id);
+  size_--;
+}
+
+void TimerWheel::link_node(uint32 node_id) {
+  auto &node = nodes_[node_id];
+  CHECK(node.slot_id == INVALID_NODE_ID);
+
+  // timeouts from the past are stored in the current slot of the level 0
+  auto tick = td::max(get_tick(node.timeout), current_tick_);
+  int32 level = 0;
+  while (level + 1 < LEVEL_COUNT &&
+         (tick >> (level * LEVEL_BITS)) - (current_tick_ >> (level * LEVEL_BITS)) >= SLOT_COUNT) {
+    level++;
+  }
+  auto shift = level * LEVEL_BITS;
+  // too distant timeouts are stored in the last slot of the highest level and are relinked when it is cascaded
+  auto slot_tick = td::min(tick >> shift, (current_tick_ >> shift) + SLOT_COUNT - 1);
+  auto slot = static_cast<uint32>(slot_tick & (SLOT_COUNT - 1));
+  auto slot_id = static_cast<uint32>(level * SLOT_COUNT) + slot;
+
+  node.slot_id = slot_id;
+  node.prev = INVALID_NODE_ID;
+  node.next = slot_heads_[slot_id];
+  if (node.next != INVALID_NODE_ID) {
+    nodes_[node.next].prev = node_id;
+  }
+  slot_heads_[slot_id] = node_id;
+  slot_masks_[level] |= static_cast<uint64>(1) << slot;
+}
+
+void TimerWheel::unlink_node(uint32 node_id) {
+  auto &node = nodes_[node_id];
+  CHECK(node.slot_id != INVALID_NODE_ID);
+  if (node.prev == INVALID_NODE_ID) {
+    CHECK(slot_heads_[node.slot_id] == node_id);
+    slot_heads_[node.slot_id] = node.next;
+    if (node.next == INVALID_NODE_ID) {
+      slot_masks_[node.slot_id / SLOT_COUNT] &= ~(static_cast<uint64>(1) << (node.slot_id % SLOT_COUNT));
+    }
+  } else {
+    nodes_[node.prev].next = node.next;
+  }
+  if (node.next != INVALID_NODE_ID) {
+    nodes_[node.next].prev = node.prev;
+  }
+  node.prev = INVALID_NODE_ID;
+  node.next = INVALID_NODE_ID;
+  node.slot_id = INVALID_NODE_ID;
+}
+
+// returns the first tick after the current tick, at which a non-empty slot of the level becomes current
+int64 TimerWheel::get_next_slot_tick(int32 level) const {
+  auto mask = slot_masks_[level];
+  auto shift = level * LEVEL_BITS;
+  auto current_slot_tick = current_tick_ >> shift;
+  auto current_slot = static_cast<int32>(current_slot_tick & (SLOT_COUNT - 1));
+  // rotate the mask, so that bit i corresponds to the slot current_slot + 1 + i
+  auto rotation = (current_slot + 1) & (SLOT_COUNT - 1);
+  if (rotation != 0) {
+    mask = (mask >> rotation) | (mask << (SLOT_COUNT - rotation));
+  }
+  // the current slot of the level 0 contains expired keys and the current slots of other levels are always empty
+  mask &= ~(static_cast<uint64>(1) << (SLOT_COUNT - 1));
+  if (mask == 0) {
+    return std::numeric_limits<int64>::max();
+  }
+  return (current_slot_tick + count_trailing_zeroes_non_zero64(mask) + 1) << shift;
+}
+
+int64 TimerWheel::get_next_event_tick() const {
+  auto result = std::numeric_limits<int64>::max();
+  for (int32 level = 0; level < LEVEL_COUNT; level++) {
+    result = td::min(result, get_next_slot_tick(level));
+  }
+  return result;
+}
+
+void TimerWheel::cascade(int32 level) {
+  auto slot = static_cast<uint32>((current_tick_ >> (level * LEVEL_BITS)) & (SLOT_COUNT - 1));
+  auto slot_id = static_cast<uint32>(level * SLOT_COUNT) + slot;
+  auto node_id = slot_heads_[slot_id];
+  slot_heads_[slot_id] = INVALID_NODE_ID;
+  slot_masks_[level] &= ~(static_cast<uint64>(1) << slot);
+  while (node_id != INVALID_NODE_ID) {
+    auto &node = nodes_[node_id];
+    auto next_node_id = node.next;
+    node.prev = INVALID_NODE_ID;
+    node.next = INVALID_NODE_ID;
+    node.slot_id = INVALID_NODE_ID;
+    link_node(node_id);
+    node_id = next_node_id;
+  }
+}
+
+}  // namespace td
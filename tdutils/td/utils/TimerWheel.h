@@ -0,0 +1,98 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+
+namespace td {
+
+// hierarchical timing wheel with O(1) setting, cancellation and expiration of timeouts for int64 keys
+// the time is divided into ticks; level i has 64 slots, each of which spans 64^i ticks
+// a timeout is stored in the lowest level, which can hold it, and is moved down when its slot becomes current
+// nodes are stored in a vector and linked by index, so there are no allocations in a steady state
+class TimerWheel {
+ public:
+  explicit TimerWheel(double tick_duration = 0.001);
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool has_timeout(int64 key) const {
+    return get_node_id(key) != INVALID_NODE_ID;
+  }
+
+  void set_timeout(int64 key, double timeout);
+
+  // doesn't replace an existing timeout; returns true if the timeout was added
+  bool add_timeout(int64 key, double timeout);
+
+  // returns true if the key had a timeout
+  bool cancel_timeout(int64 key);
+
+  // returns the time at which get_expired_keys must be called next; the wheel must not be empty
+  // it isn't later than the end of the tick of the earliest timeout
+  double get_wakeup_time() const;
+
+  // returns keys with timeouts less than now in the order of the timeouts and advances the current time
+  vector<int64> get_expired_keys(double now);
+
+  // returns all keys in the order of the timeouts and removes them
+  vector<int64> pop_all_keys();
+
+ private:
+  static constexpr int32 LEVEL_BITS = 6;
+  static constexpr int32 SLOT_COUNT = 1 << LEVEL_BITS;
+  static constexpr int32 LEVEL_COUNT = 6;
+  static constexpr uint32 INVALID_NODE_ID = static_cast<uint32>(-1);
+  static constexpr int64 MAX_TICK = static_cast<int64>(1) << 60;
+
+  struct Node {
+    int64 key = 0;
+    double timeout = 0.0;
+    uint32 prev = INVALID_NODE_ID;
+    uint32 next = INVALID_NODE_ID;
+    uint32 slot_id = INVALID_NODE_ID;  // level * SLOT_COUNT + slot, or INVALID_NODE_ID for free nodes
+  };
+
+  double tick_duration_;
+  int64 current_tick_ = 0;
+  size_t size_ = 0;
+
+  vector<Node> nodes_;
+  vector<uint32> free_node_ids_;
+  FlatHashMap<int64, uint32> node_ids_;  // FlatHashMap doesn't support zero keys
+  uint32 zero_key_node_id_ = INVALID_NODE_ID;
+
+  uint32 slot_heads_[LEVEL_COUNT * SLOT_COUNT];
+  uint64 slot_masks_[LEVEL_COUNT] = {};
+
+  int64 get_tick(double time) const;
+
+  uint32 get_node_id(int64 key) const;
+
+  uint32 create_node(int64 key, double timeout);
+
+  void destroy_node(uint32 node_id);
+
+  void link_node(uint32 node_id);
+
+  void unlink_node(uint32 node_id);
+
+  int64 get_next_slot_tick(int32 level) const;
+
+  int64 get_next_event_tick() const;
+
+  void cascade(int32 level);
+};
+
+}  // namespace td
@@ -0,0 +1,67 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/Utf16OffsetIndex.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/utf8.h"
+
+#include <algorithm>
+
+namespace td {
+
+Utf16OffsetIndex::Utf16OffsetIndex(Slice str) : str_(str) {
+  checkpoints_.reserve(str.size() / CHECKPOINT_INTERVAL + 1);
+  checkpoints_.push_back(Checkpoint{0, 0});
+
+  size_t next_checkpoint_pos = CHECKPOINT_INTERVAL;
+  size_t utf16_offset = 0;
+  for (size_t i = 0; i < str.size(); i++) {
+    auto c = static_cast<unsigned char>(str[i]);
+    if (is_utf8_character_first_code_unit(c)) {
+      if (i >= next_checkpoint_pos) {
+        checkpoints_.push_back(Checkpoint{i, utf16_offset});
+        next_checkpoint_pos = i + CHECKPOINT_INTERVAL;
+      }
+      // count code units in the same way as utf8_utf16_truncate does
+      utf16_offset += 1 + (c >= 0xf0);
+    }
+  }
+}
+
+const Utf16OffsetIndex::Checkpoint &Utf16OffsetIndex::get_checkpoint(size_t offset) const {
+  auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset,
+                             [](size_t lhs, const Checkpoint &rhs) { return lhs < rhs.utf16_offset_; });
+  CHECK(it != checkpoints_.begin());
+  return *--it;
+}
+
+Slice Utf16OffsetIndex::substr(size_t offset) const {
+  // the offset can't split a surrogate pair before the checkpoint, so the result is the same as for the whole string
+  const auto &checkpoint = get_checkpoint(offset);
+  auto result = utf8_utf16_substr(str_.substr(checkpoint.utf8_pos_), offset - checkpoint.utf16_offset_);
+  CHECK(result.end() == str_.end());
+  return result;
+}
+
+Slice Utf16OffsetIndex::substr(size_t offset, size_t length) const {
+  auto result = substr(offset);
+  if (length >= result.size()) {
+    // there are no more UTF-16 code units than bytes
+    return result;
+  }
+
+  auto begin_pos = static_cast<size_t>(result.begin() - str_.begin());
+  auto end_offset = offset + length;
+  const auto &checkpoint = get_checkpoint(end_offset);
+  if (checkpoint.utf8_pos_ <= begin_pos) {
+    return utf8_utf16_truncate(result, length);
+  }
+  auto tail = utf8_utf16_truncate(str_.substr(checkpoint.utf8_pos_), end_offset - checkpoint.utf16_offset_);
+  return Slice(result.begin(), tail.end());
+}
+
+}  // namespace td
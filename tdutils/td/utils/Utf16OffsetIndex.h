@@ -0,0 +1,41 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+namespace td {
+
+/// allows to find substrings of a UTF-8 string by UTF-16 offsets without walking the string from the beginning
+/// the string must not be changed while the index is used
+class Utf16OffsetIndex {
+ public:
+  explicit Utf16OffsetIndex(Slice str);
+
+  /// returns the same as utf8_utf16_substr(str, offset)
+  Slice substr(size_t offset) const;
+
+  /// returns the same as utf8_utf16_substr(str, offset, length)
+  Slice substr(size_t offset, size_t length) const;
+
+ private:
+  static constexpr size_t CHECKPOINT_INTERVAL = 64;
+
+  // UTF-8 position of a first code unit of a character and the corresponding UTF-16 offset
+  struct Checkpoint {
+    size_t utf8_pos_;
+    size_t utf16_offset_;
+  };
+
+  Slice str_;
+  vector<Checkpoint> checkpoints_;
+
+  const Checkpoint &get_checkpoint(size_t offset) const;
+};
+
+}  // namespace td
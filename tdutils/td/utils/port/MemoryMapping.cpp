@@ -25,6 +25,17 @@ namespace td {
 class MemoryMapping::Impl {
  public:
   Impl(MutableSlice data, int64 offset) : data_(data), offset_(offset) {
+  }
+  Impl(const Impl &) = delete;
+  Impl &operator=(const Impl &) = delete;
+  Impl(Impl &&) = delete;
+  Impl &operator=(Impl &&) = delete;
+  ~Impl() {
+#if !TD_WINDOWS
+    if (!data_.empty()) {
+      munmap(data_.data(), data_.size());
+    }
+#endif
   }
   Slice as_slice() const {
     return data_.substr(narrow_cast<size_t>(offset_));
@@ -73,7 +84,14 @@ Result<MemoryMapping> MemoryMapping::create_from_file(const FileFd &file_fd, con
   if (options.size < 0) {
     end = stat.size_;
   } else {
-    end = begin + stat.size_;
+    end = begin + options.size;
+  }
+  if (end > stat.size_) {
+    return Status::Error(PSLICE() << "Can't create memory mapping: range [" << begin << ", " << end
+                                  << ") is out of file of size " << stat.size_);
+  }
+  if (end <= begin) {
+    return Status::Error("Can't create memory mapping: range is empty");
   }
 
   TRY_RESULT(page_size, get_page_size());
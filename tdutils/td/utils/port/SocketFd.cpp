@@ -11,6 +11,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/detail/skip_eintr.h"
+#include "td/utils/port/platform.h"
 #include "td/utils/port/PollFlags.h"
 #include "td/utils/SliceBuilder.h"
 
@@ -35,6 +36,10 @@
 #include <unistd.h>
 #endif
 
+#if TD_LINUX || TD_ANDROID
+#include <sys/sendfile.h>
+#endif
+
 #include <atomic>
 #include <cstring>
 
@@ -456,6 +461,35 @@ class SocketFdImpl {
     return write_finish();
   }
 
+  Result<size_t> send_file(const NativeFd &file_fd, int64 offset, size_t size) {
+#if TD_LINUX || TD_ANDROID
+    int native_fd = get_native_fd().socket();
+    auto file_offset = static_cast<off_t>(offset);
+    auto write_res = detail::skip_eintr([&] { return ::sendfile(native_fd, file_fd.fd(), &file_offset, size); });
+    if (write_res > 0) {
+      auto result = narrow_cast<size_t>(write_res);
+      LOG_CHECK(result <= size) << "Receive " << write_res << " as sendfile response, but tried to write only " << size
+                                << " bytes";
+      return result;
+    }
+    if (write_res == 0) {
+      if (size == 0) {
+        return 0;
+      }
+      return Status::Error(PSLICE() << "File " << file_fd << " was truncated while being sent");
+    }
+    auto write_errno = errno;
+    if (write_errno == EINVAL || write_errno == ENOSYS || write_errno == EOVERFLOW) {
+      return Status::Error(SocketFd::SEND_FILE_UNSUPPORTED_ERROR_CODE,
+                           PSLICE() << "Can't send " << file_fd << " to " << get_native_fd() << ": "
+                                    << strerror_safe(write_errno));
+    }
+    return write_finish();
+#else
+    return Status::Error(SocketFd::SEND_FILE_UNSUPPORTED_ERROR_CODE, "sendfile is unsupported");
+#endif
+  }
+
   Result<size_t> write_finish() {
     auto write_errno = errno;
     if (write_errno == EAGAIN
@@ -615,6 +649,8 @@ Status init_socket_options(NativeFd &native_fd) {
 
 }  // namespace detail
 
+constexpr int SocketFd::SEND_FILE_UNSUPPORTED_ERROR_CODE;
+
 SocketFd::SocketFd() = default;
 SocketFd::SocketFd(SocketFd &&) noexcept = default;
 SocketFd &SocketFd::operator=(SocketFd &&) noexcept = default;
@@ -717,6 +753,15 @@ Result<size_t> SocketFd::read(MutableSlice slice) {
   return impl_->read(slice);
 }
 
+Result<size_t> SocketFd::send_file(const NativeFd &file_fd, int64 offset, size_t size) {
+  CHECK(!empty());
+#if TD_PORT_POSIX
+  return impl_->send_file(file_fd, offset, size);
+#else
+  return Status::Error(SEND_FILE_UNSUPPORTED_ERROR_CODE, "sendfile is unsupported");
+#endif
+}
+
 Result<uint32> SocketFd::maximize_snd_buffer(uint32 max_size) {
   return get_native_fd().maximize_snd_buffer(max_size);
 }
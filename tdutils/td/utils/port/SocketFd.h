@@ -51,6 +51,13 @@ class SocketFd {
   Result<size_t> writev(Span<IoSlice> slices) TD_WARN_UNUSED_RESULT;
   Result<size_t> read(MutableSlice slice) TD_WARN_UNUSED_RESULT;
 
+  // the code of the error, which is returned if the file can't be sent without copying, so it must be read and written
+  static constexpr int SEND_FILE_UNSUPPORTED_ERROR_CODE = -1;
+
+  // writes up to size bytes of the file starting from the offset without copying them to user space;
+  // returns 0 if the socket isn't ready for writing and an error if the file ends before the offset
+  Result<size_t> send_file(const NativeFd &file_fd, int64 offset, size_t size) TD_WARN_UNUSED_RESULT;
+
   const NativeFd &get_native_fd() const;
   static Result<SocketFd> from_native_fd(NativeFd fd);
 
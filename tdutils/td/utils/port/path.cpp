@@ -132,6 +132,14 @@ Status rename(CSlice from, CSlice to) {
   return Status::OK();
 }
 
+Status link(CSlice from, CSlice to) {
+  int link_res = detail::skip_eintr([&] { return ::link(from.c_str(), to.c_str()); });
+  if (link_res < 0) {
+    return OS_ERROR(PSLICE() << "Can't create hard link \"" << to << "\" to \"" << from << '\"');
+  }
+  return Status::OK();
+}
+
 Result<string> realpath(CSlice slice, bool ignore_access_denied) {
   char full_path[PATH_MAX + 1];
   string res;
@@ -439,6 +447,20 @@ Status rename(CSlice from, CSlice to) {
   return Status::OK();
 }
 
+Status link(CSlice from, CSlice to) {
+#if TD_WINRT
+  return Status::Error("Hard links are unsupported");
+#else
+  TRY_RESULT(wfrom, to_wstring(from));
+  TRY_RESULT(wto, to_wstring(to));
+  auto status = CreateHardLinkW(wto.c_str(), wfrom.c_str(), nullptr);
+  if (status == 0) {
+    return OS_ERROR(PSLICE() << "Can't create hard link \"" << to << "\" to \"" << from << '\"');
+  }
+  return Status::OK();
+#endif
+}
+
 Result<string> realpath(CSlice slice, bool ignore_access_denied) {
   wchar_t buf[MAX_PATH + 1];
   TRY_RESULT(wslice, to_wstring(slice));
@@ -9,6 +9,7 @@
 #include "td/utils/FlatHashMap.h"
 #include "td/utils/FlatHashMapChunks.h"
 #include "td/utils/FlatHashSet.h"
+#include "td/utils/FlatHashTableSwiss.h"
 #include "td/utils/HashTableUtils.h"
 #include "td/utils/logging.h"
 #include "td/utils/Random.h"
@@ -106,6 +107,30 @@ TEST(FlatHashSet, init) {
   ASSERT_TRUE(s.count("") == 0);
 }
 
+TEST(FlatHashMap, transparent_lookup) {
+  td::FlatHashMap<td::string, int, td::SliceHash, td::SliceEq> map;
+  map["abc"] = 1;
+  map[td::string(20, 'a')] = 2;
+  ASSERT_EQ(td::Hash<td::string>()("abc"), td::SliceHash()(td::Slice("abc")));
+
+  const auto &const_map = map;
+  ASSERT_TRUE(const_map.find(td::Slice("abc")) != const_map.end());
+  ASSERT_EQ(1, map.find(td::Slice("abc"))->second);
+  ASSERT_EQ(2, map.find(td::Slice(td::string(20, 'a')))->second);
+  ASSERT_TRUE(map.find(td::Slice("ab")) == map.end());
+  ASSERT_TRUE(map.find(td::Slice()) == map.end());
+  ASSERT_EQ(1u, map.count("abc"));
+  ASSERT_EQ(0u, map.count(td::Slice("abcd")));
+  ASSERT_EQ(1u, map.erase(td::Slice("abc")));
+  ASSERT_EQ(0u, map.erase(td::Slice("abc")));
+  ASSERT_EQ(1u, map.size());
+
+  td::FlatHashSetSwiss<td::string, td::SliceHash, td::SliceEq> set{"a", "bb"};
+  ASSERT_EQ(1u, set.count(td::Slice("bb")));
+  ASSERT_EQ(1u, set.erase(td::Slice("a")));
+  ASSERT_EQ(0u, set.count(td::Slice("a")));
+}
+
 TEST(FlatHashSet, foreach) {
   td::FlatHashSet<A, AHash> s;
   for (auto it : s) {
@@ -252,11 +277,13 @@ TEST(FlatHashMap, remove_if_basic) {
 }
 
 static constexpr size_t MAX_TABLE_SIZE = 1000;
-TEST(FlatHashMap, stress_test) {
+
+template <class TableT>
+static void run_flat_hash_map_stress_test() {
   td::Random::Xorshift128plus rnd(123);
   size_t max_table_size = MAX_TABLE_SIZE;  // dynamic value
   std::unordered_map<td::uint64, td::uint64, td::Hash<td::uint64>> ref;
-  td::FlatHashMap<td::uint64, td::uint64> tbl;
+  TableT tbl;
 
   auto validate = [&] {
     ASSERT_EQ(ref.empty(), tbl.empty());
@@ -369,6 +396,60 @@ TEST(FlatHashMap, stress_test) {
   }
 }
 
+TEST(FlatHashMap, stress_test) {
+  run_flat_hash_map_stress_test<td::FlatHashMap<td::uint64, td::uint64>>();
+}
+
+TEST(FlatHashMapSwiss, stress_test) {
+  run_flat_hash_map_stress_test<td::FlatHashMapSwiss<td::uint64, td::uint64>>();
+}
+
+struct BadHash {
+  td::uint32 operator()(td::int32 key) const {
+    return static_cast<td::uint32>(key & 3) << 7;
+  }
+};
+
+TEST(FlatHashMapSwiss, collisions) {
+  td::FlatHashMapSwiss<td::int32, td::int32, BadHash> map;
+  constexpr td::int32 N = 1000;
+  for (td::int32 i = 1; i <= N; i++) {
+    map[i] = i * 2;
+  }
+  ASSERT_EQ(static_cast<size_t>(N), map.size());
+  for (td::int32 i = 1; i <= N; i += 2) {
+    ASSERT_EQ(1u, map.erase(i));
+  }
+  ASSERT_EQ(static_cast<size_t>(N / 2), map.size());
+  for (td::int32 i = 1; i <= N; i++) {
+    auto it = map.find(i);
+    if (i % 2 == 1) {
+      ASSERT_TRUE(it == map.end());
+    } else {
+      ASSERT_TRUE(it != map.end());
+      ASSERT_EQ(i * 2, it->second);
+    }
+  }
+  td::table_remove_if(map, [](auto &it) { return it.first % 4 == 0; });
+  ASSERT_EQ(static_cast<size_t>(N / 4), map.size());
+  for (auto &it : map) {
+    ASSERT_EQ(2, it.first % 4);
+  }
+  for (td::int32 i = 1; i <= N; i++) {
+    map.erase(i);
+  }
+  ASSERT_TRUE(map.empty());
+}
+
+TEST(FlatHashSetSwiss, init) {
+  td::FlatHashSetSwiss<td::Slice, td::SliceHash> s{"1", "22", "333", "4444"};
+  ASSERT_TRUE(s.size() == 4);
+  ASSERT_TRUE(s.count("1") == 1);
+  ASSERT_TRUE(s.count("4444") == 1);
+  ASSERT_TRUE(s.count("4") == 0);
+  ASSERT_TRUE(s.count("") == 0);
+}
+
 TEST(FlatHashSet, stress_test) {
   td::vector<td::RandomSteps::Step> steps;
   auto add_step = [&steps](td::Slice, td::uint32 weight, auto f) {
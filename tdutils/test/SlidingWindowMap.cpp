@@ -0,0 +1,109 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/List.h"
+#include "td/utils/Random.h"
+#include "td/utils/SlidingWindowMap.h"
+#include "td/utils/tests.h"
+
+#include <map>
+#include <utility>
+
+namespace {
+
+struct Value final : private td::ListNode {
+  td::uint64 key_;
+  td::unique_ptr<int> data_;
+
+  Value(td::uint64 key, td::ListNode *list) : key_(key), data_(td::make_unique<int>(static_cast<int>(key))) {
+    list->put(static_cast<td::ListNode *>(this));
+  }
+
+  static const Value *from_list_node(const td::ListNode *list_node) {
+    return static_cast<const Value *>(list_node);
+  }
+};
+
+}  // namespace
+
+TEST(SlidingWindowMap, stress) {
+  td::ListNode list;
+  td::SlidingWindowMap<td::uint64, Value> map;
+  std::map<td::uint64, td::uint64> reference;
+  td::uint64 next_key = 1000;
+
+  auto check = [&] {
+    ASSERT_EQ(reference.size(), map.size());
+    ASSERT_EQ(reference.empty(), map.empty());
+    size_t count = 0;
+    map.foreach([&](td::uint64 key, Value &value) {
+      ASSERT_EQ(key, value.key_);
+      ASSERT_EQ(static_cast<int>(key), *value.data_);
+      ASSERT_TRUE(reference.count(key) == 1);
+      count++;
+    });
+    ASSERT_EQ(reference.size(), count);
+    size_t list_size = 0;
+    for (auto it = list.next; it != &list; it = it->next) {
+      ASSERT_TRUE(reference.count(Value::from_list_node(it)->key_) == 1);
+      list_size++;
+    }
+    ASSERT_EQ(reference.size(), list_size);
+  };
+
+  for (int i = 0; i < 200000; i++) {
+    auto type = td::Random::fast(0, 99);
+    if (type < 45 || reference.empty()) {
+      auto key = next_key;
+      next_key += td::Random::fast(1, 100);
+      if (td::Random::fast(0, 99) == 0) {
+        key -= td::Random::fast(0, 2000);
+      }
+      auto result = map.emplace(key, Value(key, &list));
+      ASSERT_EQ(reference.count(key) == 0, result.second);
+      ASSERT_EQ(key, result.first->key_);
+      reference.emplace(key, key);
+    } else if (type < 90) {
+      // mostly erase one of the oldest keys
+      auto it = reference.begin();
+      auto skip = td::Random::fast(0, 99) < 90 ? td::Random::fast(0, 3) : td::Random::fast(0, 100);
+      for (int j = 0; j < skip && std::next(it) != reference.end(); j++) {
+        ++it;
+      }
+      auto key = it->first;
+      ASSERT_TRUE(map.get(key) != nullptr);
+      ASSERT_TRUE(map.erase(key));
+      ASSERT_TRUE(map.get(key) == nullptr);
+      ASSERT_TRUE(!map.erase(key));
+      reference.erase(it);
+    } else if (type < 99) {
+      auto key = next_key - td::Random::fast(0, 10000);
+      auto value = map.get(key);
+      ASSERT_EQ(reference.count(key) == 1, value != nullptr);
+      if (value != nullptr) {
+        ASSERT_EQ(key, value->key_);
+      }
+    } else {
+      auto mod = td::Random::fast(2, 10);
+      map.remove_if([&](td::uint64 key, Value &) {
+        if (key % mod == 0) {
+          reference.erase(key);
+          return true;
+        }
+        return false;
+      });
+    }
+    if (i % 1000 == 0) {
+      check();
+    }
+  }
+  check();
+
+  map.clear();
+  reference.clear();
+  check();
+}
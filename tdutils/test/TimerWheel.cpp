@@ -0,0 +1,138 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/common.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+#include "td/utils/TimerWheel.h"
+
+#include <map>
+#include <set>
+#include <utility>
+
+TEST(TimerWheel, simple) {
+  td::TimerWheel wheel(0.001);
+  ASSERT_TRUE(wheel.empty());
+  wheel.get_expired_keys(1000.0);
+
+  wheel.set_timeout(0, 1000.5);
+  wheel.set_timeout(1, 1000.002);
+  ASSERT_TRUE(!wheel.add_timeout(1, 1010.0));
+  ASSERT_TRUE(wheel.add_timeout(2, 2000000.0));
+  ASSERT_EQ(3u, wheel.size());
+  ASSERT_TRUE(wheel.has_timeout(0));
+  ASSERT_TRUE(!wheel.has_timeout(3));
+  ASSERT_TRUE(wheel.get_wakeup_time() <= 1000.003);
+
+  ASSERT_TRUE(wheel.get_expired_keys(1000.001).empty());
+  ASSERT_EQ(td::vector<td::int64>{1}, wheel.get_expired_keys(1000.003));
+  ASSERT_TRUE(wheel.cancel_timeout(0));
+  ASSERT_TRUE(!wheel.cancel_timeout(0));
+  wheel.set_timeout(3, 999.0);
+  ASSERT_EQ(td::vector<td::int64>{3}, wheel.get_expired_keys(1000.004));
+  ASSERT_TRUE(wheel.get_expired_keys(1999999.0).empty());
+  wheel.set_timeout(4, 1e20);
+  ASSERT_EQ((td::vector<td::int64>{2, 4}), wheel.pop_all_keys());
+  ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheel, stress) {
+  for (auto tick_duration : {0.001, 0.1}) {
+    td::TimerWheel wheel(tick_duration);
+    std::map<td::int64, double> timeouts;
+    std::set<std::pair<double, td::int64>> queue;
+    double now = 100.0;
+    wheel.get_expired_keys(now);
+
+    auto set_timeout = [&](td::int64 key, double timeout) {
+      auto it = timeouts.find(key);
+      if (it != timeouts.end()) {
+        queue.erase({it->second, key});
+      }
+      timeouts[key] = timeout;
+      queue.emplace(timeout, key);
+    };
+    auto erase_timeout = [&](td::int64 key) {
+      auto it = timeouts.find(key);
+      CHECK(it != timeouts.end());
+      queue.erase({it->second, key});
+      timeouts.erase(it);
+    };
+
+    for (int i = 0; i < 300000; i++) {
+      auto key = static_cast<td::int64>(td::Random::fast(-1000, 1000));
+      auto type = td::Random::fast(0, 99);
+      if (type < 30) {
+        double timeout;
+        switch (td::Random::fast(0, 3)) {
+          case 0:
+            timeout = now + td::Random::fast(0, 100) * 0.0001;
+            break;
+          case 1:
+            timeout = now + td::Random::fast(0, 100000) * 0.01;
+            break;
+          case 2:
+            timeout = now + td::Random::fast(0, 1000000) * 100.0;
+            break;
+          default:
+            timeout = now - td::Random::fast(0, 100) * 0.01;
+            break;
+        }
+        wheel.set_timeout(key, timeout);
+        set_timeout(key, timeout);
+      } else if (type < 40) {
+        auto timeout = now + td::Random::fast(0, 1000) * 0.01;
+        bool is_added = wheel.add_timeout(key, timeout);
+        ASSERT_EQ(timeouts.count(key) == 0, is_added);
+        if (is_added) {
+          set_timeout(key, timeout);
+        }
+      } else if (type < 60) {
+        bool is_cancelled = wheel.cancel_timeout(key);
+        ASSERT_EQ(timeouts.count(key) != 0, is_cancelled);
+        if (is_cancelled) {
+          erase_timeout(key);
+        }
+      } else if (type < 70) {
+        ASSERT_EQ(timeouts.count(key) != 0, wheel.has_timeout(key));
+      } else {
+        if (!queue.empty()) {
+          // the wheel must be woken up not later than the end of the tick of the first timeout or the current tick
+          auto first_timeout = td::max(queue.begin()->first, now);
+          auto first_tick_end =
+              static_cast<double>(static_cast<td::int64>(first_timeout / tick_duration) + 1) * tick_duration;
+          auto wakeup_time = wheel.get_wakeup_time();
+          ASSERT_TRUE(wakeup_time <= first_tick_end + 1e-9);
+          if (td::Random::fast(0, 1) == 0) {
+            now = td::max(now, wakeup_time);
+          }
+        }
+        if (td::Random::fast(0, 9) == 0) {
+          now += td::Random::fast(0, 1000000) * 0.01;
+        } else {
+          now += td::Random::fast(0, 100) * 0.0001;
+        }
+
+        auto expired_keys = wheel.get_expired_keys(now);
+        td::vector<td::int64> expected_keys;
+        while (!queue.empty() && queue.begin()->first < now) {
+          auto key_to_expire = queue.begin()->second;
+          expected_keys.push_back(key_to_expire);
+          erase_timeout(key_to_expire);
+        }
+        ASSERT_EQ(expected_keys, expired_keys);
+      }
+      ASSERT_EQ(timeouts.size(), wheel.size());
+    }
+
+    td::vector<td::int64> all_keys;
+    for (auto &timeout : queue) {
+      all_keys.push_back(timeout.second);
+    }
+    ASSERT_EQ(all_keys, wheel.pop_all_keys());
+    ASSERT_TRUE(wheel.empty());
+  }
+}
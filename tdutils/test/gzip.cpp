@@ -5,13 +5,17 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/utils/algorithm.h"
+#include "td/utils/BlobCompressor.h"
 #include "td/utils/buffer.h"
 #include "td/utils/ByteFlow.h"
 #include "td/utils/common.h"
+#include "td/utils/crypto.h"
 #include "td/utils/Gzip.h"
 #include "td/utils/GzipByteFlow.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/port/thread_local.h"
+#include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 #include "td/utils/tests.h"
@@ -29,6 +33,35 @@ TEST(Gzip, gzencode_gzdecode) {
   encode_decode(td::string(1000000, 'a'));
 }
 
+static td::string to_gzip_format(td::Slice zlib_data, td::Slice data) {
+  // replace zlib header and trailer with gzip header and trailer
+  td::string result("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+  result += zlib_data.substr(2, zlib_data.size() - 6).str();
+  auto append_uint32 = [&result](td::uint32 value) {
+    for (int i = 0; i < 4; i++) {
+      result += static_cast<char>((value >> (8 * i)) & 255);
+    }
+  };
+  append_uint32(td::crc32(data));
+  append_uint32(static_cast<td::uint32>(data.size()));
+  return result;
+}
+
+TEST(Gzip, gzdecode_gzip_format) {
+  for (auto &s : {td::rand_string(0, 255, 1000), td::rand_string('a', 'z', 1000000), td::string(1000000, 'a'),
+                  td::string(1, 'a')}) {
+    auto r = td::gzencode(s, 2);
+    ASSERT_TRUE(!r.empty());
+    auto gzip = to_gzip_format(r.as_slice(), s);
+    ASSERT_EQ(s, td::gzdecode(gzip));
+
+    // wrong size in the trailer
+    auto wrong_gzip = gzip;
+    wrong_gzip[wrong_gzip.size() - 4]++;
+    ASSERT_TRUE(td::gzdecode(wrong_gzip).empty());
+  }
+}
+
 static void test_gzencode(const td::string &s) {
   auto begin_time = td::Time::now();
   auto r = td::gzencode(s, td::max(2, static_cast<int>(100 / s.size())));
@@ -245,3 +278,68 @@ TEST(Gzip, decode_encode_flow_bomb) {
   td::clear_thread_locals();
   ASSERT_EQ(start_mem, td::BufferAllocator::get_buffer_mem());
 }
+
+static td::string get_tl_like_blob(int i) {
+  td::string result;
+  result += "\x01\x02\x00\x20";
+  result += td::to_string(i * 7919);
+  result += "|first_name|Telegram user|last_name|https://t.me/username";
+  result += td::rand_string('a', 'z', td::Random::fast(5, 50));
+  result += "|photo|small_file_id|big_file_id|dc_id|has_video|restriction_reason|emoji_status";
+  result += td::to_string(td::Random::fast(0, 1000000));
+  result += "|is_verified|is_premium|is_support|is_scam|is_fake|is_contact|is_mutual_contact";
+  while (result.size() % 4 != 0) {
+    result += '\0';
+  }
+  return result;
+}
+
+TEST(Gzip, blob_compressor) {
+  td::vector<td::string> sample_strings;
+  for (int i = 0; i < 1000; i++) {
+    sample_strings.push_back(get_tl_like_blob(i));
+  }
+  auto samples = td::transform(sample_strings, [](const td::string &sample) { return td::Slice(sample); });
+  auto dictionary = td::BlobCompressor::train_dictionary(samples);
+  ASSERT_TRUE(!dictionary.empty());
+  ASSERT_TRUE(dictionary.size() <= td::BlobCompressor::MAX_DICTIONARY_SIZE);
+
+  td::BlobCompressor compressor;
+  auto blob = get_tl_like_blob(12345);
+  ASSERT_EQ(blob, compressor.compress(td::BufferSlice(blob)).as_slice().str());
+
+  compressor.add_dictionary(1, dictionary);
+  ASSERT_EQ(1, compressor.get_dictionary_id());
+  auto compressed = compressor.compress(td::BufferSlice(blob));
+  ASSERT_TRUE(td::BlobCompressor::is_compressed(compressed.as_slice()));
+  ASSERT_TRUE(compressed.size() * 2 < blob.size());
+  ASSERT_EQ(blob, compressor.decompress(compressed.as_slice()).ok().as_slice().str());
+  ASSERT_EQ(blob, compressor.decompress(blob).ok().as_slice().str());
+
+  auto small_blob = td::string(16, 'a');
+  ASSERT_EQ(small_blob, compressor.compress(td::BufferSlice(small_blob)).as_slice().str());
+  auto random_blob = td::rand_string(0, 255, 1000);
+  ASSERT_EQ(random_blob, compressor.compress(td::BufferSlice(random_blob)).as_slice().str());
+
+  compressor.add_dictionary(2, td::BlobCompressor::train_dictionary(samples, 1000));
+  ASSERT_EQ(2, compressor.get_dictionary_id());
+  auto new_compressed = compressor.compress(td::BufferSlice(blob));
+  ASSERT_TRUE(new_compressed.as_slice() != compressed.as_slice());
+  ASSERT_EQ(blob, compressor.decompress(new_compressed.as_slice()).ok().as_slice().str());
+  ASSERT_EQ(blob, compressor.decompress(compressed.as_slice()).ok().as_slice().str());
+
+  td::BlobCompressor other_compressor;
+  ASSERT_TRUE(other_compressor.decompress(compressed.as_slice()).is_error());
+  auto broken = compressed.as_slice().str();
+  broken[0] ^= 0x55;
+  broken[1] ^= 0x55;
+  auto r_broken = compressor.decompress(broken);
+  ASSERT_TRUE(r_broken.is_error() || r_broken.ok().as_slice() != blob);
+  broken.back() = '\x07';
+  ASSERT_TRUE(compressor.decompress(broken).is_error());
+
+  for (int i = 0; i < 1000; i++) {
+    auto str = td::rand_string('a', 'c', td::Random::fast(0, 300) * 4);
+    ASSERT_EQ(str, compressor.decompress(compressor.compress(td::BufferSlice(str)).as_slice()).ok().as_slice().str());
+  }
+}
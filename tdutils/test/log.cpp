@@ -11,17 +11,23 @@
 #include "td/utils/format.h"
 #include "td/utils/logging.h"
 #include "td/utils/MemoryLog.h"
+#include "td/utils/misc.h"
 #include "td/utils/NullLog.h"
 #include "td/utils/port/path.h"
+#include "td/utils/port/sleep.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/tests.h"
+#include "td/utils/ThreadBufferedLog.h"
 #include "td/utils/TsFileLog.h"
 #include "td/utils/TsLog.h"
 
+#include <atomic>
 #include <functional>
 #include <limits>
+#include <string>
+#include <vector>
 
 char disable_linker_warning_about_empty_file_tdutils_test_log_cpp TD_UNUSED;
 
@@ -144,6 +150,30 @@ TEST(Log, Bench) {
     return td::make_unique<FileLog>();
   });
 
+  bench_log("FileLog + ThreadBufferedLog", [] {
+    class FileLog final : public td::LogInterface {
+     public:
+      FileLog() {
+        file_log_.init("tmplog", std::numeric_limits<td::int64>::max(), false).ensure();
+        buffered_log_.init(&file_log_);
+      }
+      void do_append(int log_level, td::CSlice slice) final {
+        static_cast<td::LogInterface &>(buffered_log_).do_append(log_level, slice);
+      }
+      void after_rotation() final {
+        buffered_log_.after_rotation();
+      }
+      std::vector<std::string> get_file_paths() final {
+        return buffered_log_.get_file_paths();
+      }
+
+     private:
+      td::FileLog file_log_;
+      td::ThreadBufferedLog buffered_log_;
+    };
+    return td::make_unique<FileLog>();
+  });
+
   bench_log("FileLog", [] {
     class FileLog final : public td::LogInterface {
      public:
@@ -184,4 +214,164 @@ TEST(Log, Bench) {
   });
 #endif
 }
+
+TEST(Log, ThreadBufferedLog) {
+  class CollectingLog final : public td::LogInterface {
+   public:
+    void do_append(int log_level, td::CSlice slice) final {
+      lines_.push_back(slice.str());
+    }
+
+    std::vector<std::string> lines_;
+  };
+
+  CollectingLog collecting_log;
+  {
+    // the buffer is small enough to be overflowed sometimes
+    td::ThreadBufferedLog buffered_log(1 << 12);
+    buffered_log.init(&collecting_log);
+
+    constexpr int THREAD_COUNT = 4;
+    constexpr int LINE_COUNT = 10000;
+    std::vector<td::thread> threads(THREAD_COUNT);
+    for (int i = 0; i < THREAD_COUNT; i++) {
+      threads[i] = td::thread([&buffered_log, i] {
+        for (int j = 0; j < LINE_COUNT; j++) {
+          auto line = PSTRING() << i << ' ' << j << ' ' << std::string(j % 100, 'a');
+          buffered_log.append(VERBOSITY_NAME(ERROR), line);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    buffered_log.append(VERBOSITY_NAME(ERROR), "main");
+    buffered_log.flush();
+    ASSERT_EQ(static_cast<size_t>(THREAD_COUNT * LINE_COUNT + 1), collecting_log.lines_.size());
+
+    // log lines from each thread must be written in order
+    std::vector<int> next_line(THREAD_COUNT);
+    for (auto &line : collecting_log.lines_) {
+      if (line == "main") {
+        continue;
+      }
+      auto parts = td::full_split(line, ' ');
+      ASSERT_EQ(3u, parts.size());
+      auto thread_id = td::to_integer<int>(parts[0]);
+      auto line_id = td::to_integer<int>(parts[1]);
+      ASSERT_EQ(next_line[thread_id], line_id);
+      ASSERT_EQ(static_cast<size_t>(line_id % 100), parts[2].size());
+      next_line[thread_id]++;
+    }
+
+    buffered_log.append(VERBOSITY_NAME(ERROR), "last");
+  }
+  // all log lines must be written on destruction
+  ASSERT_EQ("last", collecting_log.lines_.back());
+}
+
+TEST(Log, ThreadBufferedLogReinit) {
+  class ReinitableLog final : public td::LogInterface {
+   public:
+    void do_append(int log_level, td::CSlice slice) final {
+      if (is_reiniting_) {
+        appended_while_reiniting_ = true;
+      }
+      line_count_++;
+    }
+
+    bool is_reiniting_ = false;
+    bool appended_while_reiniting_ = false;
+    size_t line_count_ = 0;
+  };
+
+  ReinitableLog first_log;
+  ReinitableLog second_log;
+  td::ThreadBufferedLog buffered_log(1 << 12);
+  buffered_log.init(&first_log);
+
+  constexpr int THREAD_COUNT = 4;
+  constexpr int LINE_COUNT = 10000;
+  std::vector<td::thread> threads(THREAD_COUNT);
+  for (auto &thread : threads) {
+    thread = td::thread([&buffered_log] {
+      for (int j = 0; j < LINE_COUNT; j++) {
+        buffered_log.append(VERBOSITY_NAME(ERROR), PSLICE() << "line " << j);
+      }
+    });
+  }
+
+  for (int i = 0; i < 100; i++) {
+    auto *log = i % 2 == 0 ? &second_log : &first_log;
+    auto *old_log = i % 2 == 0 ? &first_log : &second_log;
+    buffered_log
+        .init(log,
+              [&] {
+                old_log->is_reiniting_ = true;
+                log->is_reiniting_ = true;
+                td::usleep_for(100);
+                old_log->is_reiniting_ = false;
+                log->is_reiniting_ = false;
+                return td::Status::OK();
+              })
+        .ensure();
+  }
+
+  // the underlying log must not be replaced if the initialization fails
+  buffered_log.flush();
+  auto second_log_line_count = second_log.line_count_;
+  auto status = buffered_log.init(&second_log, [] { return td::Status::Error("Failed"); });
+  ASSERT_TRUE(status.is_error());
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  buffered_log.flush();
+
+  ASSERT_TRUE(!first_log.appended_while_reiniting_);
+  ASSERT_TRUE(!second_log.appended_while_reiniting_);
+  ASSERT_EQ(static_cast<size_t>(THREAD_COUNT * LINE_COUNT), first_log.line_count_ + second_log.line_count_);
+  ASSERT_EQ(second_log_line_count, second_log.line_count_);
+}
+
+TEST(Log, ThreadBufferedLogStop) {
+  class CountingLog final : public td::LogInterface {
+   public:
+    void do_append(int log_level, td::CSlice slice) final {
+      line_count_++;
+    }
+
+    std::atomic<size_t> line_count_{0};
+  };
+
+  CountingLog counting_log;
+  td::ThreadBufferedLog buffered_log(1 << 12);
+  for (int i = 0; i < 3; i++) {
+    buffered_log.init(&counting_log);
+    auto line_count = counting_log.line_count_.load();
+
+    constexpr int THREAD_COUNT = 4;
+    constexpr int LINE_COUNT = 1000;
+    std::vector<td::thread> threads(THREAD_COUNT);
+    for (auto &thread : threads) {
+      thread = td::thread([&buffered_log] {
+        for (int j = 0; j < LINE_COUNT; j++) {
+          buffered_log.append(VERBOSITY_NAME(ERROR), PSLICE() << "line " << j);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    // all buffered log lines must be written by stop
+    buffered_log.stop();
+    ASSERT_EQ(line_count + THREAD_COUNT * LINE_COUNT, counting_log.line_count_.load());
+
+    // the stopped log must remain usable and write log lines synchronously
+    buffered_log.append(VERBOSITY_NAME(ERROR), "after stop");
+    ASSERT_EQ(line_count + THREAD_COUNT * LINE_COUNT + 1, counting_log.line_count_.load());
+    buffered_log.stop();
+  }
+}
 #endif
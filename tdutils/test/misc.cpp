@@ -42,6 +42,7 @@
 #include "td/utils/uint128.h"
 #include "td/utils/unicode.h"
 #include "td/utils/unique_value_ptr.h"
+#include "td/utils/Utf16OffsetIndex.h"
 #include "td/utils/utf8.h"
 
 #include <algorithm>
@@ -721,6 +722,81 @@ static void test_unicode(td::uint32 (*func)(td::uint32)) {
   }
 }
 
+static td::string get_random_utf8_string(int length) {
+  td::vector<td::Slice> characters{"a", "Z", " ", "\n", "\xD0\x96", "\xE2\x80\x94", "\xF0\x9F\x98\x80"};
+  td::string result;
+  for (int i = 0; i < length; i++) {
+    result += characters[td::Random::fast(0, static_cast<int>(characters.size()) - 1)].str();
+  }
+  return result;
+}
+
+TEST(Misc, Utf16OffsetIndex) {
+  for (int i = 0; i < 1000; i++) {
+    auto str = get_random_utf8_string(td::Random::fast(0, 1000));
+    auto utf16_length = static_cast<int>(td::utf8_utf16_length(str));
+    td::Utf16OffsetIndex index(str);
+    for (int j = 0; j < 100; j++) {
+      auto offset = static_cast<size_t>(td::Random::fast(0, utf16_length + 2));
+      auto length = static_cast<size_t>(td::Random::fast(0, utf16_length + 2));
+      ASSERT_TRUE(index.substr(offset) == td::utf8_utf16_substr(str, offset));
+      ASSERT_TRUE(index.substr(offset, length) == td::utf8_utf16_substr(str, offset, length));
+      ASSERT_TRUE(index.substr(offset, length).begin() == td::utf8_utf16_substr(str, offset, length).begin());
+    }
+  }
+}
+
+class Utf16SubstrBenchmark final : public td::Benchmark {
+ public:
+  explicit Utf16SubstrBenchmark(bool use_index) : use_index_(use_index) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "Utf16Substr" << (use_index_ ? "WithIndex" : "");
+  }
+
+  void start_up() final {
+    // a 4096-character message with 256 entities, which don't split surrogate pairs
+    text_.clear();
+    while (td::utf8_length(text_) < 4096) {
+      text_ += "Hello, \xD0\xBC\xD0\xB8\xD1\x80! ";
+    }
+    text_ = td::utf8_truncate(text_, 4096);
+    auto utf16_length = static_cast<int>(td::utf8_utf16_length(text_));
+    offsets_.clear();
+    for (int i = 0; i < 256; i++) {
+      offsets_.push_back(static_cast<size_t>(i) * utf16_length / 256);
+    }
+  }
+
+  void run(int n) final {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      if (use_index_) {
+        td::Utf16OffsetIndex index(text_);
+        for (auto offset : offsets_) {
+          result += index.substr(offset, 10).size();
+        }
+      } else {
+        for (auto offset : offsets_) {
+          result += td::utf8_utf16_substr(text_, offset, 10).size();
+        }
+      }
+    }
+    td::do_not_optimize_away(result);
+  }
+
+ private:
+  bool use_index_;
+  td::string text_;
+  td::vector<size_t> offsets_;
+};
+
+TEST(Misc, bench_utf16_substr) {
+  td::bench(Utf16SubstrBenchmark(false));
+  td::bench(Utf16SubstrBenchmark(true));
+}
+
 TEST(Misc, unicode) {
   test_unicode(td::prepare_search_character);
   test_unicode(td::unicode_to_lower);
@@ -6,6 +6,15 @@
 //
 #include "data.h"
 
+#include "td/telegram/DialogId.h"
+#include "td/telegram/HistoryPrefetcher.h"
+#include "td/telegram/MessageDb.h"
+#include "td/telegram/MessageFullId.h"
+#include "td/telegram/MessageId.h"
+#include "td/telegram/NotificationId.h"
+#include "td/telegram/ServerMessageId.h"
+#include "td/telegram/StartupSnapshot.h"
+
 #include "td/db/binlog/BinlogHelper.h"
 #include "td/db/binlog/ConcurrentBinlog.h"
 #include "td/db/BinlogKeyValue.h"
@@ -25,14 +34,20 @@
 #include "td/utils/filesystem.h"
 #include "td/utils/FlatHashMap.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
+#include "td/utils/Promise.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Status.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tests.h"
+#include "td/utils/tl_parsers.h"
 
+#include <algorithm>
 #include <limits>
 #include <map>
 #include <memory>
@@ -138,6 +153,49 @@ TEST(DB, binlog_encryption) {
   td::Binlog::destroy(binlog_name).ignore();
 }
 
+TEST(DB, binlog_crc_mismatch) {
+  td::CSlice binlog_name = "test_binlog";
+  td::Binlog::destroy(binlog_name).ignore();
+
+  td::vector<td::string> events;
+  {
+    td::Binlog binlog;
+    binlog.init(binlog_name.str(), [](const td::BinlogEvent &x) {}).ensure();
+    for (int i = 0; i < 50000; i++) {
+      events.push_back(td::rand_string('a', 'z', 4 * td::Random::fast(1, 25)));
+      binlog.add_raw_event(td::BinlogEvent::create_raw(binlog.next_event_id(), 1, 0, td::create_storer(events.back())),
+                           td::BinlogDebugInfo{__FILE__, __LINE__});
+    }
+    binlog.close().ensure();
+  }
+
+  auto load = [&] {
+    td::vector<td::string> v;
+    td::Binlog binlog;
+    binlog.init(binlog_name.str(), [&](const td::BinlogEvent &x) { v.push_back(x.get_data().str()); }).ensure();
+    binlog.close().ensure();
+    return v;
+  };
+  ASSERT_TRUE(load() == events);
+
+  // corrupt data of an event in the middle of the binlog
+  auto content = td::read_file_str(binlog_name).move_as_ok();
+  size_t offset = 0;
+  size_t event_count = 0;
+  while (offset < content.size() / 2) {
+    offset += static_cast<td::uint32>(td::TlParser(td::Slice(content).substr(offset, 4)).fetch_int());
+    event_count++;
+  }
+  content[offset + td::BinlogEvent::HEADER_SIZE] ^= 1;
+  td::write_file(binlog_name, content).ensure();
+
+  events.resize(event_count);
+  ASSERT_TRUE(load() == events);
+  ASSERT_TRUE(load() == events);
+
+  td::Binlog::destroy(binlog_name).ignore();
+}
+
 TEST(DB, sqlite_lfs) {
   td::string path = "test_sqlite_db";
   td::SqliteDb::destroy(path).ignore();
@@ -807,3 +865,245 @@ TEST(DB, persistent_key_value) {
   }
   td::SqliteDb::destroy(path).ignore();
 }
+
+TEST(DB, message_db_dialog_fts) {
+  td::CSlice path = "message_db_fts.sqlite";
+  td::SqliteDb::destroy(path).ignore();
+
+  {
+    auto db = td::SqliteDb::open_with_key(path, true, td::DbKey::empty()).move_as_ok();
+    db.begin_write_transaction().ensure();
+    td::init_message_db(db, 0).ensure();
+    db.commit_transaction().ensure();
+  }
+  td::ConcurrentScheduler sched(0, 0);
+  auto guard = sched.get_main_guard();
+  auto connection = std::make_shared<td::SqliteConnectionSafe>(path.str(), td::DbKey::empty());
+  auto message_db_sync_safe = td::create_message_db_sync(connection);
+  auto &message_db = message_db_sync_safe->get();
+
+  td::DialogId dialog_id(static_cast<td::int64>(123));
+  td::DialogId other_dialog_id(static_cast<td::int64>(456));
+  std::map<td::MessageId, td::int64> expected_search_ids;
+  td::vector<int> server_message_ids;
+  for (int i = 1; i <= 300; i++) {
+    server_message_ids.push_back(i);
+  }
+  td::Random::shuffle(server_message_ids);
+  message_db.begin_write_transaction().ensure();
+  for (auto server_message_id : server_message_ids) {
+    auto message_dialog_id = td::Random::fast(0, 3) == 0 ? other_dialog_id : dialog_id;
+    auto message_id = td::MessageId(td::ServerMessageId(server_message_id));
+    // messages are added in random order and often have the same date, so their search_id differ only in random bits
+    auto date = 1700000000 + td::Random::fast(0, 5);
+    auto search_id = (static_cast<td::int64>(date) << 32) | static_cast<td::uint32>(td::Random::secure_int32());
+    bool is_found = td::Random::fast(0, 2) != 0;
+    if (is_found && message_dialog_id == dialog_id) {
+      expected_search_ids[message_id] = search_id;
+    }
+    message_db.add_message(td::MessageFullId(message_dialog_id, message_id), td::ServerMessageId(), td::DialogId(), 0,
+                           0, 0, search_id, is_found ? "hello world" : "other text", td::NotificationId(),
+                           td::MessageId(), td::BufferSlice(td::to_string(search_id)));
+  }
+  message_db.commit_transaction().ensure();
+
+  // results in a chat are returned from the newest message to the oldest
+  td::MessageDbFtsQuery query;
+  query.query = "hello";
+  query.dialog_id = dialog_id;
+  query.limit = 7;
+  td::vector<td::MessageId> found_message_ids;
+  while (true) {
+    auto result = message_db.get_messages_fts(query);
+    ASSERT_TRUE(result.messages.size() <= 7u);
+    if (result.messages.empty()) {
+      break;
+    }
+    for (auto &message : result.messages) {
+      ASSERT_EQ(dialog_id, message.dialog_id);
+      ASSERT_TRUE(found_message_ids.empty() || message.message_id < found_message_ids.back());
+      ASSERT_EQ(expected_search_ids[message.message_id], td::to_integer<td::int64>(message.data.as_slice()));
+      found_message_ids.push_back(message.message_id);
+    }
+    ASSERT_TRUE(result.next_search_id != query.from_search_id);
+    query.from_search_id = result.next_search_id;
+  }
+  ASSERT_EQ(expected_search_ids.size(), found_message_ids.size());
+
+  // an offset, which was returned by the global index, continues the search in the order of search_id
+  td::vector<td::int64> search_ids;
+  for (auto &it : expected_search_ids) {
+    search_ids.push_back(it.second);
+  }
+  std::sort(search_ids.begin(), search_ids.end());
+  query.from_search_id = search_ids[search_ids.size() / 2];
+  query.limit = 1000;
+  auto result = message_db.get_messages_fts(query);
+  ASSERT_EQ(search_ids.size() / 2, result.messages.size());
+  for (size_t i = 0; i < result.messages.size(); i++) {
+    ASSERT_EQ(search_ids[search_ids.size() / 2 - 1 - i], td::to_integer<td::int64>(result.messages[i].data.as_slice()));
+  }
+
+  message_db_sync_safe.reset();
+  connection->close_and_destroy();
+}
+
+TEST(DB, history_prefetcher) {
+  auto message_id = [](td::int32 server_message_id) {
+    return td::MessageId(td::ServerMessageId(server_message_id));
+  };
+  auto get_page = [&](td::int32 from_server_message_id, size_t count) {
+    td::vector<td::MessageDbDialogMessage> messages;
+    for (size_t i = 0; i < count; i++) {
+      auto server_message_id = from_server_message_id - static_cast<td::int32>(i);
+      messages.push_back({message_id(server_message_id), td::BufferSlice(td::to_string(server_message_id))});
+    }
+    return messages;
+  };
+  auto is_page = [&](const td::vector<td::MessageDbDialogMessage> &messages, td::int32 from_server_message_id,
+                     size_t count) {
+    if (messages.size() != count) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      auto server_message_id = from_server_message_id - static_cast<td::int32>(i);
+      if (messages[i].message_id != message_id(server_message_id) ||
+          messages[i].data.as_slice() != td::to_string(server_message_id)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  int finished_query_count = 0;
+  auto create_promise = [&finished_query_count] {
+    return td::PromiseCreator::lambda([&finished_query_count](td::Unit) { finished_query_count++; });
+  };
+
+  const td::int32 page_size = 10;
+  td::HistoryPrefetcher prefetcher(page_size);
+  td::DialogId dialog_id(static_cast<td::int64>(1));
+  auto last_database_message_id = message_id(100);
+  td::vector<td::HistoryPrefetcher::WaitingQuery> dropped_queries;
+  td::HistoryPrefetcher::Page page;
+  td::HistoryPrefetcher::WaitingQuery waiting_query;
+
+  // opening of a chat doesn't prefetch anything
+  ASSERT_EQ(0u, prefetcher.on_page_loaded(dialog_id, td::MessageId::max(), true, message_id(91),
+                                          last_database_message_id, dropped_queries));
+  auto promise = create_promise();
+  ASSERT_TRUE(prefetcher.get_page(dialog_id, message_id(91), page_size, false, promise, page) ==
+              td::HistoryPrefetcher::GetPageResult::NotFound);
+
+  // the next page is prefetched after the second consecutive page
+  auto prefetch_id = prefetcher.on_page_loaded(dialog_id, message_id(91), false, message_id(81),
+                                               last_database_message_id, dropped_queries);
+  ASSERT_TRUE(prefetch_id != 0);
+  ASSERT_EQ(0u, prefetcher.on_page_loaded(dialog_id, message_id(91), false, message_id(81),
+                                          last_database_message_id, dropped_queries));
+
+  // a query, sent before the prefetch is loaded, waits for it and receives a prefix of the prefetched page
+  ASSERT_TRUE(prefetcher.get_page(dialog_id, message_id(81), 5, true, promise, page) ==
+              td::HistoryPrefetcher::GetPageResult::Waiting);
+  auto second_promise = create_promise();
+  ASSERT_TRUE(prefetcher.get_page(dialog_id, message_id(81), 5, true, second_promise, page) ==
+              td::HistoryPrefetcher::GetPageResult::NotFound);
+  ASSERT_TRUE(prefetcher.on_prefetch_loaded(dialog_id, prefetch_id, get_page(81, page_size), waiting_query, page));
+  ASSERT_EQ(message_id(81), waiting_query.from_message_id_);
+  ASSERT_EQ(5, waiting_query.limit_);
+  ASSERT_TRUE(waiting_query.only_local_);
+  ASSERT_EQ(last_database_message_id, page.old_last_database_message_id_);
+  ASSERT_TRUE(is_page(page.messages_, 81, 5));
+  waiting_query.promise_.set_value(td::Unit());
+  ASSERT_EQ(1, finished_query_count);
+
+  // the page loaded from the prefetch continues the scrolling
+  prefetch_id = prefetcher.on_page_loaded(dialog_id, message_id(81), false, message_id(71), last_database_message_id,
+                                          dropped_queries);
+  ASSERT_TRUE(prefetch_id != 0);
+  ASSERT_TRUE(!prefetcher.on_prefetch_loaded(dialog_id, prefetch_id, get_page(71, page_size), waiting_query, page));
+  ASSERT_TRUE(prefetcher.get_page(dialog_id, message_id(71), page_size + 1, false, second_promise, page) ==
+              td::HistoryPrefetcher::GetPageResult::NotFound);
+  ASSERT_TRUE(prefetcher.get_page(dialog_id, message_id(71), page_size, false, second_promise, page) ==
+              td::HistoryPrefetcher::GetPageResult::Found);
+  ASSERT_TRUE(is_page(page.messages_, 71, page_size));
+  auto third_promise = create_promise();
+  ASSERT_TRUE(prefetcher.get_page(dialog_id, message_id(71), page_size, false, third_promise, page) ==
+              td::HistoryPrefetcher::GetPageResult::NotFound);
+
+  // a change of the database drops the prefetch, and the waiting query must be resent
+  prefetch_id = prefetcher.on_page_loaded(dialog_id, message_id(71), false, message_id(61), last_database_message_id,
+                                          dropped_queries);
+  ASSERT_TRUE(prefetch_id != 0);
+  ASSERT_TRUE(prefetcher.get_page(dialog_id, message_id(61), page_size, false, third_promise, page) ==
+              td::HistoryPrefetcher::GetPageResult::Waiting);
+  ASSERT_TRUE(prefetcher.drop_prefetch(td::DialogId(static_cast<td::int64>(2))).empty());
+  auto queries = prefetcher.drop_prefetch(dialog_id);
+  ASSERT_EQ(1u, queries.size());
+  ASSERT_EQ(dialog_id, queries[0].dialog_id_);
+  ASSERT_EQ(message_id(61), queries[0].from_message_id_);
+  ASSERT_EQ(page_size, queries[0].limit_);
+  ASSERT_TRUE(!prefetcher.on_prefetch_loaded(dialog_id, prefetch_id, get_page(61, page_size), waiting_query, page));
+  auto fourth_promise = create_promise();
+  ASSERT_TRUE(prefetcher.get_page(dialog_id, message_id(61), page_size, false, fourth_promise, page) ==
+              td::HistoryPrefetcher::GetPageResult::NotFound);
+  queries[0].promise_.set_value(td::Unit());
+  ASSERT_EQ(2, finished_query_count);
+
+  // the scrolling continues after the drop, but a jump to another message doesn't prefetch anything
+  ASSERT_TRUE(prefetcher.on_page_loaded(dialog_id, message_id(61), false, message_id(51), last_database_message_id,
+                                        dropped_queries) != 0);
+  ASSERT_EQ(0u, prefetcher.on_page_loaded(dialog_id, message_id(20), false, message_id(10), last_database_message_id,
+                                          dropped_queries));
+  ASSERT_TRUE(prefetcher.on_page_loaded(dialog_id, message_id(10), false, td::MessageId(), last_database_message_id,
+                                        dropped_queries) == 0);
+  ASSERT_TRUE(dropped_queries.empty());
+
+  // prefetches of the least recently scrolled chats are dropped
+  for (td::int64 i = 1; i <= 17; i++) {
+    td::DialogId other_dialog_id(i + 10);
+    prefetcher.on_page_loaded(other_dialog_id, td::MessageId::max(), true, message_id(91), last_database_message_id,
+                              dropped_queries);
+    prefetch_id = prefetcher.on_page_loaded(other_dialog_id, message_id(91), false, message_id(81),
+                                            last_database_message_id, dropped_queries);
+    ASSERT_TRUE(prefetch_id != 0);
+    if (i == 1) {
+      ASSERT_TRUE(prefetcher.get_page(other_dialog_id, message_id(81), page_size, false, fourth_promise, page) ==
+                  td::HistoryPrefetcher::GetPageResult::Waiting);
+    }
+  }
+  ASSERT_EQ(1u, dropped_queries.size());
+  ASSERT_EQ(td::DialogId(static_cast<td::int64>(11)), dropped_queries[0].dialog_id_);
+  dropped_queries[0].promise_.set_value(td::Unit());
+  ASSERT_EQ(3, finished_query_count);
+}
+
+TEST(DB, startup_snapshot_file) {
+  td::string path = "startup_snapshot.test";
+  td::unlink(path).ignore();
+
+  auto data = td::rand_string(0, 255, 1000);
+  auto token = td::write_startup_snapshot_file(path, data).move_as_ok();
+  ASSERT_TRUE(!token.empty());
+  ASSERT_EQ(data, td::read_startup_snapshot_file(path, token));
+
+  // the snapshot can be loaded only once
+  ASSERT_TRUE(td::stat(path).is_error());
+  ASSERT_EQ("", td::read_startup_snapshot_file(path, token));
+
+  // a snapshot saved with another token is ignored and deleted
+  auto old_token = td::write_startup_snapshot_file(path, data).move_as_ok();
+  auto new_token = td::write_startup_snapshot_file(path, data).move_as_ok();
+  ASSERT_TRUE(old_token != new_token);
+  ASSERT_EQ("", td::read_startup_snapshot_file(path, old_token));
+  ASSERT_TRUE(td::stat(path).is_error());
+  ASSERT_EQ("", td::read_startup_snapshot_file(path, new_token));
+
+  // a broken snapshot is ignored
+  token = td::write_startup_snapshot_file(path, data).move_as_ok();
+  auto content = td::read_file_str(path).move_as_ok();
+  content.back() ^= 1;
+  td::write_file(path, content).ensure();
+  ASSERT_EQ("", td::read_startup_snapshot_file(path, token));
+  ASSERT_TRUE(td::stat(path).is_error());
+}
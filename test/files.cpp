@@ -0,0 +1,318 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/files/FileEncryptionKey.h"
+#include "td/telegram/files/FileLoaderUtils.h"
+#include "td/telegram/files/FileLocation.h"
+#include "td/telegram/files/PartsManager.h"
+#include "td/telegram/files/ResourceManager.h"
+#include "td/telegram/files/SharedFileCache.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
+
+#include "td/utils/common.h"
+#include "td/utils/crypto.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+#include "td/utils/Promise.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+#include "td/utils/tests.h"
+
+#include <memory>
+#include <utility>
+
+class TestFilePartHashes final : public td::Actor {
+ public:
+  explicit TestFilePartHashes(td::string path) : path_(std::move(path)) {
+  }
+
+ private:
+  static constexpr size_t PART_SIZE = 1 << 17;
+  static constexpr int PART_COUNT = 5;
+
+  td::string path_;
+  td::vector<td::FilePartHash> part_hashes_;
+  int step_ = 0;
+
+  void start_up() final {
+    td::string data = td::rand_string(0, 255, PART_SIZE * PART_COUNT);
+    auto fd = td::FileFd::open(path_, td::FileFd::Write | td::FileFd::Create | td::FileFd::Truncate).move_as_ok();
+    ASSERT_EQ(data.size(), fd.write(data).move_as_ok());
+    fd.close();
+
+    for (int i = 0; i < PART_COUNT; i++) {
+      auto part = td::Slice(data).substr(i * PART_SIZE, PART_SIZE);
+      td::string hash(32, ' ');
+      td::sha256(part, hash);
+      part_hashes_.emplace_back(static_cast<td::int64>(i * PART_SIZE), PART_SIZE, std::move(hash));
+    }
+    loop();
+  }
+
+  void check(td::string path, td::vector<td::FilePartHash> part_hashes) {
+    // the check is done on another scheduler and the result is returned asynchronously
+    td::check_file_part_hashes(1, std::move(path), std::move(part_hashes),
+                               td::PromiseCreator::lambda([actor_id = actor_id(this)](td::Result<bool> r_is_valid) {
+                                 td::send_closure(actor_id, &TestFilePartHashes::on_check, std::move(r_is_valid));
+                               }));
+  }
+
+  void loop() final {
+    switch (step_) {
+      case 0:
+        return check(path_, part_hashes_);
+      case 1: {
+        auto part_hashes = part_hashes_;
+        part_hashes[3].hash_[td::Random::fast(0, 31)] ^= 1;
+        return check(path_, std::move(part_hashes));
+      }
+      case 2:
+        return check(path_ + ".missing", part_hashes_);
+      default:
+        td::Scheduler::instance()->finish();
+        stop();
+    }
+  }
+
+  void on_check(td::Result<bool> r_is_valid) {
+    switch (step_) {
+      case 0:
+        ASSERT_TRUE(r_is_valid.is_ok());
+        ASSERT_TRUE(r_is_valid.ok());
+        break;
+      case 1:
+        ASSERT_TRUE(r_is_valid.is_ok());
+        ASSERT_TRUE(!r_is_valid.ok());
+        break;
+      case 2:
+        ASSERT_TRUE(r_is_valid.is_error());
+        break;
+      default:
+        UNREACHABLE();
+    }
+    step_++;
+    loop();
+  }
+};
+
+constexpr size_t TestFilePartHashes::PART_SIZE;
+constexpr int TestFilePartHashes::PART_COUNT;
+
+TEST(Files, check_file_part_hashes) {
+  td::ConcurrentScheduler sched(1, 0);
+  td::string path = "file_part_hashes.test";
+  sched.create_actor_unsafe<TestFilePartHashes>(0, "TestFilePartHashes", path).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+  td::unlink(path).ignore();
+}
+
+class TestSharedFileCache final : public td::Actor {
+ public:
+  explicit TestSharedFileCache(td::string directory) : directory_(std::move(directory)) {
+  }
+
+ private:
+  static constexpr td::int64 FILE_SIZE = 1 << 16;
+
+  td::string directory_;
+  td::string data_;
+  std::shared_ptr<td::SharedFileCache> shared_file_cache_;
+  td::ActorOwn<td::SharedFileCacheWorker> worker_;
+  td::string key_ = "file";
+  td::string cached_path_;
+  int lookup_count_ = 0;
+  int waiting_lookup_id_ = 0;
+
+  static bool is_shareable(td::int64 offset, td::int64 limit) {
+    return td::SharedFileCache::is_shareable_download(td::LocalFileLocation(), FILE_SIZE, td::FileEncryptionKey(),
+                                                      offset, limit);
+  }
+
+  td::SharedFileCache::LookupResult lookup(td::string &path) {
+    auto lookup_id = ++lookup_count_;
+    auto promise =
+        td::PromiseCreator::lambda([actor_id = actor_id(this), lookup_id](td::Result<td::string> r_cached_path) {
+          td::send_closure(actor_id, &TestSharedFileCache::on_waited_download, lookup_id, std::move(r_cached_path));
+        });
+    auto result = shared_file_cache_->lookup(key_, FILE_SIZE, path, promise);
+    if (result == td::SharedFileCache::LookupResult::Wait) {
+      waiting_lookup_id_ = lookup_id;
+    }
+    return result;
+  }
+
+  void start_up() final {
+    td::mkdir(directory_).ensure();
+    data_ = td::rand_string('a', 'z', static_cast<size_t>(FILE_SIZE));
+    auto downloaded_path = directory_ + TD_DIR_SLASH + "downloaded";
+    td::write_file(downloaded_path, data_).ensure();
+
+    shared_file_cache_ = td::SharedFileCache::get(directory_ + TD_DIR_SLASH + "cache");
+    // file operations are done on another scheduler
+    worker_ = td::create_actor_on_scheduler<td::SharedFileCacheWorker>("SharedFileCacheWorker", 1);
+
+    // the first full download becomes the owner of the download
+    ASSERT_TRUE(is_shareable(0, 0));
+    td::string path;
+    ASSERT_TRUE(lookup(path) == td::SharedFileCache::LookupResult::Download);
+
+    // the second full download waits for the first one
+    ASSERT_TRUE(is_shareable(0, 0));
+    ASSERT_TRUE(lookup(path) == td::SharedFileCache::LookupResult::Wait);
+
+    // ranged and streaming downloads neither wait nor become the owner
+    ASSERT_TRUE(!is_shareable(FILE_SIZE / 2, FILE_SIZE / 4));
+    ASSERT_TRUE(!is_shareable(0, FILE_SIZE / 4));
+    ASSERT_TRUE(!is_shareable(FILE_SIZE / 2, 0));
+
+    td::send_closure(worker_, &td::SharedFileCacheWorker::finish_download, shared_file_cache_, key_,
+                     std::move(downloaded_path));
+  }
+
+  void on_waited_download(int lookup_id, td::Result<td::string> r_cached_path) {
+    if (lookup_id != waiting_lookup_id_) {
+      // the promise is lost if the lookup didn't wait for the download
+      return;
+    }
+    ASSERT_TRUE(r_cached_path.is_ok());
+    cached_path_ = r_cached_path.move_as_ok();
+
+    // the next full download finds the file in the cache
+    td::string path;
+    ASSERT_TRUE(lookup(path) == td::SharedFileCache::LookupResult::Found);
+    ASSERT_EQ(cached_path_, path);
+
+    td::send_closure(worker_, &td::SharedFileCacheWorker::import_file, cached_path_,
+                     directory_ + TD_DIR_SLASH + "imported",
+                     td::PromiseCreator::lambda([actor_id = actor_id(this)](td::Result<td::Unit> result) {
+                       td::send_closure(actor_id, &TestSharedFileCache::on_imported, std::move(result));
+                     }));
+  }
+
+  void on_imported(td::Result<td::Unit> result) {
+    ASSERT_TRUE(result.is_ok());
+    ASSERT_EQ(data_, td::read_file_str(directory_ + TD_DIR_SLASH + "imported").move_as_ok());
+    ASSERT_EQ(data_, td::read_file_str(cached_path_).move_as_ok());
+
+    td::Scheduler::instance()->finish();
+    stop();
+  }
+};
+
+constexpr td::int64 TestSharedFileCache::FILE_SIZE;
+
+TEST(Files, shared_file_cache) {
+  td::ConcurrentScheduler sched(1, 0);
+  td::string directory = "shared_file_cache.test";
+  td::rmrf(directory).ignore();
+  sched.create_actor_unsafe<TestSharedFileCache>(0, "TestSharedFileCache", directory).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+  td::rmrf(directory).ignore();
+}
+
+TEST(Files, shared_file_cache_eviction) {
+  const td::int64 file_size = 1 << 12;
+  td::string directory = "shared_file_cache_eviction.test";
+  td::rmrf(directory).ignore();
+  td::mkdir(directory).ensure();
+  auto shared_file_cache = td::SharedFileCache::get(directory + TD_DIR_SLASH + "cache");
+  shared_file_cache->set_max_size(file_size * 5 / 2);
+
+  auto lookup = [&](const td::string &key) {
+    td::string path;
+    td::Promise<td::string> promise;
+    return shared_file_cache->lookup(key, file_size, path, promise);
+  };
+  auto add_file = [&](const td::string &key) {
+    ASSERT_TRUE(lookup(key) == td::SharedFileCache::LookupResult::Download);
+    auto downloaded_path = directory + TD_DIR_SLASH + key;
+    td::write_file(downloaded_path, td::rand_string('a', 'z', static_cast<size_t>(file_size))).ensure();
+    shared_file_cache->finish_download(key, std::move(downloaded_path));
+  };
+
+  add_file("1");
+  add_file("2");
+  // the first file becomes the most recently used
+  ASSERT_TRUE(lookup("1") == td::SharedFileCache::LookupResult::Found);
+  add_file("3");
+
+  // the least recently used file is removed, when the cache becomes too big
+  ASSERT_TRUE(lookup("1") == td::SharedFileCache::LookupResult::Found);
+  ASSERT_TRUE(lookup("3") == td::SharedFileCache::LookupResult::Found);
+  ASSERT_TRUE(lookup("2") == td::SharedFileCache::LookupResult::Download);
+  shared_file_cache->finish_download("2", td::Status::Error("Canceled"));
+
+  shared_file_cache = nullptr;
+  td::rmrf(directory).ignore();
+}
+
+TEST(Files, resource_manager_limit) {
+  const td::int64 min_limit = 1 << 20;
+  td::ResourceManager resource_manager(min_limit, td::ResourceManager::Mode::Baseline);
+  ASSERT_EQ(min_limit, resource_manager.get_max_resource_limit());
+
+  // 16 MB/s with 1 second minimal part load time give the maximum limit
+  resource_manager.on_part_loaded(16 << 20, 1.0);
+  ASSERT_EQ(8 * min_limit, resource_manager.get_max_resource_limit());
+
+  resource_manager.on_part_failed(td::Status::Error(420, "FLOOD_WAIT_1"));
+  resource_manager.on_part_failed(td::Status::Error(400, "FILE_REFERENCE_EXPIRED"));
+  ASSERT_EQ(8 * min_limit, resource_manager.get_max_resource_limit());
+
+  resource_manager.on_part_failed(td::Status::Error(-503, "Timeout"));
+  ASSERT_EQ(4 * min_limit, resource_manager.get_max_resource_limit());
+  resource_manager.on_part_failed(td::Status::Error(500, "Session failed"));
+  ASSERT_EQ(2 * min_limit, resource_manager.get_max_resource_limit());
+
+  resource_manager.on_part_loaded(16 << 20, 1.0);
+  ASSERT_EQ(8 * min_limit, resource_manager.get_max_resource_limit());
+}
+
+TEST(Files, resource_manager_preferred_part_size) {
+  class Callback final : public td::ResourceManager::Callback {
+   public:
+    explicit Callback(td::vector<size_t> &preferred_part_sizes) : preferred_part_sizes_(preferred_part_sizes) {
+    }
+
+   private:
+    td::vector<size_t> &preferred_part_sizes_;
+
+    void on_preferred_part_size_changed(size_t preferred_part_size) final {
+      preferred_part_sizes_.push_back(preferred_part_size);
+    }
+  };
+
+  td::vector<size_t> preferred_part_sizes;
+  td::ResourceManager resource_manager(1 << 20, td::ResourceManager::Mode::Baseline,
+                                       td::make_unique<Callback>(preferred_part_sizes));
+
+  // slow download has no preferred part size
+  resource_manager.on_part_loaded(64 << 10, 1.0);
+  ASSERT_TRUE(preferred_part_sizes.empty());
+
+  // the speed is measured again after each timeout
+  resource_manager.on_part_failed(td::Status::Error(-503, "Timeout"));
+  resource_manager.on_part_loaded(16 << 20, 1.0);
+  ASSERT_EQ(1u, preferred_part_sizes.size());
+  ASSERT_TRUE(preferred_part_sizes[0] == td::PartsManager::MAX_PART_SIZE);
+
+  // the callback is called only if the preferred part size changes
+  resource_manager.on_part_failed(td::Status::Error(-503, "Timeout"));
+  resource_manager.on_part_loaded(16 << 20, 1.0);
+  ASSERT_EQ(1u, preferred_part_sizes.size());
+}
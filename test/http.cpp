@@ -12,8 +12,13 @@
 
 #include "td/net/HttpChunkedByteFlow.h"
 #include "td/net/HttpHeaderCreator.h"
+#include "td/net/HttpInboundConnection.h"
 #include "td/net/HttpQuery.h"
 #include "td/net/HttpReader.h"
+#include "td/net/TcpListener.h"
+
+#include "td/actor/actor.h"
+#include "td/actor/ConcurrentScheduler.h"
 
 #include "td/utils/AesCtrByteFlow.h"
 #include "td/utils/algorithm.h"
@@ -23,15 +28,20 @@
 #include "td/utils/ByteFlow.h"
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
+#include "td/utils/filesystem.h"
 #include "td/utils/format.h"
 #include "td/utils/Gzip.h"
 #include "td/utils/GzipByteFlow.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/port/detail/NativeFd.h"
 #include "td/utils/port/detail/PollableFd.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/IPAddress.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/PollFlags.h"
+#include "td/utils/port/SocketFd.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
@@ -41,10 +51,17 @@
 #include "td/utils/UInt.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <limits>
 #include <mutex>
 
+#if TD_PORT_POSIX
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 static td::string make_chunked(const td::string &str) {
   auto v = td::rand_split(str);
   td::string res;
@@ -533,6 +550,247 @@ TEST(Http, form_data) {
   ASSERT_TRUE(!q.files_[0].temp_file_name.empty());
 }
 
+#if TD_PORT_POSIX
+class HttpFileResponder final : public td::HttpInboundConnection::Callback {
+ public:
+  HttpFileResponder(td::string file_path, td::int64 offset, td::int64 size)
+      : file_path_(std::move(file_path)), offset_(offset), size_(size) {
+  }
+
+  void handle(td::unique_ptr<td::HttpQuery> query, td::ActorOwn<td::HttpInboundConnection> connection) final {
+    auto connection_id = connection.release();
+    td::HttpHeaderCreator hc;
+    hc.init_ok();
+    hc.set_keep_alive();
+    hc.set_content_size(static_cast<size_t>(size_));
+    send_closure(connection_id, &td::HttpInboundConnection::write_next, td::BufferSlice(hc.finish().ok()));
+    send_closure(connection_id, &td::HttpInboundConnection::write_next_file,
+                 td::FileFd::open(file_path_, td::FileFd::Read).move_as_ok(), offset_, size_);
+    send_closure(connection_id, &td::HttpInboundConnection::write_ok);
+  }
+
+  void hangup() final {
+    td::Scheduler::instance()->finish();
+    stop();
+  }
+
+ private:
+  td::string file_path_;
+  td::int64 offset_;
+  td::int64 size_;
+};
+
+TEST(Http, write_next_file) {
+  td::string file_path = "http_write_next_file.txt";
+  td::unlink(file_path).ignore();
+
+  auto file_content = td::rand_string('a', 'z', 3 << 20);
+  td::int64 offset = 12345;
+  td::int64 size = static_cast<td::int64>(file_content.size()) - offset - 321;
+  ASSERT_TRUE(td::write_file(file_path, file_content).is_ok());
+
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  auto server_fd = td::SocketFd::from_native_fd(td::NativeFd(fds[0])).move_as_ok();
+  int client_fd = fds[1];
+
+  // two pipelined queries are followed by a query, which can't be parsed and must close the connection
+  td::string request =
+      "GET /1 HTTP/1.1\r\n\r\n"
+      "GET /2 HTTP/1.1\r\n\r\n"
+      "POST /3 HTTP/1.1\r\nTransfer-Encoding: abc\r\n\r\n";
+  td::string response;
+  td::thread client([&] {
+    td::Slice to_write = request;
+    while (!to_write.empty()) {
+      auto written = ::write(client_fd, to_write.data(), to_write.size());
+      CHECK(written > 0);
+      to_write.remove_prefix(static_cast<size_t>(written));
+    }
+    char buf[1 << 16];
+    while (true) {
+      auto read_size = ::read(client_fd, buf, sizeof(buf));
+      CHECK(read_size >= 0);
+      if (read_size == 0) {
+        break;
+      }
+      response.append(buf, static_cast<size_t>(read_size));
+    }
+  });
+
+  td::ConcurrentScheduler sched(0, 0);
+  {
+    auto guard = sched.get_main_guard();
+    td::create_actor<td::HttpInboundConnection>(
+        "HttpInboundConnection", td::BufferedFd<td::SocketFd>(std::move(server_fd)), 1 << 20, 0, 0,
+        td::create_actor<HttpFileResponder>("HttpFileResponder", file_path, offset, size))
+        .release();
+  }
+  sched.start();
+  while (sched.run_main(10)) {
+  }
+  sched.finish();
+  client.join();
+  ::close(client_fd);
+  td::unlink(file_path).ignore();
+
+  td::HttpHeaderCreator hc;
+  hc.init_ok();
+  hc.set_keep_alive();
+  hc.set_content_size(static_cast<size_t>(size));
+  auto file_response =
+      hc.finish().ok().str() + file_content.substr(static_cast<size_t>(offset), static_cast<size_t>(size));
+  ASSERT_TRUE(response.size() > 2 * file_response.size());
+  ASSERT_EQ(file_response + file_response, response.substr(0, 2 * file_response.size()));
+  ASSERT_TRUE(td::begins_with(response.substr(2 * file_response.size()), "HTTP/1.1 501"));
+}
+
+TEST(Http, write_next_file_truncated) {
+  td::string file_path = "http_write_next_file_truncated.txt";
+  td::unlink(file_path).ignore();
+
+  // the file is shorter than the announced response, so the connection must be closed after its end is sent
+  auto file_content = td::rand_string('a', 'z', 1 << 20);
+  td::int64 size = static_cast<td::int64>(file_content.size()) + 12345;
+  ASSERT_TRUE(td::write_file(file_path, file_content).is_ok());
+
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  auto server_fd = td::SocketFd::from_native_fd(td::NativeFd(fds[0])).move_as_ok();
+  int client_fd = fds[1];
+
+  td::string request = "GET /1 HTTP/1.1\r\n\r\n";
+  td::string response;
+  td::thread client([&] {
+    CHECK(::write(client_fd, request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+    char buf[1 << 16];
+    while (true) {
+      auto read_size = ::read(client_fd, buf, sizeof(buf));
+      CHECK(read_size >= 0);
+      if (read_size == 0) {
+        break;
+      }
+      response.append(buf, static_cast<size_t>(read_size));
+    }
+  });
+
+  td::ConcurrentScheduler sched(0, 0);
+  {
+    auto guard = sched.get_main_guard();
+    td::create_actor<td::HttpInboundConnection>(
+        "HttpInboundConnection", td::BufferedFd<td::SocketFd>(std::move(server_fd)), 1 << 20, 0, 0,
+        td::create_actor<HttpFileResponder>("HttpFileResponder", file_path, 0, size))
+        .release();
+  }
+  sched.start();
+  while (sched.run_main(10)) {
+  }
+  sched.finish();
+  client.join();
+  ::close(client_fd);
+  td::unlink(file_path).ignore();
+
+  td::HttpHeaderCreator hc;
+  hc.init_ok();
+  hc.set_keep_alive();
+  hc.set_content_size(static_cast<size_t>(size));
+  ASSERT_EQ(hc.finish().ok().str() + file_content, response);
+}
+#endif
+
+#if TD_LINUX
+class ShardedTcpListenerTester final : public td::Actor {
+ public:
+  static constexpr int SHARD_COUNT = 3;
+
+  ShardedTcpListenerTester(int port, std::array<std::atomic<int>, SHARD_COUNT + 1> &accepted_counts)
+      : port_(port), accepted_counts_(accepted_counts) {
+  }
+
+ private:
+  static constexpr int MAX_CONNECTION_COUNT = 1000;
+
+  int port_;
+  std::array<std::atomic<int>, SHARD_COUNT + 1> &accepted_counts_;
+  td::ActorOwn<td::ShardedTcpListener> listener_;
+  td::vector<td::SocketFd> client_fds_;
+  int connection_count_ = 0;
+
+  void start_up() final {
+    td::vector<td::int32> scheduler_ids;
+    for (int i = 1; i <= SHARD_COUNT; i++) {
+      scheduler_ids.push_back(i);
+    }
+    listener_ = td::create_actor<td::ShardedTcpListener>(
+        "ShardedTcpListener", port_, std::move(scheduler_ids),
+        [&accepted_counts = accepted_counts_](td::SocketFd fd) {
+          accepted_counts[td::Scheduler::instance()->sched_id()]++;
+        },
+        "127.0.0.1");
+    set_timeout_in(0.001);
+  }
+
+  bool are_all_shards_used() const {
+    for (int i = 1; i <= SHARD_COUNT; i++) {
+      if (accepted_counts_[i] == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void timeout_expired() final {
+    if (are_all_shards_used() || connection_count_ >= MAX_CONNECTION_COUNT) {
+      listener_.reset();
+      td::Scheduler::instance()->finish();
+      stop();
+      return;
+    }
+
+    // the connections are established by the kernel even before they are accepted
+    td::IPAddress ip_address;
+    ip_address.init_ipv4_port("127.0.0.1", port_).ensure();
+    auto r_socket_fd = td::SocketFd::open(ip_address);
+    if (r_socket_fd.is_ok()) {
+      connection_count_++;
+      if (client_fds_.size() >= 100) {
+        client_fds_.clear();
+      }
+      client_fds_.push_back(r_socket_fd.move_as_ok());
+    }
+    set_timeout_in(0.001);
+  }
+};
+
+TEST(Http, sharded_tcp_listener) {
+  constexpr int SHARD_COUNT = ShardedTcpListenerTester::SHARD_COUNT;
+  std::array<std::atomic<int>, SHARD_COUNT + 1> accepted_counts;
+  for (auto &accepted_count : accepted_counts) {
+    accepted_count = 0;
+  }
+  auto port = td::Random::fast(20000, 60000);
+
+  td::ConcurrentScheduler sched(SHARD_COUNT, 0);
+  {
+    auto guard = sched.get_main_guard();
+    td::create_actor<ShardedTcpListenerTester>("ShardedTcpListenerTester", port, accepted_counts).release();
+  }
+  sched.start();
+  while (sched.run_main(10)) {
+  }
+  sched.finish();
+
+  // connections must be accepted on all shards and never on the scheduler of the listener
+  int total_accepted_count = 0;
+  for (int i = 1; i <= SHARD_COUNT; i++) {
+    ASSERT_TRUE(accepted_counts[i] > 0);
+    total_accepted_count += accepted_counts[i];
+  }
+  ASSERT_EQ(0, accepted_counts[0].load());
+  ASSERT_TRUE(total_accepted_count < 1000);
+}
+#endif
+
 #if TD_DARWIN_WATCH_OS
 struct Baton {
   std::mutex mutex;
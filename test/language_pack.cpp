@@ -0,0 +1,72 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/LanguagePackFile.h"
+
+#include "td/utils/common.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/port/path.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/tests.h"
+
+#include <map>
+#include <utility>
+
+TEST(LanguagePackFile, simple) {
+  td::string path = "test_language_pack.langpack";
+  td::unlink(path).ignore();
+
+  for (int size : {0, 1, 2, 3, 10, 100, 5000}) {
+    std::map<td::string, td::string> strings;
+    while (static_cast<int>(strings.size()) < size) {
+      auto key = td::rand_string('a', 'z', td::Random::fast(1, 20));
+      auto value = td::rand_string('0', '9', td::Random::fast(0, 50));
+      value.insert(value.begin(), static_cast<char>(td::Random::fast('1', '2')));
+      strings[key] = value;
+    }
+    td::vector<std::pair<td::Slice, td::Slice>> file_strings;
+    for (auto &str : strings) {
+      file_strings.emplace_back(str.first, str.second);
+    }
+    td::Random::shuffle(file_strings);
+
+    ASSERT_TRUE(td::LanguagePackFile::write(path, size + 1, size, file_strings).is_ok());
+    auto r_file = td::LanguagePackFile::open(path);
+    ASSERT_TRUE(r_file.is_ok());
+    auto file = r_file.move_as_ok();
+    ASSERT_EQ(size + 1, file.get_version());
+    ASSERT_EQ(size, file.get_key_count());
+
+    for (auto &str : strings) {
+      ASSERT_EQ(str.second, file.get(str.first));
+      ASSERT_TRUE(file.has(str.first));
+    }
+    for (int i = 0; i < 100; i++) {
+      auto key = td::rand_string('a', 'z', td::Random::fast(21, 30));
+      ASSERT_TRUE(!file.has(key));
+    }
+    ASSERT_TRUE(file.get(td::Slice()).empty());
+
+    std::map<td::string, td::string> file_content;
+    file.for_each([&](td::Slice key, td::Slice value) { file_content.emplace(key.str(), value.str()); });
+    ASSERT_TRUE(strings == file_content);
+  }
+
+  td::vector<std::pair<td::Slice, td::Slice>> duplicate_strings{{"a", "1a"}, {"a", "1b"}};
+  ASSERT_TRUE(td::LanguagePackFile::write(path, 1, 2, duplicate_strings).is_error());
+
+  auto content = td::read_file_str(path).move_as_ok();
+  content.pop_back();
+  td::write_file(path, content).ensure();
+  ASSERT_TRUE(td::LanguagePackFile::open(path).is_error());
+  content[0] ^= 1;
+  content.push_back('a');
+  td::write_file(path, content).ensure();
+  ASSERT_TRUE(td::LanguagePackFile::open(path).is_error());
+
+  td::unlink(path).ignore();
+}
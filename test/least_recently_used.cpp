@@ -0,0 +1,178 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2024
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/LeastRecentlyUsed.h"
+#include "td/telegram/UserId.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/tests.h"
+#include "td/utils/WaitFreeHashMap.h"
+
+#include <algorithm>
+
+namespace {
+
+struct TestFullInfo {
+  td::string about;
+  double last_used_time = 0.0;
+  size_t estimated_size = 0;
+  bool is_changed = false;
+};
+
+// mimics the way UserManager keeps full infos: objects are saved to a database, unloaded by size and loaded again
+// from the database on the next access
+class TestFullInfoManager {
+ public:
+  explicit TestFullInfoManager(size_t max_size) : max_size_(max_size) {
+  }
+
+  TestFullInfo *get_full_info(td::int64 user_id) {
+    return full_infos_.get_pointer(td::UserId(user_id));
+  }
+
+  TestFullInfo *get_full_info_force(td::int64 user_id) {
+    auto full_info = get_full_info(user_id);
+    if (full_info != nullptr) {
+      full_info->last_used_time = ++time_;
+      return full_info;
+    }
+    auto it = database_.find(td::UserId(user_id));
+    if (it == database_.end()) {
+      return nullptr;
+    }
+    unloaded_full_infos_.on_load(td::UserId(user_id));
+    full_info = add_full_info(user_id);
+    full_info->about = it->second;
+    unloaded_full_infos_.on_size_changed(full_info->estimated_size, sizeof(TestFullInfo) + it->second.size());
+    return full_info;
+  }
+
+  void set_about(td::int64 user_id, td::string about) {
+    auto full_info = get_full_info_force(user_id);
+    if (full_info == nullptr) {
+      full_info = add_full_info(user_id);
+    }
+    full_info->about = std::move(about);
+    save_full_info(full_info, td::UserId(user_id));
+  }
+
+  td::vector<td::UserId> unload_full_infos() {
+    auto user_ids = td::get_least_recently_used_keys(
+        full_infos_, unloaded_full_infos_.get_total_size(), max_size_,
+        [](td::UserId, const TestFullInfo *full_info) { return !full_info->is_changed; });
+    for (auto user_id : user_ids) {
+      unloaded_full_infos_.on_unload(user_id, full_infos_.get_pointer(user_id)->estimated_size);
+      full_infos_.erase(user_id);
+    }
+    std::sort(user_ids.begin(), user_ids.end(), [](td::UserId lhs, td::UserId rhs) { return lhs.get() < rhs.get(); });
+    return user_ids;
+  }
+
+  size_t get_loaded_count() const {
+    return full_infos_.calc_size();
+  }
+
+  const td::UnloadedObjects<td::UserId, td::UserIdHash> &get_unloaded_full_infos() const {
+    return unloaded_full_infos_;
+  }
+
+ private:
+  TestFullInfo *add_full_info(td::int64 user_id) {
+    auto &full_info = full_infos_[td::UserId(user_id)];
+    CHECK(full_info == nullptr);
+    full_info = td::make_unique<TestFullInfo>();
+    full_info->last_used_time = ++time_;
+    return full_info.get();
+  }
+
+  void save_full_info(TestFullInfo *full_info, td::UserId user_id) {
+    unloaded_full_infos_.on_size_changed(full_info->estimated_size, sizeof(TestFullInfo) + full_info->about.size());
+    database_[user_id] = full_info->about;
+  }
+
+  size_t max_size_ = 0;
+  double time_ = 0.0;
+  td::WaitFreeHashMap<td::UserId, td::unique_ptr<TestFullInfo>, td::UserIdHash> full_infos_;
+  td::UnloadedObjects<td::UserId, td::UserIdHash> unloaded_full_infos_;
+  td::FlatHashMap<td::UserId, td::string, td::UserIdHash> database_;
+};
+
+td::vector<td::UserId> get_user_ids(td::vector<td::int64> user_ids) {
+  return td::transform(user_ids, [](td::int64 user_id) { return td::UserId(user_id); });
+}
+
+}  // namespace
+
+TEST(LeastRecentlyUsed, unload_by_size) {
+  const size_t object_size = sizeof(TestFullInfo) + 100;
+  TestFullInfoManager manager(3 * object_size);
+  for (int i = 1; i <= 5; i++) {
+    manager.set_about(i, td::string(100, static_cast<char>('a' + i)));
+  }
+  ASSERT_EQ(5 * object_size, manager.get_unloaded_full_infos().get_total_size());
+
+  manager.get_full_info_force(1);
+  manager.get_full_info(2)->is_changed = true;
+  ASSERT_TRUE(manager.unload_full_infos() == get_user_ids({3, 4}));
+  ASSERT_EQ(3u, manager.get_loaded_count());
+  ASSERT_EQ(3 * object_size, manager.get_unloaded_full_infos().get_total_size());
+  ASSERT_TRUE(manager.unload_full_infos().empty());
+
+  // a bigger object displaces several smaller ones
+  manager.set_about(6, td::string(150, 'x'));
+  ASSERT_TRUE(manager.unload_full_infos() == get_user_ids({1, 5}));
+  ASSERT_TRUE(manager.get_full_info(2) != nullptr);
+  ASSERT_TRUE(manager.get_full_info(6) != nullptr);
+  ASSERT_TRUE(manager.get_unloaded_full_infos().get_total_size() <= 3 * object_size);
+  ASSERT_EQ(4, manager.get_unloaded_full_infos().get_unload_count());
+  ASSERT_EQ(0, manager.get_unloaded_full_infos().get_reload_count());
+
+  // the changed object is kept even if the budget can't be met without unloading it
+  manager.get_full_info(6)->is_changed = true;
+  manager.set_about(2, td::string(1000, 'y'));
+  ASSERT_TRUE(manager.unload_full_infos().empty());
+  ASSERT_EQ(2u, manager.get_loaded_count());
+}
+
+TEST(LeastRecentlyUsed, unload_and_reload) {
+  const size_t max_size = 10 * (sizeof(TestFullInfo) + 50);
+  TestFullInfoManager manager(max_size);
+  auto get_about = [](td::int64 user_id) {
+    return td::string(static_cast<size_t>(user_id % 100), static_cast<char>('a' + user_id % 26));
+  };
+  for (int i = 1; i <= 100; i++) {
+    manager.set_about(i, get_about(i));
+    manager.unload_full_infos();
+    ASSERT_TRUE(manager.get_unloaded_full_infos().get_total_size() <= max_size);
+  }
+  ASSERT_TRUE(manager.get_loaded_count() < 100u);
+  auto unload_count = manager.get_unloaded_full_infos().get_unload_count();
+  ASSERT_EQ(static_cast<td::int64>(100 - manager.get_loaded_count()), unload_count);
+
+  // unloaded objects are transparently loaded again with the same content
+  td::int64 reload_count = 0;
+  for (int i = 1; i <= 100; i++) {
+    bool is_loaded = manager.get_full_info(i) != nullptr;
+    auto full_info = manager.get_full_info_force(i);
+    ASSERT_TRUE(full_info != nullptr);
+    ASSERT_EQ(get_about(i), full_info->about);
+    if (!is_loaded) {
+      reload_count++;
+    }
+    ASSERT_EQ(reload_count, manager.get_unloaded_full_infos().get_reload_count());
+    manager.unload_full_infos();
+    ASSERT_TRUE(manager.get_unloaded_full_infos().get_total_size() <= max_size);
+  }
+  ASSERT_TRUE(reload_count > 0);
+
+  // an object, which was loaded again, is counted as reloaded only once per unload
+  manager.get_full_info_force(100);
+  manager.get_full_info_force(100);
+  ASSERT_EQ(reload_count, manager.get_unloaded_full_infos().get_reload_count());
+  ASSERT_TRUE(manager.get_full_info_force(101) == nullptr);
+}
@@ -721,6 +721,39 @@ TEST(MessageEntities, url) {
   check_url("_.test.com", {"_.test.com"});
 }
 
+TEST(MessageEntities, find_entities_fuzz) {
+  // the prefix contains all characters, which are needed to find entities, so no entity recognizer is skipped
+  td::string prefix = "@#$/:.0\n";
+  auto prefix_length = static_cast<td::int32>(td::utf8_utf16_length(prefix));
+  td::vector<td::string> parts{"a",  "Z",  "0",  "1",  "5",   " ",    "@",   "#",   "$",   "/",  ":",
+                               ".",  "-",  "_",  "\n", "tg", "http", "com", "ABC", "gif", "<", "\xD0\x96",
+                               "\xE2\x80\x8C", "\xE2\x80\x94", "\xF0\x9F\x98\x80"};
+  for (int i = 0; i < 100000; i++) {
+    td::string str;
+    int part_n = td::Random::fast(1, 100);
+    for (int j = 0; j < part_n; j++) {
+      str += parts[td::Random::fast(0, static_cast<int>(parts.size()) - 1)];
+    }
+    bool skip_bot_commands = td::Random::fast_bool();
+    bool skip_media_timestamps = td::Random::fast_bool();
+
+    td::vector<td::MessageEntity> expected;
+    for (auto &entity : td::find_entities(prefix + str, skip_bot_commands, skip_media_timestamps)) {
+      if (entity.offset < prefix_length) {
+        ASSERT_TRUE(entity.offset + entity.length <= prefix_length);
+        continue;
+      }
+      entity.offset -= prefix_length;
+      expected.push_back(entity);
+    }
+    auto result = td::find_entities(str, skip_bot_commands, skip_media_timestamps);
+    if (result != expected) {
+      LOG(FATAL) << td::tag("text", str) << td::tag("got", td::format::as_array(result))
+                 << td::tag("expected", td::format::as_array(expected));
+    }
+  }
+}
+
 static void check_fix_formatted_text(td::string str, td::vector<td::MessageEntity> entities,
                                      const td::string &expected_str,
                                      const td::vector<td::MessageEntity> &expected_entities, bool allow_empty = true,
@@ -5,22 +5,28 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/telegram/ConfigManager.h"
+#include "td/telegram/net/DcId.h"
+#include "td/telegram/net/DcOptions.h"
+#include "td/telegram/net/DcOptionsSet.h"
 #include "td/telegram/net/PublicRsaKeySharedMain.h"
 #include "td/telegram/net/Session.h"
 #include "td/telegram/NotificationManager.h"
 #include "td/telegram/telegram_api.h"
 
 #include "td/mtproto/AuthData.h"
+#include "td/mtproto/AuthKey.h"
 #include "td/mtproto/DhCallback.h"
 #include "td/mtproto/DhHandshake.h"
 #include "td/mtproto/Handshake.h"
 #include "td/mtproto/HandshakeActor.h"
+#include "td/mtproto/PacketInfo.h"
 #include "td/mtproto/Ping.h"
 #include "td/mtproto/PingConnection.h"
 #include "td/mtproto/ProxySecret.h"
 #include "td/mtproto/RawConnection.h"
 #include "td/mtproto/RSA.h"
 #include "td/mtproto/TlsInit.h"
+#include "td/mtproto/Transport.h"
 #include "td/mtproto/TransportType.h"
 
 #include "td/net/GetHostByNameActor.h"
@@ -30,7 +36,10 @@
 #include "td/actor/actor.h"
 #include "td/actor/ConcurrentScheduler.h"
 
+#include "td/utils/algorithm.h"
+#include "td/utils/as.h"
 #include "td/utils/base64.h"
+#include "td/utils/buffer.h"
 #include "td/utils/BufferedFd.h"
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
@@ -44,6 +53,7 @@
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/Storer.h"
 #include "td/utils/tests.h"
 #include "td/utils/Time.h"
 
@@ -140,6 +150,42 @@ TEST(Time, parse_http_date) {
   ASSERT_EQ(784887151, td::HttpDate::parse_http_date("Tue, 15 Nov 1994 08:12:31 GMT").move_as_ok());
 }
 
+TEST(Mtproto, dc_option_stats) {
+  auto get_dc_options = [] {
+    td::DcOptions dc_options;
+    for (td::string ip : {"149.154.167.51", "95.161.76.100"}) {
+      td::IPAddress ip_address;
+      ip_address.init_ipv4_port(ip, 443).ensure();
+      dc_options.dc_options.emplace_back(td::DcId::internal(2), ip_address);
+    }
+    return dc_options;
+  };
+  auto get_stats = [](td::DcOptionsSet &dc_options_set, bool only_http) {
+    auto connections = dc_options_set.find_all_connections(td::DcId::internal(2), false, false, false, only_http);
+    ASSERT_EQ(2u, connections.size());
+    return td::transform(connections, [](const td::DcOptionsSet::ConnectionInfo &info) { return info.stat; });
+  };
+
+  td::DcOptionsSet dc_options_set;
+  dc_options_set.add_dc_options(get_dc_options());
+  auto tcp_stats = get_stats(dc_options_set, false);
+  auto http_stats = get_stats(dc_options_set, true);
+  tcp_stats[0]->on_rtt(0.1);
+  http_stats[0]->on_rtt(0.5);
+  http_stats[1]->on_rtt(0.7);
+
+  td::DcOptionsSet new_dc_options_set;
+  new_dc_options_set.set_serialized_option_stats(dc_options_set.get_serialized_option_stats());
+  new_dc_options_set.add_dc_options(get_dc_options());
+  auto new_tcp_stats = get_stats(new_dc_options_set, false);
+  auto new_http_stats = get_stats(new_dc_options_set, true);
+  for (size_t i = 0; i < 2; i++) {
+    ASSERT_EQ(tcp_stats[i]->rtt, new_tcp_stats[i]->rtt);
+    ASSERT_EQ(http_stats[i]->rtt, new_http_stats[i]->rtt);
+  }
+  ASSERT_EQ(0.0, new_tcp_stats[1]->rtt);
+}
+
 TEST(Mtproto, config) {
   int threads_n = 0;
   td::ConcurrentScheduler sched(threads_n, 0);
@@ -741,3 +787,39 @@ TEST(Mtproto, RSA) {
   rsa.encrypt(pem.substr(0, 256), to);
   ASSERT_EQ("U2nJEtB2AgpHrm3HB0yhpTQgb0wbesi9Pv/W1v/vULU=", td::base64_encode(td::sha256(to)));
 }
+
+TEST(Mtproto, server_transport) {
+  td::string key(256, '\0');
+  td::Random::secure_bytes(key);
+  td::mtproto::AuthKey auth_key(td::mtproto::DhHandshake::calc_key_id(key), td::string(key));
+
+  // msg_id:long seqno:int bytes:int body:Object
+  td::string message(32, '\0');
+  td::Random::secure_bytes(message);
+  td::as<td::int32>(&message[12]) = 16;
+
+  for (auto is_server : {false, true}) {
+    td::mtproto::PacketInfo packet_info;
+    packet_info.version = 2;
+    packet_info.is_server = is_server;
+    packet_info.salt = 1;
+    packet_info.session_id = 2;
+    auto packet = td::mtproto::Transport::write(td::create_storer(message), auth_key, &packet_info).as_buffer_slice();
+
+    auto packet_copy = packet.copy();
+    td::mtproto::PacketInfo same_side_packet_info;
+    same_side_packet_info.version = 2;
+    same_side_packet_info.is_server = is_server;
+    ASSERT_TRUE(
+        td::mtproto::Transport::read(packet_copy.as_mutable_slice(), auth_key, &same_side_packet_info).is_error());
+
+    td::mtproto::PacketInfo other_side_packet_info;
+    other_side_packet_info.version = 2;
+    other_side_packet_info.is_server = !is_server;
+    auto r_read_result = td::mtproto::Transport::read(packet.as_mutable_slice(), auth_key, &other_side_packet_info);
+    ASSERT_TRUE(r_read_result.is_ok());
+    ASSERT_EQ(message, r_read_result.ok().packet().str());
+    ASSERT_EQ(1u, other_side_packet_info.salt);
+    ASSERT_EQ(2u, other_side_packet_info.session_id);
+  }
+}
@@ -101,3 +101,50 @@ TEST(QueryMerger, stress) {
   }
   sched.finish();
 }
+
+class TestQueryMergerDelay final : public td::Actor {
+  void start_up() final {
+    query_merger_.set_merge_function([](td::vector<td::int64> query_ids, td::Promise<td::Unit> &&promise) {
+      // all queries must be merged into one request
+      ASSERT_EQ(static_cast<std::size_t>(QUERY_COUNT), query_ids.size());
+      for (int i = 0; i < QUERY_COUNT; i++) {
+        ASSERT_EQ(i + 1, query_ids[i]);
+      }
+      promise.set_value(td::Unit());
+    });
+    for (int i = 0; i < QUERY_COUNT; i++) {
+      td::create_actor<td::SleepActor>("AddMergeQuery", 0.01 * i,
+                                       td::PromiseCreator::lambda([actor_id = actor_id(this), i](td::Unit) {
+                                         send_closure(actor_id, &TestQueryMergerDelay::add_query, i + 1);
+                                       }))
+          .release();
+    }
+  }
+
+  void add_query(td::int64 query_id) {
+    query_merger_.add_query(query_id, td::PromiseCreator::lambda([this](td::Result<td::Unit> result) {
+                              ASSERT_TRUE(result.is_ok());
+                              if (++completed_query_count_ == QUERY_COUNT) {
+                                td::Scheduler::instance()->finish();
+                              }
+                            }),
+                            "TestQueryMergerDelay::add_query");
+  }
+
+  static constexpr int QUERY_COUNT = 3;
+
+  td::QueryMerger query_merger_{"QueryMerger", 1, 10, 0.2};
+  int completed_query_count_ = 0;
+};
+
+constexpr int TestQueryMergerDelay::QUERY_COUNT;
+
+TEST(QueryMerger, delay) {
+  td::ConcurrentScheduler sched(0, 0);
+  sched.create_actor_unsafe<TestQueryMergerDelay>(0, "TestQueryMergerDelay").release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+}
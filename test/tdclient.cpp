@@ -9,7 +9,9 @@
 #include "td/telegram/Client.h"
 #include "td/telegram/ClientActor.h"
 #include "td/telegram/files/PartsManager.h"
+#include "td/telegram/HibernatableTd.h"
 #include "td/telegram/td_api.h"
+#include "td/telegram/TdCallback.h"
 
 #include "td/actor/actor.h"
 #include "td/actor/ConcurrentScheduler.h"
@@ -1094,6 +1096,49 @@ TEST(Client, ManagerClose) {
   ASSERT_EQ(send_count.load(), receive_count.load());
   ASSERT_TRUE(request_ids.empty());
 }
+
+TEST(Client, ManagerSharded) {
+  td::ClientManager client_manager;
+  int shard_count = 4;
+  int clients_n = 100;
+  int requests_n = 10;
+  ASSERT_TRUE(!client_manager.set_receive_shard_count(0));
+  ASSERT_TRUE(client_manager.set_receive_shard_count(shard_count));
+
+  td::vector<td::ClientManager::ClientId> client_ids;
+  for (int i = 0; i < clients_n; i++) {
+    client_ids.push_back(client_manager.create_client_id());
+  }
+  ASSERT_TRUE(!client_manager.set_receive_shard_count(shard_count + 1));
+  for (int request_id = 1; request_id <= requests_n; request_id++) {
+    for (auto client_id : client_ids) {
+      client_manager.send(client_id, request_id, td::make_tl_object<td::td_api::testSquareInt>(request_id));
+    }
+  }
+
+  std::atomic<int> response_count{0};
+  td::vector<td::thread> threads;
+  for (int shard = 0; shard < shard_count; shard++) {
+    threads.emplace_back([&, shard] {
+      std::map<td::ClientManager::ClientId, td::uint64> last_request_ids;
+      while (response_count.load() != clients_n * requests_n) {
+        auto response = client_manager.receive(shard, 0.1);
+        if (response.object == nullptr || response.request_id == 0) {
+          continue;
+        }
+        ASSERT_EQ(shard, client_manager.get_receive_shard(response.client_id));
+        ASSERT_EQ(td::td_api::testInt::ID, response.object->get_id());
+        auto &last_request_id = last_request_ids[response.client_id];
+        ASSERT_EQ(last_request_id + 1, response.request_id);
+        last_request_id = response.request_id;
+        response_count++;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
 #endif
 #endif
 
@@ -1179,6 +1224,260 @@ TEST(Client, ManagerCloseOneThread) {
   ASSERT_TRUE(sent_requests.empty());
 }
 
+struct FakeTdState {
+  int created_count = 0;
+  int hangup_count = 0;
+  int destroyed_count = 0;
+  td::string database_encryption_key;
+};
+
+// answers requests immediately and closes after a delay like a real Td
+class FakeTd final : public td::Actor {
+ public:
+  struct Options {
+    std::shared_ptr<FakeTdState> state;
+    double close_delay = 0.0;
+    double resume_delay = 0.0;
+  };
+
+  FakeTd(td::unique_ptr<td::TdCallback> callback, Options options)
+      : callback_(std::move(callback)), options_(std::move(options)) {
+    options_.state->created_count++;
+  }
+  FakeTd(const FakeTd &) = delete;
+  FakeTd &operator=(const FakeTd &) = delete;
+  FakeTd(FakeTd &&) = delete;
+  FakeTd &operator=(FakeTd &&) = delete;
+  ~FakeTd() final {
+    options_.state->destroyed_count++;
+  }
+
+  void request(td::uint64 id, td::td_api::object_ptr<td::td_api::Function> function) {
+    if (is_closing_) {
+      return callback_->on_error(id, td::td_api::make_object<td::td_api::error>(500, "Request aborted"));
+    }
+    if (function->get_id() == td::td_api::setTdlibParameters::ID) {
+      if (static_cast<const td::td_api::setTdlibParameters &>(*function).database_encryption_key_ !=
+          options_.state->database_encryption_key) {
+        return callback_->on_error(id,
+                                   td::td_api::make_object<td::td_api::error>(401, "Wrong database encryption key"));
+      }
+      if (options_.state->created_count > 1 && options_.resume_delay > 0) {
+        delayed_request_id_ = id;
+        return set_timeout_in(options_.resume_delay);
+      }
+      return set_ready(id);
+    }
+    if (function->get_id() == td::td_api::close::ID) {
+      callback_->on_result(id, td::td_api::make_object<td::td_api::ok>());
+      return hangup();
+    }
+    if (!is_ready_) {
+      return callback_->on_error(id, td::td_api::make_object<td::td_api::error>(400, "Unexpected request"));
+    }
+    if (function->get_id() == td::td_api::setDatabaseEncryptionKey::ID) {
+      options_.state->database_encryption_key =
+          static_cast<const td::td_api::setDatabaseEncryptionKey &>(*function).new_encryption_key_;
+    }
+    callback_->on_result(id, td::td_api::make_object<td::td_api::ok>());
+  }
+
+ private:
+  td::unique_ptr<td::TdCallback> callback_;
+  Options options_;
+  td::uint64 delayed_request_id_ = 0;
+  bool is_ready_ = false;
+  bool is_closing_ = false;
+
+  void set_ready(td::uint64 id) {
+    is_ready_ = true;
+    callback_->on_result(0, td::td_api::make_object<td::td_api::updateAuthorizationState>(
+                                td::td_api::make_object<td::td_api::authorizationStateReady>()));
+    callback_->on_result(id, td::td_api::make_object<td::td_api::ok>());
+  }
+
+  void hangup() final {
+    options_.state->hangup_count++;
+    is_closing_ = true;
+    if (delayed_request_id_ != 0) {
+      callback_->on_error(delayed_request_id_, td::td_api::make_object<td::td_api::error>(500, "Request aborted"));
+      delayed_request_id_ = 0;
+    }
+    set_timeout_in(options_.close_delay);
+  }
+
+  void timeout_expired() final {
+    if (is_closing_) {
+      return stop();
+    }
+    CHECK(delayed_request_id_ != 0);
+    set_ready(delayed_request_id_);
+    delayed_request_id_ = 0;
+  }
+};
+
+class TestHibernatableTd final : public td::Actor {
+ public:
+  enum class Scenario : td::int32 { Close, CloseWhileHibernating, HangupWhileResuming, ChangeKey };
+
+  explicit TestHibernatableTd(Scenario scenario) : scenario_(scenario) {
+  }
+
+ private:
+  struct ClientState {
+    std::map<td::uint64, td::int32> results;
+    std::map<td::uint64, td::int32> errors;
+    int update_count = 0;
+    bool is_closed = false;
+  };
+
+  class Callback final : public td::TdCallback {
+   public:
+    explicit Callback(std::shared_ptr<ClientState> state) : state_(std::move(state)) {
+    }
+    void on_result(std::uint64_t id, td::td_api::object_ptr<td::td_api::Object> result) final {
+      if (id == 0) {
+        state_->update_count++;
+      } else {
+        CHECK(state_->results.emplace(id, result->get_id()).second);
+      }
+    }
+    void on_error(std::uint64_t id, td::td_api::object_ptr<td::td_api::error> error) final {
+      CHECK(state_->errors.emplace(id, error->code_).second);
+    }
+    Callback(const Callback &) = delete;
+    Callback &operator=(const Callback &) = delete;
+    Callback(Callback &&) = delete;
+    Callback &operator=(Callback &&) = delete;
+    ~Callback() final {
+      state_->is_closed = true;
+    }
+
+   private:
+    std::shared_ptr<ClientState> state_;
+  };
+
+  Scenario scenario_;
+  std::shared_ptr<FakeTdState> td_state_ = std::make_shared<FakeTdState>();
+  std::shared_ptr<ClientState> client_state_ = std::make_shared<ClientState>();
+  td::ActorOwn<td::HibernatableTd<FakeTd>> hibernatable_td_;
+  int step_ = 0;
+
+  static constexpr double IDLE_TIMEOUT = 0.05;
+
+  void start_up() final {
+    FakeTd::Options options;
+    options.state = td_state_;
+    options.close_delay = scenario_ == Scenario::CloseWhileHibernating ? 0.2 : 0.01;
+    options.resume_delay = scenario_ == Scenario::HangupWhileResuming ? 10.0 : 0.0;
+    hibernatable_td_ = td::create_actor<td::HibernatableTd<FakeTd>>(
+        "HibernatableTd", td::make_unique<Callback>(client_state_), std::move(options), IDLE_TIMEOUT);
+    send_request(1, td::td_api::make_object<td::td_api::setTdlibParameters>());
+    if (scenario_ == Scenario::ChangeKey) {
+      // the database must be reopened with the new key after hibernation
+      send_request(4, td::td_api::make_object<td::td_api::setDatabaseEncryptionKey>("new key"));
+    }
+    set_timeout_in(0.01);
+  }
+
+  void send_request(td::uint64 id, td::td_api::object_ptr<td::td_api::Function> function) {
+    send_closure(hibernatable_td_, &td::HibernatableTd<FakeTd>::request, id, std::move(function));
+  }
+
+  void timeout_expired() final {
+    if (client_state_->is_closed) {
+      return check_result();
+    }
+    switch (step_) {
+      case 0:
+        // wait for the start of hibernation
+        if (td_state_->hangup_count == 1) {
+          if (scenario_ == Scenario::CloseWhileHibernating) {
+            ASSERT_EQ(0, td_state_->destroyed_count);
+            send_request(2, td::td_api::make_object<td::td_api::getAuthorizationState>());
+            send_request(3, td::td_api::make_object<td::td_api::close>());
+            step_ = 2;
+          } else {
+            step_ = 1;
+          }
+        }
+        break;
+      case 1:
+        // wait for the end of hibernation
+        if (td_state_->destroyed_count == 1) {
+          send_request(2, td::td_api::make_object<td::td_api::getAuthorizationState>());
+          if (scenario_ == Scenario::HangupWhileResuming) {
+            hibernatable_td_.reset();
+          }
+          step_ = 2;
+        }
+        break;
+      case 2:
+        if ((scenario_ == Scenario::Close || scenario_ == Scenario::ChangeKey) &&
+            (client_state_->results.count(2) != 0 || client_state_->errors.count(2) != 0)) {
+          ASSERT_EQ(2, td_state_->created_count);
+          send_request(3, td::td_api::make_object<td::td_api::close>());
+          step_ = 3;
+        }
+        break;
+      default:
+        break;
+    }
+    set_timeout_in(0.01);
+  }
+
+  void check_result() {
+    ASSERT_EQ(1, client_state_->update_count);
+    ASSERT_EQ(td::td_api::ok::ID, client_state_->results[1]);
+    switch (scenario_) {
+      case Scenario::Close:
+        ASSERT_EQ(3u, client_state_->results.size());
+        ASSERT_EQ(td::td_api::ok::ID, client_state_->results[2]);
+        ASSERT_EQ(td::td_api::ok::ID, client_state_->results[3]);
+        ASSERT_TRUE(client_state_->errors.empty());
+        break;
+      case Scenario::CloseWhileHibernating:
+        ASSERT_EQ(1u, client_state_->results.size());
+        ASSERT_EQ(2u, client_state_->errors.size());
+        ASSERT_EQ(500, client_state_->errors[2]);
+        ASSERT_EQ(500, client_state_->errors[3]);
+        break;
+      case Scenario::HangupWhileResuming:
+        ASSERT_EQ(1u, client_state_->results.size());
+        ASSERT_EQ(1u, client_state_->errors.size());
+        ASSERT_EQ(500, client_state_->errors[2]);
+        break;
+      case Scenario::ChangeKey:
+        ASSERT_EQ(4u, client_state_->results.size());
+        ASSERT_EQ(td::td_api::ok::ID, client_state_->results[2]);
+        ASSERT_EQ(td::td_api::ok::ID, client_state_->results[3]);
+        ASSERT_EQ(td::td_api::ok::ID, client_state_->results[4]);
+        ASSERT_TRUE(client_state_->errors.empty());
+        ASSERT_EQ("new key", td_state_->database_encryption_key);
+        break;
+      default:
+        UNREACHABLE();
+    }
+    ASSERT_EQ(td_state_->created_count, td_state_->destroyed_count);
+    td::Scheduler::instance()->finish();
+    stop();
+  }
+};
+
+constexpr double TestHibernatableTd::IDLE_TIMEOUT;
+
+TEST(Client, HibernatableTd) {
+  for (auto scenario : {TestHibernatableTd::Scenario::Close, TestHibernatableTd::Scenario::CloseWhileHibernating,
+                        TestHibernatableTd::Scenario::HangupWhileResuming, TestHibernatableTd::Scenario::ChangeKey}) {
+    td::ConcurrentScheduler sched(0, 0);
+    sched.create_actor_unsafe<TestHibernatableTd>(0, "TestHibernatableTd", scenario).release();
+    sched.start();
+    while (sched.run_main(10)) {
+    }
+    sched.finish();
+  }
+}
+
 TEST(PartsManager, hands) {
   {
     td::PartsManager pm;